@@ -0,0 +1,74 @@
+#include <AnimationClip.hpp>
+#include <KeyframeCollection.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Bake .animation files into .clip files, loaded instead of them by tortuekaizen.
+// Usage: bake_animations [--rate samples_per_second] [--tolerance error] file.animation...
+// A track which cannot be baked within the tolerance, for instance with constant
+// interpolations, is not written and keeps its keyframes.
+int main(int argc, char* argv[])
+{
+	float rate = 30.0f;
+	float tolerance = 1e-2f;
+	int baked = 0, skipped = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--rate" && i + 1 < argc)
+		{
+			rate = std::atof(argv[++i]);
+			continue;
+		}
+		if (arg == "--tolerance" && i + 1 < argc)
+		{
+			tolerance = std::atof(argv[++i]);
+			continue;
+		}
+
+		KeyframeCollection keyframes;
+		keyframes.addFromFile(arg, 0.0f);
+		if (keyframes.empty())
+		{
+			std::cerr << arg << ": no keyframe" << std::endl;
+			++skipped;
+			continue;
+		}
+
+		AnimationClip clip;
+		float error = clip.bake(keyframes, rate, tolerance);
+		std::cout << arg << ": " << clip.getSampleCount() << " samples, " << clip.getMemorySize()
+		          << " bytes, error " << error;
+		if (error > tolerance)
+		{
+			std::cout << ", above the tolerance: skipped" << std::endl;
+			++skipped;
+			continue;
+		}
+
+		std::string clip_path = arg;
+		size_t extension = clip_path.rfind(".animation");
+		if (extension != std::string::npos)
+			clip_path.erase(extension);
+		clip_path += ".clip";
+		if (!clip.saveToFile(clip_path))
+		{
+			std::cout << std::endl;
+			std::cerr << "Error: cannot write " << clip_path << std::endl;
+			++skipped;
+			continue;
+		}
+		std::cout << " -> " << clip_path << std::endl;
+		++baked;
+	}
+
+	if (baked + skipped == 0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [--rate samples_per_second] [--tolerance error] file.animation..." << std::endl;
+		return 1;
+	}
+	std::cout << baked << " clips baked, " << skipped << " tracks skipped" << std::endl;
+	return 0;
+}
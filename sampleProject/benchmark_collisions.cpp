@@ -0,0 +1,110 @@
+#include <dynamics/ConstantForceField.hpp>
+#include <dynamics/DynamicSystem.hpp>
+#include <dynamics/EulerExplicitSolver.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Build a cloud of particles falling on a ground, as dense as the explosion of the movie
+static DynamicSystemPtr build_system(size_t count, bool broadphase)
+{
+	DynamicSystemPtr system = std::make_shared<DynamicSystem>();
+	system->setDt(1.0f / 240.0f);
+	system->setSolver(std::make_shared<EulerExplicitSolver>());
+	system->setRestitution(0.6f);
+	system->setBroadphase(broadphase);
+
+	// About 1500 particles per unit of volume
+	float side = std::cbrt(count / 1500.0f);
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> position(-0.5f * side, 0.5f * side);
+	std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> radius(0.02f, 0.04f);
+	std::vector<ParticlePtr> particles;
+	for (size_t i = 0; i < count; ++i)
+	{
+		glm::vec3 p(position(generator), position(generator) + 0.5f * side, position(generator));
+		glm::vec3 v(velocity(generator), velocity(generator), velocity(generator));
+		particles.push_back(std::make_shared<Particle>(p, v, 1.0f, radius(generator)));
+		system->addParticle(particles.back());
+	}
+	system->addForceField(std::make_shared<ConstantForceField>(particles, DynamicSystem::gravity));
+	system->addPlaneObstacle(std::make_shared<Plane>(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f)));
+	return system;
+}
+
+// Time the simulation steps of a system, in milliseconds per step
+static double time_steps(const DynamicSystemPtr& system, int steps)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int s = 0; s < steps; ++s)
+		system->computeSimulationStep();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+}
+
+// Compare the simulation steps with and without the broadphase of the particle
+// particle collisions, for several numbers of particles. Both must give the
+// same particles at the end.
+// Usage: benchmark_collisions [--steps count] [--max-brute-force count] [particle count...]
+// The brute force is skipped above --max-brute-force particles, 20000 by default.
+int main(int argc, char* argv[])
+{
+	int steps = 20;
+	size_t maxBruteForce = 20000;
+	std::vector<size_t> counts;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--steps" && i + 1 < argc)
+		{
+			steps = std::max(1, std::atoi(argv[++i]));
+			continue;
+		}
+		if (arg == "--max-brute-force" && i + 1 < argc)
+		{
+			maxBruteForce = std::strtoul(argv[++i], nullptr, 10);
+			continue;
+		}
+		size_t count = std::strtoul(arg.c_str(), nullptr, 10);
+		if (count == 0)
+		{
+			std::cerr << "Usage: " << argv[0] << " [--steps count] [--max-brute-force count] [particle count...]" << std::endl;
+			return 1;
+		}
+		counts.push_back(count);
+	}
+	if (counts.empty())
+		counts = {500, 2000, 10000, 50000};
+
+	bool same = true;
+	for (size_t count : counts)
+	{
+		DynamicSystemPtr grid = build_system(count, true);
+		double gridTime = time_steps(grid, steps);
+		std::cout << count << " particles: broadphase " << gridTime << " ms/step";
+
+		if (count <= maxBruteForce)
+		{
+			DynamicSystemPtr bruteForce = build_system(count, false);
+			double bruteForceTime = time_steps(bruteForce, steps);
+			std::cout << ", brute force " << bruteForceTime << " ms/step, x" << bruteForceTime / gridTime;
+
+			DynamicSystem::State gridState, bruteForceState;
+			grid->saveState(gridState);
+			bruteForce->saveState(bruteForceState);
+			if (gridState.positions != bruteForceState.positions || gridState.velocities != bruteForceState.velocities)
+			{
+				std::cout << ", different particles";
+				same = false;
+			}
+		}
+		std::cout << std::endl;
+	}
+	return same ? 0 : 1;
+}
@@ -1,9 +1,21 @@
 #include <FrameRenderable.hpp>
+#include <Io.hpp>
 #include <ShaderProgram.hpp>
 #include <Utils.hpp>
 #include <Viewer.hpp>
+#include <cmath>
 #include <iostream>
+#include <texturing/MorphMeshRenderable.hpp>
 #include <texturing/TexturedMeshRenderable.hpp>
+#include <texturing/VertexAnimatedMeshRenderable.hpp>
+
+// Swing of the fish of nonRigidVertex.glsl: x += w(z) * sin(4 * time + 2 * z)
+static float swing_weight(float z)
+{
+	// head is at (0,0,1), tail at (0,0,-1), and the tail swings more than the head
+	float tail_weight = -0.5f * z + 0.5f;
+	return 0.1f + 0.4f * std::pow(tail_weight, 3.0f);
+}
 
 void initialize_scene(Viewer& viewer)
 {
@@ -23,6 +35,61 @@ void initialize_scene(Viewer& viewer)
 	std::string fish_texture_path = "../../sfmlGraphicsPipeline/textures/fish_texture.png";
 	auto fish = std::make_shared<TexturedMeshRenderable>(nonRigidShader, fish_mesh_path, fish_texture_path);
 	viewer.addRenderable(fish);
+
+	// The same swing with morph targets and with a vertex animation texture.
+	// These programs are not registered for the depth pre-pass: their vertex
+	// shaders move the vertices.
+	ShaderProgramPtr morphShader = std::make_shared<ShaderProgram>("../../sfmlGraphicsPipeline/shaders/morphVertex.glsl",
+	                                                               "../../sfmlGraphicsPipeline/shaders/nonRigidFragment.glsl");
+	ShaderProgramPtr vatShader = std::make_shared<ShaderProgram>("../../sfmlGraphicsPipeline/shaders/vatVertex.glsl",
+	                                                             "../../sfmlGraphicsPipeline/shaders/nonRigidFragment.glsl");
+	viewer.addShaderProgram(morphShader);
+	viewer.addShaderProgram(vatShader);
+
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> tcoords;
+	std::vector<unsigned int> indices;
+	read_obj(fish_mesh_path, positions, indices, normals, tcoords);
+
+	// sin(4t + 2z) = sin(4t) cos(2z) + cos(4t) sin(2z): two targets weighted by sin(4t) and cos(4t)
+	std::vector<glm::vec3> cosine_shape(positions), sine_shape(positions);
+	for (size_t v = 0; v < positions.size(); ++v)
+	{
+		float z = positions[v].z;
+		cosine_shape[v].x += swing_weight(z) * std::cos(2.0f * z);
+		sine_shape[v].x += swing_weight(z) * std::sin(2.0f * z);
+	}
+	auto morphFish = std::make_shared<MorphMeshRenderable>(morphShader, fish_mesh_path, fish_texture_path);
+	morphFish->setGlobalTransform(getTranslationMatrix(glm::vec3(1.5, 0, 0)));
+	int cosine_target = morphFish->addMorphTarget("cosine", cosine_shape, std::vector<glm::vec3>());
+	int sine_target = morphFish->addMorphTarget("sine", sine_shape, std::vector<glm::vec3>());
+	const float period = M_PI / 2.0f;
+	const int steps = 32;
+	for (int i = 0; i <= 8 * steps; ++i)
+	{
+		float time = i * period / steps;
+		morphFish->addWeightKeyframe(cosine_target, std::sin(4.0f * time), time);
+		morphFish->addWeightKeyframe(sine_target, std::cos(4.0f * time), time);
+	}
+	viewer.addRenderable(morphFish);
+	// The weight keyframes cover eight periods: the animation restarts after them
+	viewer.setAnimationLoop(true, 8 * period);
+
+	// One period baked at 30 frames per second and looped
+	auto vatFish = std::make_shared<VertexAnimatedMeshRenderable>(vatShader, fish_mesh_path, fish_texture_path);
+	vatFish->setGlobalTransform(getTranslationMatrix(glm::vec3(-1.5, 0, 0)));
+	const float frame_rate = 30.0f;
+	const int frames = int(std::round(period * frame_rate));
+	for (int f = 0; f < frames; ++f)
+	{
+		float time = f * period / frames;
+		std::vector<glm::vec3> frame(positions);
+		for (size_t v = 0; v < positions.size(); ++v)
+			frame[v].x += swing_weight(positions[v].z) * std::sin(4.0f * time + 2.0f * positions[v].z);
+		vatFish->addFrame(frame, normals);
+	}
+	vatFish->setPlayback(frames / period);
+	viewer.addRenderable(vatFish);
 }
 
 int main()
@@ -0,0 +1,49 @@
+#include <KeyframeCollection.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Remove the duplicate and redundant keyframes of .animation files, and print
+// how many were removed from each file.
+// Usage: reduce_animations [--tolerance distance] [--angle radians] [--write] file.animation...
+// Without --write, the files are left unchanged.
+int main(int argc, char* argv[])
+{
+	float tolerance = 1e-3f;
+	float angle = 1e-3f;
+	bool write = false;
+	int files = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--tolerance" && i + 1 < argc)
+		{
+			tolerance = std::atof(argv[++i]);
+			continue;
+		}
+		if (arg == "--angle" && i + 1 < argc)
+		{
+			angle = std::atof(argv[++i]);
+			continue;
+		}
+		if (arg == "--write")
+		{
+			write = true;
+			continue;
+		}
+
+		// The reduction of the import logs the counts and writes the file back
+		KeyframeCollection::setImportReduction(tolerance, angle, write);
+		KeyframeCollection keyframes;
+		keyframes.addFromFile(arg, 0.0f);
+		++files;
+	}
+
+	if (files == 0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [--tolerance distance] [--angle radians] [--write] file.animation..." << std::endl;
+		return 1;
+	}
+	return 0;
+}
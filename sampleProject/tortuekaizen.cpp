@@ -1,7 +1,11 @@
+#include <AnimationClip.hpp>
 #include <CylinderMeshRenderable.hpp>
 #include <FrameRenderable.hpp>
+#include <Io.hpp>
+#include <KeyframeCollection.hpp>
 #include <MeshRenderable.hpp>
 #include <ShaderProgram.hpp>
+#include <Skeleton.hpp>
 #include <Viewer.hpp>
 #include <dynamics/ConstantForceField.hpp>
 #include <dynamics/DampingForceField.hpp>
@@ -18,13 +22,32 @@
 #include <lighting/LightedMeshRenderable.hpp>
 #include <lighting/PointLightRenderable.hpp>
 #include <texturing/CubeMapRenderable.hpp>
+#include <texturing/SkinnedMeshRenderable.hpp>
 #include <texturing/TexturedLightedMeshRenderable.hpp>
 
+// Animate an object with its baked clip if there is one, see bake_animations.cpp
+void add_animation(const KeyframedHierarchicalRenderablePtr& obj, const std::string& name)
+{
+	AnimationClipPtr clip = std::make_shared<AnimationClip>();
+	if (clip->loadFromFile("../Animation/" + name + ".clip"))
+	{
+		obj->setClip(clip, false);
+		return;
+	}
+	std::string anim_path = "../Animation/" + name + ".animation";
+	std::ifstream anim_file(anim_path);
+	if (anim_file.good())
+	{
+		obj->addKeyframesFromFile(anim_path, 0.0, false);
+	}
+}
+
 LightedMeshRenderablePtr add_object(Viewer& viewer,
                                     const std::string& name,
                                     const MaterialPtr& material,
                                     ShaderProgramPtr& shaderProgram,
-                                    HierarchicalRenderablePtr parent = nullptr)
+                                    HierarchicalRenderablePtr parent = nullptr,
+                                    bool deferred = false)
 {
 	std::string obj_path = "../ObjFiles/" + name + ".obj";
 	std::ifstream file(obj_path);
@@ -33,18 +56,18 @@ LightedMeshRenderablePtr add_object(Viewer& viewer,
 		std::cerr << "Error: File " << obj_path << " does not exist." << std::endl;
 		return nullptr;
 	}
-	auto obj = std::make_shared<LightedMeshRenderable>(shaderProgram, obj_path, material);
+	auto obj = std::make_shared<LightedMeshRenderable>(shaderProgram, obj_path, material, deferred);
+	obj->setName(name);
 	if (parent != nullptr)
 	{
 		HierarchicalRenderable::addChild(parent, obj, true);
 	}
-	std::string anim_path = "../Animation/" + name + ".animation";
-	std::ifstream anim_file(anim_path);
-	if (anim_file.good())
+	add_animation(obj, name);
+	// A child is drawn and animated by its parent
+	if (parent == nullptr)
 	{
-		obj->addKeyframesFromFile(anim_path, 0.0, false);
+		viewer.addRenderable(obj);
 	}
-	viewer.addRenderable(obj);
 
 	return obj;
 }
@@ -54,7 +77,8 @@ TexturedLightedMeshRenderablePtr add_textured_object(Viewer& viewer,
                                                      const MaterialPtr& material,
                                                      const std::string& texture_path,
                                                      ShaderProgramPtr& shaderProgram,
-                                                     HierarchicalRenderablePtr parent = nullptr)
+                                                     HierarchicalRenderablePtr parent = nullptr,
+                                                     bool deferred = false)
 {
 	std::string obj_path = "../ObjFiles/" + name + ".obj";
 	std::ifstream file(obj_path);
@@ -63,22 +87,57 @@ TexturedLightedMeshRenderablePtr add_textured_object(Viewer& viewer,
 		std::cerr << "Error: File " << obj_path << " does not exist." << std::endl;
 		return nullptr;
 	}
-	auto obj = std::make_shared<TexturedLightedMeshRenderable>(shaderProgram, obj_path, material, texture_path);
+	auto obj = std::make_shared<TexturedLightedMeshRenderable>(shaderProgram, obj_path, material, texture_path, deferred);
+	obj->setName(name);
 	if (parent != nullptr)
 	{
 		HierarchicalRenderable::addChild(parent, obj, true);
 	}
-	std::string anim_path = "../Animation/" + name + ".animation";
-	std::ifstream anim_file(anim_path);
-	if (anim_file.good())
+	add_animation(obj, name);
+	// A child is drawn and animated by its parent
+	if (parent == nullptr)
 	{
-		obj->addKeyframesFromFile(anim_path, 0.0, false);
+		viewer.addRenderable(obj);
 	}
-	viewer.addRenderable(obj);
 
 	return obj;
 }
 
+// A character made of rigid parts: the first one is the root of the skeleton, the others its children
+SkinnedMeshRenderablePtr add_skinned_object(Viewer& viewer,
+                                            const std::vector<std::string>& parts,
+                                            const MaterialPtr& material,
+                                            const std::string& texture_path,
+                                            ShaderProgramPtr& shaderProgram)
+{
+	SkeletonPtr skeleton = std::make_shared<Skeleton>();
+	for (size_t i = 0; i < parts.size(); ++i)
+	{
+		int joint = skeleton->addJoint(parts[i], i == 0 ? -1 : 0, read_obj_transform("../ObjFiles/" + parts[i] + ".obj"));
+		AnimationClipPtr clip = std::make_shared<AnimationClip>();
+		if (clip->loadFromFile("../Animation/" + parts[i] + ".clip"))
+		{
+			skeleton->setClip(joint, clip);
+			continue;
+		}
+		std::string anim_path = "../Animation/" + parts[i] + ".animation";
+		std::ifstream anim_file(anim_path);
+		if (anim_file.good())
+		{
+			skeleton->addKeyframesFromFile(joint, anim_path, 0.0);
+		}
+	}
+
+	auto obj = std::make_shared<SkinnedMeshRenderable>(shaderProgram, skeleton, material, texture_path);
+	obj->setName(parts[0]);
+	for (size_t i = 0; i < parts.size(); ++i)
+	{
+		obj->addRigidPart("../ObjFiles/" + parts[i] + ".obj", i);
+	}
+	viewer.addRenderable(obj);
+	return obj;
+}
+
 void initialize_scene(Viewer& viewer, RadialImpulseForceFieldPtr& explosion, MushroomForceFieldPtr& mushroom, PointLightPtr& explosion_light, LightedMeshRenderablePtr& filter)
 {
 	// Shaders
@@ -95,6 +154,18 @@ void initialize_scene(Viewer& viewer, RadialImpulseForceFieldPtr& explosion, Mus
 	viewer.addShaderProgram(cubeMapShader);
 	viewer.addShaderProgram(cartoonTextureShader);
 	viewer.addShaderProgram(cartoonShader);
+	// Skinned meshes are neither pre-passed nor deferred: those programs do not skin the vertices
+	ShaderProgramPtr skinningShader = std::make_shared<ShaderProgram>(
+	    "../../sfmlGraphicsPipeline/shaders/skinningVertex.glsl",
+	    "../../sfmlGraphicsPipeline/shaders/cartoonTextureFragment.glsl");
+	viewer.addShaderProgram(skinningShader);
+	// Opaque cartoon objects can be shaded by the deferred renderer (F9)
+	viewer.addDeferredShaderProgram(cartoonShader, DeferredRenderer::CARTOON);
+	viewer.addDeferredShaderProgram(cartoonTextureShader, DeferredRenderer::CARTOON);
+	// Opaque cartoon objects are shaded once per pixel thanks to a depth pre-pass (F10)
+	viewer.addDepthPrepassShaderProgram(cartoonShader);
+	viewer.addDepthPrepassShaderProgram(cartoonTextureShader, 0.8f);  // same cutoff as cartoonTextureFragment.glsl
+	viewer.setDepthPrepass(true);
 
 	// Materials
 	MaterialPtr nolighting = Material::NoLighting();
@@ -130,13 +201,18 @@ void initialize_scene(Viewer& viewer, RadialImpulseForceFieldPtr& explosion, Mus
 	auto skipper = add_textured_object(viewer, "Skipper", white, "../Textures/Skipper.png", cartoonTextureShader);
 	auto vietnam = add_object(viewer, "Red Beach Vietnam", red, cartoonShader);
 
-	auto house2 = add_object(viewer, "maison.001", white, cartoonShader);
-	auto clock = add_textured_object(viewer, "Clock", nolighting, "../Textures/clock.jpg", cartoonTextureShader);
-	auto hour_hand = add_object(viewer, "Hours", white, cartoonShader, clock);
-	auto minute_hand = add_object(viewer, "Minutes", white, cartoonShader, clock);
-	auto bed_frame = add_object(viewer, "BedFrame", bark, cartoonShader);
-	auto bed_sheets = add_object(viewer, "BedSheets", white, cartoonShader);
-	auto sakado = add_object(viewer, "Sakado", darkgreen, cartoonShader);
+	// The bedroom is only in view from 31.55 s to 47.78 s: it is loaded around this scene
+	auto house2 = add_object(viewer, "maison.001", white, cartoonShader, nullptr, true);
+	auto clock = add_textured_object(viewer, "Clock", nolighting, "../Textures/clock.jpg", cartoonTextureShader, nullptr, true);
+	auto hour_hand = add_object(viewer, "Hours", white, cartoonShader, clock, true);
+	auto minute_hand = add_object(viewer, "Minutes", white, cartoonShader, clock, true);
+	auto bed_frame = add_object(viewer, "BedFrame", bark, cartoonShader, nullptr, true);
+	auto bed_sheets = add_object(viewer, "BedSheets", white, cartoonShader, nullptr, true);
+	auto sakado = add_object(viewer, "Sakado", darkgreen, cartoonShader, nullptr, true);
+	for (const MeshRenderablePtr& obj : std::vector<MeshRenderablePtr>{house2, clock, bed_frame, bed_sheets, sakado})
+		obj->addActiveInterval(31.5f, 47.8f);
+	for (const MeshRenderablePtr& obj : std::vector<MeshRenderablePtr>{house2, clock, hour_hand, minute_hand, bed_frame, bed_sheets, sakado})
+		viewer.getAssetResidency().add(obj);
 
 	// Militaire
 	auto soldats = add_object(viewer, "Soldats", green, cartoonShader);
@@ -146,7 +222,10 @@ void initialize_scene(Viewer& viewer, RadialImpulseForceFieldPtr& explosion, Mus
 	auto tank3 = add_object(viewer, "Tank.003", green, cartoonShader);
 	auto tank4 = add_object(viewer, "Tank.004", green, cartoonShader);
 	auto avion = add_object(viewer, "Avion", green, cartoonShader);
-	auto bombe = add_textured_object(viewer, "Bombe", white, "../Textures/Bombe.png", cartoonTextureShader);
+	// The bomb is only in view from 89.74 s to 96.59 s
+	auto bombe = add_textured_object(viewer, "Bombe", white, "../Textures/Bombe.png", cartoonTextureShader, nullptr, true);
+	bombe->addActiveInterval(89.7f, 96.6f);
+	viewer.getAssetResidency().add(bombe);
 
 	// Tortues marines
 	auto shell = add_textured_object(viewer, "Carapace.001", white, "../Textures/Tortue_bleue.png", cartoonTextureShader);
@@ -156,12 +235,9 @@ void initialize_scene(Viewer& viewer, RadialImpulseForceFieldPtr& explosion, Mus
 	auto nag_avg = add_textured_object(viewer, "Nag-AvG.001", white, "../Textures/Tortue_bleue.png", cartoonTextureShader, shell);
 	auto tete = add_textured_object(viewer, "Tete.001", white, "../Textures/Tortue_bleue.png", cartoonTextureShader, shell);
 
-	auto shell2 = add_textured_object(viewer, "Carapace.002", white, "../Textures/Tortue_orange.png", cartoonTextureShader);
-	auto nag_ard2 = add_textured_object(viewer, "Nag-ArD.002", white, "../Textures/Tortue_orange.png", cartoonTextureShader, shell2);
-	auto nag_arg2 = add_textured_object(viewer, "Nag-ArG.002", white, "../Textures/Tortue_orange.png", cartoonTextureShader, shell2);
-	auto nag_avd2 = add_textured_object(viewer, "Nag-AvD.002", white, "../Textures/Tortue_orange.png", cartoonTextureShader, shell2);
-	auto nag_avg2 = add_textured_object(viewer, "Nag-AvG.002", white, "../Textures/Tortue_orange.png", cartoonTextureShader, shell2);
-	auto tete2 = add_textured_object(viewer, "Tete.002", white, "../Textures/Tortue_orange.png", cartoonTextureShader, shell2);
+	// One mesh and one draw for the whole turtle, each part is bound to a joint of its skeleton
+	auto turtle2 = add_skinned_object(viewer, {"Carapace.002", "Nag-ArD.002", "Nag-ArG.002", "Nag-AvD.002", "Nag-AvG.002", "Tete.002"},
+	                                  white, "../Textures/Tortue_orange.png", skinningShader);
 
 	auto tear = add_object(viewer, "Larme", water, cartoonShader);
 
@@ -206,12 +282,16 @@ void initialize_scene(Viewer& viewer, RadialImpulseForceFieldPtr& explosion, Mus
 	viewer.addPointLight(house_light1);
 	viewer.addPointLight(explosion_light);
 
+	// The meshes of a scene are read 3 seconds before it
+	viewer.getAssetResidency().setPrefetchTime(3.0f);
+
 	// Camera
 	viewer.getCamera().setFov(0.5);
 	viewer.getCamera().addKeyframesFromFile("../Animation/Camera.animation", 0.0, false);
 
-	// Blue filter
+	// Blue filter, shown over the flashback
 	filter = add_object(viewer, "Filter", nolightingblue, cartoonShader);
+	filter->addActiveInterval(2.6666f, 66.7f);
 
 	// Soundtrack
 	viewer.setSoundtrack("../tortuekaizen.wav");
@@ -279,6 +359,13 @@ void initialize_scene(Viewer& viewer, RadialImpulseForceFieldPtr& explosion, Mus
 	// Renderables bound to the dynamic system
 	auto systemRenderable = std::make_shared<DynamicSystemRenderable>(system);
 	systemRenderable->setStartTime(92.87f);
+	// The blast is part of the simulation, so that it is replayed when seeking back
+	RadialImpulseForceFieldPtr blast = explosion;
+	MushroomForceFieldPtr cloud = mushroom;
+	systemRenderable->addEvent(95.87f, [blast, cloud]() {
+		blast->trigger();
+		cloud->trigger();
+	});
 	viewer.addRenderable(systemRenderable);
 
 	auto particlesRenderable = std::make_shared<ParticleListRenderable>(particleShader, particles, 12u, 16u);
@@ -292,6 +379,8 @@ int main()
 	glm::vec4 background_color(0.8, 0.8, 0.8, 1);
 	Viewer viewer(background_color);
 	viewer.setTimeFactor(1.004f);  // Correct weird audio sync issue
+	// Drop the duplicate and redundant keyframes of the exported animations
+	KeyframeCollection::setImportReduction(1e-3f, 1e-3f);
 	RadialImpulseForceFieldPtr explosion;
 	MushroomForceFieldPtr mushroom;
 	PointLightPtr explosion_light;
@@ -301,8 +390,6 @@ int main()
 	filter->setLocalTransform(getTranslationMatrix(0.0, 0.0, -0.1));
 
 	glm::vec3 explosion_color = glm::vec3(3.0, 2.0, 1.0);
-	float explosion_strength = 0.0f;
-	bool explosionTriggered = false;
 	while (viewer.isRunning())
 	{
 		if (viewer.getTime() >= 100.0f)  // End
@@ -311,31 +398,15 @@ int main()
 		}
 		viewer.handleEvent();
 		viewer.animate();
-		if (viewer.getTime() >= 95.87f)
-		{
-			if (!explosionTriggered)
-			{
-				if (explosion)
-					explosion->trigger();
-				if (mushroom)
-					mushroom->trigger();
-				explosionTriggered = true;
-			}
-			if (explosion_strength >= 0.0f)
-			{
-				explosion_strength = 10.0f - (viewer.getTime() - 95.87f) * 5.0f;
-				explosion_light->setDiffuse(explosion_color * std::max(explosion_strength, 0.0f));
-				explosion_light->setSpecular(explosion_color * std::max(explosion_strength, 0.0f));
-			}
-		}
-		if (viewer.getTime() >= 2.6666f && viewer.getTime() <= 66.7f)
+		// The flash of the explosion fades out in 2 seconds, it is given by the time for the seeks
+		float time = viewer.getTime();
+		float explosion_strength = time >= 95.87f ? std::max(10.0f - (time - 95.87f) * 5.0f, 0.0f) : 0.0f;
+		explosion_light->setDiffuse(explosion_color * explosion_strength);
+		explosion_light->setSpecular(explosion_color * explosion_strength);
+		if (filter->isActive())
 		{
 			filter->setGlobalTransform(viewer.getCamera().getGlobalTransform());
 		}
-		else
-		{
-			filter->setGlobalTransform(getTranslationMatrix(0.0, -50000.0, 0.0));  // Hide filter by moving it very very far
-		}
 
 		viewer.draw();
 		viewer.display();
@@ -0,0 +1,81 @@
+#ifndef ACTIVITY_TIMELINE_HPP
+#define ACTIVITY_TIMELINE_HPP
+
+/**@file
+ * @brief Define an index of the activity intervals of the renderables.
+ */
+
+#include <vector>
+
+#include "Renderable.hpp"
+
+/**@brief Interval index telling which renderables are active at a given time.
+ *
+ * A renderable with activity intervals, see Renderable::addActiveInterval(),
+ * is only active during them. The index holds the bounds of all the intervals
+ * as a sorted list of events, and a cursor after the events of the last time:
+ * when the time moves, only the events crossed since then are visited. Playing
+ * forward costs a constant time per frame, plus the renderables which start or
+ * stop; a seek visits the events between the two times.
+ *
+ * \sa Viewer::draw(), Viewer::animate()
+ */
+class ActivityTimeline
+{
+   public:
+	/**@brief Build an empty index.
+	 */
+	ActivityTimeline();
+
+	/**@brief Index the intervals of renderables.
+	 *
+	 * The renderables without interval are ignored, they are always active. The
+	 * cursor is put before the first event, where no indexed renderable is active.
+	 * @param renderables The renderables to index.
+	 */
+	void build(const std::vector<RenderablePtr>& renderables);
+
+	/**@brief Remove all the renderables.
+	 */
+	void clear();
+
+	/**@brief Move the cursor to a time.
+	 *
+	 * @param time The new time.
+	 * @param changed Output vector: the renderables whose activity changes are
+	 * appended to it with their new activity, in the order of the events. A
+	 * renderable may appear several times after a seek, its last entry holds
+	 * its activity at \a time.
+	 */
+	void update(float time, std::vector<std::pair<Renderable*, bool> >& changed);
+
+	/**@brief Get the number of indexed renderables.
+	 */
+	size_t size() const;
+
+   private:
+	ActivityTimeline(const ActivityTimeline&);
+	ActivityTimeline& operator=(const ActivityTimeline&);
+
+	/**@brief Bound of an interval.
+	 */
+	struct Event
+	{
+		float time;         /*!< Time of the bound. */
+		unsigned int node;  /*!< Index of the renderable in \ref m_nodes. */
+		bool start;         /*!< True for a start, false for an end. */
+
+		bool operator<(const Event& e) const
+		{
+			return time < e.time;
+		}
+	};
+
+	void apply(const Event& e, bool undo, std::vector<std::pair<Renderable*, bool> >& changed);
+
+	std::vector<RenderablePtr> m_nodes;  /*!< Indexed renderables. */
+	std::vector<Event> m_events;         /*!< Bounds of the intervals, by increasing time. */
+	size_t m_cursor;                     /*!< Number of events applied: those before the time of the cursor. */
+};
+
+#endif
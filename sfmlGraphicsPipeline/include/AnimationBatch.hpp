@@ -0,0 +1,99 @@
+#ifndef ANIMATION_BATCH_HPP
+#define ANIMATION_BATCH_HPP
+
+/**@file
+ * @brief Define a batch of animation tracks evaluated together.
+ */
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+#include "AnimationClip.hpp"
+#include "KeyframeCollection.hpp"
+
+/**@brief Samples of many animation tracks, composed into matrices at once.
+ *
+ * Each track is sampled into a slot of the batch, see sample(). The samples
+ * are stored as a structure of arrays: one array per component of the
+ * translations, orientations and scales. compose() then turns all of them into
+ * matrices with a SIMD kernel which handles 8 (AVX) or 4 (SSE2) tracks per
+ * iteration, chosen at runtime from the features of the processor, or a scalar
+ * loop on other architectures.
+ *
+ * Different slots can be sampled by different threads at once.
+ *
+ * \sa Viewer::animate()
+ */
+class AnimationBatch
+{
+   public:
+	/**@brief Build an empty batch.
+	 */
+	AnimationBatch();
+
+	/**@brief Set the number of tracks.
+	 *
+	 * The previous samples are lost.
+	 * @param count The number of slots.
+	 */
+	void resize(size_t count);
+
+	/**@brief Get the number of tracks.
+	 */
+	size_t size() const;
+
+	/**@brief Store the sample of a track.
+	 *
+	 * @param i The slot of the track.
+	 * @param translation The translation.
+	 * @param orientation The orientation, a unit quaternion.
+	 * @param scale The scale.
+	 */
+	void set(size_t i, const glm::vec3& translation, const glm::quat& orientation, const glm::vec3& scale);
+
+	/**@brief Sample keyframes into a slot.
+	 *
+	 * @param i The slot of the track.
+	 * @param keyframes The keyframes, not empty.
+	 * @param time The time of the sample.
+	 */
+	void sample(size_t i, const KeyframeCollection& keyframes, float time);
+
+	/**@brief Sample a clip into a slot.
+	 *
+	 * @param i The slot of the track.
+	 * @param clip The clip, not empty.
+	 * @param time The time of the sample.
+	 */
+	void sample(size_t i, const AnimationClip& clip, float time);
+
+	/**@brief Compose the matrices of all the tracks.
+	 *
+	 * The matrix of a track is the same as GeometricTransformation::toMatrix().
+	 * @param matrices Output: the matrices, in the order of the slots.
+	 */
+	void compose(std::vector<glm::mat4>& matrices) const;
+
+	/**@brief Get the name of the kernel used by compose(): "avx", "sse2" or "scalar".
+	 */
+	static const char* getKernelName();
+
+   private:
+	/**@brief Component arrays of the samples.
+	 */
+	enum Channel
+	{
+		TX, TY, TZ,
+		QX, QY, QZ, QW,
+		SX, SY, SZ,
+		CHANNEL_COUNT
+	};
+
+	float* channel(Channel c);
+
+	size_t m_size;               /*!< Number of tracks. */
+	std::vector<float> m_values; /*!< The arrays of each channel, one after the other. */
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef ANIMATION_CLIP_HPP
+#define ANIMATION_CLIP_HPP
+
+/**@file
+ * @brief Define a compact animation track, baked from keyframes.
+ */
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "KeyframeCollection.hpp"
+
+/**@brief Animation track resampled at a fixed rate and quantised.
+ *
+ * A clip is baked from a KeyframeCollection, see bake(): the translation,
+ * orientation and scale are sampled at a fixed rate, and each sample is
+ * quantised.
+ * - The translations and scales are stored on 16 bits per component, relative
+ * to the bounds of the track.
+ * - The orientations are stored on 48 bits with the smallest three encoding:
+ * the largest component of the unit quaternion is dropped, as it can be
+ * computed from the three others, and its index is kept on two bits.
+ * - A channel whose samples are all within the tolerance of the first one is
+ * constant, and only this value is stored.
+ *
+ * sample() decodes the two samples around a time and interpolates them
+ * linearly. The samples are found in a constant time, without any search.
+ *
+ * \sa KeyframedHierarchicalRenderable::setClip()
+ */
+class AnimationClip
+{
+   public:
+	/**@brief Build an empty clip.
+	 */
+	AnimationClip();
+
+	/**@brief Bake a clip from keyframes.
+	 *
+	 * The keyframes are sampled from their first time to their last one. If
+	 * the error of the clip is larger than the tolerance, the sample rate is
+	 * doubled, until it reaches \a maxSampleRate. The error is measured at the
+	 * samples and at several times between them.
+	 * @param keyframes The keyframes to bake.
+	 * @param sampleRate The initial number of samples per second.
+	 * @param tolerance The largest error allowed: a distance for the
+	 * translations and scales, an angle in radians for the orientations.
+	 * @param maxSampleRate The largest number of samples per second.
+	 * @return The error of the clip. It is larger than the tolerance if the
+	 * keyframes cannot be baked at \a maxSampleRate, for instance if they have
+	 * constant interpolations: the clip cannot jump between two samples.
+	 */
+	float bake(const KeyframeCollection& keyframes, float sampleRate, float tolerance, float maxSampleRate = 240.0f);
+
+	/**@brief Sample the transformation at a given time.
+	 *
+	 * @param time The time. Outside of the range of the clip, the closest
+	 * sample is returned.
+	 * @return The transformation, the identity if the clip is empty.
+	 */
+	glm::mat4 sample(float time) const;
+
+	/**@brief Sample the components of the transformation at a given time.
+	 *
+	 * @param time The time, the clip must not be empty.
+	 * @param translation Output: the translation.
+	 * @param orientation Output: the orientation.
+	 * @param scale Output: the scale.
+	 */
+	void sample(float time, glm::vec3& translation, glm::quat& orientation, glm::vec3& scale) const;
+
+	/**@brief Check if the clip is empty.
+	 */
+	bool empty() const;
+
+	/**@brief Get the time range of the clip.
+	 *
+	 * @param begin Output: the time of the first sample.
+	 * @param end Output: the time of the last sample.
+	 * @return False if the clip is empty.
+	 */
+	bool getTimeRange(float& begin, float& end) const;
+
+	/**@brief Get the number of samples of the clip.
+	 */
+	size_t getSampleCount() const;
+
+	/**@brief Get the size of the samples, in bytes.
+	 */
+	size_t getMemorySize() const;
+
+	/**@brief Load a clip written by saveToFile().
+	 *
+	 * @param filename The path to the clip file.
+	 * @return False if the file is missing or invalid, the clip is then empty.
+	 */
+	bool loadFromFile(const std::string& filename);
+
+	/**@brief Write the clip to a binary file.
+	 *
+	 * @param filename The path to the clip file.
+	 * @return False if the file cannot be written.
+	 */
+	bool saveToFile(const std::string& filename) const;
+
+   private:
+	/**@brief Quantised translations or scales.
+	 */
+	struct VectorChannel
+	{
+		glm::vec3 minimum;             /*!< Lower bound of the samples, or the value of a constant channel. */
+		glm::vec3 extent;              /*!< Size of the bounds of the samples. */
+		std::vector<uint16_t> samples; /*!< Three components per sample, empty for a constant channel. */
+
+		void encode(const std::vector<glm::vec3>& values, float tolerance);
+		glm::vec3 decode(size_t i) const;
+	};
+
+	/**@brief Orientations in the smallest three encoding.
+	 */
+	struct RotationChannel
+	{
+		glm::quat constant;            /*!< Value of a constant channel. */
+		std::vector<uint16_t> samples; /*!< Three words per sample, empty for a constant channel. */
+
+		void encode(const std::vector<glm::quat>& values, float tolerance);
+		glm::quat decode(size_t i) const;
+	};
+
+	void clear();
+
+	float m_startTime;           /*!< Time of the first sample. */
+	float m_sampleInterval;      /*!< Time between two samples. */
+	uint32_t m_sampleCount;      /*!< Number of samples, 0 for an empty clip. */
+	VectorChannel m_translation; /*!< Translation samples. */
+	RotationChannel m_rotation;  /*!< Orientation samples. */
+	VectorChannel m_scale;       /*!< Scale samples. */
+};
+
+typedef std::shared_ptr<AnimationClip> AnimationClipPtr; /*!< Typedef for a smart pointer of AnimationClip */
+
+#endif
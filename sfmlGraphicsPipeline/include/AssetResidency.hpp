@@ -0,0 +1,134 @@
+#ifndef ASSET_RESIDENCY_HPP
+#define ASSET_RESIDENCY_HPP
+
+/**@file
+ * @brief Define the loading and unloading of the meshes along the timeline.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MeshRenderable.hpp"
+
+/**@brief Keep in memory only the meshes needed around the current time.
+ *
+ * A mesh is needed during the activity intervals of the nearest renderable
+ * with intervals among itself and its ancestors, see
+ * Renderable::addActiveInterval(): outside of them, it is neither drawn nor
+ * animated. A mesh without such intervals is always needed.
+ *
+ * The files of a mesh needed in the next seconds, see setPrefetchTime(), are
+ * read by a background thread, and the mesh is sent to the GPU by update()
+ * once they are read. A mesh needed at the current time is loaded at once,
+ * waiting for the background thread if needed: this is counted as a stall.
+ * Once the time is past the last interval of a mesh, its memory is released;
+ * it is loaded again if the time goes back.
+ *
+ * The meshes should be built with a deferred loading, see
+ * MeshRenderable::MeshRenderable(), so that nothing is loaded before they are
+ * needed. A registered mesh must not be prefetched, loaded or released by
+ * anything else.
+ *
+ * \sa Viewer::getAssetResidency()
+ */
+class AssetResidency
+{
+   public:
+	/**@brief Build an empty manager.
+	 *
+	 * The background thread is started with the first mesh.
+	 */
+	AssetResidency();
+
+	/**@brief Stop the background thread.
+	 */
+	~AssetResidency();
+
+	/**@brief Manage the residency of a mesh read from a file.
+	 *
+	 * @param mesh The mesh. A mesh built from arrays is ignored.
+	 */
+	void add(const MeshRenderablePtr& mesh);
+
+	/**@brief Stop managing all the meshes.
+	 *
+	 * The meshes are left as they are.
+	 */
+	void clear();
+
+	/**@brief Set how long before its first use a mesh is read.
+	 *
+	 * @param seconds The prefetch time, 2 seconds by default.
+	 */
+	void setPrefetchTime(float seconds);
+
+	/**@brief Get how long before its first use a mesh is read.
+	 */
+	float getPrefetchTime() const;
+
+	/**@brief Load and release the meshes for a time.
+	 *
+	 * This sends data to the GPU: it must be called from the thread of the
+	 * OpenGL context, before the meshes are drawn.
+	 * @param time The current time.
+	 */
+	void update(float time);
+
+	/**@brief Get the number of managed meshes.
+	 */
+	size_t size() const;
+
+	/**@brief Get the number of managed meshes which are resident.
+	 */
+	size_t getResidentCount() const;
+
+	/**@brief Get the number of meshes which were needed before they were read.
+	 */
+	size_t getStallCount() const;
+
+   private:
+	AssetResidency(const AssetResidency&);
+	AssetResidency& operator=(const AssetResidency&);
+
+	/**@brief Residency of a managed mesh.
+	 */
+	enum State
+	{
+		RELEASED,   /*!< Nothing in memory. */
+		QUEUED,     /*!< Waiting to be read, or being read, by the background thread. */
+		PREFETCHED, /*!< Read, waiting to be sent to the GPU. */
+		RESIDENT    /*!< In memory and on the GPU. */
+	};
+
+	/**@brief A managed mesh.
+	 */
+	struct Asset
+	{
+		MeshRenderablePtr mesh;                          /*!< The mesh. */
+		std::vector<std::pair<float, float> > intervals; /*!< When it is needed, always if empty. */
+		State state;                                     /*!< Its residency, guarded by \ref m_mutex. */
+	};
+
+	void gather_intervals();
+	void run();
+
+	std::vector<Asset> m_assets;        /*!< Managed meshes. */
+	float m_prefetchTime;               /*!< How long before its first use a mesh is read. */
+	unsigned int m_intervalsRevision;   /*!< Value of Renderable::getAnimationRevision() for the intervals, 0 to gather them. */
+	size_t m_residentCount;             /*!< Number of resident meshes. */
+	size_t m_stallCount;                /*!< Number of meshes needed before they were read. */
+
+	std::thread m_worker;               /*!< Background thread reading the files. */
+	std::mutex m_mutex;                 /*!< Guard of the queue and of the states. */
+	std::condition_variable m_queued;   /*!< Signaled when a mesh is queued, or to stop. */
+	std::condition_variable m_read;     /*!< Signaled when a mesh has been read. */
+	std::deque<size_t> m_queue;         /*!< Indices of the meshes to read. */
+	int m_reading;                      /*!< Index of the mesh being read, -1 if none. */
+	bool m_stop;                        /*!< Tell the background thread to stop. */
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef BOUNDING_BOX_HPP
+#define BOUNDING_BOX_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/**@brief Axis aligned bounding box.
+ *
+ * Represent the smallest box, aligned with the axes, containing some geometry.
+ * A default constructed box is invalid: it contains nothing, and is used to
+ * tell that the bounds of a geometry are unknown.
+ */
+class BoundingBox
+{
+   public:
+	/**@brief Build an invalid box.
+	 */
+	BoundingBox();
+
+	/**@brief Build a box from its corners.
+	 *
+	 * @param min The corner of minimal coordinates.
+	 * @param max The corner of maximal coordinates.
+	 */
+	BoundingBox(const glm::vec3& min, const glm::vec3& max);
+
+	/**@brief Build the bounding box of points.
+	 *
+	 * @param points The points to bound. The box is invalid if there is none.
+	 */
+	explicit BoundingBox(const std::vector<glm::vec3>& points);
+
+	/**@brief Tell if the box contains something.
+	 */
+	bool isValid() const;
+
+	/**@brief Grow the box to contain a point.
+	 */
+	void extend(const glm::vec3& point);
+
+	/**@brief Grow the box to contain another box.
+	 */
+	void extend(const BoundingBox& box);
+
+	/**@brief Get the bounding box of this box transformed by a matrix.
+	 *
+	 * @param transform An affine transformation.
+	 * @return The axis aligned box containing the transformed box.
+	 */
+	BoundingBox transformed(const glm::mat4& transform) const;
+
+	/**@brief Get the corner of minimal coordinates.
+	 */
+	const glm::vec3& min() const;
+
+	/**@brief Get the corner of maximal coordinates.
+	 */
+	const glm::vec3& max() const;
+
+	/**@brief Get the center of the box.
+	 */
+	glm::vec3 center() const;
+
+	/**@brief Get the radius of the bounding sphere of the box.
+	 *
+	 * The bounding sphere is centered on center().
+	 */
+	float radius() const;
+
+	/**@brief Get the area of the surface of the box.
+	 */
+	float surfaceArea() const;
+
+	/**@brief Tell if the box contains another box.
+	 */
+	bool contains(const BoundingBox& box) const;
+
+	/**@brief Tell if the box intersects a sphere.
+	 *
+	 * @param center The center of the sphere.
+	 * @param radius The radius of the sphere.
+	 */
+	bool intersects(const glm::vec3& center, float radius) const;
+
+	/**@brief Intersect a ray with the box.
+	 *
+	 * The ray is the set of the points origin + t * direction, for t in [0, maxDistance].
+	 * @param origin The origin of the ray.
+	 * @param direction The direction of the ray, not necessarily normalized.
+	 * @param maxDistance The maximal value of t.
+	 * @param distance The value of t where the ray enters the box, 0 if the origin is inside.
+	 * @return True if the ray hits the box.
+	 */
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const;
+
+   private:
+	glm::vec3 m_min;
+	glm::vec3 m_max;
+};
+
+#endif
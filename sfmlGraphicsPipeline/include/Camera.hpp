@@ -291,6 +291,7 @@ class Camera : public KeyframedHierarchicalRenderable
 	void do_draw() {}
 
 	void do_animate(float time);
+	bool getAnimationRange(float& begin, float& end) const;
 
 	/** @name Private members */
 	CAMERA_BEHAVIOR m_behavior;
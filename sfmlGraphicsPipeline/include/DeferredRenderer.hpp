@@ -0,0 +1,123 @@
+#ifndef DEFERRED_RENDERER_HPP
+#define DEFERRED_RENDERER_HPP
+
+/**@file
+ * @brief Define a deferred renderer for lighted meshes.
+ *
+ * This file defines the DeferredRenderer class, an alternative to the forward
+ * rendering of the Viewer for opaque lighted meshes.
+ */
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Renderable.hpp"
+#include "ShaderProgram.hpp"
+#include "lighting/Material.hpp"
+
+/**@brief Shade opaque lighted meshes once per visible pixel.
+ *
+ * With the forward rendering, each fragment of a lighted mesh evaluates all
+ * the lights, even if it is overdrawn later by another mesh. A deferred
+ * renderer splits the rendering in two passes:
+ * \li a geometry pass draws the meshes in a G-buffer: color, normal, material
+ * index and depth of the visible surfaces;
+ * \li a lighting pass draws a full-screen triangle that reads the G-buffer and
+ * evaluates the lights once per pixel, see deferredLightingFragment.glsl.
+ *
+ * The renderer only takes the renderables whose shader program has been added
+ * with addShaderProgram(): this tells which forward shading it reproduces. A
+ * renderable is drawn by the renderer only if it is rendered in the window, is
+ * a LightedMeshRenderable or a TexturedLightedMeshRenderable with an opaque
+ * material, and if its children satisfy the same conditions. All the other
+ * renderables, including the transparent ones, are drawn by the forward path
+ * of the Viewer after the lighting pass, depth tested against the deferred
+ * surfaces.
+ *
+ * \sa Viewer::setDeferredShading()
+ */
+class DeferredRenderer
+{
+   public:
+	/**@brief Forward shading reproduced by the lighting pass.
+	 */
+	enum SHADING_MODEL
+	{
+		PHONG,   /*!< phongFragment.glsl and textureFragment.glsl */
+		CARTOON  /*!< cartoonFragment.glsl and cartoonTextureFragment.glsl */
+	};
+
+	/**@brief Build a deferred renderer.
+	 *
+	 * Load the shader programs of the renderer. The G-buffer is created at the
+	 * first draw. This needs a valid OpenGL context.
+	 */
+	DeferredRenderer();
+
+	/**@brief Instance destructor.
+	 */
+	~DeferredRenderer();
+
+	/**@brief Draw the renderables of a forward program with the deferred renderer.
+	 *
+	 * @param forwardProgram The forward program.
+	 * @param model The shading of the forward program.
+	 */
+	void addShaderProgram(const ShaderProgramPtr& forwardProgram, SHADING_MODEL model);
+
+	/**@brief Get the shader programs of the renderer.
+	 *
+	 * Those programs should be managed by the viewer, so that they receive the
+	 * lights and are reloaded with the other programs.
+	 * @return The geometry and lighting programs.
+	 */
+	const std::vector<ShaderProgramPtr>& getShaderPrograms() const;
+
+	/**@brief Draw the renderables that can be deferred.
+	 *
+	 * Fill the G-buffer with the renderables that can be deferred, then shade
+	 * them in the bound framebuffer. The depth of the deferred surfaces is
+	 * written in the depth buffer.
+	 * @param renderables The renderables to draw, in drawing order.
+	 * @param forward Output vector filled with the renderables that cannot be
+	 * deferred, in the same order.
+	 * @param projection The projection matrix of the camera.
+	 * @param view The view matrix of the camera.
+	 * @param width The width of the framebuffer.
+	 * @param height The height of the framebuffer.
+	 */
+	void draw(const std::vector<RenderablePtr>& renderables, std::vector<RenderablePtr>& forward,
+	          const glm::mat4& projection, const glm::mat4& view, unsigned int width, unsigned int height);
+
+   private:
+	DeferredRenderer(const DeferredRenderer&);
+	DeferredRenderer& operator=(const DeferredRenderer&);
+
+	typedef std::vector<std::pair<RenderablePtr, ShaderProgramPtr> > ProgramSwaps;
+
+	bool prepare(const RenderablePtr& renderable, ProgramSwaps& swaps);
+	void resize(unsigned int width, unsigned int height);
+	void release();
+
+	std::unordered_map<ShaderProgramPtr, SHADING_MODEL> m_forwardPrograms; /*!< Programs whose renderables can be deferred. */
+	ShaderProgramPtr m_geometryPrograms[2][2];                               /*!< G-buffer programs, by [textured][shading model]. */
+	ShaderProgramPtr m_lightingProgram;                                      /*!< Full-screen lighting program. */
+	std::vector<ShaderProgramPtr> m_programs;                                /*!< All the programs above. */
+	std::vector<MaterialPtr> m_materials;                                    /*!< Material table of the current frame. */
+
+	unsigned int m_width;          /*!< Width of the G-buffer. */
+	unsigned int m_height;         /*!< Height of the G-buffer. */
+	unsigned int m_fbo;            /*!< G-buffer framebuffer. */
+	unsigned int m_albedoTexture;  /*!< RGBA8 color multiplied with the lighting. */
+	unsigned int m_normalTexture;  /*!< RGBA16F world space normal. */
+	unsigned int m_materialTexture;/*!< RG16UI material index and shading flags. */
+	unsigned int m_depthTexture;   /*!< 24 bits depth. */
+	unsigned int m_triangleBuffer; /*!< Full-screen triangle. */
+};
+
+typedef std::shared_ptr<DeferredRenderer> DeferredRendererPtr; /*!< Typedef for a smart pointer of DeferredRenderer */
+
+#endif
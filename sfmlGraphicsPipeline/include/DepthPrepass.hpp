@@ -0,0 +1,94 @@
+#ifndef DEPTH_PREPASS_HPP
+#define DEPTH_PREPASS_HPP
+
+/**@file
+ * @brief Define a depth-only pre-pass for opaque renderables.
+ *
+ * This file defines the DepthPrepass class, used by the Viewer to shade each
+ * pixel of the opaque geometry at most once.
+ */
+
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Renderable.hpp"
+#include "ShaderProgram.hpp"
+
+/**@brief Fill the depth buffer before shading the opaque renderables.
+ *
+ * The renderables are drawn in priority order, not from front to back: an
+ * expensive fragment shader can shade the same pixel several times. The
+ * pre-pass draws the opaque renderables once with a trivial program and the
+ * colour writes disabled, to fill the depth buffer. The main pass then draws
+ * them with a GL_LEQUAL (or GL_EQUAL) depth test and the depth writes
+ * disabled: only the visible fragments are shaded.
+ *
+ * Only the renderables drawn with a program given to addShaderProgram() are
+ * pre-passed, as the pre-pass must produce the same depth as their program.
+ * A renderable is pre-passed if it is a MeshRenderable rendered in the window,
+ * and if its children satisfy the same conditions.
+ *
+ * \sa Viewer::setDepthPrepass()
+ */
+class DepthPrepass
+{
+   public:
+	/**@brief Build a depth pre-pass.
+	 *
+	 * Load the shader program of the pre-pass. This needs a valid OpenGL context.
+	 */
+	DepthPrepass();
+
+	/**@brief Instance destructor.
+	 */
+	~DepthPrepass();
+
+	/**@brief Pre-pass the renderables of a program.
+	 *
+	 * @param forwardProgram The program of the main pass. Its vertex shader
+	 * must compute gl_Position like depthVertex.glsl.
+	 * @param alphaCutoff If positive, the textured meshes discard the texels
+	 * whose alpha is lower, as the fragment shader of \a forwardProgram does.
+	 */
+	void addShaderProgram(const ShaderProgramPtr& forwardProgram, float alphaCutoff = 0.0f);
+
+	/**@brief Get the shader programs of the pre-pass.
+	 *
+	 * Those programs should be managed by the viewer, so that they are
+	 * reloaded with the other programs.
+	 * @return The programs of the pre-pass.
+	 */
+	const std::vector<ShaderProgramPtr>& getShaderPrograms() const;
+
+	/**@brief Fill the depth buffer with the renderables that can be pre-passed.
+	 *
+	 * @param renderables The opaque renderables of the main pass.
+	 * @param prepassed Output vector filled with the renderables that have been
+	 * drawn in the depth buffer.
+	 * @param projection The projection matrix of the camera.
+	 * @param view The view matrix of the camera.
+	 */
+	void draw(const std::vector<RenderablePtr>& renderables, std::vector<RenderablePtr>& prepassed,
+	          const glm::mat4& projection, const glm::mat4& view);
+
+   private:
+	DepthPrepass(const DepthPrepass&);
+	DepthPrepass& operator=(const DepthPrepass&);
+
+	typedef std::vector<std::pair<RenderablePtr, ShaderProgramPtr> > ProgramSwaps;
+
+	bool prepare(const RenderablePtr& renderable, ProgramSwaps& swaps);
+
+	std::unordered_map<ShaderProgramPtr, float> m_forwardPrograms; /*!< Programs whose renderables can be pre-passed, with their alpha cutoff. */
+	ShaderProgramPtr m_depthProgram;                               /*!< Position only program. */
+	std::map<float, ShaderProgramPtr> m_alphaTestPrograms;         /*!< Programs of textured meshes, by alpha cutoff. */
+	std::vector<ShaderProgramPtr> m_programs;                      /*!< All the programs above. */
+};
+
+typedef std::shared_ptr<DepthPrepass> DepthPrepassPtr; /*!< Typedef for a smart pointer of DepthPrepass */
+
+#endif
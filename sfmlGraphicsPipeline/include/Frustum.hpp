@@ -0,0 +1,43 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+#include "BoundingBox.hpp"
+
+/**@brief View frustum of a camera.
+ *
+ * The frustum is the volume seen by a camera, bounded by six planes. It is
+ * used to skip the objects the camera cannot see.
+ */
+class Frustum
+{
+   public:
+	/**@brief Build the frustum of a camera.
+	 *
+	 * @param viewProjection The projection matrix multiplied by the view matrix.
+	 */
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	/**@brief Tell if a sphere may be visible.
+	 *
+	 * @param center The center of the sphere, in world space.
+	 * @param radius The radius of the sphere.
+	 * @return False if the sphere is outside the frustum.
+	 */
+	bool intersects(const glm::vec3& center, float radius) const;
+
+	/**@brief Tell if a box may be visible.
+	 *
+	 * The test is conservative: a box close to a corner of the frustum may be
+	 * considered visible while it is not.
+	 * @param box A box in world space. An invalid box is considered visible.
+	 * @return False if the box is outside the frustum.
+	 */
+	bool intersects(const BoundingBox& box) const;
+
+   private:
+	glm::vec4 m_planes[6]; /*!< Planes (normal, distance), with the normals toward the inside. */
+};
+
+#endif
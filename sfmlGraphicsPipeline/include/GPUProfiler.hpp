@@ -0,0 +1,196 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+/**@file
+ * @brief Define a GPU profiler based on timer queries.
+ *
+ * This file defines the GPUProfiler class, which measures how long the GPU
+ * spends in the render passes and the renderables of each frame.
+ */
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**@brief Measure GPU durations without stalling the rendering.
+ *
+ * The CPU only submits commands: a draw call returns long before the GPU
+ * executes it. To know how long the GPU spends on a part of a frame, we ask
+ * the GPU to record a timestamp (glQueryCounter with GL_TIMESTAMP) before and
+ * after it. Timestamps are used rather than GL_TIME_ELAPSED queries because
+ * the latter cannot be nested, and we want to time renderables inside passes.
+ *
+ * Reading a query result too early would stall the CPU until the GPU reaches
+ * the query. Thus the queries of a frame are stored in a ring of a few frames,
+ * and their results are read a few frames later, when they are available.
+ * If the results of a frame are still not available when its slot of the ring
+ * is needed again, this frame is dropped rather than waited for.
+ *
+ * A typical use:
+ * \code{.cpp}
+ * profiler.beginFrame();
+ * profiler.begin("shadows");
+ * // draw calls
+ * profiler.end();
+ * profiler.endFrame();
+ * // a few frames later
+ * const GPUProfiler::FrameResult* frame = profiler.lastFrame();
+ * \endcode
+ */
+class GPUProfiler
+{
+   public:
+	/**@brief Duration of a profiled scope.
+	 */
+	struct Timing
+	{
+		std::string name;     /*!< Name given to begin(). */
+		unsigned int depth;   /*!< Nesting depth, 0 for the whole frame. */
+		double start;         /*!< Start of the scope since the start of the frame, in milliseconds. */
+		double duration;      /*!< GPU duration of the scope, in milliseconds. */
+	};
+
+	/**@brief Results of a profiled frame.
+	 */
+	struct FrameResult
+	{
+		unsigned long frame;          /*!< Index of the frame since the profiler was enabled. */
+		double cpuDuration;           /*!< CPU duration since the previous frame, in milliseconds. */
+		std::vector<Timing> timings;  /*!< Scopes of the frame, in the order they began. The first one is the whole frame. */
+	};
+
+	/**@brief Build a disabled profiler.
+	 *
+	 * No OpenGL call is made before the profiler is enabled.
+	 * @param latency Number of frames between the submission of the queries
+	 * and the reading of their results.
+	 * @param historySize Number of frame results kept for the dumps.
+	 */
+	GPUProfiler(unsigned int latency = 4, unsigned int historySize = 1000);
+
+	/**@brief Instance destructor.
+	 */
+	~GPUProfiler();
+
+	/**@brief Enable or disable the profiler.
+	 *
+	 * A disabled profiler ignores all the calls to beginFrame(), begin(),
+	 * end() and endFrame().
+	 * @param enabled True to enable the profiler.
+	 */
+	void setEnabled(bool enabled);
+
+	/**@brief Tell if the profiler is enabled.
+	 */
+	bool isEnabled() const;
+
+	/**@brief Enable or disable the timing of each renderable.
+	 *
+	 * This is only a hint for the code that uses the profiler, see
+	 * Viewer::draw(): timing each renderable needs two queries per renderable.
+	 * @param enabled True to time each renderable.
+	 */
+	void setRenderableTiming(bool enabled);
+
+	/**@brief Tell if each renderable should be timed.
+	 */
+	bool isRenderableTimingEnabled() const;
+
+	/**@brief Start profiling a new frame.
+	 *
+	 * Read the available results of the previous frames, and open the scope
+	 * of the whole frame.
+	 */
+	void beginFrame();
+
+	/**@brief Finish profiling the current frame.
+	 *
+	 * Close all the open scopes.
+	 */
+	void endFrame();
+
+	/**@brief Open a scope in the current frame.
+	 *
+	 * Scopes can be nested. Each begin() must be matched by an end().
+	 * @param name The name of the scope.
+	 */
+	void begin(const std::string& name);
+
+	/**@brief Close the last open scope.
+	 */
+	void end();
+
+	/**@brief Get the results of the last frame whose results are available.
+	 *
+	 * @return The results of the last available frame, nullptr if none.
+	 */
+	const FrameResult* lastFrame() const;
+
+	/**@brief Get the results of the last frames.
+	 *
+	 * @return The last available frame results, from the oldest to the newest.
+	 */
+	const std::deque<FrameResult>& history() const;
+
+	/**@brief Get the number of frames dropped because their results were late.
+	 */
+	unsigned long droppedFrames() const;
+
+	/**@brief Save the history in a CSV file.
+	 *
+	 * Each line is a scope: frame, name, depth, start and duration in milliseconds.
+	 * @param filename The file to write.
+	 * @return True if the file was written.
+	 */
+	bool dumpCSV(const std::string& filename) const;
+
+	/**@brief Save the history in a JSON file.
+	 *
+	 * The file contains an array of frames, each frame having its scopes.
+	 * @param filename The file to write.
+	 * @return True if the file was written.
+	 */
+	bool dumpJSON(const std::string& filename) const;
+
+   private:
+	GPUProfiler(const GPUProfiler&);
+	GPUProfiler& operator=(const GPUProfiler&);
+
+	typedef std::chrono::steady_clock clock;
+
+	struct Scope
+	{
+		std::string name;
+		unsigned int depth;
+		unsigned int beginQuery;
+		unsigned int endQuery;
+	};
+
+	struct FrameQueries
+	{
+		std::vector<unsigned int> queries; /*!< Query objects, allocated on demand and reused. */
+		unsigned int used;                 /*!< Number of queries used by the frame. */
+		std::vector<Scope> scopes;
+		unsigned long frame;
+		double cpuDuration;
+		bool pending;                      /*!< True if the results have not been read yet. */
+	};
+
+	unsigned int timestamp();
+	void collect();
+	void release();
+
+	bool m_enabled;
+	bool m_renderableTiming;
+	unsigned int m_historySize;
+	std::vector<FrameQueries> m_ring;
+	unsigned long m_frame;               /*!< Index of the current frame. */
+	bool m_inFrame;                      /*!< True between beginFrame() and endFrame(). */
+	std::vector<unsigned int> m_stack;   /*!< Open scopes of the current frame. */
+	std::deque<FrameResult> m_history;
+	unsigned long m_droppedFrames;
+	clock::time_point m_lastFrameTime;
+};
+
+#endif
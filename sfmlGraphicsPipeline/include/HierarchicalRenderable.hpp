@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "Renderable.hpp"
+#include "TransformStore.hpp"
 
 class HierarchicalRenderable;
 typedef std::shared_ptr<HierarchicalRenderable> HierarchicalRenderablePtr;
@@ -41,6 +42,18 @@ typedef std::shared_ptr<HierarchicalRenderable> HierarchicalRenderablePtr;
  * scale for example, without needing to apply the reverse operation to all its
  * children.
  *
+ * The total global transform of each instance is cached. Each transform has a
+ * version, incremented when it is modified, and the cache remembers the versions
+ * it was computed from: it is recomputed only if the instance or one of its
+ * ancestors has moved. Before drawing, the root updates its whole hierarchy in a
+ * single top-down pass, see updateHierarchy(), which skips the subtrees where
+ * nothing has changed.
+ *
+ * A hierarchy can also keep its transforms in a TransformStore, see
+ * setTransformStore(). The store updates all the hierarchies it holds in one
+ * linear loop, and the instances only read their model matrix from it. The
+ * Viewer puts the hierarchies added to it in its store.
+ *
  * Only the root instance is meant to be added to the Viewer instance: that root
  * will take care itself to draw and animate all the hierarchy. However, if you want
  * to interact with all the hierarchy, you will have to propagate yourself the
@@ -73,7 +86,8 @@ class HierarchicalRenderable : public Renderable
 	/** @brief Set hierarchical relationship between two HierarchicalRenderable instances.
 	 *
 	 * This function adds \a child to the m_children of \a parent and set the m_parent member
-	 * of \a child to \a parent.
+	 * of \a child to \a parent. If \a child had another parent, it is removed from its children:
+	 * a renderable belongs to a single hierarchy, and is drawn once.
 	 *
 	 * \param parent A pointer to the parent.
 	 * \param child A pointer to the child.
@@ -96,17 +110,29 @@ class HierarchicalRenderable : public Renderable
 	 * matrices \ref m_globalTransform. This computation is done in this function and should be
 	 * typically applied before drawing a hierarchical renderable. The result is stored
 	 * in \ref m_model.
+	 *
+	 * Only the cached transforms that are out of date are recomputed, from the root
+	 * to this instance.
 	 */
 	void updateModelMatrix();
 
+	/** @brief Update the model matrices of the instance and its descendants.
+	 *
+	 * Recompute, from this instance to the leaves, the cached total global transforms
+	 * and the model matrices that are out of date. The subtrees where no transform
+	 * has been modified are skipped. This is done by the root before each draw.
+	 */
+	void updateHierarchy();
+
 	/** @brief Compute the total global transformation.
 	 *
 	 * This function composes recursively the global transformations until
-	 * it reaches the root of the hierarchy.
+	 * it reaches the root of the hierarchy. The result is cached, and only
+	 * recomputed if a transformation of the instance or its ancestors has changed.
 	 *
 	 * \return The total global transformation matrix.
 	 */
-	glm::mat4 computeTotalGlobalTransform() const;
+	const glm::mat4& computeTotalGlobalTransform() const;
 
 	/** \brief Read only access to the global transformation.
 	 *
@@ -148,6 +174,39 @@ class HierarchicalRenderable : public Renderable
 	 * @return A vector of hierarchical renderable shared pointers. */
 	std::vector<HierarchicalRenderablePtr>& getChildren();
 
+	/**@brief Access to the parent of this renderable.
+	 *
+	 * @return The parent, nullptr for the root of a hierarchy. */
+	const HierarchicalRenderablePtr& getParent() const;
+
+	/**@brief Keep the transforms of the hierarchy in a transform store.
+	 *
+	 * The whole hierarchy containing this instance, from its root, is added to
+	 * \a store. The children added later are added to the store too. The
+	 * hierarchy is removed from its previous store, if any.
+	 * @param store The store, nullptr to keep the transforms in the instances.
+	 */
+	void setTransformStore(const TransformStorePtr& store);
+
+	/**@brief Get the transform store of the instance.
+	 *
+	 * @return The store of the hierarchy, nullptr if it has none.
+	 */
+	const TransformStorePtr& getTransformStore() const;
+
+	/**@brief Update the bounding box of the instance and its descendants, in world space.
+	 *
+	 * The bounds are unknown if those of the instance or of a descendant are unknown.
+	 * \return The world bounding box of the hierarchy from this instance.
+	 */
+	const BoundingBox& updateWorldBounds();
+
+	/**@brief Intersect a ray with the instance and its descendants.
+	 *
+	 * \sa Renderable::pick()
+	 */
+	bool pick(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+
 	void applyObjTransform(const std::string &filename);
 
    private:
@@ -187,6 +246,57 @@ class HierarchicalRenderable : public Renderable
 	 */
 	glm::mat4 m_inverse = glm::mat4(1.0);
 
+	unsigned int m_globalVersion; /*!< Incremented each time \ref m_globalTransform changes. */
+	unsigned int m_localVersion;  /*!< Incremented each time \ref m_localTransform changes. */
+
+	mutable glm::mat4 m_totalGlobalTransform;   /*!< Cache of computeTotalGlobalTransform(). */
+	mutable unsigned int m_totalGlobalVersion;  /*!< Incremented each time \ref m_totalGlobalTransform is recomputed. */
+	mutable unsigned int m_cachedGlobalVersion; /*!< Version of \ref m_globalTransform used by \ref m_totalGlobalTransform. */
+	mutable unsigned int m_cachedParentVersion; /*!< Version of the parent total global transform used by \ref m_totalGlobalTransform. */
+
+	unsigned int m_modelTotalGlobalVersion; /*!< Version of \ref m_totalGlobalTransform used by the model matrix. */
+	unsigned int m_modelLocalVersion;       /*!< Version of \ref m_localTransform used by the model matrix. */
+
+	/**@brief True if a transform of a descendant has changed since the last updateHierarchy().
+	 *
+	 * If this flag is set, it is also set for all the ancestors.
+	 */
+	bool m_dirtyDescendants;
+
+	TransformStorePtr m_transformStore;         /*!< Store of the transforms of the hierarchy, if any. */
+	TransformStore::Handle m_transformHandle;   /*!< Node of this instance in \ref m_transformStore. */
+
+	/**@brief Add this instance and its descendants to a store, or remove them from their store.
+	 */
+	void attachTransformStore(const TransformStorePtr& store);
+
+	/**@brief Tell the ancestors that a transform of this instance has changed.
+	 */
+	void markDirty();
+
+	/**@brief Recompute the cached total global transform if it is out of date.
+	 *
+	 * The cache of the parent must be up to date.
+	 * @return True if the cache has been recomputed.
+	 */
+	bool refreshTotalGlobalTransform() const;
+
+	/**@brief Update the cached total global transforms from the root to this instance.
+	 */
+	void updateTotalGlobalTransform() const;
+
+	/**@brief Recompute the model matrix if it is out of date.
+	 *
+	 * The cached total global transform must be up to date.
+	 */
+	void refreshModelMatrix();
+
+	/**@brief Top-down update of updateHierarchy().
+	 *
+	 * @param parentMoved True if the total global transform of the parent has changed.
+	 */
+	void propagateTransforms(bool parentMoved);
+
 	/**\brief Perform computations before do_draw()
 	 */
 	virtual void beforeDraw();
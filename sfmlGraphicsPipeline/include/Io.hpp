@@ -4,7 +4,8 @@
 /**@file
  *@brief Input/Output functions.
  *
- * Currently, this file only contains I/O functions for OBJ meshes.*/
+ * This file contains I/O functions for OBJ meshes, and for the caches of
+ * their levels of detail.*/
 
 #include <glm/glm.hpp>
 #include <string>
@@ -30,4 +31,51 @@ bool read_obj(
     std::vector<glm::vec3>& normals,
     std::vector<glm::vec2>& texcoords);
 
+/**@brief Read the rest transform of an OBJ file.
+ *
+ * The exporter of the scenes writes the transform of each object in a
+ * "TRANSFORM" line of 16 numbers, in row-major order.
+ *
+ * @param filename The path to the mesh file.
+ * @return The transform, the identity if the file has none.
+ */
+glm::mat4 read_obj_transform(const std::string& filename);
+
+/**@brief Read the levels of detail of a mesh from a cache file.
+ *
+ * The cache is a binary file written by write_lod_cache(). It is rejected if
+ * it was written for another mesh: its header holds the vertex and index
+ * counts and a hash of the positions and indices of the mesh, so that a
+ * mesh exported again with other geometry is simplified again.
+ *
+ * @param filename The path to the cache file.
+ * @param positions The vertex positions of the mesh.
+ * @param indices The vertex indices of the faces of the mesh.
+ * @param lodIndices The vertex indices of the triangles of each level.
+ * @param lodErrors The geometric error of each level.
+ * @return False if the cache is missing or invalid, true otherwise.
+ */
+bool read_lod_cache(
+    const std::string& filename,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& indices,
+    std::vector<std::vector<unsigned int> >& lodIndices,
+    std::vector<float>& lodErrors);
+
+/**@brief Write the levels of detail of a mesh to a cache file.
+ *
+ * @param filename The path to the cache file.
+ * @param positions The vertex positions of the mesh.
+ * @param indices The vertex indices of the faces of the mesh.
+ * @param lodIndices The vertex indices of the triangles of each level.
+ * @param lodErrors The geometric error of each level.
+ * @return False if the file cannot be written, true otherwise.
+ */
+bool write_lod_cache(
+    const std::string& filename,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& indices,
+    const std::vector<std::vector<unsigned int> >& lodIndices,
+    const std::vector<float>& lodErrors);
+
 #endif  // IO_HPP
@@ -2,8 +2,8 @@
 #define KEYFRAMECOLLECTION_HPP_
 
 #include <array>
-#include <map>
 #include <string>
+#include <vector>
 
 #include "GeometricTransformation.hpp"
 
@@ -19,12 +19,28 @@ typedef enum KeyframeInterpolationMode
  *
  * This class store the keyframes in ascending time order. For now, the
  * key frames only define a geometric transformation at a given time.
+ *
+ * The keyframes are stored as a structure of arrays: contiguous arrays of the
+ * times, translations, orientations and scales. The segment of the last
+ * interpolation is remembered, so that playing the animation forward finds the
+ * next segment in a constant time, and a seek does a binary search.
+ *
+ * The cubic segments are baked when a keyframe is added: the translation and
+ * scale are Catmull-Rom splines, stored as the coefficients of a polynomial
+ * evaluated with the Horner scheme, and the orientation is a spherical
+ * quadrangle interpolation (squad) whose inner control points are stored, so
+ * that it stays a unit quaternion between the keyframes.
  * You can either extend this class to add other attributes to interpolate,
  * such as colors, or to create another class similar to this one.
  */
 class KeyframeCollection
 {
    public:
+	/**
+	 * \brief Build an empty collection.
+	 */
+	KeyframeCollection();
+
 	/**
 	 * \brief Add a key frame to the collection.
 	 *
@@ -37,12 +53,50 @@ class KeyframeCollection
 	/**
 	 * \brief Add keyframes from a file.
 	 *
-	 * Add all the keyframes contained in a .animation file.
+	 * Add all the keyframes contained in a .animation file. The keyframes
+	 * with the time of a previous one are dropped. If an import reduction is
+	 * set, the redundant keyframes of the file are removed before they are
+	 * added, see setImportReduction().
 	 * \param animation_filename Name of the file containing the keyframes.
 	 * \param time_shift The amount of time to shift all the keyframes by.
 	 */
 	void addFromFile(const std::string &animation_filename, float time_shift);
 
+	/**
+	 * \brief Write the keyframes to a .animation file.
+	 *
+	 * The file is read back by addFromFile(), with the same keyframes.
+	 * \param animation_filename Name of the file to write.
+	 * \param time_shift The amount of time the keyframes were shifted by when they were read.
+	 * \return False if the file cannot be written.
+	 */
+	bool saveToFile(const std::string &animation_filename, float time_shift = 0.0f) const;
+
+	/**
+	 * \brief Remove the redundant keyframes.
+	 *
+	 * A keyframe is redundant if the interpolation without it stays within the
+	 * tolerances of the interpolation of the original keyframes: for instance
+	 * in a run of constant keyframes, or of keyframes on a straight line. The
+	 * interpolations are compared at the original keyframes and at several
+	 * times between them. The first and the last keyframes are kept.
+	 * \param translation_tolerance The largest distance between the translations, and between the scales.
+	 * \param angle_tolerance The largest angle between the orientations, in radians.
+	 * \return The number of removed keyframes.
+	 */
+	size_t reduce(float translation_tolerance, float angle_tolerance);
+
+	/**
+	 * \brief Reduce the keyframes of the files read by addFromFile().
+	 *
+	 * Each file is reduced on its own, see reduce(), and the number of
+	 * duplicate and redundant keyframes removed from it is logged.
+	 * \param translation_tolerance The translation tolerance, 0 to disable the reduction.
+	 * \param angle_tolerance The angle tolerance, in radians.
+	 * \param rewrite_files Whether to write the reduced keyframes back to the files which had removed keyframes.
+	 */
+	static void setImportReduction(float translation_tolerance, float angle_tolerance, bool rewrite_files = false);
+
 	/**
 	 * \brief Interpolate a transformation at a given time.
 	 *
@@ -55,39 +109,90 @@ class KeyframeCollection
 	 * keyframe is returned. In case there is no keyframe, the identity
 	 * matrix is returned.
 	 *
+	 * This updates the segment cursor of the collection: a collection must not
+	 * be interpolated by two threads at once.
+	 *
 	 * \param time Interpolation time
 	 * \param smooth Whether to use cubic interpolation (true) or linear interpolation (false)
 	 * \return The interpolated geometric transformation.
 	 */
 	glm::mat4 interpolateTransformation(float time) const;
 
+	/**
+	 * \brief Interpolate the components of a transformation at a given time.
+	 *
+	 * This is interpolateTransformation(), before the components are combined
+	 * in a matrix.
+	 * \param time Interpolation time, the collection must not be empty.
+	 * \param translation Output: the interpolated translation.
+	 * \param orientation Output: the interpolated orientation.
+	 * \param scale Output: the interpolated scale.
+	 */
+	void interpolate(float time, glm::vec3& translation, glm::quat& orientation, glm::vec3& scale) const;
+
 	/**
 	 * @brief Check if the collection is empty.
 	 * @return True if the collection is empty, false otherwise.
 	 */
 	bool empty() const;
 
+	/**
+	 * @brief Get the time range of the keyframes.
+	 *
+	 * The interpolated transformation is constant before the first keyframe
+	 * and after the last one.
+	 * @param begin Output: the time of the first keyframe.
+	 * @param end Output: the time of the last keyframe.
+	 * @return False if the collection is empty.
+	 */
+	bool getTimeRange(float& begin, float& end) const;
+
    private:
 	/**
-	* \brief Definition of a keyframe.
-	*/
-	struct Keyframe
+	 * \brief Find the segment containing a time.
+	 *
+	 * \param time A time strictly between the first and the last keyframes.
+	 * \return The index k of the keyframes such that m_times[k] <= time < m_times[k + 1].
+	 */
+	size_t findSegment(float time) const;
+
+	/**
+	 * \brief Remove a keyframe and bake the cubic segments around it again.
+	 *
+	 * \param k The index of the keyframe.
+	 */
+	void remove(size_t k);
+
+	/**
+	 * \brief Compute the coefficients of a cubic segment.
+	 *
+	 * \param k The index of the first keyframe of the segment.
+	 */
+	void bakeSegment(size_t k);
+
+	/**
+	 * \brief Precomputed interpolation from a keyframe to the next one.
+	 */
+	struct Segment
 	{
-		float time;
-		GeometricTransformation transform;
-		KeyframeInterpolationMode interpolation;
+		std::array<glm::vec3, 4> translation; /*!< Coefficients of the cubic translation, highest degree first. */
+		std::array<glm::vec3, 4> scale;       /*!< Coefficients of the cubic scale, highest degree first. */
+		std::array<glm::quat, 4> orientation; /*!< Start, end and inner control points of the squad. */
 	};
 
 	/**
 	 * \brief Internal storage of the keyframes.
 	 *
-	 * Keyframes are stored inside a map. Such collection associate
-	 * to a time a Keyyframe struct. Its specificity is to
-	 * store the data in a way that it is trivial to iterate over the
-	 * keyframes in a increasing time order. Internally, a map element
-	 * is similar to a set of pair< float, GeometricTransformation >.
+	 * The keyframes are stored in parallel arrays, sorted by increasing time.
+	 * Two keyframes never have the same time.
 	 */
-	std::map<float, Keyframe> m_keyframes;
+	std::vector<float> m_times;                               /*!< Time of each keyframe. */
+	std::vector<glm::vec3> m_translations;                    /*!< Translation of each keyframe. */
+	std::vector<glm::quat> m_orientations;                    /*!< Orientation of each keyframe. */
+	std::vector<glm::vec3> m_scales;                          /*!< Scale of each keyframe. */
+	std::vector<KeyframeInterpolationMode> m_interpolations; /*!< Interpolation from each keyframe to the next one. */
+	std::vector<Segment> m_segments;                          /*!< Baked cubic segment from each keyframe to the next one. */
+	mutable size_t m_cursor;                                  /*!< Segment of the last interpolation. */
 };
 
 #endif
@@ -3,6 +3,8 @@
 
 #include <glm/glm.hpp>
 
+#include "AnimationBatch.hpp"
+#include "AnimationClip.hpp"
 #include "HierarchicalRenderable.hpp"
 #include "KeyframeCollection.hpp"
 
@@ -42,8 +44,69 @@ class KeyframedHierarchicalRenderable : public HierarchicalRenderable
 	 */
 	void addKeyframesFromFile(const std::string &animation_filename, float time_shift, bool local);
 
+	/**
+	 * \brief Animate a transformation with a baked clip.
+	 *
+	 * The clip replaces the keyframes of the same transformation: they are
+	 * kept, but no longer sampled until the clip is removed.
+	 * \param clip The clip, or nullptr to go back to the keyframes.
+	 * \param local Whether the clip animates the local (true) or global (false) transformation.
+	 */
+	void setClip(const AnimationClipPtr& clip, bool local);
+
+	/**
+	 * \brief Sample the keyframes at a given time.
+	 *
+	 * Interpolate the local and global keyframes, without applying them: the
+	 * next call to do_animate() with the same time applies the samples instead
+	 * of interpolating again. Only this instance is modified, so that the
+	 * renderables can be sampled in parallel before being animated in order.
+	 * \param time The animation time.
+	 */
+	void sampleKeyframes(float time);
+
+	/**
+	 * \brief Get the number of animated transformations, local and global.
+	 *
+	 * A transformation is animated if it has keyframes or a clip.
+	 */
+	unsigned int getTrackCount() const;
+
+	/**
+	 * \brief Sample the animated transformations into a batch.
+	 *
+	 * The local track comes first, then the global one, see getTrackCount().
+	 * Only this instance and the given slots are modified.
+	 * \param time The animation time.
+	 * \param batch The batch.
+	 * \param first The slot of the first track.
+	 */
+	void sampleTracks(float time, AnimationBatch& batch, size_t first) const;
+
+	/**
+	 * \brief Set the samples of the animated transformations.
+	 *
+	 * This replaces sampleKeyframes() with matrices composed by a batch: the
+	 * next call to do_animate() with the same time applies them.
+	 * \param time The animation time.
+	 * \param matrices The matrices of the tracks, in the order of sampleTracks().
+	 */
+	void setSampledTracks(float time, const glm::mat4* matrices);
+
+	/**
+	 * \brief Get the time range of the keyframes.
+	 *
+	 * The renderable is animated between its first and last keyframes, local
+	 * or global, or the range of its clips. It is static with a single keyframe
+	 * per collection, or none.
+	 * \param begin Output: the time of the first keyframe.
+	 * \param end Output: the time of the last keyframe.
+	 * \return False if the keyframes do not animate the renderable.
+	 */
+	bool getAnimationRange(float& begin, float& end) const;
+
 protected:
-	KeyframedHierarchicalRenderable() : HierarchicalRenderable(nullptr)
+	KeyframedHierarchicalRenderable() : HierarchicalRenderable(nullptr), m_sampleTime(0.0f), m_sampled(false)
 	{
 	}
 
@@ -52,6 +115,13 @@ protected:
    private:
 	KeyframeCollection m_localKeyframes;  /*!< A collection of keyframes for the local transformation of renderable. */
 	KeyframeCollection m_globalKeyframes; /*!< A collection of keyframes for the global transformation of renderable. */
+	AnimationClipPtr m_localClip;         /*!< Baked clip replacing the local keyframes, if any. */
+	AnimationClipPtr m_globalClip;        /*!< Baked clip replacing the global keyframes, if any. */
+
+	glm::mat4 m_sampledLocalTransform;  /*!< Local transformation sampled by sampleKeyframes(). */
+	glm::mat4 m_sampledGlobalTransform; /*!< Global transformation sampled by sampleKeyframes(). */
+	float m_sampleTime;                 /*!< Time of the samples. */
+	bool m_sampled;                     /*!< True if the samples have not been applied yet. */
 };
 
 typedef std::shared_ptr<KeyframedHierarchicalRenderable> KeyframedHierarchicalRenderablePtr;
@@ -14,8 +14,18 @@ class MeshRenderable : public KeyframedHierarchicalRenderable
    public:
 	virtual ~MeshRenderable();
 
+	/**@brief Build a mesh from an OBJ file.
+	 *
+	 * The rest transform of the file is applied at once. The geometry is read
+	 * and sent to the GPU at once too, unless its loading is deferred: it is
+	 * then loaded by load(), or when the mesh is first drawn.
+	 * \param program The shader program of the mesh.
+	 * \param mesh_filename The OBJ file.
+	 * \param deferred Whether to defer the loading of the geometry.
+	 */
 	MeshRenderable(ShaderProgramPtr program,
-	               const std::string& mesh_filename);
+	               const std::string& mesh_filename,
+	               bool deferred = false);
 
 	MeshRenderable(ShaderProgramPtr program,
 	               const std::vector<glm::vec3>& positions,
@@ -34,6 +44,83 @@ class MeshRenderable : public KeyframedHierarchicalRenderable
 	void update_indices_buffer();
 	virtual void update_all_buffers();
 
+	/**@brief Intersect a ray with the triangles of the mesh.
+	 *
+	 * Only the meshes drawn with GL_TRIANGLES are intersected triangle by
+	 * triangle, the others are intersected with their bounding box.
+	 * \sa Renderable::intersectRay()
+	 */
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+
+	/**@brief Generate the levels of detail of the mesh.
+	 *
+	 * Each level is an index buffer of the same vertices, simplified from the
+	 * previous level by quadric error edge collapses, see simplify_mesh(). The
+	 * level 0 is the full mesh. Only the indexed meshes drawn with GL_TRIANGLES
+	 * have levels of detail. The levels are dropped when the indices are updated.
+	 * \param levels The number of simplified levels.
+	 * \param ratio The ratio of the triangle counts of two successive levels.
+	 */
+	void generateLods(int levels = 3, float ratio = 0.5f);
+
+	/**@brief Remove the levels of detail of the mesh.
+	 */
+	void clearLods();
+
+	/**@brief Get the number of levels of detail, including the full mesh.
+	 */
+	int getLodCount() const;
+
+	/**@brief Get the level of detail drawn last.
+	 */
+	int getCurrentLod() const;
+
+	/**@brief Set the screen-space error allowed when choosing the level of detail.
+	 *
+	 * The coarsest level whose geometric error, projected on the screen, is at
+	 * most \a pixels is drawn. To avoid flickering, a coarser level is only
+	 * chosen once its projected error is at most 3/4 of \a pixels.
+	 * \param pixels The allowed error, in pixels. The default is 1.
+	 */
+	void setLodThreshold(float pixels);
+
+	/**@brief Get the screen-space error allowed when choosing the level of detail.
+	 */
+	float getLodThreshold() const;
+
+	/**@brief Get the OBJ file of the mesh.
+	 *
+	 * \return The file, empty if the mesh was built from arrays.
+	 */
+	const std::string& getMeshFilename() const;
+
+	/**@brief Tell if the geometry of the mesh is in memory and on the GPU.
+	 *
+	 * A mesh built from arrays is always resident.
+	 */
+	bool isResident() const;
+
+	/**@brief Read the files of the mesh into memory.
+	 *
+	 * Nothing is sent to the GPU: this may run on another thread, as long as
+	 * the mesh is neither drawn, loaded nor released meanwhile. Does nothing if
+	 * the files are already read, see AssetResidency.
+	 */
+	virtual void prefetch();
+
+	/**@brief Make the mesh resident.
+	 *
+	 * Read its files if they are not prefetched, and send the geometry to the GPU.
+	 */
+	virtual void load();
+
+	/**@brief Free the geometry of a mesh read from a file, in memory and on the GPU.
+	 *
+	 * The bounds are kept, so that the mesh is still culled. It is loaded again
+	 * by load(), or when it is drawn. Does nothing for a mesh built from arrays.
+	 */
+	virtual void release();
+
    protected:
 	void do_draw();
 	MeshRenderable(ShaderProgramPtr program, bool indexed);
@@ -51,8 +138,21 @@ class MeshRenderable : public KeyframedHierarchicalRenderable
 	unsigned int m_nBuffer;
 	unsigned int m_iBuffer;
 
+	std::vector<std::vector<unsigned int> > m_lodIndices; /*!< Indices of the levels of detail, from the level 1. */
+	std::vector<float> m_lodErrors;                      /*!< Geometric error of the levels of detail, from the level 1. */
+	std::vector<unsigned int> m_lodBuffers;              /*!< Index buffers of the levels of detail, from the level 1. */
+	float m_lodThreshold;                                /*!< Screen-space error allowed, in pixels. */
+	int m_currentLod;                                    /*!< Level of detail drawn last. */
+
+	std::string m_meshFilename; /*!< OBJ file of the mesh, empty if it was built from arrays. */
+	bool m_prefetched;          /*!< True if the geometry is in memory. */
+	bool m_resident;            /*!< True if the geometry is also on the GPU. */
+
    private:
 	void gen_buffers();
+	void compute_lods(int levels, float ratio);
+	void update_lod_buffers();
+	int select_lod();
 	void update_buffers();
 	void set_random_colors();
 };
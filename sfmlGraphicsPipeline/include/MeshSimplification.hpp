@@ -0,0 +1,47 @@
+#ifndef MESH_SIMPLIFICATION_HPP
+#define MESH_SIMPLIFICATION_HPP
+
+/**@file
+ * @brief Simplification of triangle meshes.
+ *
+ * This file contains the functions used to build the levels of detail of the
+ * meshes, see MeshRenderable::generateLods().
+ */
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/**@brief Simplify a triangle mesh by quadric error edge collapses.
+ *
+ * The vertices are not modified: an edge collapse moves one of its vertices
+ * onto the other one, so the simplified mesh is a new index buffer for the
+ * same vertex buffer, and can be drawn with the same vertex attributes. The
+ * cost of a collapse is the quadric error of Garland and Heckbert: the sum of
+ * the squared distances of the new vertex to the planes of the triangles around
+ * the collapsed vertices. The cheapest collapses are done first, and collapses
+ * flipping a triangle are rejected.
+ *
+ * The vertices sharing a position (seams of normals or texture coordinates) are
+ * welded during the simplification, so that no crack opens along the seams. A
+ * corner of a simplified triangle keeps its vertex if it has not moved, and takes
+ * otherwise the vertex of its new position whose normal is the closest. The
+ * vertices on the border of the mesh never move, so that no hole grows.
+ *
+ * @param positions The positions of the vertices.
+ * @param normals The normals of the vertices, used to choose the vertex of a
+ * moved corner. If empty, the first vertex of the position is used.
+ * @param indices The vertex indices of the triangles.
+ * @param targetIndexCount The number of indices to reach. The result may have
+ * more indices if no more edge can be collapsed.
+ * @param error Output: the geometric error of the simplified mesh, as a
+ * distance in the units of \a positions.
+ * @return The vertex indices of the triangles of the simplified mesh.
+ */
+std::vector<unsigned int> simplify_mesh(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<glm::vec3>& normals,
+    const std::vector<unsigned int>& indices,
+    size_t targetIndexCount,
+    float& error);
+
+#endif
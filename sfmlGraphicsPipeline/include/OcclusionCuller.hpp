@@ -0,0 +1,138 @@
+#ifndef OCCLUSION_CULLER_HPP
+#define OCCLUSION_CULLER_HPP
+
+/**@file
+ * @brief Define an occlusion culling based on a hierarchical depth buffer.
+ *
+ * This file defines the OcclusionCuller class, used by the Viewer to skip the
+ * renderables hidden behind the opaque geometry.
+ */
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "BoundingBox.hpp"
+#include "ShaderProgram.hpp"
+
+/**@brief Skip the renderables hidden by the opaque geometry of the previous frames.
+ *
+ * After the opaque renderables of a frame are drawn, the depth buffer is copied
+ * and reduced in a hierarchical depth buffer (Hi-Z): a mipmap pyramid whose
+ * texels keep the farthest depth of the texels they cover, see hizFragment.glsl.
+ * A level of this pyramid small enough is read back to the CPU through a pixel
+ * buffer, without waiting for the GPU: it is used a frame or two later, when the
+ * GPU has finished writing it.
+ *
+ * A renderable is occluded if its world bounds, projected with the camera of
+ * the captured frame, are behind the farthest depth of the texels of the level
+ * where they cover a couple of texels. As the depth is a few frames old, an
+ * object revealed by a fast moving camera or occluder may appear a frame or two
+ * late.
+ *
+ * \sa Viewer::setOcclusionCulling()
+ */
+class OcclusionCuller
+{
+   public:
+	/**@brief Build an occlusion culler.
+	 *
+	 * Load the shader programs of the culler. The pyramid is created at the
+	 * first capture. This needs a valid OpenGL context.
+	 */
+	OcclusionCuller();
+
+	/**@brief Instance destructor.
+	 */
+	~OcclusionCuller();
+
+	/**@brief Get the shader programs of the culler.
+	 *
+	 * Those programs should be managed by the viewer, so that they are
+	 * reloaded with the other programs.
+	 * @return The reduction and debug programs.
+	 */
+	const std::vector<ShaderProgramPtr>& getShaderPrograms() const;
+
+	/**@brief Build the pyramid from the depth buffer and start its read back.
+	 *
+	 * @param width The width of the bound framebuffer.
+	 * @param height The height of the bound framebuffer.
+	 * @param viewProjection The projection times the view matrix of the camera
+	 * used to fill the depth buffer.
+	 */
+	void capture(unsigned int width, unsigned int height, const glm::mat4& viewProjection);
+
+	/**@brief Use the last pyramid whose read back is finished.
+	 *
+	 * This never waits for the GPU: the pyramid used by isOccluded() is kept
+	 * if no newer one is ready.
+	 */
+	void update();
+
+	/**@brief Forget the pyramids, until the next capture is read back.
+	 */
+	void reset();
+
+	/**@brief Tell if a box is hidden in the pyramid.
+	 *
+	 * @param box The world bounds to test. Invalid bounds are never occluded.
+	 * @return True if the box is behind the depth of the pyramid.
+	 */
+	bool isOccluded(const BoundingBox& box) const;
+
+	/**@brief Draw the edges of boxes over the bound framebuffer.
+	 *
+	 * This is used to show which renderables have been occluded.
+	 * @param boxes The boxes to draw.
+	 * @param viewProjection The projection times the view matrix of the camera.
+	 */
+	void drawBoxes(const std::vector<BoundingBox>& boxes, const glm::mat4& viewProjection);
+
+   private:
+	OcclusionCuller(const OcclusionCuller&);
+	OcclusionCuller& operator=(const OcclusionCuller&);
+
+	/**@brief Read back of a captured pyramid level.
+	 */
+	struct Readback
+	{
+		unsigned int buffer;      /*!< Pixel buffer receiving the level. */
+		void* fence;              /*!< Signaled when the level is written, nullptr if the slot is free. */
+		glm::ivec2 size;          /*!< Size of the level, in texels. */
+		float texelSize;          /*!< Size of a texel of the level, in pixels. */
+		glm::vec2 screenSize;     /*!< Size of the framebuffer, in pixels. */
+		glm::mat4 viewProjection; /*!< Camera of the captured frame. */
+	};
+
+	void resize(unsigned int width, unsigned int height);
+	void release();
+
+	ShaderProgramPtr m_reductionProgram; /*!< Farthest depth of 2x2 texels. */
+	ShaderProgramPtr m_debugProgram;     /*!< Uniform color lines. */
+	std::vector<ShaderProgramPtr> m_programs;
+
+	unsigned int m_width;          /*!< Width of the captured depth. */
+	unsigned int m_height;         /*!< Height of the captured depth. */
+	unsigned int m_depthFbo;       /*!< Framebuffer of the copy of the depth buffer. */
+	unsigned int m_depthTexture;   /*!< Copy of the depth buffer. */
+	unsigned int m_pyramidFbo;     /*!< Framebuffer of the reductions. */
+	unsigned int m_pyramidTexture; /*!< R32F pyramid, its level 0 has half the size of the depth buffer. */
+	int m_levelCount;              /*!< Number of levels of the pyramid. */
+	int m_readLevel;               /*!< Level read back to the CPU. */
+	unsigned int m_triangleBuffer; /*!< Full-screen triangle. */
+	unsigned int m_lineBuffer;     /*!< Edges of the debug boxes. */
+
+	std::vector<Readback> m_readbacks; /*!< Ring of the read backs in flight. */
+	size_t m_nextReadback;             /*!< Slot of the next capture. */
+
+	std::vector<std::vector<float> > m_levels; /*!< Pyramid on the CPU, from the level read back. */
+	std::vector<glm::ivec2> m_levelSizes;      /*!< Size of each level of \ref m_levels. */
+	float m_texelSize;                         /*!< Size of a texel of the first level of \ref m_levels, in pixels. */
+	glm::vec2 m_screenSize;                    /*!< Size of the framebuffer of \ref m_levels. */
+	glm::mat4 m_viewProjection;                /*!< Camera of \ref m_levels. */
+};
+
+typedef std::shared_ptr<OcclusionCuller> OcclusionCullerPtr; /*!< Typedef for a smart pointer of OcclusionCuller */
+
+#endif
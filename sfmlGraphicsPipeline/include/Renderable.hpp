@@ -11,9 +11,11 @@
 #include <SFML/Graphics.hpp>
 #include <glm/glm.hpp>
 #include <memory>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "BoundingBox.hpp"
 #include "ShaderProgram.hpp"
 
 /* Forward declaration of the Viewer class in order to store a pointer to a
@@ -173,6 +175,75 @@ class Renderable
 	 */
 	virtual void animate(float time);
 
+	/** \brief Animate this renderable alone.
+	 *
+	 * Same as animate(), without afterAnimate(): the children of a hierarchical
+	 * renderable are not animated. This is used by the viewer, which animates
+	 * each renderable of its active list on its own.
+	 * \param time Current simulation time.
+	 */
+	void animateNode(float time);
+
+	/** \brief Get the time range over which this renderable is animated.
+	 *
+	 * Once a renderable has been animated a first time, the viewer only animates
+	 * it again when the simulation time is in this range, or has crossed it since
+	 * the last call: before and after the range, do_animate() must leave the
+	 * renderable as it is. The default range is unbounded, as do_animate() may
+	 * change the renderable at any time, so a class overriding do_animate()
+	 * should override this function too.
+	 *
+	 * Call animationChanged() when the range changes.
+	 * \param begin Output: the start of the range.
+	 * \param end Output: the end of the range.
+	 * \return False if do_animate() never changes the renderable after its first call.
+	 */
+	virtual bool getAnimationRange(float& begin, float& end) const;
+
+	/** \brief Get a counter incremented each time a renderable changes its
+	 * animation range or its hierarchy.
+	 *
+	 * The viewer rebuilds its list of the animated renderables when it changes.
+	 */
+	static unsigned int getAnimationRevision();
+
+	/** \brief Add an interval of time during which this renderable is active.
+	 *
+	 * A renderable with activity intervals is only drawn and animated, with its
+	 * children, when the simulation time is in one of them: this hides an object
+	 * outside of its scenes without moving it away. A renderable without
+	 * interval is always active. The overlapping intervals are merged.
+	 * \param start The start of the interval, included.
+	 * \param end The end of the interval, excluded. The interval is ignored if
+	 * it is empty.
+	 */
+	void addActiveInterval(float start, float end);
+
+	/** \brief Remove the activity intervals: the renderable is always active.
+	 */
+	void clearActiveIntervals();
+
+	/** \brief Get the activity intervals of this renderable.
+	 *
+	 * \return The [start, end) intervals, disjoint and sorted by time.
+	 */
+	const std::vector<std::pair<float, float> >& getActiveIntervals() const;
+
+	/** \brief Tell if this renderable is active at a given time.
+	 *
+	 * \param time The simulation time.
+	 * \return True if the time is in one of its intervals, or if it has none.
+	 */
+	bool isActiveAt(float time) const;
+
+	/** \brief Tell if this renderable is active at the current time of its viewer.
+	 *
+	 * This is updated by the viewer with an index of the intervals of the scene,
+	 * see ActivityTimeline.
+	 * \return False if the renderable, and its children, are not drawn and animated.
+	 */
+	bool isActive() const;
+
 	/**
 	 * \brief Handle a key pressed event.
 	 *
@@ -224,6 +295,71 @@ class Renderable
 	RENDER_MODE getRenderMode() const;
 	void setRenderMode(RENDER_MODE);
 
+	/**@brief Get the name of this renderable.
+	 *
+	 * The name is only used to identify the renderable in logs and profiling
+	 * results. It is empty by default.
+	 * @return The name of this renderable.
+	 */
+	const std::string& getName() const;
+
+	/**@brief Set the name of this renderable.
+	 *
+	 * @param name The new name of this renderable.
+	 */
+	void setName(const std::string& name);
+
+	/**@brief Get the bounding box of this renderable, in object space.
+	 *
+	 * \return The local bounding box, invalid if the bounds are unknown.
+	 */
+	const BoundingBox& getLocalBounds() const;
+
+	/**@brief Set the bounding box of this renderable, in object space.
+	 *
+	 * The bounds are used by the viewer to skip the renderables outside the
+	 * view of the camera. Set an invalid box if the geometry is unknown, or if
+	 * the shader program moves the vertices out of the box: the renderable is
+	 * then never skipped.
+	 * \param bounds The new local bounding box.
+	 */
+	void setLocalBounds(const BoundingBox& bounds);
+
+	/**@brief Update the bounding box of this renderable, in world space.
+	 *
+	 * Transform the local bounds with the model matrix. The hierarchical
+	 * renderables also include their children, which are drawn with them.
+	 * \return The world bounding box, invalid if the bounds are unknown.
+	 */
+	virtual const BoundingBox& updateWorldBounds();
+
+	/**@brief Get the bounding box of this renderable, in world space.
+	 *
+	 * \return The world bounding box computed by the last updateWorldBounds().
+	 */
+	const BoundingBox& getWorldBounds() const;
+
+	/**@brief Intersect a ray with the geometry of this renderable.
+	 *
+	 * The ray is the set of the points origin + t * direction, t >= 0, in world
+	 * space. The default implementation intersects the local bounding box.
+	 * \param origin The origin of the ray.
+	 * \param direction The direction of the ray.
+	 * \param distance Output: the value of t of the closest hit.
+	 * \return True if the ray hits the geometry.
+	 */
+	virtual bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+
+	/**@brief Intersect a ray with everything drawn by this renderable.
+	 *
+	 * This is intersectRay(), and the children for the hierarchical renderables.
+	 * \param origin The origin of the ray.
+	 * \param direction The direction of the ray.
+	 * \param distance Output: the value of t of the closest hit.
+	 * \return True if the ray hits the renderable.
+	 */
+	virtual bool pick(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+
 	// void displayTextInViewer(std::string text) const;
 
    private:
@@ -321,11 +457,26 @@ class Renderable
 	 */
 	virtual void do_animate(float time);
 
+	/** \brief Tell the viewers that the animation range or the hierarchy of a
+	 * renderable has changed.
+	 */
+	static void animationChanged();
+
+	/** \brief Tell the viewer that the world bounds of this renderable may have changed.
+	 *
+	 * The viewer refits the bounds of the root of its hierarchy before the next
+	 * draw, see Viewer::invalidateBounds(). This is called when the model matrix,
+	 * the transforms, the local bounds or the render mode change.
+	 */
+	void boundsChanged();
+
 	/** @name Protected members.
 	 * We want those members to be accessible in the derived classes.
 	 */
 	glm::mat4 m_model;                /*!< Model matrix of the renderable. */
 	ShaderProgramPtr m_shaderProgram; /*!< Shader program of the renderable. */
+	BoundingBox m_localBounds;        /*!< Bounds of the geometry in object space. */
+	BoundingBox m_worldBounds;        /*!< Bounds of the geometry in world space. */
 
 	/* The viewer is declared as a friend to be able to set the field m_viewer
 	 * when a Renderable is added to a viewer. If we want to get rid of the
@@ -345,6 +496,10 @@ class Renderable
 
 	int m_priority;
 	RENDER_MODE m_render_mode;
+	std::string m_name; /*!< Name of the renderable, used for logs and profiling. */
+
+	std::vector<std::pair<float, float> > m_activeIntervals; /*!< Intervals of activity, disjoint and sorted. */
+	bool m_active;                                           /*!< Activity at the current time of the viewer. */
 };
 
 typedef std::shared_ptr<Renderable> RenderablePtr; /*!< Typedef for smart pointer to renderable.*/
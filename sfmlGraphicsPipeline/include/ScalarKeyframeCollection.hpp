@@ -0,0 +1,58 @@
+#ifndef SCALAR_KEYFRAME_COLLECTION_HPP
+#define SCALAR_KEYFRAME_COLLECTION_HPP
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * \brief An ordered collection of scalar keyframes.
+ *
+ * This is the counterpart of KeyframeCollection for a single value, such as
+ * the weight of a morph target. The values are interpolated linearly, and the
+ * segment of the last interpolation is remembered in the same way.
+ */
+class ScalarKeyframeCollection
+{
+   public:
+	/**
+	 * \brief Build an empty collection.
+	 */
+	ScalarKeyframeCollection();
+
+	/**
+	 * \brief Add a keyframe to the collection.
+	 *
+	 * A keyframe at the time of an existing one replaces it.
+	 * \param value The value of the keyframe.
+	 * \param time The time of the keyframe.
+	 */
+	void add(float value, float time);
+
+	/**
+	 * \brief Interpolate the value at a given time.
+	 *
+	 * Out of the range of the keyframes, the closest keyframe is returned.
+	 * \param time Interpolation time.
+	 * \return The interpolated value, 0 if the collection is empty.
+	 */
+	float interpolate(float time) const;
+
+	/**
+	 * @brief Check if the collection is empty.
+	 */
+	bool empty() const;
+
+	/**
+	 * @brief Get the time range of the keyframes.
+	 *
+	 * @return False if the collection is empty.
+	 */
+	bool getTimeRange(float& begin, float& end) const;
+
+   private:
+	std::vector<float> m_times;  /*!< Times of the keyframes, increasing. */
+	std::vector<float> m_values; /*!< Values of the keyframes. */
+	mutable size_t m_cursor;     /*!< Segment of the last interpolation. */
+};
+
+#endif
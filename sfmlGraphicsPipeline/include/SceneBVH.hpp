@@ -0,0 +1,130 @@
+#ifndef SCENE_BVH_HPP
+#define SCENE_BVH_HPP
+
+/**@file
+ * @brief Define a bounding volume hierarchy over the renderables of a scene.
+ */
+
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+#include "Renderable.hpp"
+
+/**@brief Dynamic bounding volume hierarchy of renderables.
+ *
+ * This is a binary tree of axis aligned boxes: each leaf holds a renderable and
+ * a box slightly larger than its world bounds, each internal node the box of
+ * its two children. A query only visits the nodes whose box it intersects, which
+ * takes a logarithmic time for a balanced tree.
+ *
+ * The tree is dynamic: a leaf is inserted next to the sibling that increases the
+ * least the areas of the boxes, and the tree is rebalanced by rotations after
+ * each insertion or removal. When a renderable moves, its leaf is left untouched
+ * while the new bounds stay inside the enlarged box of the leaf; otherwise, the
+ * leaf is removed and inserted again, see update().
+ *
+ * \sa Viewer::pick(), Viewer::queryRadius()
+ */
+class SceneBVH
+{
+   public:
+	/**@brief Build an empty hierarchy.
+	 */
+	SceneBVH();
+
+	/**@brief Instance destructor.
+	 */
+	~SceneBVH();
+
+	/**@brief Insert, move or remove a renderable.
+	 *
+	 * @param renderable The renderable.
+	 * @param bounds The world bounds of the renderable. If they are invalid, the
+	 * renderable is removed from the hierarchy.
+	 * @return True if the tree has been modified.
+	 */
+	bool update(const RenderablePtr& renderable, const BoundingBox& bounds);
+
+	/**@brief Remove a renderable from the hierarchy.
+	 *
+	 * @param renderable The renderable, ignored if it is not in the hierarchy.
+	 */
+	void remove(const RenderablePtr& renderable);
+
+	/**@brief Remove all the renderables.
+	 */
+	void clear();
+
+	/**@brief Tell if a renderable is in the hierarchy.
+	 */
+	bool contains(const RenderablePtr& renderable) const;
+
+	/**@brief Get the renderables that may be inside a frustum.
+	 *
+	 * @param frustum The frustum.
+	 * @param result Output vector, the renderables are appended to it.
+	 */
+	void query(const Frustum& frustum, std::vector<RenderablePtr>& result) const;
+
+	/**@brief Get the renderables that may be inside a sphere.
+	 *
+	 * @param center The center of the sphere.
+	 * @param radius The radius of the sphere.
+	 * @param result Output vector, the renderables are appended to it.
+	 */
+	void query(const glm::vec3& center, float radius, std::vector<RenderablePtr>& result) const;
+
+	/**@brief Get the first renderable hit by a ray.
+	 *
+	 * The renderables whose box is hit are tested with Renderable::pick().
+	 * @param origin The origin of the ray.
+	 * @param direction The direction of the ray.
+	 * @param distance Output: the distance along the ray to the hit, in units of \a direction.
+	 * @return The renderable hit first, nullptr if none.
+	 */
+	RenderablePtr raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
+
+	/**@brief Get the number of renderables in the hierarchy.
+	 */
+	size_t size() const;
+
+	/**@brief Get the height of the tree, 0 for a single leaf.
+	 */
+	int height() const;
+
+   private:
+	SceneBVH(const SceneBVH&);
+	SceneBVH& operator=(const SceneBVH&);
+
+	struct Node
+	{
+		BoundingBox box;         /*!< Enlarged bounds for a leaf, union of the children otherwise. */
+		BoundingBox bounds;      /*!< Exact bounds of the renderable of a leaf. */
+		int parent;              /*!< Index of the parent, or of the next free node. */
+		int children[2];         /*!< Indices of the children, -1 for a leaf. */
+		int height;              /*!< Height of the subtree, 0 for a leaf, -1 for a free node. */
+		RenderablePtr renderable;/*!< Renderable of a leaf. */
+
+		bool isLeaf() const
+		{
+			return children[0] < 0;
+		}
+	};
+
+	int allocateNode();
+	void freeNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int node);
+	void fixUpwards(int node);
+
+	std::vector<Node> m_nodes;
+	int m_root;       /*!< Index of the root, -1 if the tree is empty. */
+	int m_freeList;   /*!< First free node, -1 if none. */
+	std::unordered_map<Renderable*, int> m_leaves; /*!< Leaf of each renderable. */
+};
+
+#endif
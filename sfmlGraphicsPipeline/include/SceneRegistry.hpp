@@ -0,0 +1,93 @@
+#ifndef SCENE_REGISTRY_HPP
+#define SCENE_REGISTRY_HPP
+
+/**@file
+ * @brief Define the registry of the scene graph of a viewer.
+ */
+
+#include <functional>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "Renderable.hpp"
+
+/**@brief Order the renderables by decreasing priority.
+ */
+struct PriorityComparator
+{
+	bool operator()(const RenderablePtr& a, const RenderablePtr& b) const;
+};
+
+/**@brief Owner of the roots of the scene graph.
+ *
+ * A hierarchical renderable draws and animates its children, see
+ * HierarchicalRenderable::afterDraw(). If a child is also drawn as a root of
+ * the scene, it is drawn and animated twice per frame. The registry keeps the
+ * scene a forest: only the renderables without parent are roots, and each
+ * renderable is registered once. A child given as a root is rejected, and a root
+ * that becomes a child is removed from the roots by validate(), with a warning
+ * naming the renderable in both cases. The root of its hierarchy is registered
+ * instead, if it was not already.
+ */
+class SceneRegistry
+{
+   public:
+	typedef std::multiset<RenderablePtr, PriorityComparator> RootSet; /*!< Roots, by decreasing priority. */
+
+	/**@brief Build an empty registry.
+	 */
+	SceneRegistry();
+
+	/**@brief Register a root of the scene.
+	 *
+	 * @param renderable The renderable to register.
+	 * @return False if \a renderable is already registered or is the child of
+	 * a hierarchy: it is then not added as a root, but the root of its hierarchy is.
+	 */
+	bool addRoot(const RenderablePtr& renderable);
+
+	/**@brief Unregister a root, ignored if it is not a root.
+	 */
+	void remove(const RenderablePtr& renderable);
+
+	/**@brief Unregister all the roots.
+	 */
+	void clear();
+
+	/**@brief Get the roots of the scene.
+	 */
+	const RootSet& getRoots() const;
+
+	/**@brief Tell if a renderable is a root of the scene.
+	 */
+	bool isRoot(const RenderablePtr& renderable) const;
+
+	/**@brief Remove the roots that have become children since they were registered.
+	 *
+	 * @param demoted Output vector, the removed roots are appended to it.
+	 * @return The number of removed roots.
+	 */
+	size_t validate(std::vector<RenderablePtr>& demoted);
+
+	/**@brief Call a function on each renderable of the scene, exactly once.
+	 *
+	 * The roots are visited by decreasing priority, each followed by its
+	 * descendants in depth first order.
+	 * @param visit The function to call.
+	 */
+	void forEachNode(const std::function<void(const RenderablePtr&)>& visit) const;
+
+	/**@brief Get a name for a renderable in the logs.
+	 */
+	static std::string describe(const RenderablePtr& renderable);
+
+   private:
+	SceneRegistry(const SceneRegistry&);
+	SceneRegistry& operator=(const SceneRegistry&);
+
+	RootSet m_roots;                       /*!< Roots of the scene. */
+	std::unordered_set<Renderable*> m_ids; /*!< Roots of the scene, for the lookups. */
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 /**@brief Assembly of the graphics pipeline programmable steps.
  *
@@ -81,6 +82,42 @@ class ShaderProgram
 	 */
 	void reload();
 
+	/** @brief Reload the shader sources without waiting for the driver.
+	 *
+	 * Submit the compilation and the linking of the shader sources, but do not
+	 * wait for the result: this shader program keeps using its current GPU
+	 * program until pollReload() reports that the new one is ready. When the
+	 * driver supports GL_ARB_parallel_shader_compile, the compilation happens
+	 * on the driver threads and the rendering never stalls.
+	 *
+	 * Calling this function while a reload is pending discards the pending one.
+	 */
+	void reloadAsync();
+
+	/** @brief Finish a pending asynchronous reload if it is ready.
+	 *
+	 * Check if the program submitted by reloadAsync() is compiled and linked.
+	 * If so, it replaces the current GPU program when it is valid, and it is
+	 * discarded otherwise.
+	 * @return True if a pending reload has been finished by this call.
+	 */
+	bool pollReload();
+
+	/** @brief Tell if an asynchronous reload is pending.
+	 *
+	 * @return True if reloadAsync() has been called and pollReload() did not finish it yet.
+	 */
+	bool isReloading() const;
+
+	/**@brief Get the source files this program is built from.
+	 *
+	 * The list contains the vertex and the fragment shader files, followed by
+	 * every file they pull with an \c #include "file" directive. Included file
+	 * names are relative to the directory of the including file.
+	 * @return The files of the last successful load.
+	 */
+	const std::vector<std::string>& getSourceFiles() const;
+
 	/**
 	 * Bind this program to the GPU. This is necessary to render objects or to
 	 * send uniforms/attributes values.
@@ -142,12 +179,24 @@ class ShaderProgram
 
    private:
 	void resources_introspection();
+	bool begin_link(const std::string& vertex_file_path, const std::string& fragment_file_path);
+	void end_link();
+	void discard_pending();
 
 	unsigned int m_programId;
 	std::unordered_map<std::string, int> m_uniforms;
 	std::unordered_map<std::string, int> m_attributes;
 	std::string m_vertexFilename;
 	std::string m_fragmentFilename;
+	std::vector<std::string> m_sourceFiles;
+
+	unsigned int m_pendingProgramId;                  /*!< Program being compiled and linked, 0 if none. */
+	unsigned int m_pendingVertexId;                   /*!< Vertex shader of the pending program. */
+	unsigned int m_pendingFragmentId;                 /*!< Fragment shader of the pending program. */
+	std::string m_pendingVertexFilename;              /*!< Vertex shader file of the pending program. */
+	std::string m_pendingFragmentFilename;            /*!< Fragment shader file of the pending program. */
+	std::vector<std::string> m_pendingVertexFiles;    /*!< Source files of the pending vertex shader. */
+	std::vector<std::string> m_pendingFragmentFiles;  /*!< Source files of the pending fragment shader. */
 };
 
 typedef std::shared_ptr<ShaderProgram> ShaderProgramPtr; /*!< Typedef for a smart pointer of ShaderProgram */
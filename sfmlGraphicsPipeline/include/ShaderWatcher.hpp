@@ -0,0 +1,73 @@
+#ifndef SHADER_WATCHER_HPP
+#define SHADER_WATCHER_HPP
+
+/**@file
+ * @brief Define a watcher of shader source files.
+ *
+ * This file defines the ShaderWatcher class, which tells which shader programs
+ * should be reloaded when their source files are modified on the disk.
+ */
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderProgram.hpp"
+
+/**@brief Watch the source files of shader programs.
+ *
+ * A shader watcher knows the source files of the shader programs it watches,
+ * including the files they include (see ShaderProgram::getSourceFiles()).
+ * When one of those files is modified, only the programs depending on it are
+ * reported, so that the Viewer reloads them and nothing else.
+ *
+ * On Linux, modifications are notified by inotify. We watch the directories
+ * rather than the files: many editors save a file by replacing it, which would
+ * silently end a watch on the file itself. Elsewhere, or if inotify is not
+ * available, the modification dates of the files are compared at each poll.
+ */
+class ShaderWatcher
+{
+   public:
+	/**@brief Build a watcher with no program to watch.
+	 */
+	ShaderWatcher();
+
+	/**@brief Instance destructor.
+	 */
+	~ShaderWatcher();
+
+	/**@brief Watch the source files of a program.
+	 *
+	 * Start watching the source files of a program. If the program was already
+	 * watched, its list of files is updated: call this again after a reload, as
+	 * the program may include other files now.
+	 * @param program The program to watch.
+	 */
+	void watch(const ShaderProgramPtr& program);
+
+	/**@brief Get the programs whose sources changed since the last poll.
+	 *
+	 * This function never blocks. Each program appears at most once in the
+	 * result, even if several of its files changed.
+	 * @param programs Output vector filled with the programs to reload.
+	 */
+	void poll(std::vector<ShaderProgramPtr>& programs);
+
+   private:
+	ShaderWatcher(const ShaderWatcher&);
+	ShaderWatcher& operator=(const ShaderWatcher&);
+
+	void watchFile(const std::string& filename, const ShaderProgramPtr& program);
+	void notify(const std::string& filename, std::vector<ShaderProgramPtr>& programs);
+
+	/** Programs depending on each (canonical) file name. */
+	std::unordered_map<std::string, std::vector<ShaderProgramPtr> > m_dependents;
+	/** Last known modification date of each file, used when polling. */
+	std::unordered_map<std::string, long long> m_modificationDates;
+
+	int m_inotifyFd;                                      /*!< inotify instance, -1 when polling. */
+	std::unordered_map<int, std::string> m_directories;  /*!< Watched directory of each inotify watch descriptor. */
+};
+
+#endif
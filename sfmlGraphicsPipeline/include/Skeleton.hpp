@@ -0,0 +1,118 @@
+#ifndef SKELETON_HPP
+#define SKELETON_HPP
+
+/**@file
+ * @brief Define a hierarchy of animated joints, used to skin a mesh.
+ */
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AnimationClip.hpp"
+#include "GeometricTransformation.hpp"
+#include "KeyframeCollection.hpp"
+
+/**@brief Hierarchy of joints deforming a skinned mesh.
+ *
+ * Each joint has a parent, added before it, and a transform relative to this
+ * parent: its rest transform, or the sample of its keyframes or its clip if
+ * it has some. The transform of a joint in the space of the mesh is the
+ * product of the transforms from the root to the joint, like the model matrix
+ * of a HierarchicalRenderable.
+ *
+ * The inverse bind matrix of a joint brings a vertex from the space of the mesh
+ * to the space of the joint in the bind pose. The palette of the skeleton, see
+ * computePalette(), holds for each joint its transform times its inverse bind
+ * matrix: the matrix moving a vertex bound to the joint from the bind pose to
+ * the current pose.
+ *
+ * \sa SkinnedMeshRenderable
+ */
+class Skeleton
+{
+   public:
+	/**@brief Largest number of joints, the size of the palette in the shaders.
+	 */
+	static const unsigned int max_joints;
+
+	/**@brief Build an empty skeleton.
+	 */
+	Skeleton();
+
+	/**@brief Add a joint.
+	 *
+	 * @param name The name of the joint.
+	 * @param parent The index of the parent joint, -1 for a root.
+	 * @param restTransform The transform relative to the parent when the joint
+	 * is not animated.
+	 * @param inverseBindMatrix The inverse of the transform of the joint in
+	 * the space of the mesh, in the bind pose. The identity if the vertices
+	 * bound to the joint are in the space of the joint.
+	 * @return The index of the joint, -1 if the skeleton is full.
+	 */
+	int addJoint(const std::string& name, int parent, const glm::mat4& restTransform,
+	             const glm::mat4& inverseBindMatrix = glm::mat4(1.0f));
+
+	/**@brief Get the number of joints.
+	 */
+	size_t getJointCount() const;
+
+	/**@brief Find a joint by its name.
+	 *
+	 * @return The index of the joint, -1 if there is none with this name.
+	 */
+	int findJoint(const std::string& name) const;
+
+	/**@brief Add a keyframe to the transform of a joint relative to its parent.
+	 */
+	void addKeyframe(int joint, const GeometricTransformation& transformation, float time);
+
+	/**@brief Add the keyframes of a .animation file to a joint.
+	 *
+	 * @param joint The index of the joint.
+	 * @param animation_filename Name of the file containing the keyframes.
+	 * @param time_shift The amount of time to shift all the keyframes by.
+	 */
+	void addKeyframesFromFile(int joint, const std::string& animation_filename, float time_shift);
+
+	/**@brief Animate a joint with a baked clip instead of its keyframes.
+	 *
+	 * @param joint The index of the joint.
+	 * @param clip The clip, or nullptr to go back to the keyframes.
+	 */
+	void setClip(int joint, const AnimationClipPtr& clip);
+
+	/**@brief Get the time range of the animation of the joints.
+	 *
+	 * @return False if no joint is animated.
+	 */
+	bool getAnimationRange(float& begin, float& end) const;
+
+	/**@brief Compute the palette of the skeleton at a given time.
+	 *
+	 * @param time The animation time.
+	 * @param palette Output: one matrix per joint.
+	 */
+	void computePalette(float time, std::vector<glm::mat4>& palette) const;
+
+   private:
+	/**@brief Joint of the skeleton.
+	 */
+	struct Joint
+	{
+		std::string name;             /*!< Name of the joint. */
+		int parent;                   /*!< Index of the parent, -1 for a root. */
+		glm::mat4 restTransform;      /*!< Transform relative to the parent without animation. */
+		glm::mat4 inverseBindMatrix;  /*!< From the space of the mesh to the space of the joint, in the bind pose. */
+		KeyframeCollection keyframes; /*!< Keyframes of the transform relative to the parent. */
+		AnimationClipPtr clip;        /*!< Clip replacing the keyframes, if any. */
+	};
+
+	std::vector<Joint> m_joints; /*!< Joints, a parent before its children. */
+};
+
+typedef std::shared_ptr<Skeleton> SkeletonPtr; /*!< Typedef for a smart pointer of Skeleton */
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef TRANSFORM_STORE_HPP
+#define TRANSFORM_STORE_HPP
+
+/**@file
+ * @brief Define a flat storage for the transforms of hierarchies.
+ *
+ * This file defines the TransformStore class, which stores the transforms of
+ * HierarchicalRenderable instances in contiguous arrays.
+ */
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+/**@brief Contiguous storage of hierarchical transforms.
+ *
+ * Each HierarchicalRenderable stores its transforms and points to its parent
+ * and children: updating a hierarchy chases pointers all over the heap. A
+ * transform store keeps the transforms of many hierarchies in arrays instead:
+ * the index of the parent, the global transform (relative to the parent), the
+ * local transform, the total global transform and the model matrix of each
+ * node. The nodes are sorted by depth, so that a parent always comes before its
+ * children: all the model matrices are then updated in one linear loop, see
+ * update(). The nodes of a same depth do not depend on each other, so each
+ * depth level is split across threads when it is large enough.
+ *
+ * The nodes are identified by handles, which stay valid when the nodes are
+ * sorted. Only the transforms that have changed since the last update, and those
+ * of their descendants, are recomputed.
+ *
+ * \sa HierarchicalRenderable::setTransformStore()
+ */
+class TransformStore
+{
+   public:
+	/**@brief Identifier of a node of the store.
+	 */
+	typedef unsigned int Handle;
+
+	/**@brief Handle of no node, used for the parent of the roots.
+	 */
+	static const Handle null_handle;
+
+	/**@brief Build an empty store.
+	 */
+	TransformStore();
+
+	/**@brief Instance destructor.
+	 */
+	~TransformStore();
+
+	/**@brief Add a node to the store.
+	 *
+	 * @param parent The handle of the parent, null_handle for a root.
+	 * @param globalTransform The transform of the node relative to its parent.
+	 * @param localTransform The transform applied to the node only.
+	 * @return The handle of the new node.
+	 */
+	Handle add(Handle parent, const glm::mat4& globalTransform, const glm::mat4& localTransform);
+
+	/**@brief Remove a node from the store.
+	 *
+	 * The children of the node become roots. The handle may be reused by add().
+	 * @param handle The node to remove.
+	 */
+	void remove(Handle handle);
+
+	/**@brief Change the parent of a node.
+	 *
+	 * @param handle The node.
+	 * @param parent The handle of the new parent, null_handle to make the node a root.
+	 */
+	void setParent(Handle handle, Handle parent);
+
+	/**@brief Set the transform of a node relative to its parent.
+	 */
+	void setGlobalTransform(Handle handle, const glm::mat4& globalTransform);
+
+	/**@brief Set the transform applied to a node only.
+	 */
+	void setLocalTransform(Handle handle, const glm::mat4& localTransform);
+
+	/**@brief Get the total global transform of a node, as of the last update().
+	 */
+	const glm::mat4& totalGlobalTransform(Handle handle) const;
+
+	/**@brief Get the model matrix of a node, as of the last update().
+	 */
+	const glm::mat4& modelMatrix(Handle handle) const;
+
+	/**@brief Tell if a transform has changed since the last update().
+	 */
+	bool isDirty() const;
+
+	/**@brief Update the total global transforms and the model matrices.
+	 *
+	 * Sort the nodes if the hierarchy has changed, then recompute the matrices
+	 * that are out of date, from the roots to the leaves. Nothing is done if no
+	 * transform has changed since the last update.
+	 */
+	void update();
+
+	/**@brief Get the number of nodes in the store.
+	 */
+	size_t size() const;
+
+   private:
+	TransformStore(const TransformStore&);
+	TransformStore& operator=(const TransformStore&);
+
+	void sort();
+
+	// Per node arrays, sorted by depth once sort() has been called
+	std::vector<int> m_parents;          /*!< Index of the parent, -1 for the roots. */
+	std::vector<glm::mat4> m_globals;    /*!< Transform relative to the parent. */
+	std::vector<glm::mat4> m_locals;     /*!< Transform of the node only. */
+	std::vector<glm::mat4> m_totals;     /*!< Total global transform. */
+	std::vector<glm::mat4> m_models;     /*!< Model matrix. */
+	std::vector<unsigned char> m_dirty;  /*!< Which transforms have changed since the last update. */
+	std::vector<unsigned char> m_moved;  /*!< True if the total global transform has changed in the last update. */
+	std::vector<Handle> m_handles;       /*!< Handle of the node, null_handle for a removed node. */
+
+	std::vector<int> m_indices;          /*!< Index of the node of each handle, -1 for a free handle. */
+	std::vector<Handle> m_freeHandles;   /*!< Handles of the removed nodes. */
+	std::vector<size_t> m_levels;        /*!< Index of the first node of each depth, and the number of nodes. */
+
+	bool m_sorted;                       /*!< False if the nodes must be sorted before the next update. */
+	bool m_dirtyNodes;                   /*!< True if a node is dirty. */
+};
+
+typedef std::shared_ptr<TransformStore> TransformStorePtr; /*!< Typedef for a smart pointer of TransformStore */
+
+#endif
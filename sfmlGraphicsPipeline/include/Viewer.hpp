@@ -8,7 +8,11 @@
  * the renderables, the user input and the shader programs.
  */
 
+#include "ActivityTimeline.hpp"
+#include "AssetResidency.hpp"
 #include "Camera.hpp"
+#include "DeferredRenderer.hpp"
+#include "DepthPrepass.hpp"
 #include "Renderable.hpp"
 #include "lighting/LightedMeshRenderable.hpp"
 #include "lighting/Light.hpp"
@@ -24,14 +28,16 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "FPSCounter.hpp"
-
-struct PriorityComparator
-{
-	bool operator()(const RenderablePtr& a, const RenderablePtr& b) const;
-};
+#include "GPUProfiler.hpp"
+#include "OcclusionCuller.hpp"
+#include "SceneBVH.hpp"
+#include "SceneRegistry.hpp"
+#include "ShaderWatcher.hpp"
+#include "TransformStore.hpp"
 
 /**
  * \brief Manage the rendering and the interaction in a window.
@@ -84,11 +90,14 @@ class Viewer
 	 * program management of the Viewer quite simple:
 	 * \li add a shader program to manage
 	 * \li reload all managed shader program
+	 * \li automatically reload the programs whose sources changed on the disk
 	 * @{
 	 */
 	/**@brief Manage a shader program.
 	 *
-	 * Add a shader program to the list of managed programs.
+	 * Add a shader program to the list of managed programs. Its source files
+	 * are watched: when one of them is saved, the program is reloaded in the
+	 * background.
 	 * @param program The shader program to manage.
 	 */
 	void addShaderProgram(const ShaderProgramPtr &program);
@@ -96,11 +105,13 @@ class Viewer
 	 *
 	 * Reload each managed shader program, to use possibly newer shader sources.
 	 * This is useful if you want to see the effects immediately of a modification
-	 * in the shader sources on the scene.
+	 * in the shader sources on the scene. The reload does not block: each program
+	 * keeps its current version until the new one is linked.
 	 *
-	 * \sa ShaderProgram::reload()
+	 * \sa ShaderProgram::reloadAsync()
 	 */
 	void reloadShaderPrograms();
+	/**@}*/
 
 	/**@name Main loop functions
 	 * @{*/
@@ -117,7 +128,10 @@ class Viewer
 	void display();
 	/**\brief Draw the renderables.
 	 *
-	 * Iterate over all the renderables of \ref m_renderables and call their Renderable::draw() function.
+	 * Iterate over the active roots of \ref m_scene and call their Renderable::draw() function, which draws their children.
+	 * The renderables inactive at the current time are not visited, see Renderable::addActiveInterval() and updateTimeline().
+	 * Only the roots whose bounds have changed are refitted in \ref m_bvh, and the frustum culling draws
+	 * the roots given by its query, with the roots that cannot be culled.
 	 * For each renderable, the viewer will first bind its shader, send camera information to
 	 * the GPU, draw the renderable and unbind its shader.
 	 */
@@ -125,7 +139,13 @@ class Viewer
 
 	/** \brief Animate the renderables.
 	 *
-	 * Iterate over all the renderable of m_renderables and call their function animate.
+	 * Only the renderables of the active list of \ref m_animations whose animation range
+	 * overlaps the time elapsed since the last frame are animated, see
+	 * Renderable::getAnimationRange(): the static renderables cost nothing once
+	 * placed. Their keyframes, and those of the lights and camera, are first
+	 * sampled in parallel with OpenMP. Then each of them is animated, parents
+	 * first, which applies the samples. Finally, the transforms of the
+	 * hierarchies are propagated.
 	 */
 	void animate();
 	/** \brief handleEvent
@@ -163,14 +183,46 @@ class Viewer
 	 */
 	glm::vec3 worldToWindow(const glm::vec3& worldCoordinate);
 
+	/**@brief Get the renderable under a window point.
+	 *
+	 * Cast a ray from the camera through the point, and return the first
+	 * renderable it hits. The ray is tested against the bounding volume
+	 * hierarchy of the scene, then against the triangles of the meshes.
+	 * \param x The horizontal window coordinate, in pixels from the left.
+	 * \param y The vertical window coordinate, in pixels from the top.
+	 * \return The renderable hit, nullptr if none.
+	 */
+	RenderablePtr pick(int x, int y);
+
+	/**@brief Get the renderables near a point.
+	 *
+	 * \param center The center of the query, in world space.
+	 * \param radius The radius of the query.
+	 * \param result Output vector filled with the renderables whose world bounds
+	 * intersect the sphere. The renderables with unknown bounds are ignored.
+	 */
+	void queryRadius(const glm::vec3& center, float radius, std::vector<RenderablePtr>& result);
+
 	/**
 	 * \brief addRenderable
 	 *
-	 * Add a renderable to the set of renderabbles \ref m_renderables of the viewer.
-	 * \param r A renderable to add to \ref m_renderables.
+	 * Add a renderable to the roots of the scene \ref m_scene of the viewer.
+	 * The transforms of a hierarchical renderable are kept in \ref m_transformStore.
+	 * A child of a hierarchy is not added, as its parent draws it: a warning names it.
+	 * \param r A renderable to add to \ref m_scene.
 	 */
 	void addRenderable(const RenderablePtr& r);
 
+	/**
+	 * \brief Refit the bounds of a root of the scene before the next draw.
+	 *
+	 * Called by Renderable::boundsChanged(). Only the invalidated roots are
+	 * refitted in \ref m_bvh, the other roots keep their bounds.
+	 * \param root The root whose world bounds may have changed, ignored if it is
+	 * not a root of \ref m_scene.
+	 */
+	void invalidateBounds(Renderable* root);
+
 	/**
 	 * @brief Take a screen shot.
 	 *
@@ -216,6 +268,42 @@ class Viewer
 	 * \param loopDuration Set \ref m_loopDuration value. 0.0 is the default value.
 	 */
 	void setAnimationLoop(bool animationLoop, float loopDuration = 0.0);
+
+	/** \brief Jump to a time of the animation.
+	 *
+	 * The keyframed renderables are placed at this time directly. The dynamic
+	 * systems restore their last checkpoint before it and simulate the rest,
+	 * see DynamicSystemRenderable. The scene is updated at the next animate(),
+	 * even if the animation is stopped. The soundtrack cannot start in the
+	 * middle: it is stopped until the animation is reset.
+	 * \param time The time, as returned by getTime().
+	 */
+	void seek(float time);
+
+	/** \brief Stop the animation and move it by some frames.
+	 *
+	 * \param frames The number of frames, negative to go back.
+	 * \sa setFrameDuration()
+	 */
+	void stepFrames(int frames);
+
+	/** \brief Set the duration of a frame for stepFrames().
+	 *
+	 * \param seconds The duration of a frame, 1/30 second by default.
+	 */
+	void setFrameDuration(float seconds);
+
+	/** \brief Play the animation backward or forward.
+	 *
+	 * Played backward, the animation wraps to the end of the loop, or stops at
+	 * the beginning if it does not loop. The soundtrack is stopped.
+	 * \param reverse True to play the animation backward.
+	 */
+	void setReverse(bool reverse);
+
+	/** \brief Tell if the animation is played backward.
+	 */
+	bool isReversed() const;
 	/**@}*/
 	
 	void setSoundtrack(const std::string& path);
@@ -227,6 +315,145 @@ class Viewer
 	void addSpotLight(const SpotLightPtr& spotLight);
 
 	void setBackgroundColor(const glm::vec4& color);
+
+	/**@name Deferred shading
+	 * @{
+	 */
+	/**@brief Enable or disable the deferred shading.
+	 *
+	 * When enabled, the opaque lighted meshes drawn with a program given to
+	 * addDeferredShaderProgram() are shaded once per pixel by a DeferredRenderer.
+	 * The other renderables are drawn as usual after them.
+	 * \param enabled True to enable the deferred shading.
+	 */
+	void setDeferredShading(bool enabled);
+
+	/**@brief Tell if the deferred shading is enabled.
+	 *
+	 * \return True if the deferred shading is enabled.
+	 */
+	bool isDeferredShadingEnabled() const;
+
+	/**@brief Let the deferred renderer draw the renderables of a program.
+	 *
+	 * \param forwardProgram A program whose renderables can be deferred.
+	 * \param model The shading of this program, reproduced by the deferred renderer.
+	 * \sa DeferredRenderer::addShaderProgram()
+	 */
+	void addDeferredShaderProgram(const ShaderProgramPtr& forwardProgram, DeferredRenderer::SHADING_MODEL model);
+	/**@}*/
+
+	/**@name Depth pre-pass
+	 * @{
+	 */
+	/**@brief Enable or disable the depth pre-pass.
+	 *
+	 * When enabled, the opaque renderables drawn with a program given to
+	 * addDepthPrepassShaderProgram() are first drawn in the depth buffer only.
+	 * They are then shaded with the depth writes disabled, so that each pixel
+	 * is shaded once.
+	 * \param enabled True to enable the depth pre-pass.
+	 * \param equalDepthTest True to shade with GL_EQUAL instead of GL_LEQUAL.
+	 * \sa DepthPrepass
+	 */
+	void setDepthPrepass(bool enabled, bool equalDepthTest = false);
+
+	/**@brief Tell if the depth pre-pass is enabled.
+	 *
+	 * \return True if the depth pre-pass is enabled.
+	 */
+	bool isDepthPrepassEnabled() const;
+
+	/**@brief Let the depth pre-pass draw the renderables of a program.
+	 *
+	 * \param forwardProgram A program whose renderables can be pre-passed.
+	 * \param alphaCutoff The alpha under which the program discards texels, 0 if it does not.
+	 * \sa DepthPrepass::addShaderProgram()
+	 */
+	void addDepthPrepassShaderProgram(const ShaderProgramPtr& forwardProgram, float alphaCutoff = 0.0f);
+	/**@}*/
+
+	/**@name Frustum culling
+	 * @{
+	 */
+	/**@brief Statistics of the frustum culling of the last frame.
+	 */
+	struct CullingStats
+	{
+		unsigned int tested;   /*!< Number of renderables tested against the frustum or the occluders. */
+		unsigned int culled;   /*!< Number of renderables skipped because they were outside the frustum. */
+		unsigned int occluded; /*!< Number of renderables skipped because they were hidden by the occluders. */
+	};
+
+	/**@brief Enable or disable the frustum culling.
+	 *
+	 * When enabled, the renderables drawn in the window whose world bounds
+	 * are outside the view frustum of the camera are not drawn. The renderables
+	 * with unknown bounds are always drawn. The culling is enabled by default,
+	 * and uses the bounding volume hierarchy of the scene.
+	 * \param enabled True to enable the frustum culling.
+	 * \sa Renderable::setLocalBounds()
+	 */
+	void setFrustumCulling(bool enabled);
+
+	/**@brief Tell if the frustum culling is enabled.
+	 */
+	bool isFrustumCullingEnabled() const;
+
+	/**@brief Get the statistics of the frustum culling of the last frame.
+	 */
+	const CullingStats& getCullingStats() const;
+	/**@}*/
+
+	/**@name Occlusion culling
+	 * @{
+	 */
+	/**@brief Enable or disable the occlusion culling.
+	 *
+	 * When enabled, the renderables drawn in the window whose world bounds are
+	 * hidden behind the opaque renderables of the previous frames are not drawn.
+	 * The occlusion culling is disabled by default.
+	 * \param enabled True to enable the occlusion culling.
+	 * \sa OcclusionCuller
+	 */
+	void setOcclusionCulling(bool enabled);
+
+	/**@brief Tell if the occlusion culling is enabled.
+	 */
+	bool isOcclusionCullingEnabled() const;
+
+	/**@brief Show the bounds of the renderables rejected by the occlusion culling.
+	 *
+	 * \param enabled True to draw the bounds of the occluded renderables in red,
+	 * over the frame.
+	 */
+	void setOcclusionDebug(bool enabled);
+
+	/**@brief Tell if the bounds of the occluded renderables are shown.
+	 */
+	bool isOcclusionDebugEnabled() const;
+	/**@}*/
+
+	/**@brief Get the GPU profiler of the viewer.
+	 *
+	 * When enabled, the profiler times the passes of each frame, and each
+	 * renderable by name if its renderable timing is enabled.
+	 * \return The GPU profiler.
+	 */
+	GPUProfiler& getProfiler();
+
+	/**@brief Get the residency manager of the viewer.
+	 *
+	 * The meshes added to it are loaded around their activity intervals and
+	 * released after them, see AssetResidency. It is updated with the activity
+	 * of the renderables, before they are animated or drawn.
+	 * \return The residency manager.
+	 */
+	AssetResidency& getAssetResidency();
+
+	/**@brief Get the size of the render window, in pixels.
+	 */
+	sf::Vector2u getWindowSize() const;
 	
 	void setTimeFactor(float factor);
 
@@ -282,15 +509,117 @@ class Viewer
 	 */
 	void mouseMoveEvent(sf::Event& e);
 
+	/**
+	 * \brief Reload the shader programs whose sources changed.
+	 *
+	 * Start the reload of the programs reported by \ref m_shaderWatcher, and
+	 * switch to the new version of the programs that finished linking.
+	 */
+	void updateShaderPrograms();
+
+	/**
+	 * \brief Get the deferred renderer, creating it if needed.
+	 */
+	const DeferredRendererPtr& deferredRenderer();
+
+	/**
+	 * \brief Get the depth pre-pass, creating it if needed.
+	 */
+	const DepthPrepassPtr& depthPrepass();
+
+	/**
+	 * \brief Get the occlusion culler, creating it if needed.
+	 */
+	const OcclusionCullerPtr& occlusionCuller();
+
+	/**
+	 * \brief Capture the depth of the opaque renderables for the occlusion culling.
+	 */
+	void captureOccluders();
+
+	/**
+	 * \brief Remove from the scene and the hierarchy of bounds the roots that have become children.
+	 */
+	void validateScene();
+
+	/**
+	 * \brief Rebuild \ref m_animations and its active list from the renderables of the scene.
+	 */
+	void updateAnimations();
+
+	struct RootState;
+
+	/**
+	 * \brief Rebuild \ref m_roots and the active roots from the roots of the scene.
+	 */
+	void updateRoots();
+
+	/**
+	 * \brief Update the active list of \ref m_animations for a subtree whose activity has changed.
+	 *
+	 * The renderables of the subtree that are active in their hierarchy join the
+	 * list, the others leave it.
+	 * \param node The index of the root of the subtree in \ref m_animations.
+	 */
+	void updateActiveAnimations(size_t node);
+
+	/**
+	 * \brief Add a root to the active roots, or remove it from them and from \ref m_bvh.
+	 */
+	void setRootActive(RootState& root, bool active);
+
+	/**
+	 * \brief Refit the invalidated roots in \ref m_bvh, and move them between
+	 * the cullable roots and \ref m_uncullableRoots.
+	 */
+	void refitBounds();
+
+	/**
+	 * \brief Update the activity of the renderables with \ref m_timeline,
+	 * and the residency of the meshes with \ref m_residency.
+	 *
+	 * The index, \ref m_animations and \ref m_roots are rebuilt when the scene
+	 * or the intervals have changed. Otherwise, only the renderables whose
+	 * activity changes are added to or removed from the active roots and the
+	 * active list of \ref m_animations: the inactive renderables are not
+	 * visited by draw() and animate().
+	 * \param time The current simulation time.
+	 */
+	void updateTimeline(float time);
+
+	/**
+	 * \brief Log the last GPU profile and save the profile history.
+	 */
+	void dumpProfile();
+
 	Camera m_camera;                                                /*!< Camera used to render the scene in the Viewer. */
 	sf::RenderWindow m_window;                                      /*!< Pointer to the render window. */
 	sf::RenderTexture m_texture;                                    /*!< Pointer to the render texture. */
-	std::multiset<RenderablePtr, PriorityComparator> m_renderables; /*!< Ordered set of renderables that the viewer displays. */
+	SceneRegistry m_scene;                                          /*!< Roots of the scene graph that the viewer displays. */
+	std::vector<KeyframedHierarchicalRenderable*> m_keyframedNodes; /*!< Nodes whose keyframes are sampled in parallel, rebuilt by animate(). */
+	std::vector<Renderable*> m_animatedNodes;                       /*!< Nodes animated in the current frame, rebuilt by animate(). */
+	std::vector<size_t> m_trackOffsets;                             /*!< Slot of the first track of each keyframed node in the batch. */
+	AnimationBatch m_animationBatch;                                /*!< Samples of the tracks of the keyframed nodes. */
+	std::vector<glm::mat4> m_trackMatrices;                         /*!< Matrices composed by the batch, in the order of its slots. */
 	std::vector<DirectionalLightPtr> m_directionalLights;           /*!< Vector of pointer to the directional light. */
 	std::vector<PointLightPtr> m_pointLights;                       /*!< Vector of pointer to the point lights. */
 	std::vector<SpotLightPtr> m_spotLights;                         /*!< Vector of pointer to the spot lights. */
 
 	std::unordered_set<ShaderProgramPtr> m_programs;
+	TransformStorePtr m_transformStore; /*!< Transforms of the hierarchical renderables, updated once per frame. */
+	SceneBVH m_bvh;                     /*!< Bounds of the renderables, refitted when they move. */
+	ShaderWatcher m_shaderWatcher; /*!< Tell which programs of \ref m_programs to reload. */
+
+	DeferredRendererPtr m_deferredRenderer; /*!< Deferred renderer, created on demand. */
+	bool m_deferredShading;                 /*!< True if \ref m_deferredRenderer draws the renderables it can. */
+
+	DepthPrepassPtr m_depthPrepass; /*!< Depth pre-pass, created on demand. */
+	bool m_depthPrepassEnabled;     /*!< True if \ref m_depthPrepass fills the depth buffer before the opaque renderables. */
+	bool m_depthPrepassEqual;       /*!< True to shade the pre-passed renderables with GL_EQUAL. */
+
+	OcclusionCullerPtr m_occlusionCuller; /*!< Occlusion culler, created on demand. */
+	bool m_occlusionCulling;              /*!< True if the renderables hidden by \ref m_occlusionCuller are skipped. */
+	bool m_occlusionDebug;                /*!< True to draw the bounds of the occluded renderables. */
 
 	// TextEngine m_tengine; /*!< Engine to display textual information. */
 	// TimePoint m_modeInformationTextDisappearanceTime; /*!< Duration of appearance for textual information in seconds. */
@@ -302,6 +631,9 @@ class Viewer
 	float m_loopDuration;                /*!< Duration of the animation loop in seconds. */
 	float m_simulationTime;              /*!< Current simulation time in the animation loop. */
 	float m_timeFactor; 			     /*!< Factor to speed up or slow down the animation (higher values speed it up, values closer to 0 slow it down). */
+	bool m_reverse;                      /*!< True if the animation is played backward. */
+	bool m_seekPending;                  /*!< True if the time was changed by seek() since the last animation. */
+	float m_frameDuration;               /*!< Duration of a frame for stepFrames(). */
 	TimePoint m_lastSimulationTimePoint; /*!< Date of the last simulation. */
 	glm::vec4 m_background_color;
 
@@ -311,6 +643,51 @@ class Viewer
 	unsigned int m_screenshotCounter; /*!< Number of screenshots since the beginning of the application. */
 
 	FPSCounter m_fpsCounter; /*!< A framerate counter */
+	GPUProfiler m_profiler;  /*!< Timer queries of the passes and renderables. */
+	bool m_frustumCulling;       /*!< True if the renderables outside the view frustum are skipped. */
+	CullingStats m_cullingStats; /*!< Statistics of the culling of the last frame. */
+
+	/**
+	 * \brief A renderable of the scene that the viewer animates.
+	 */
+	struct AnimatedRenderable
+	{
+		RenderablePtr renderable;                   /*!< The animated renderable. */
+		KeyframedHierarchicalRenderable* keyframed; /*!< The same renderable if it is keyframed, nullptr otherwise. */
+		Renderable* root;                           /*!< Root of its hierarchy. */
+		size_t parent;                              /*!< Index of its parent, its own index for a root. */
+		size_t subtreeEnd;                          /*!< Index after the last of its descendants. */
+		float begin;                                /*!< Start of its animation range. */
+		float end;                                  /*!< End of its animation range. */
+		bool animated;                              /*!< False if it is static once placed. */
+		bool placed;                                /*!< True once it has been animated a first time. */
+		float lastTime;                             /*!< Time of its last check. */
+	};
+	std::vector<AnimatedRenderable> m_animations;             /*!< The renderables of the scene, in depth first order. */
+	std::vector<size_t> m_activeAnimations;                   /*!< Active list: sorted indices in \ref m_animations of the renderables active in their hierarchy which may still change. */
+	std::unordered_map<Renderable*, size_t> m_animationIndices; /*!< Index of each renderable in \ref m_animations. */
+	unsigned int m_animationRevision;                         /*!< Value of Renderable::getAnimationRevision() for \ref m_animations, 0 to rebuild it. */
+
+	/**
+	 * \brief A root of the scene that the viewer draws.
+	 */
+	struct RootState
+	{
+		RenderablePtr renderable; /*!< The root. */
+		size_t order;             /*!< Rank of the root in the drawing order, by decreasing priority. */
+		bool active;              /*!< True if it is in \ref m_activeRoots. */
+		bool dirty;               /*!< True if it is in \ref m_dirtyRoots. */
+		bool cullable;            /*!< True if it is drawn in the window with valid bounds, false if it is in \ref m_uncullableRoots. */
+	};
+	std::unordered_map<Renderable*, RootState> m_roots; /*!< State of each root of \ref m_scene, rebuilt with \ref m_animations. */
+	std::vector<RootState*> m_activeRoots;              /*!< Draw list: the active roots, in drawing order. */
+	std::vector<RootState*> m_dirtyRoots;               /*!< Active roots whose bounds are refitted by the next draw. */
+	std::vector<RootState*> m_uncullableRoots;          /*!< Active roots that the culling cannot skip, in drawing order. */
+	size_t m_cullableCount;                             /*!< Number of active roots that the culling may skip. */
+
+	ActivityTimeline m_timeline;                                      /*!< Index of the activity intervals of the renderables. */
+	std::vector<std::pair<Renderable*, bool> > m_activityChanges;     /*!< Changes of activity of the last update of \ref m_timeline. */
+	unsigned int m_timelineRevision;                                  /*!< Value of Renderable::getAnimationRevision() for \ref m_timeline, 0 to rebuild it. */
 	bool m_helpDisplayed;
 	bool m_helpDisplayRequest;
 
@@ -338,5 +715,7 @@ class Viewer
 	TimePoint m_lastEventHandleTime; /*!< Last time all input events were handled.*/
 
 	std::string soundtrack_path;
+
+	AssetResidency m_residency; /*!< Loading of the meshes along the timeline, stopped before the rest of the viewer is destroyed. */
 };
 #endif
@@ -51,7 +51,7 @@ class ConstantForceField : public ForceField
 	void setForce(const glm::vec3& force);
 
    private:
-	void do_addForce();
+	void do_addForce(ParticleStore& particles);
 	std::vector<ParticlePtr> m_particles;
 	glm::vec3 m_force;
 };
@@ -63,6 +63,7 @@ class ControlledForceFieldRenderable : public ConstantForceFieldRenderable
 
    protected:
 	virtual void do_animate(float time);
+	virtual bool getAnimationRange(float& begin, float& end) const;
 
    private:
 	virtual void do_keyPressedEvent(sf::Event& e);
@@ -51,7 +51,7 @@ class DampingForceField : public ForceField
 	void setDamping(const float& damping);
 
    private:
-	void do_addForce();
+	void do_addForce(ParticleStore& particles);
 	std::vector<ParticlePtr> m_particles;
 	float m_damping;
 };
@@ -1,12 +1,15 @@
 #ifndef DYNAMICSYSTEM_HPP
 #define DYNAMICSYSTEM_HPP
 
+#include <utility>
 #include <vector>
 
 #include "../Plane.hpp"
 #include "Collision.hpp"
 #include "ForceField.hpp"
 #include "Particle.hpp"
+#include "ParticleGrid.hpp"
+#include "ParticleStore.hpp"
 #include "Solver.hpp"
 
 /**@brief A dynamic system.
@@ -15,7 +18,9 @@
  * fixed planes obstacles and that handle collisions. If you want to, you can
  * replace fixed planes obstacles by triangle obstacles: you will be able to
  * model more kind of obstacles. However, this would require a spatial optimization
- * that is out of the scope of these practical lessons.
+ * that is out of the scope of these practical lessons. The particle particle
+ * collisions are only tested between the close particles found by a
+ * ParticleGrid, see setBroadphase().
  */
 class DynamicSystem
 {
@@ -28,6 +33,14 @@ class DynamicSystem
 	 */
 	std::vector<ParticlePtr> m_particles;
 
+	/**@brief The values of the particles of this system.
+	 *
+	 * The particles of this system are handles on the elements of this
+	 * store, in the same order. The force fields, the solver and the
+	 * collision detection work on its arrays.
+	 */
+	ParticleStorePtr m_store;
+
 	/**@brief The set of force fields influencing particles of this system.
 	 *
 	 * The force fields that influence the particles of this system.
@@ -56,13 +69,19 @@ class DynamicSystem
 	 */
 	float m_dt;
 
-	/**@brief The set of collision events detected during a simulation step.
+	/**@brief The particle plane collisions detected during a simulation step.
+	 *
+	 * Index of the particle in \ref m_store and index of the plane of each
+	 * collision. Those events would be resolved by updating velocities and
+	 * positions of dynamic objects to avoid inter-penetration.
+	 */
+	std::vector<std::pair<size_t, size_t> > m_planeCollisions;
+
+	/**@brief The particle particle collisions detected during a simulation step.
 	 *
-	 * Set of collision events between dynamic components during a simulation
-	 * step. Those events would be resolved by updating velocities and positions
-	 * of dynamic objects to avoid inter-penetration.
+	 * Indices in \ref m_store of the particles of each collision.
 	 */
-	std::vector<CollisionPtr> m_collisions;
+	std::vector<std::pair<size_t, size_t> > m_particleCollisions;
 
 	/**@brief A flag to activate/desactivate collision detection.
 	 *
@@ -77,15 +96,44 @@ class DynamicSystem
 	 */
 	float m_restitution;
 
+	/**@brief A flag to use the broadphase for the particle particle collisions.
+	 *
+	 * If set to true, the particle pairs are found by \ref m_grid. Otherwise
+	 * every pair of particles is tested.
+	 */
+	bool m_broadphase;
+
+	/**@brief The grid of the particles, built at each step by the broadphase.
+	 */
+	ParticleGrid m_grid;
+
+	/**@brief The pairs of close particles found by the broadphase.
+	 */
+	std::vector<std::pair<size_t, size_t> > m_candidatePairs;
+
    public:
 	~DynamicSystem();
 	DynamicSystem();
 
+	/**@brief State of a dynamic system between two simulation steps.
+	 *
+	 * It holds what the simulation steps change: the motion of the particles
+	 * and the state of the force fields. Restoring a state and computing the
+	 * same steps again gives the same motion.
+	 */
+	struct State
+	{
+		std::vector<glm::vec3> positions;  /*!< Position of each particle. */
+		std::vector<glm::vec3> velocities; /*!< Velocity of each particle. */
+		std::vector<float> forceFields;    /*!< Values saved by the force fields, see ForceField::saveState(). */
+	};
+
 	static glm::vec3 gravity;
 
 	/**@brief Add a particle to the system.
 	 *
-	 * Add a particle to this dynamic system.
+	 * Add a particle to this dynamic system. The particle is moved to the
+	 * store of the system, see Particle::moveTo().
 	 * @param p The particle to add to this system.
 	 */
 	void addParticle(ParticlePtr p);
@@ -129,6 +177,20 @@ class DynamicSystem
 	 */
 	void setCollisionsDetection(bool onOff);
 
+	/**@brief Check if the broadphase of the collision detection is used.
+	 *
+	 * @return True if the particle particle collisions are found with a grid.
+	 */
+	bool getBroadphase() const;
+	/**@brief Set the broadphase mode of the collision detection.
+	 *
+	 * With the broadphase, only the particles close to each other are tested,
+	 * which scales to many particles. Without it, every pair is tested. Both
+	 * find the same collisions, in the same order. The broadphase is used by default.
+	 * @param onOff True if the particle particle collisions should be found with a grid.
+	 */
+	void setBroadphase(bool onOff);
+
 	/**@brief Access to the set of particles of this system.
 	 *
 	 * Get the set of particles of this dynamic system.
@@ -142,6 +204,13 @@ class DynamicSystem
 	 */
 	void setParticles(const std::vector<ParticlePtr>& particles);
 
+	/**@brief Access to the store of the particles of this system.
+	 *
+	 * Get the arrays holding the values of the particles of this system.
+	 * @return The store of the particles.
+	 */
+	const ParticleStorePtr& getParticleStore() const;
+
 	/**@brief Access to the force fields of this system.
 	 *
 	 * Get the set of force fields of this system.
@@ -162,6 +231,19 @@ class DynamicSystem
 	 */
 	void computeSimulationStep();
 
+	/**@brief Save the state of the system.
+	 *
+	 * @param state The state to overwrite with the current one.
+	 */
+	void saveState(State& state) const;
+
+	/**@brief Restore a saved state of the system.
+	 *
+	 * @param state A state saved with the same particles and force fields.
+	 * @return False if the state does not have the particles of the system, which are left unchanged.
+	 */
+	bool restoreState(const State& state);
+
 	/**@brief Access to the collision restitution factor.
 	 *
 	 * Get the current collision restitution factor of this system.
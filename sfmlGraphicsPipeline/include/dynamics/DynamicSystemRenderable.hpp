@@ -1,6 +1,7 @@
 #ifndef DYNAMIC_SYSTEM_RENDERABLE_HPP
 #define DYNAMIC_SYSTEM_RENDERABLE_HPP
 
+#include <functional>
 #include <vector>
 
 #include "DynamicSystem.hpp"
@@ -15,6 +16,12 @@
  * concept of renderable. Moreover, since it is a hierarchical renderable, it is
  * possible to define a dynamic system in a local frame and then use hierarchical
  * geometric transformation to replace it correctly in the scene.
+ *
+ * The system is simulated in fixed steps of DynamicSystem::getDt() from its
+ * start time, so that its state is given by the animation time alone. Its
+ * state is saved in checkpoints at regular intervals: when the viewer seeks
+ * to an earlier time, see Viewer::seek(), the last checkpoint before this
+ * time is restored and only the remaining steps are computed again.
  */
 class DynamicSystemRenderable : public HierarchicalRenderable
 {
@@ -43,15 +50,43 @@ class DynamicSystemRenderable : public HierarchicalRenderable
 	 */
 	void setStartTime(float startTime);
 
+	/**@brief Call an action when the simulation reaches a time.
+	 *
+	 * The action is called before the first simulation step at or after this
+	 * time, for instance to trigger a force field. It is called again each time
+	 * the simulation is replayed past this time, so it must only change the
+	 * state saved in the checkpoints, see DynamicSystem::State.
+	 * @param time The time of the action.
+	 * @param action The action.
+	 */
+	void addEvent(float time, const std::function<void()>& action);
+
+	/**@brief Set the time between two checkpoints of the simulation.
+	 *
+	 * A shorter interval makes the seeks faster, and uses more memory.
+	 * @param seconds The interval, 1 second by default.
+	 */
+	void setCheckpointInterval(float seconds);
+
+	/**@brief Get the number of checkpoints of the simulation.
+	 */
+	size_t getCheckpointCount() const;
+
+	/**@brief Drop the checkpoints after the current simulation step.
+	 *
+	 * This must be called when the particles or the force fields are changed
+	 * by something else than the simulation, as the next steps change too.
+	 */
+	void invalidateCheckpoints();
+
    protected:
 	void do_draw();
 	/**@brief Update the dynamic system.
 	 *
 	 * This function will update the managed dynamic system, i.e. compute the
-	 * new positions and velocities of the particles. This update will be
-	 * actually done only if the last time the system was updated was more
-	 * than m_sytem->m_dt ago. This allows us to update the dynamic system
-	 * at the specified time interval.
+	 * new positions and velocities of the particles. It computes the steps
+	 * up to the time, from the current step or from a checkpoint if the time
+	 * went back.
 	 */
 	void do_animate(float time);
 
@@ -60,6 +95,7 @@ class DynamicSystemRenderable : public HierarchicalRenderable
 	 *
 	 * If the key A is pressed, the collision detected is toggled.
 	 * If the key T is pressed, particles are titled in random directions.
+	 * These two change the next steps: the checkpoints after the current one are dropped.
 	 * If the key F5 is pressed, the particles are restarted.
 	 * Other key pressed are transmitted to the children of this renderable.
 	 * @param e A key pressed event.
@@ -77,16 +113,40 @@ class DynamicSystemRenderable : public HierarchicalRenderable
 	 * the simulation steps and to handle use input events.
 	 */
 	DynamicSystemPtr m_system;
-	/**@brief Last time the dynamic system was updated.
-	 *
-	 * Store the last time the dynamic system was updated. This is used to
-	 * keep updating the dynamic system at the specified time interval.
+
+	/**@brief An action called during the simulation.
 	 */
-	float m_lastUpdateTime;
+	struct Event
+	{
+		float time;                   /*!< Time of the action. */
+		std::function<void()> action; /*!< The action. */
+	};
+
+	/**@brief A saved state of the simulation.
+	 */
+	struct Checkpoint
+	{
+		unsigned long step;          /*!< Number of steps computed before the state. */
+		DynamicSystem::State state;  /*!< State of the system. */
+	};
+
+	unsigned long step_count(float time) const;
+	void compute_step();
+
+	/**@brief Number of simulation steps computed for the current state.
+	 */
+	unsigned long m_step;
 
 	/**@brief Time when the simulation starts.
 	 */
 	float m_startTime;
+
+	/**@brief Time between two checkpoints.
+	 */
+	float m_checkpointInterval;
+
+	std::vector<Event> m_events;           /*!< Actions of the simulation, sorted by time. */
+	std::vector<Checkpoint> m_checkpoints; /*!< Saved states, sorted by step, the first one before any step. */
 };
 
 typedef std::shared_ptr<DynamicSystemRenderable> DynamicSystemRenderablePtr;
@@ -14,7 +14,7 @@ class EulerExplicitSolver : public Solver
 	~EulerExplicitSolver();
 
    private:
-	void do_solve(const float& dt, std::vector<ParticlePtr>& particles);
+	void do_solve(const float& dt, ParticleStore& particles);
 };
 
 typedef std::shared_ptr<EulerExplicitSolver> EulerExplicitSolverPtr;
@@ -1,12 +1,18 @@
 #ifndef FORCE_FIELD_HPP
 #define FORCE_FIELD_HPP
 
+#include <cstddef>
 #include <memory>
+#include <vector>
+
+#include "Particle.hpp"
 
 /**@brief Force field interface.
  *
  * Define an interface for a force field. A force field applies forces
  * to a set of handled particles. Those particles are stored in derived classes.
+ * The forces are added to the arrays of the store of the dynamic system,
+ * where the particles are found by their indices, see indicesIn().
  */
 class ForceField
 {
@@ -17,8 +23,42 @@ class ForceField
 	/**@brief Add a force to particles.
 	 *
 	 * Add a force to the particles influenced by this force field.
+	 * @param particles The store of the particles of the dynamic system.
+	 * The influenced particles which are not in this store are ignored.
+	 */
+	void addForce(ParticleStore& particles);
+
+	/**@brief Save the state of the force field.
+	 *
+	 * Append the values that the force field changes during the simulation,
+	 * for instance the remaining time of an impulse, to a state.
+	 * @param state The state to append to.
+	 */
+	void saveState(std::vector<float>& state) const;
+
+	/**@brief Restore the state of the force field.
+	 *
+	 * Read back the values appended by saveState().
+	 * @param state The saved state.
+	 * @param offset The index of the first value of this force field, moved after its last value.
+	 */
+	void restoreState(const std::vector<float>& state, size_t& offset);
+
+   protected:
+	/**@brief Get the indices of particles in a store.
+	 *
+	 * The indices are kept until the store changes, or until
+	 * invalidateIndices() is called.
+	 * @param store The store.
+	 * @param particles The particles.
+	 * @return The index of each particle in the store, without the particles
+	 * which are not in the store.
+	 */
+	const std::vector<size_t>& indicesIn(const ParticleStore& store, const std::vector<ParticlePtr>& particles);
+
+	/**@brief Tell that the indices must be found again, when the particles have changed.
 	 */
-	void addForce();
+	void invalidateIndices();
 
    private:
 	/**@brief Add force implementation.
@@ -26,7 +66,22 @@ class ForceField
 	 * The actual implementation to add force to the particles.
 	 * This should be implemented in derived classes.
 	 */
-	virtual void do_addForce() = 0;
+	virtual void do_addForce(ParticleStore& particles) = 0;
+
+	/**@brief Save state implementation.
+	 *
+	 * A force field which changes during the simulation overrides this
+	 * function and do_restoreState(). By default, there is nothing to save.
+	 */
+	virtual void do_saveState(std::vector<float>& state) const;
+
+	/**@brief Restore state implementation.
+	 */
+	virtual void do_restoreState(const std::vector<float>& state, size_t& offset);
+
+	std::vector<size_t> m_indices;         /*!< Indices of the particles in \ref m_indexedStore. */
+	const ParticleStore* m_indexedStore;   /*!< Store of the indices, nullptr to find them again. */
+	unsigned int m_indexedRevision;        /*!< Revision of the store for the indices. */
 };
 
 typedef std::shared_ptr<ForceField> ForceFieldPtr;
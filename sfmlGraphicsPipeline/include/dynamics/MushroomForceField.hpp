@@ -57,7 +57,9 @@ class MushroomForceField : public ForceField
 	bool isActive() const;
 
    private:
-	void do_addForce() override;
+	void do_addForce(ParticleStore& particles) override;
+	void do_saveState(std::vector<float>& state) const override;
+	void do_restoreState(const std::vector<float>& state, size_t& offset) override;
 
 	std::vector<ParticlePtr> m_particles;
 	glm::vec3 m_center;
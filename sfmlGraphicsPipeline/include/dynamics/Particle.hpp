@@ -5,6 +5,8 @@
 #include <iostream>
 #include <memory>
 
+#include "ParticleStore.hpp"
+
 /**@brief Represent a particle as a moving ball.
  *
  * This class is used to model particles in a dynamic system.
@@ -12,6 +14,11 @@
  * a position. This ball is affected by forces that will change
  * both its position and its velocity. This ball can be fixed,
  * making its position constant and its velocity null.
+ *
+ * The values of the particle are kept in a ParticleStore: a particle is a
+ * handle on one of its elements. A new particle has a store of its own; it is
+ * moved to the store of a dynamic system when it is added to it, see
+ * DynamicSystem::addParticle(). A particle belongs to one system at most.
  */
 class Particle
 {
@@ -106,21 +113,21 @@ class Particle
 	 *
 	 * Increment the position of this particle.
 	 * @param pos The position to add to this particle's position,
-	 * i.e. m_position += pos.
+	 * i.e. position += pos.
 	 */
 	void incrPosition(const glm::vec3& pos);
 	/**@brief Increment the particle's velocity.
 	 *
 	 * Increment the velocity of this particle.
 	 * @param vel The velocity to add to this particle's velocity,
-	 * i.e. m_velocity += vel.
+	 * i.e. velocity += vel.
 	 */
 	void incrVelocity(const glm::vec3& vel);
 	/**@brief Increment the particle's applied force.
 	 *
 	 * Increment the force applied to this particle.
 	 * @param force The force to add to this particle's applied force,
-	 * i.e. m_force += force.
+	 * i.e. force += force.
 	 */
 	void incrForce(const glm::vec3& force);
 
@@ -130,49 +137,35 @@ class Particle
 	 */
 	void restart();
 
-   private:
-	/**@brief The initial particle's position.
+	/**@brief Access to the store of the particle.
 	 *
-	 * The initial position of this particle, stored to be set at restart.
+	 * Get the store that holds the values of this particle.
+	 * @return The store of the particle.
 	 */
-	const glm::vec3 m_initialPosition;
-	/**@brief The initial particle's velocity.
+	const ParticleStorePtr& getStore() const;
+	/**@brief Access to the index of the particle in its store.
 	 *
-	 * The initial velocity of this particle, stored to be set at restart.
+	 * @return The index of the particle in getStore().
 	 */
-	const glm::vec3 m_initialVelocity;
-
-	/**@brief The particle's position.
+	size_t getIndex() const;
+	/**@brief Move the particle to another store.
 	 *
-	 * The position of this particle.
+	 * Copy the values of this particle at the end of a store, and make the
+	 * particle a handle on them. Nothing is done if the particle is already
+	 * in this store.
+	 * @param store The new store of the particle.
 	 */
-	glm::vec3 m_position;
-	/**@brief The particle's velocity.
-	 *
-	 * The position of this particle.
-	 */
-	glm::vec3 m_velocity;
-	/**@brief The particle's applied force.
-	 *
-	 * The force applied to this particle.
-	 */
-	glm::vec3 m_force;
-	/**@brief The particle's mass.
-	 *
-	 * The mass of this particle.
-	 */
-	float m_mass;
-	/**@brief The particle's radius.
+	void moveTo(const ParticleStorePtr& store);
+
+   private:
+	/**@brief The store of the particle.
 	 *
-	 * The radius of this particle.
+	 * The store holding the values of this particle.
 	 */
-	float m_radius;
-	/**@brief The particle's fixed flag.
-	 *
-	 * A flag that tells if this particle is fixed. If set to true,
-	 * the position should be constant and the velocity null in simulation steps.
+	ParticleStorePtr m_store;
+	/**@brief The index of the particle in its store.
 	 */
-	bool m_isFixed;
+	size_t m_index;
 };
 
 typedef std::shared_ptr<Particle> ParticlePtr;
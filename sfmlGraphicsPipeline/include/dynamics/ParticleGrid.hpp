@@ -0,0 +1,73 @@
+#ifndef PARTICLE_GRID_HPP
+#define PARTICLE_GRID_HPP
+
+/**@file
+ * @brief Define a uniform grid to find the particles which may collide.
+ */
+
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+#include "ParticleStore.hpp"
+
+/**@brief Broadphase of the particle particle collisions.
+ *
+ * The particles of a store are sorted into the cells of a uniform grid,
+ * whose cells are as large as the diameter of the largest particle. Two
+ * particles in contact are then in the same cell or in neighbouring cells,
+ * and only those pairs need to be tested by testParticleParticle(). The
+ * cells are stored in a hash table with about two buckets per particle,
+ * so the grid is not bounded and its memory only depends on the number
+ * of particles.
+ *
+ * The grid is built again at each simulation step, see DynamicSystem::setBroadphase().
+ */
+class ParticleGrid
+{
+   public:
+	/**@brief Build an empty grid.
+	 */
+	ParticleGrid();
+
+	/**@brief Instance destructor.
+	 */
+	~ParticleGrid();
+
+	/**@brief Sort the particles of a store into the cells of the grid.
+	 *
+	 * The size of the cells is computed from the largest radius.
+	 * @param particles The store of the particles.
+	 */
+	void build(const ParticleStore& particles);
+
+	/**@brief Find the pairs of particles which may collide.
+	 *
+	 * Get the pairs of particles in the same cell or in neighbouring cells
+	 * since the last build(). Every pair of particles in contact is found,
+	 * along with pairs which are close without being in contact.
+	 * @param pairs The pairs, overwritten. The indices (i, j) of a pair
+	 * are such that i < j, and the pairs are sorted by i then by j, as in a
+	 * loop over all the pairs.
+	 */
+	void findPairs(std::vector<std::pair<size_t, size_t> >& pairs);
+
+	/**@brief Get the size of the cells of the last build().
+	 */
+	float getCellSize() const;
+
+   private:
+	ParticleGrid(const ParticleGrid&);
+	ParticleGrid& operator=(const ParticleGrid&);
+
+	size_t bucket(const glm::ivec3& cell) const;
+
+	float m_cellSize;                   /*!< Size of the cells. */
+	size_t m_bucketMask;                /*!< Number of buckets minus one, a power of two minus one. */
+	std::vector<glm::ivec3> m_cells;    /*!< Cell of each particle. */
+	std::vector<size_t> m_starts;       /*!< Index in \ref m_sorted of the first particle of each bucket, and the total count. */
+	std::vector<size_t> m_sorted;       /*!< Indices of the particles, sorted by bucket. */
+	std::vector<size_t> m_candidates;   /*!< Neighbours of a particle, reused by findPairs(). */
+};
+
+#endif
@@ -14,7 +14,8 @@ class ParticleParticleCollision : public Collision
 	~ParticleParticleCollision();
 	/**@brief Build a new collision event between two particles.
 	 *
-	 * Build a collision event between two particles.
+	 * Build a collision event between two particles of the same dynamic
+	 * system, i.e. of the same store.
 	 * @param particle1 The first colliding particle.
 	 * @param particle2 The second colliding particle.
 	 * @param restitution The restitution factor of the collision.
@@ -31,4 +32,22 @@ typedef std::shared_ptr<ParticleParticleCollision> ParticleParticleCollisionPtr;
 
 bool testParticleParticle(const ParticlePtr& p1, const ParticlePtr& p2);
 
+/**@brief Test the collision between two particles of a store.
+ *
+ * @param particles The store of the particles.
+ * @param i The index of the first particle.
+ * @param j The index of the second particle.
+ * @return True if the particles are different and overlap.
+ */
+bool testParticleParticle(const ParticleStore& particles, size_t i, size_t j);
+
+/**@brief Solve the collision between two particles of a store.
+ *
+ * @param particles The store of the particles.
+ * @param i The index of the first particle.
+ * @param j The index of the second particle.
+ * @param restitution Restitution factor of the collision.
+ */
+void solveParticleParticle(ParticleStore& particles, size_t i, size_t j, float restitution);
+
 #endif  // PARTICLE_PARTICLE_COLLISION_HPP
@@ -38,4 +38,22 @@ typedef std::shared_ptr<ParticlePlaneCollision> ParticlePlaneCollisionPtr;
 
 bool testParticlePlane(const ParticlePtr& particle, const PlanePtr& plane);
 
+/**@brief Test the collision between a particle of a store and a plane.
+ *
+ * @param particles The store of the particle.
+ * @param i The index of the particle.
+ * @param plane The plane.
+ * @return True if the particle touches the plane.
+ */
+bool testParticlePlane(const ParticleStore& particles, size_t i, const Plane& plane);
+
+/**@brief Solve the collision between a particle of a store and a fixed plane.
+ *
+ * @param particles The store of the particle.
+ * @param i The index of the particle.
+ * @param plane The plane.
+ * @param restitution Restitution factor of the collision.
+ */
+void solveParticlePlane(ParticleStore& particles, size_t i, Plane& plane, float restitution);
+
 #endif  // PARTICLE_PLANE_COLLISION_HPP
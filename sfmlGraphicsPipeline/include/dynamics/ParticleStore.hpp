@@ -0,0 +1,117 @@
+#ifndef PARTICLE_STORE_HPP
+#define PARTICLE_STORE_HPP
+
+/**@file
+ * @brief Define a flat storage for the particles of a dynamic system.
+ */
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+/**@brief Contiguous storage of particles.
+ *
+ * The state of the particles is stored as a structure of arrays: one array
+ * for the positions, one for the velocities, one for the forces, and so on.
+ * The force fields, the solvers and the collision detection of a dynamic
+ * system loop over these arrays, instead of dereferencing a Particle per
+ * particle and per value. A Particle is a handle on one element of a store.
+ *
+ * The arrays are resized by add() and clear() only, which change the
+ * revision of the store: the indices cached from an older revision may be
+ * wrong. The pointers to the arrays are invalidated by add().
+ *
+ * \sa DynamicSystem::getParticleStore()
+ */
+class ParticleStore
+{
+   public:
+	/**@brief Flags of a particle.
+	 */
+	enum Flag
+	{
+		FIXED = 1 /*!< The particle does not move. */
+	};
+
+	/**@brief Build an empty store.
+	 */
+	ParticleStore();
+
+	/**@brief Instance destructor.
+	 */
+	~ParticleStore();
+
+	/**@brief Add a particle at the end of the store.
+	 *
+	 * @param position The initial position.
+	 * @param velocity The initial velocity.
+	 * @param mass The mass.
+	 * @param radius The radius.
+	 * @return The index of the new particle.
+	 */
+	size_t add(const glm::vec3& position, const glm::vec3& velocity, float mass, float radius);
+
+	/**@brief Add a copy of a particle of another store at the end of the store.
+	 *
+	 * @param other The other store.
+	 * @param index The index of the particle in the other store.
+	 * @return The index of the new particle.
+	 */
+	size_t add(const ParticleStore& other, size_t index);
+
+	/**@brief Remove all the particles.
+	 */
+	void clear();
+
+	/**@brief Get the number of particles.
+	 */
+	size_t size() const;
+
+	/**@brief Get the revision of the store, changed when particles are added or removed.
+	 *
+	 * Two stores never have the same revision.
+	 */
+	unsigned int getRevision() const;
+
+	/**@brief Set the forces of all the particles to zero.
+	 */
+	void clearForces();
+
+	/**@name Arrays
+	 * Values of the particles, in the order of their indices.
+	 * @{
+	 */
+	glm::vec3* positions();
+	const glm::vec3* positions() const;
+	glm::vec3* velocities();
+	const glm::vec3* velocities() const;
+	glm::vec3* forces();
+	const glm::vec3* forces() const;
+	float* inverseMasses();
+	const float* inverseMasses() const;
+	float* radii();
+	const float* radii() const;
+	unsigned char* flags();
+	const unsigned char* flags() const;
+	const glm::vec3* initialPositions() const;
+	const glm::vec3* initialVelocities() const;
+	/**@}*/
+
+   private:
+	ParticleStore(const ParticleStore&);
+	ParticleStore& operator=(const ParticleStore&);
+
+	std::vector<glm::vec3> m_positions;         /*!< Position of each particle. */
+	std::vector<glm::vec3> m_velocities;        /*!< Velocity of each particle. */
+	std::vector<glm::vec3> m_forces;            /*!< Force applied to each particle in the current step. */
+	std::vector<float> m_inverseMasses;         /*!< Inverse of the mass of each particle. */
+	std::vector<float> m_radii;                 /*!< Radius of each particle. */
+	std::vector<unsigned char> m_flags;         /*!< Flags of each particle, see Flag. */
+	std::vector<glm::vec3> m_initialPositions;  /*!< Position of each particle when it restarts. */
+	std::vector<glm::vec3> m_initialVelocities; /*!< Velocity of each particle when it restarts. */
+	unsigned int m_revision;                    /*!< Incremented when particles are added or removed. */
+};
+
+typedef std::shared_ptr<ParticleStore> ParticleStorePtr;
+
+#endif
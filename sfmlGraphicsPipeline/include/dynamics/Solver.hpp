@@ -4,7 +4,7 @@
 #include <memory>
 #include <vector>
 
-#include "Particle.hpp"
+#include "ParticleStore.hpp"
 
 /**@brief Dynamic system solver interface.
  *
@@ -19,9 +19,9 @@ class Solver
 	 *
 	 * Solve the dynamic system of particles for a specified time step.
 	 * @param dt The time step for the integration.
-	 * @param particles The collection of particles.
+	 * @param particles The store of the particles.
 	 */
-	void solve(const float& dt, std::vector<ParticlePtr>& particles);
+	void solve(const float& dt, ParticleStore& particles);
 
    private:
 	/**@brief Solve implementation.
@@ -29,9 +29,9 @@ class Solver
 	 * The actual implementation to solve the dynamic system. This should
 	 * be implemented in derived classes.
 	 * @param dt The time step for the integration.
-	 * @param particles The collection of particles.
+	 * @param particles The store of the particles.
 	 */
-	virtual void do_solve(const float& dt, std::vector<ParticlePtr>& particles) = 0;
+	virtual void do_solve(const float& dt, ParticleStore& particles) = 0;
 };
 
 typedef std::shared_ptr<Solver> SolverPtr;
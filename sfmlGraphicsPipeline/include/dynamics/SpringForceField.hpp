@@ -43,7 +43,7 @@ class SpringForceField : public ForceField
 	 * Compute the forces applied by this spring to each particles
 	 * and add them to the particles.
 	 */
-	void do_addForce();
+	void do_addForce(ParticleStore& particles);
 
 	const ParticlePtr m_p1, m_p2;
 	float m_stiffness;
@@ -15,6 +15,7 @@ class DirectionalLightRenderable : public MeshRenderable
 
    private:
 	void do_animate(float time);
+	bool getAnimationRange(float& begin, float& end) const;
 
 	DirectionalLightPtr m_light;
 };
@@ -172,6 +172,12 @@ class Light : public KeyframedHierarchicalRenderable
 		updateModelMatrix();
 	}
 
+	bool getAnimationRange(float& begin, float& end) const
+	{
+		// The light follows its parent at any time
+		return Renderable::getAnimationRange(begin, end);
+	}
+
 	virtual bool sendToGPU(const ShaderProgramPtr& program, const std::string& identifier) const = 0;
 
    private:
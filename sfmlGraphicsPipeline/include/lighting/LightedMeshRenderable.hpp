@@ -16,7 +16,8 @@ class LightedMeshRenderable : public MeshRenderable
 
 	LightedMeshRenderable(ShaderProgramPtr program,
 	                      const std::string& filename,
-	                      const MaterialPtr& material);
+	                      const MaterialPtr& material,
+	                      bool deferred = false);
 
 	LightedMeshRenderable(ShaderProgramPtr shaderProgram,
 	                      const std::vector<glm::vec3>& positions,
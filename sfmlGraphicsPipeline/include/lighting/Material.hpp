@@ -125,6 +125,24 @@ class Material
 	 */
 	void setAlpha(float shininess);
 
+	/**
+	 * @brief Access to the index of the material.
+	 *
+	 * The index of a material is its position in the material table of the
+	 * DeferredRenderer. It is sent to the shader programs that declare a
+	 * \c materialId uniform.
+	 * @return The value of m_index.
+	 */
+	unsigned int index() const;
+
+	/**
+	 * @brief Set the index of the material.
+	 *
+	 * Set the value of m_index.
+	 * @param index The new index of the material.
+	 */
+	void setIndex(unsigned int index);
+
 	/**
 	 * @brief Get location for the attributes of the material and send the data to the GPU as uniforms.
 	 *
@@ -134,6 +152,18 @@ class Material
 	 */
 	static bool sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& material);
 
+	/**
+	 * @brief Send the material to a uniform with a specific name.
+	 *
+	 * Same as sendToGPU(const ShaderProgramPtr&, const MaterialPtr&) for a material
+	 * uniform named \a identifier, e.g. an element "materials[3]" of an array.
+	 * @param program A pointer to the shader program where to get the locations.
+	 * @param material A pointer to the material to send to the GPU.
+	 * @param identifier The name of the material uniform in the shader program.
+	 * @return  True if everything was fine, false otherwise
+	 */
+	static bool sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& material, const std::string& identifier);
+
 	/**
 	 * @brief Construct a pearl material from real data according to http://devernay.free.fr/cours/opengl/materials.html
 	 * @return A pearl material.
@@ -184,6 +214,7 @@ private:
 	glm::vec3 m_specular; /*!< The specular material vector sets the color impact a specular light has on the object. */
 	float m_shininess;    /*!< The shininess impacts the scattering/radius of the specular highlight. */
 	float m_alpha;	      /*!< The alpha is the transparency of the material. */
+	unsigned int m_index; /*!< The index of the material in the material table of the deferred renderer. */
 };
 
 typedef std::shared_ptr<Material> MaterialPtr; /*!< Smart pointer to a material */
@@ -15,6 +15,7 @@ class PointLightRenderable : public MeshRenderable
 
    private:
 	void do_animate(float time);
+	bool getAnimationRange(float& begin, float& end) const;
 
 	PointLightPtr m_light;
 };
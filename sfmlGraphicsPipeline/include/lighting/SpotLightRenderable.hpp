@@ -15,6 +15,7 @@ class SpotLightRenderable : public MeshRenderable
 
    private:
 	void do_animate(float time);
+	bool getAnimationRange(float& begin, float& end) const;
 
 	SpotLightPtr m_light;
 };
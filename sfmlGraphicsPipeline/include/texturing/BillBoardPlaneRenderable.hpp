@@ -20,6 +20,7 @@ class BillBoardPlaneRenderable : public Renderable
    protected:
 	void do_draw();
 	void do_animate(float time);
+	bool getAnimationRange(float& begin, float& end) const;
 
    private:
 	void do_keyPressedEvent(sf::Event& e);
@@ -0,0 +1,135 @@
+#ifndef MORPH_MESH_RENDERABLE_HPP
+#define MORPH_MESH_RENDERABLE_HPP
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "../ScalarKeyframeCollection.hpp"
+#include "TexturedMeshRenderable.hpp"
+
+/**@brief Textured mesh deformed by weighted morph targets.
+ *
+ * A morph target is another shape of the mesh, with the same vertices. Only
+ * the vertices it moves are kept, as sparse deltas of their position and
+ * normal. The deltas of all the targets are sorted by vertex and sent to a
+ * buffer texture; each vertex has the range of its own deltas as an
+ * attribute. The vertex shader adds the deltas of its vertex, scaled by the
+ * weights of their targets, see morphVertex.glsl. The shader program must have
+ * the "morphDeltas" buffer sampler, the "morphWeights" uniform array and the
+ * "vMorphRange" attribute.
+ *
+ * The weight of a target is set directly, or interpolated from keyframes at
+ * each animation step. The weights are expected to be between -1 and 1: the
+ * bounds of the mesh contain all the shapes reached with such weights.
+ */
+class MorphMeshRenderable : public TexturedMeshRenderable
+{
+   public:
+	/**@brief Largest number of morph targets, the size of the weight array in the shaders.
+	 */
+	static const unsigned int max_targets;
+
+	~MorphMeshRenderable();
+
+	MorphMeshRenderable(ShaderProgramPtr program,
+	                    const std::string& mesh_filename,
+	                    const std::string& texture_filename);
+
+	/**@brief Add a morph target.
+	 *
+	 * @param name The name of the target.
+	 * @param positions The positions of all the vertices in the target shape.
+	 * @param normals The normals of all the vertices in the target shape, or
+	 * none to keep the normals of the mesh.
+	 * @param threshold The vertices which move less than this distance are ignored.
+	 * @return The index of the target, -1 if there are already max_targets or
+	 * if the target does not have the vertices of the mesh.
+	 */
+	int addMorphTarget(const std::string& name,
+	                   const std::vector<glm::vec3>& positions,
+	                   const std::vector<glm::vec3>& normals,
+	                   float threshold = 1e-5f);
+
+	/**@brief Add a morph target from an OBJ file with the same vertices as the mesh.
+	 *
+	 * \sa addMorphTarget()
+	 */
+	int addMorphTargetFromFile(const std::string& name, const std::string& mesh_filename, float threshold = 1e-5f);
+
+	/**@brief Find a morph target by its name.
+	 *
+	 * @return The index of the target, -1 if there is none with this name.
+	 */
+	int findMorphTarget(const std::string& name) const;
+
+	/**@brief Get the number of morph targets.
+	 */
+	size_t getMorphTargetCount() const;
+
+	/**@brief Get the number of deltas of all the targets.
+	 */
+	size_t getDeltaCount() const;
+
+	/**@brief Set the weight of a target.
+	 *
+	 * The weight is replaced at the next animation step if the target has
+	 * weight keyframes.
+	 */
+	void setWeight(int target, float weight);
+
+	/**@brief Get the weight of a target.
+	 */
+	float getWeight(int target) const;
+
+	/**@brief Add a keyframe to the weight of a target.
+	 *
+	 * @param target The index of the target.
+	 * @param weight The weight at this time.
+	 * @param time The time of the keyframe.
+	 */
+	void addWeightKeyframe(int target, float weight, float time);
+
+	/**@brief Get the time range of the animation of the mesh and of its weights.
+	 */
+	bool getAnimationRange(float& begin, float& end) const;
+
+	/**@brief Intersect a ray with the bounding box of all the shapes.
+	 *
+	 * The triangles are not deformed on the CPU, they are not intersected one by one.
+	 */
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+
+   protected:
+	void do_draw();
+	void do_animate(float time);
+
+   private:
+	MorphMeshRenderable(const MorphMeshRenderable&);
+	MorphMeshRenderable& operator=(const MorphMeshRenderable&);
+
+	/**@brief Sparse deltas of a target shape.
+	 */
+	struct MorphTarget
+	{
+		std::string name;                      /*!< Name of the target. */
+		std::vector<unsigned int> vertices;    /*!< Vertices moved by the target, increasing. */
+		std::vector<glm::vec3> positionDeltas; /*!< Position delta of each moved vertex. */
+		std::vector<glm::vec3> normalDeltas;   /*!< Normal delta of each moved vertex. */
+		ScalarKeyframeCollection weights;      /*!< Keyframes of the weight, if it is animated. */
+	};
+
+	void update_morph_buffers();
+
+	std::vector<MorphTarget> m_targets;     /*!< Morph targets. */
+	std::vector<float> m_weights;           /*!< Current weight of each target. */
+	std::vector<glm::uvec2> m_morphRanges;  /*!< First delta and number of deltas of each vertex. */
+	size_t m_deltaCount;                    /*!< Number of deltas in the buffer texture. */
+	unsigned int m_rangeBuffer;             /*!< Delta range buffer. */
+	unsigned int m_deltaBuffer;             /*!< Buffer of the deltas: two texels per delta. */
+	unsigned int m_deltaTexture;            /*!< Buffer texture of m_deltaBuffer. */
+};
+
+typedef std::shared_ptr<MorphMeshRenderable> MorphMeshRenderablePtr;
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef SKINNED_MESH_RENDERABLE_HPP
+#define SKINNED_MESH_RENDERABLE_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <string>
+#include <vector>
+
+#include "../BoundingBox.hpp"
+#include "../Skeleton.hpp"
+#include "../lighting/Material.hpp"
+#include "TexturedMeshRenderable.hpp"
+
+/**@brief Textured and lighted mesh deformed by a skeleton.
+ *
+ * Each vertex is bound to up to four joints of the skeleton, with weights
+ * summing to one. At each animation step, the palette of the skeleton is
+ * computed and sent to a uniform buffer, and the vertex shader blends the
+ * palette matrices of the joints of each vertex, see skinningVertex.glsl. The
+ * shader program must have a "JointPalette" uniform block, and the "vJoints"
+ * and "vWeights" attributes.
+ *
+ * A character made of rigid parts, each in its own OBJ file with its own
+ * animation, becomes a single mesh drawn at once: each part is bound to a
+ * joint, see addRigidPart(), and each animation drives a joint.
+ *
+ * The mesh is neither pre-passed nor shaded by the deferred renderer, whose
+ * programs do not skin the vertices.
+ */
+class SkinnedMeshRenderable : public TexturedMeshRenderable
+{
+   public:
+	~SkinnedMeshRenderable();
+
+	/**@brief Build an empty skinned mesh.
+	 *
+	 * @param program The skinning shader program.
+	 * @param skeleton The skeleton deforming the mesh.
+	 * @param material The material of the mesh.
+	 * @param texture_filename The texture of the mesh.
+	 */
+	SkinnedMeshRenderable(ShaderProgramPtr program,
+	                      const SkeletonPtr& skeleton,
+	                      const MaterialPtr& material,
+	                      const std::string& texture_filename);
+
+	/**@brief Add the triangles of an OBJ file, bound to a single joint.
+	 *
+	 * The vertices are kept in the space of the file: the inverse bind matrix
+	 * of the joint should be the identity, and its rest transform the one of
+	 * the file, see read_obj_transform().
+	 * @param mesh_filename The OBJ file.
+	 * @param joint The index of the joint.
+	 * @return False if the file cannot be read.
+	 */
+	bool addRigidPart(const std::string& mesh_filename, int joint);
+
+	/**@brief Add skinned triangles.
+	 *
+	 * @param positions The positions, in the bind pose.
+	 * @param normals The normals, in the bind pose.
+	 * @param tcoords The texture coordinates.
+	 * @param indices The vertex indices of the triangles, from 0 for the first of \a positions.
+	 * @param joints The indices of the four joints of each vertex.
+	 * @param weights The weights of the four joints of each vertex.
+	 */
+	void addVertices(const std::vector<glm::vec3>& positions,
+	                 const std::vector<glm::vec3>& normals,
+	                 const std::vector<glm::vec2>& tcoords,
+	                 const std::vector<unsigned int>& indices,
+	                 const std::vector<glm::uvec4>& joints,
+	                 const std::vector<glm::vec4>& weights);
+
+	const SkeletonPtr& getSkeleton() const;
+	const MaterialPtr& getMaterial() const;
+	void setMaterial(const MaterialPtr&);
+
+	/**@brief Get the time range of the animation of the mesh and of its skeleton.
+	 */
+	bool getAnimationRange(float& begin, float& end) const;
+
+	/**@brief Intersect a ray with the bounding box of the current pose.
+	 *
+	 * The triangles are in the bind pose, they are not intersected one by one.
+	 */
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+
+   protected:
+	void do_draw();
+	void do_animate(float time);
+
+   private:
+	SkinnedMeshRenderable(const SkinnedMeshRenderable&);
+	SkinnedMeshRenderable& operator=(const SkinnedMeshRenderable&);
+
+	void update_skin_buffers();
+	void update_pose_bounds();
+
+	SkeletonPtr m_skeleton;                      /*!< Skeleton deforming the mesh. */
+	MaterialPtr m_material;                      /*!< Material of the mesh. */
+	std::vector<glm::u8vec4> m_joints;           /*!< Joints of each vertex. */
+	std::vector<glm::u8vec4> m_weights;          /*!< Weights of each vertex, normalized to 255. */
+	std::vector<BoundingBox> m_jointBounds;      /*!< Bind pose bounds of the vertices bound to each joint. */
+	std::vector<glm::mat4> m_palette;            /*!< Palette of the last animation step. */
+	unsigned int m_jBuffer;                      /*!< Joint index buffer. */
+	unsigned int m_wBuffer;                      /*!< Joint weight buffer. */
+	unsigned int m_paletteBuffer;                /*!< Uniform buffer of the palette. */
+};
+
+typedef std::shared_ptr<SkinnedMeshRenderable> SkinnedMeshRenderablePtr;
+
+#endif
@@ -22,7 +22,8 @@ class TexturedLightedMeshRenderable : public TexturedMeshRenderable
 	TexturedLightedMeshRenderable(ShaderProgramPtr program,
 	                              const std::string& mesh_filename,
 	                              const MaterialPtr& material,
-	                              const std::string& texture_filename);
+	                              const std::string& texture_filename,
+	                              bool deferred = false);
 
 	TexturedLightedMeshRenderable(ShaderProgramPtr shaderProgram,
 	                              const std::vector<glm::vec3>& positions,
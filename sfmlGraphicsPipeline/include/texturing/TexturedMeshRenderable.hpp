@@ -12,9 +12,15 @@ class TexturedMeshRenderable : public MeshRenderable
    public:
 	~TexturedMeshRenderable();
 
+	/**@brief Build a textured mesh from an OBJ file and an image.
+	 *
+	 * \param deferred Whether to defer the loading of the geometry and of the
+	 * image, see MeshRenderable::MeshRenderable().
+	 */
 	TexturedMeshRenderable(ShaderProgramPtr program,
 	                       const std::string& mesh_filename,
-	                       const std::string& texture_filename);
+	                       const std::string& texture_filename,
+	                       bool deferred = false);
 
 	TexturedMeshRenderable(ShaderProgramPtr shaderProgram,
 	                       const std::vector<glm::vec3>& positions,
@@ -39,6 +45,13 @@ class TexturedMeshRenderable : public MeshRenderable
 	void update_tcoords_buffer();
 	void update_all_buffers();
 
+	/**@brief Read the OBJ file and the image into memory.
+	 * \sa MeshRenderable::prefetch()
+	 */
+	void prefetch();
+	void load();
+	void release();
+
    protected:
 	TexturedMeshRenderable(ShaderProgramPtr shaderProgram, bool indexed);
 	void do_draw();
@@ -48,6 +61,7 @@ class TexturedMeshRenderable : public MeshRenderable
 	sf::Image m_image;
 	// std::vector< glm::vec2 > m_tcoords; Already in MeshRenderable
 	std::vector<glm::vec2> m_original_tcoords;
+	std::string m_textureFilename;  // Empty if the image was given
 
    private:
 	void do_keyPressedEvent(sf::Event& e);
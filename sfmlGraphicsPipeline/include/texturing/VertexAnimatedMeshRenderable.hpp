@@ -0,0 +1,92 @@
+#ifndef VERTEX_ANIMATED_MESH_RENDERABLE_HPP
+#define VERTEX_ANIMATED_MESH_RENDERABLE_HPP
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "TexturedMeshRenderable.hpp"
+
+/**@brief Textured mesh played back from a vertex animation texture.
+ *
+ * The positions and normals of all the vertices are baked for each frame of
+ * an animation, for instance a simulation, into a floating point texture:
+ * the texels of a frame are its positions, then its normals, in the order of
+ * the vertices. The vertex shader fetches the two frames around the current
+ * time with the index of its vertex, and interpolates them, see
+ * vatVertex.glsl. The shader program must have the "vatTexture" sampler and
+ * the "vatVertexCount", "vatFrames" and "vatBlend" uniforms.
+ *
+ * The frames are played at a fixed rate from a start time, once or in a loop.
+ */
+class VertexAnimatedMeshRenderable : public TexturedMeshRenderable
+{
+   public:
+	/**@brief Width of the vertex animation texture, in texels.
+	 */
+	static const unsigned int texture_width;
+
+	~VertexAnimatedMeshRenderable();
+
+	VertexAnimatedMeshRenderable(ShaderProgramPtr program,
+	                             const std::string& mesh_filename,
+	                             const std::string& texture_filename);
+
+	/**@brief Add a frame at the end of the animation.
+	 *
+	 * @param positions The positions of all the vertices.
+	 * @param normals The normals of all the vertices, or none to keep the normals of the mesh.
+	 * @return False if the frame does not have the vertices of the mesh.
+	 */
+	bool addFrame(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals);
+
+	/**@brief Add a frame from an OBJ file with the same vertices as the mesh.
+	 */
+	bool addFrameFromFile(const std::string& mesh_filename);
+
+	/**@brief Get the number of frames.
+	 */
+	size_t getFrameCount() const;
+
+	/**@brief Set how the frames are played.
+	 *
+	 * @param frameRate The number of frames per second.
+	 * @param startTime The time of the first frame.
+	 * @param loop Whether the animation restarts after its last frame, or stays on it.
+	 */
+	void setPlayback(float frameRate, float startTime = 0.0f, bool loop = true);
+
+	/**@brief Get the time range of the animation of the mesh and of its frames.
+	 *
+	 * A looping animation never ends.
+	 */
+	bool getAnimationRange(float& begin, float& end) const;
+
+	/**@brief Intersect a ray with the bounding box of all the frames.
+	 */
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance);
+
+   protected:
+	void do_draw();
+	void do_animate(float time);
+
+   private:
+	VertexAnimatedMeshRenderable(const VertexAnimatedMeshRenderable&);
+	VertexAnimatedMeshRenderable& operator=(const VertexAnimatedMeshRenderable&);
+
+	void update_frame_texture();
+
+	std::vector<glm::vec4> m_frames;  /*!< Texels of the frames: the positions then the normals of each frame. */
+	size_t m_frameCount;              /*!< Number of frames. */
+	bool m_framesChanged;             /*!< True if the texture must be updated before the next draw. */
+	float m_frameRate;                /*!< Frames per second. */
+	float m_startTime;                /*!< Time of the first frame. */
+	bool m_loop;                      /*!< Whether the animation loops. */
+	glm::ivec2 m_currentFrames;       /*!< Frames around the time of the last animation step. */
+	float m_blend;                    /*!< Interpolation factor between these two frames. */
+	unsigned int m_frameTexture;      /*!< Vertex animation texture. */
+};
+
+typedef std::shared_ptr<VertexAnimatedMeshRenderable> VertexAnimatedMeshRenderablePtr;
+
+#endif
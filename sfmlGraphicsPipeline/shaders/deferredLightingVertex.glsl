@@ -0,0 +1,14 @@
+#version 400
+
+// Lighting pass of the deferred renderer (see DeferredRenderer).
+// vPosition covers the screen with a single triangle in clip space.
+
+in vec2 vPosition;
+
+out vec2 texCoord;
+
+void main()
+{
+    texCoord = 0.5 * vPosition + 0.5;
+    gl_Position = vec4(vPosition, 0.0, 1.0);
+}
@@ -0,0 +1,8 @@
+#version 400
+
+// Depth pre-pass (see DepthPrepass): colour writes are disabled, only the
+// depth of the fragment matters.
+
+void main()
+{
+}
@@ -0,0 +1,17 @@
+#version 400
+
+// Depth pre-pass (see DepthPrepass) of textured meshes: discard the same
+// texels as the fragment shader of the main pass.
+
+// Texels with a smaller alpha are discarded
+uniform float alphaCutoff = 0.0;
+
+uniform sampler2D texSampler;
+
+in vec2 surfel_texCoord;
+
+void main()
+{
+    if (texture(texSampler, surfel_texCoord).a < alphaCutoff)
+        discard;
+}
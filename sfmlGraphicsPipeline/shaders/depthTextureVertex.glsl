@@ -0,0 +1,21 @@
+#version 400
+
+// Depth pre-pass (see DepthPrepass) of textured meshes whose fragment shader
+// discards transparent texels, like cartoonTextureFragment.glsl.
+// gl_Position is computed exactly like in textureVertex.glsl.
+
+invariant gl_Position;
+
+uniform mat4 projMat, viewMat, modelMat;
+
+in vec2 vTexCoord;
+in vec3 vPosition;
+
+out vec2 surfel_texCoord;
+
+void main()
+{
+    vec3 surfel_position = vec3(modelMat*vec4(vPosition,1.0f));
+    surfel_texCoord = vTexCoord;
+    gl_Position = projMat*viewMat*vec4(surfel_position,1.0f);
+}
@@ -0,0 +1,18 @@
+#version 400
+
+// Depth pre-pass (see DepthPrepass): only the position is needed.
+// The position is computed exactly like in phongVertex.glsl and
+// textureVertex.glsl, and gl_Position is invariant in all of them, so that
+// the main pass finds the same depth values.
+
+invariant gl_Position;
+
+uniform mat4 projMat, viewMat, modelMat;
+
+in vec3 vPosition;
+
+void main()
+{
+    vec3 surfel_position = vec3(modelMat*vec4(vPosition,1.0f));
+    gl_Position = projMat*viewMat*vec4(surfel_position,1.0f);
+}
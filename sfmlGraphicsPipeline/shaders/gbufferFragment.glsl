@@ -0,0 +1,52 @@
+#version 400
+
+// Geometry pass of the deferred renderer (see DeferredRenderer).
+// Instead of computing the lighting, we store in the G-buffer what the
+// lighting pass (deferredLightingFragment.glsl) needs to compute it.
+
+// Index of the material in the material table of the lighting pass
+uniform int materialId = 0;
+// True for textured meshes, false for plain meshes
+uniform bool useTexture = false;
+// True to reproduce cartoonFragment.glsl/cartoonTextureFragment.glsl
+uniform bool cartoon = false;
+
+uniform sampler2D texSampler;
+
+// Surfel: a SURFace ELement. All coordinates are in world space
+in vec2 surfel_texCoord;
+in vec3 surfel_normal;
+
+// G-buffer. The depth is written in the depth attachment.
+layout(location = 0) out vec4 outAlbedo;    // color multiplied with the lighting
+layout(location = 1) out vec4 outNormal;    // world space normal
+layout(location = 2) out uvec2 outMaterial; // material index, posterize the lighting or not
+
+float posterizeFactor(float value, float steps) {
+    return floor(value * steps) / steps;
+}
+
+void main()
+{
+    vec4 albedo = vec4(1.0);
+    uint posterizeLighting = 0u;
+
+    if (useTexture)
+    {
+        albedo = texture(texSampler, surfel_texCoord);
+        if (cartoon)
+        {
+            if (albedo.a < 0.8)
+                discard;
+            albedo = albedo * posterizeFactor(sqrt(length(albedo)), 8.0);
+        }
+    }
+    else if (cartoon)
+    {
+        posterizeLighting = 1u;
+    }
+
+    outAlbedo = vec4(albedo.rgb, 1.0);
+    outNormal = vec4(surfel_normal, 0.0);
+    outMaterial = uvec2(uint(materialId), posterizeLighting);
+}
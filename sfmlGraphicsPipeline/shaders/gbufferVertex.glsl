@@ -0,0 +1,27 @@
+#version 400
+
+// Geometry pass of the deferred renderer (see DeferredRenderer).
+// Same inputs as textureVertex.glsl, without the lighting outputs.
+
+uniform mat4 projMat, viewMat, modelMat;
+
+// This is the normal inverse transpose matrix.
+uniform mat3 NIT = mat3(1.0);
+
+// Attributes
+in vec2 vTexCoord;
+in vec3 vPosition;
+in vec3 vNormal;
+
+// Surfel: a SURFace ELement. All coordinates are in world space
+out vec2 surfel_texCoord;
+out vec3 surfel_normal;
+
+void main()
+{
+    surfel_normal = normalize( NIT * vNormal);
+    surfel_texCoord = vTexCoord;
+
+    // Define the fragment position on the screen
+    gl_Position = projMat*viewMat*modelMat*vec4(vPosition,1.0f);
+}
@@ -0,0 +1,22 @@
+#version 400
+
+// Reduction of the hierarchical depth buffer (see OcclusionCuller).
+// Each texel keeps the farthest depth of the 2x2 texels it covers in the
+// source level. The size of the target is half the size of the source,
+// rounded up: the last row and column of an odd source are only covered once.
+
+uniform sampler2D sourceSampler;
+
+out vec4 outDepth;
+
+void main()
+{
+    ivec2 last = textureSize(sourceSampler, 0) - 1;
+    ivec2 texel = 2 * ivec2(gl_FragCoord.xy);
+
+    float depth = texelFetch(sourceSampler, texel, 0).r;
+    depth = max(depth, texelFetch(sourceSampler, min(texel + ivec2(1, 0), last), 0).r);
+    depth = max(depth, texelFetch(sourceSampler, min(texel + ivec2(0, 1), last), 0).r);
+    depth = max(depth, texelFetch(sourceSampler, min(texel + ivec2(1, 1), last), 0).r);
+    outDepth = vec4(depth, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 400
+
+// Reduction of the hierarchical depth buffer (see OcclusionCuller).
+// vPosition covers the screen with a single triangle in clip space.
+
+in vec2 vPosition;
+
+void main()
+{
+    gl_Position = vec4(vPosition, 0.0, 1.0);
+}
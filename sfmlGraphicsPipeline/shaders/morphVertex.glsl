@@ -0,0 +1,47 @@
+#version 400
+
+uniform mat4 projMat, viewMat, modelMat;
+uniform mat3 NIT = mat3(1.0);
+
+// Deltas of all the morph targets, sorted by vertex, see MorphMeshRenderable:
+// the position delta and its target, then the normal delta
+uniform samplerBuffer morphDeltas;
+uniform float morphWeights[32];
+
+// Attributes
+in vec2 vTexCoord;
+in vec3 vPosition;
+in vec4 vColor;
+in vec3 vNormal;
+in uvec2 vMorphRange;   // First delta and number of deltas of the vertex
+
+// Surfel: a SURFace ELement. All coordinates are in world space
+out vec2 surfel_texCoord;
+out vec3 surfel_position;
+out vec3 surfel_normal;
+out vec4 surfel_color;
+
+out vec3 cameraPosition;
+
+void main()
+{
+    vec3 position = vPosition;
+    vec3 normal = vNormal;
+    for (uint i = 0u; i < vMorphRange.y; ++i)
+    {
+        int texel = int(2u * (vMorphRange.x + i));
+        vec4 positionDelta = texelFetch(morphDeltas, texel);
+        float weight = morphWeights[int(positionDelta.w)];
+        position += weight * positionDelta.xyz;
+        normal += weight * texelFetch(morphDeltas, texel + 1).xyz;
+    }
+
+    surfel_position = vec3(modelMat*vec4(position,1.0f));
+    surfel_normal = normalize( NIT * normal);
+    surfel_color  = vColor;
+    surfel_texCoord = vTexCoord;
+
+    cameraPosition = - vec3( viewMat[3] ) * mat3( viewMat );
+
+    gl_Position = projMat*viewMat*vec4(surfel_position,1.0f);
+}
@@ -0,0 +1,12 @@
+#version 400
+
+// Edges of the renderables rejected by the occlusion culling (see OcclusionCuller).
+
+uniform vec4 color;
+
+out vec4 outColor;
+
+void main()
+{
+    outColor = color;
+}
@@ -0,0 +1,12 @@
+#version 400
+
+// Edges of the renderables rejected by the occlusion culling (see OcclusionCuller).
+
+uniform mat4 viewProjection;
+
+in vec3 vPosition;
+
+void main()
+{
+    gl_Position = viewProjection * vec4(vPosition, 1.0);
+}
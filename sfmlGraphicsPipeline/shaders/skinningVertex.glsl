@@ -0,0 +1,53 @@
+#version 400
+
+// Same as Skeleton::max_joints
+#define MAX_JOINTS 64
+
+uniform mat4 projMat, viewMat, modelMat;
+
+// This is the normal inverse transpose matrix of modelMat, see textureVertex.glsl.
+uniform mat3 NIT = mat3(1.0);
+
+// Palette of the skeleton: the matrix of each joint, from the bind pose to the current pose
+layout(std140) uniform JointPalette
+{
+    mat4 joints[MAX_JOINTS];
+};
+
+// Attributes
+in vec2 vTexCoord;
+in vec3 vPosition;
+in vec4 vColor;
+in vec3 vNormal;
+in uvec4 vJoints;  // The four joints of the vertex
+in vec4 vWeights;  // Their weights, summing to one
+
+// Surfel: a SURFace ELement. All coordinates are in world space
+out vec2 surfel_texCoord;
+out vec3 surfel_position;
+out vec3 surfel_normal;
+out vec4 surfel_color;
+
+out vec3 cameraPosition;
+
+void main()
+{
+    // Linear blend of the matrices of the joints
+    mat4 skin = vWeights.x * joints[vJoints.x]
+              + vWeights.y * joints[vJoints.y]
+              + vWeights.z * joints[vJoints.z]
+              + vWeights.w * joints[vJoints.w];
+
+    // All attributes are in world space. The joints are expected to be rotated
+    // and uniformly scaled: the normal is transformed by the skin matrix itself
+    surfel_position = vec3(modelMat * skin * vec4(vPosition, 1.0f));
+    surfel_normal = normalize(NIT * mat3(skin) * vNormal);
+    surfel_color  = vColor;
+    surfel_texCoord = vTexCoord;
+
+    // Compute the position of the camera in world space
+    cameraPosition = - vec3( viewMat[3] ) * mat3( viewMat );
+
+    // Define the fragment position on the screen
+    gl_Position = projMat*viewMat*vec4(surfel_position,1.0f);
+}
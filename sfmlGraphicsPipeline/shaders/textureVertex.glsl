@@ -1,5 +1,8 @@
 #version 400
 
+// Same depth as the depth pre-pass, see depthVertex.glsl
+invariant gl_Position;
+
 uniform mat4 projMat, viewMat, modelMat;
 
 // This is the normal inverse transpose matrix.
@@ -0,0 +1,53 @@
+#version 400
+
+uniform mat4 projMat, viewMat, modelMat;
+uniform mat3 NIT = mat3(1.0);
+
+// Frames of the animation, see VertexAnimatedMeshRenderable: for each frame,
+// the positions then the normals of the vertices, in rows of the texture width
+uniform sampler2D vatTexture;
+uniform int vatVertexCount;     // 0 until the first frame
+uniform ivec2 vatFrames;        // The two frames around the current time
+uniform float vatBlend;         // Interpolation factor between them
+
+// Attributes
+in vec2 vTexCoord;
+in vec3 vPosition;
+in vec4 vColor;
+in vec3 vNormal;
+
+// Surfel: a SURFace ELement. All coordinates are in world space
+out vec2 surfel_texCoord;
+out vec3 surfel_position;
+out vec3 surfel_normal;
+out vec4 surfel_color;
+
+out vec3 cameraPosition;
+
+vec3 fetch(int texel)
+{
+    int width = textureSize(vatTexture, 0).x;
+    return texelFetch(vatTexture, ivec2(texel % width, texel / width), 0).xyz;
+}
+
+void main()
+{
+    vec3 position = vPosition;
+    vec3 normal = vNormal;
+    if (vatVertexCount > 0)
+    {
+        int first = 2 * vatFrames.x * vatVertexCount + gl_VertexID;
+        int second = 2 * vatFrames.y * vatVertexCount + gl_VertexID;
+        position = mix(fetch(first), fetch(second), vatBlend);
+        normal = mix(fetch(first + vatVertexCount), fetch(second + vatVertexCount), vatBlend);
+    }
+
+    surfel_position = vec3(modelMat*vec4(position,1.0f));
+    surfel_normal = normalize( NIT * normal);
+    surfel_color  = vColor;
+    surfel_texCoord = vTexCoord;
+
+    cameraPosition = - vec3( viewMat[3] ) * mat3( viewMat );
+
+    gl_Position = projMat*viewMat*vec4(surfel_position,1.0f);
+}
@@ -0,0 +1,57 @@
+#include "../include/ActivityTimeline.hpp"
+
+#include <algorithm>
+
+ActivityTimeline::ActivityTimeline() : m_cursor{0}
+{
+}
+
+void ActivityTimeline::build(const std::vector<RenderablePtr>& renderables)
+{
+	clear();
+	for (const RenderablePtr& r : renderables)
+	{
+		const std::vector<std::pair<float, float> >& intervals = r->getActiveIntervals();
+		if (intervals.empty())
+			continue;
+		unsigned int node = m_nodes.size();
+		m_nodes.push_back(r);
+		// The intervals of a renderable are disjoint, so its events alternate
+		for (const std::pair<float, float>& interval : intervals)
+		{
+			Event start = {interval.first, node, true};
+			Event end = {interval.second, node, false};
+			m_events.push_back(start);
+			m_events.push_back(end);
+		}
+	}
+	std::stable_sort(m_events.begin(), m_events.end());
+}
+
+void ActivityTimeline::clear()
+{
+	m_nodes.clear();
+	m_events.clear();
+	m_cursor = 0;
+}
+
+void ActivityTimeline::apply(const Event& e, bool undo, std::vector<std::pair<Renderable*, bool> >& changed)
+{
+	// Undoing a start ends the interval, undoing an end starts it again
+	changed.push_back(std::make_pair(m_nodes[e.node].get(), e.start != undo));
+}
+
+void ActivityTimeline::update(float time, std::vector<std::pair<Renderable*, bool> >& changed)
+{
+	// An interval [start, end) contains the time once its start is applied, and
+	// no longer once its end is: the events at or before the time are applied
+	while (m_cursor < m_events.size() && m_events[m_cursor].time <= time)
+		apply(m_events[m_cursor++], false, changed);
+	while (m_cursor > 0 && m_events[m_cursor - 1].time > time)
+		apply(m_events[--m_cursor], true, changed);
+}
+
+size_t ActivityTimeline::size() const
+{
+	return m_nodes.size();
+}
@@ -0,0 +1,233 @@
+#include "../include/AnimationBatch.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ANIMATION_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// Channels of a batch, in the order of AnimationBatch::Channel
+struct batch_channels
+{
+	const float *tx, *ty, *tz;
+	const float *qx, *qy, *qz, *qw;
+	const float *sx, *sy, *sz;
+};
+
+// A kernel composes the matrices of the tracks from begin, and returns the first one it did not compose
+typedef size_t (*compose_kernel)(const batch_channels& c, float* matrices, size_t begin, size_t end);
+
+static size_t compose_scalar(const batch_channels& c, float* matrices, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		float x = c.qx[i], y = c.qy[i], z = c.qz[i], w = c.qw[i];
+		float xx = x * x, yy = y * y, zz = z * z;
+		float xy = x * y, xz = x * z, yz = y * z;
+		float wx = w * x, wy = w * y, wz = w * z;
+
+		// Same as glm::mat4_cast(), with each axis scaled
+		float* m = matrices + 16 * i;
+		m[0] = (1.0f - 2.0f * (yy + zz)) * c.sx[i];
+		m[1] = 2.0f * (xy + wz) * c.sx[i];
+		m[2] = 2.0f * (xz - wy) * c.sx[i];
+		m[3] = 0.0f;
+		m[4] = 2.0f * (xy - wz) * c.sy[i];
+		m[5] = (1.0f - 2.0f * (xx + zz)) * c.sy[i];
+		m[6] = 2.0f * (yz + wx) * c.sy[i];
+		m[7] = 0.0f;
+		m[8] = 2.0f * (xz + wy) * c.sz[i];
+		m[9] = 2.0f * (yz - wx) * c.sz[i];
+		m[10] = (1.0f - 2.0f * (xx + yy)) * c.sz[i];
+		m[11] = 0.0f;
+		m[12] = c.tx[i];
+		m[13] = c.ty[i];
+		m[14] = c.tz[i];
+		m[15] = 1.0f;
+	}
+	return end;
+}
+
+#if defined(ANIMATION_BATCH_X86) && defined(__SSE2__)
+#define ANIMATION_BATCH_SSE2
+
+static size_t compose_sse2(const batch_channels& c, float* matrices, size_t begin, size_t end)
+{
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(c.qx + i), y = _mm_loadu_ps(c.qy + i);
+		__m128 z = _mm_loadu_ps(c.qz + i), w = _mm_loadu_ps(c.qw + i);
+		__m128 x2 = _mm_mul_ps(two, x), y2 = _mm_mul_ps(two, y), z2 = _mm_mul_ps(two, z);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+		__m128 sx = _mm_loadu_ps(c.sx + i), sy = _mm_loadu_ps(c.sy + i), sz = _mm_loadu_ps(c.sz + i);
+
+		// Rows of the 4x4 blocks: component r of the column of 4 tracks
+		__m128 columns[4][4] = {
+		    {_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+		     _mm_mul_ps(_mm_sub_ps(xz, wy), sx), zero},
+		    {_mm_mul_ps(_mm_sub_ps(xy, wz), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+		     _mm_mul_ps(_mm_add_ps(yz, wx), sy), zero},
+		    {_mm_mul_ps(_mm_add_ps(xz, wy), sz), _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+		     _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), zero},
+		    {_mm_loadu_ps(c.tx + i), _mm_loadu_ps(c.ty + i), _mm_loadu_ps(c.tz + i), one}};
+
+		// Transpose each block to get the column of each track
+		float* m = matrices + 16 * i;
+		for (int col = 0; col < 4; ++col)
+		{
+			__m128* r = columns[col];
+			_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+			for (int t = 0; t < 4; ++t)
+				_mm_storeu_ps(m + 16 * t + 4 * col, r[t]);
+		}
+	}
+	return i;
+}
+#endif
+
+#ifdef ANIMATION_BATCH_X86
+#define ANIMATION_BATCH_AVX
+
+// Compiled for AVX whatever the flags of the build, only called if the processor supports it
+__attribute__((target("avx"))) static size_t compose_avx(const batch_channels& c, float* matrices, size_t begin, size_t end)
+{
+	const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), zero = _mm256_setzero_ps();
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(c.qx + i), y = _mm256_loadu_ps(c.qy + i);
+		__m256 z = _mm256_loadu_ps(c.qz + i), w = _mm256_loadu_ps(c.qw + i);
+		__m256 x2 = _mm256_mul_ps(two, x), y2 = _mm256_mul_ps(two, y), z2 = _mm256_mul_ps(two, z);
+		__m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		__m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+		__m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+		__m256 sx = _mm256_loadu_ps(c.sx + i), sy = _mm256_loadu_ps(c.sy + i), sz = _mm256_loadu_ps(c.sz + i);
+
+		__m256 columns[4][4] = {
+		    {_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx), _mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+		     _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx), zero},
+		    {_mm256_mul_ps(_mm256_sub_ps(xy, wz), sy), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+		     _mm256_mul_ps(_mm256_add_ps(yz, wx), sy), zero},
+		    {_mm256_mul_ps(_mm256_add_ps(xz, wy), sz), _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+		     _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz), zero},
+		    {_mm256_loadu_ps(c.tx + i), _mm256_loadu_ps(c.ty + i), _mm256_loadu_ps(c.tz + i), one}};
+
+		// Transpose the 4x4 blocks of each 128-bit lane: the low lanes hold the
+		// tracks i to i + 3, the high lanes the tracks i + 4 to i + 7
+		float* m = matrices + 16 * i;
+		for (int col = 0; col < 4; ++col)
+		{
+			__m256* r = columns[col];
+			__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+			__m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+			__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+			__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+			__m256 v[4] = {_mm256_shuffle_ps(t0, t2, 0x44), _mm256_shuffle_ps(t0, t2, 0xEE),
+			               _mm256_shuffle_ps(t1, t3, 0x44), _mm256_shuffle_ps(t1, t3, 0xEE)};
+			for (int t = 0; t < 4; ++t)
+			{
+				_mm_storeu_ps(m + 16 * t + 4 * col, _mm256_castps256_ps128(v[t]));
+				_mm_storeu_ps(m + 16 * (t + 4) + 4 * col, _mm256_extractf128_ps(v[t], 1));
+			}
+		}
+	}
+	return i;
+}
+#endif
+
+static compose_kernel select_kernel(const char** name)
+{
+#ifdef ANIMATION_BATCH_AVX
+	// Called while the static variables are initialised, maybe before the CPU features are
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx"))
+	{
+		*name = "avx";
+		return compose_avx;
+	}
+#endif
+#ifdef ANIMATION_BATCH_SSE2
+	*name = "sse2";
+	return compose_sse2;
+#else
+	*name = "scalar";
+	return compose_scalar;
+#endif
+}
+
+static const char* kernel_name = "scalar";
+static const compose_kernel kernel = select_kernel(&kernel_name);
+
+AnimationBatch::AnimationBatch() : m_size(0)
+{
+}
+
+void AnimationBatch::resize(size_t count)
+{
+	m_size = count;
+	m_values.resize(CHANNEL_COUNT * count);
+}
+
+size_t AnimationBatch::size() const
+{
+	return m_size;
+}
+
+float* AnimationBatch::channel(Channel c)
+{
+	return m_values.data() + c * m_size;
+}
+
+void AnimationBatch::set(size_t i, const glm::vec3& translation, const glm::quat& orientation, const glm::vec3& scale)
+{
+	channel(TX)[i] = translation.x;
+	channel(TY)[i] = translation.y;
+	channel(TZ)[i] = translation.z;
+	channel(QX)[i] = orientation.x;
+	channel(QY)[i] = orientation.y;
+	channel(QZ)[i] = orientation.z;
+	channel(QW)[i] = orientation.w;
+	channel(SX)[i] = scale.x;
+	channel(SY)[i] = scale.y;
+	channel(SZ)[i] = scale.z;
+}
+
+void AnimationBatch::sample(size_t i, const KeyframeCollection& keyframes, float time)
+{
+	glm::vec3 translation, scale;
+	glm::quat orientation;
+	keyframes.interpolate(time, translation, orientation, scale);
+	set(i, translation, orientation, scale);
+}
+
+void AnimationBatch::sample(size_t i, const AnimationClip& clip, float time)
+{
+	glm::vec3 translation, scale;
+	glm::quat orientation;
+	clip.sample(time, translation, orientation, scale);
+	set(i, translation, orientation, scale);
+}
+
+void AnimationBatch::compose(std::vector<glm::mat4>& matrices) const
+{
+	matrices.resize(m_size);
+	if (m_size == 0)
+		return;
+
+	const float* v = m_values.data();
+	batch_channels c = {v + TX * m_size, v + TY * m_size, v + TZ * m_size,
+	                    v + QX * m_size, v + QY * m_size, v + QZ * m_size, v + QW * m_size,
+	                    v + SX * m_size, v + SY * m_size, v + SZ * m_size};
+	float* out = &matrices[0][0][0];
+	// The SIMD kernels stop before an incomplete group of tracks, which the scalar loop finishes
+	size_t done = kernel(c, out, 0, m_size);
+	compose_scalar(c, out, done, m_size);
+}
+
+const char* AnimationBatch::getKernelName()
+{
+	return kernel_name;
+}
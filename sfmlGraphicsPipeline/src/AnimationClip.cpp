@@ -0,0 +1,317 @@
+#include "../include/AnimationClip.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "../include/GeometricTransformation.hpp"
+
+static const char clip_magic[4] = {'C', 'L', 'P', '1'};
+
+// Number of times where the error is measured between two samples
+static const int error_subdivisions = 8;
+
+// Largest absolute value of the three smallest components of a unit quaternion
+static const float smallest_three_bound = 0.70710678f;
+
+static float angle_between(const glm::quat& a, const glm::quat& b)
+{
+	return 2.0f * std::acos(std::min(1.0f, std::abs(glm::dot(a, b))));
+}
+
+void AnimationClip::VectorChannel::encode(const std::vector<glm::vec3>& values, float tolerance)
+{
+	glm::vec3 lower = values[0], upper = values[0];
+	for (const glm::vec3& v : values)
+	{
+		lower = glm::min(lower, v);
+		upper = glm::max(upper, v);
+	}
+
+	samples.clear();
+	extent = upper - lower;
+	if (std::max(extent.x, std::max(extent.y, extent.z)) <= 2.0f * tolerance)
+	{
+		// Constant channel: the middle of the bounds is within the tolerance of all the values
+		minimum = 0.5f * (lower + upper);
+		extent = glm::vec3(0.0f);
+		return;
+	}
+
+	minimum = lower;
+	samples.resize(3 * values.size());
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			float normalized = extent[c] > 0 ? (values[i][c] - minimum[c]) / extent[c] : 0.0f;
+			samples[3 * i + c] = uint16_t(std::floor(glm::clamp(normalized, 0.0f, 1.0f) * 65535.0f + 0.5f));
+		}
+	}
+}
+
+glm::vec3 AnimationClip::VectorChannel::decode(size_t i) const
+{
+	if (samples.empty())
+		return minimum;
+	const uint16_t* s = &samples[3 * i];
+	return minimum + extent * glm::vec3(s[0], s[1], s[2]) / 65535.0f;
+}
+
+void AnimationClip::RotationChannel::encode(const std::vector<glm::quat>& values, float tolerance)
+{
+	samples.clear();
+	constant = glm::normalize(values[0]);
+	bool isConstant = true;
+	for (size_t i = 1; i < values.size() && isConstant; ++i)
+		isConstant = angle_between(constant, glm::normalize(values[i])) <= tolerance;
+	if (isConstant)
+		return;
+
+	samples.resize(3 * values.size());
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		glm::quat q = glm::normalize(values[i]);
+		int largest = 0;
+		for (int c = 1; c < 4; ++c)
+		{
+			if (std::abs(q[c]) > std::abs(q[largest]))
+				largest = c;
+		}
+		// q and -q are the same rotation: the dropped component is positive
+		if (q[largest] < 0)
+			q = -q;
+
+		uint16_t* s = &samples[3 * i];
+		for (int c = 0, k = 0; c < 4; ++c)
+		{
+			if (c == largest)
+				continue;
+			float normalized = (q[c] / smallest_three_bound + 1.0f) * 0.5f;
+			s[k++] = uint16_t(std::floor(glm::clamp(normalized, 0.0f, 1.0f) * 32767.0f + 0.5f));
+		}
+		// The index of the dropped component is in the high bits of the first two words
+		s[0] |= (largest & 1) << 15;
+		s[1] |= (largest >> 1) << 15;
+	}
+}
+
+glm::quat AnimationClip::RotationChannel::decode(size_t i) const
+{
+	if (samples.empty())
+		return constant;
+	const uint16_t* s = &samples[3 * i];
+	int largest = (s[0] >> 15) | ((s[1] >> 15) << 1);
+
+	glm::quat q;
+	float sum = 0.0f;
+	for (int c = 0, k = 0; c < 4; ++c)
+	{
+		if (c == largest)
+			continue;
+		q[c] = ((s[k++] & 0x7FFF) / 32767.0f * 2.0f - 1.0f) * smallest_three_bound;
+		sum += q[c] * q[c];
+	}
+	q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+	return q;
+}
+
+AnimationClip::AnimationClip() : m_startTime(0.0f), m_sampleInterval(1.0f), m_sampleCount(0)
+{
+}
+
+void AnimationClip::clear()
+{
+	m_startTime = 0.0f;
+	m_sampleInterval = 1.0f;
+	m_sampleCount = 0;
+	m_translation = VectorChannel();
+	m_rotation = RotationChannel();
+	m_scale = VectorChannel();
+}
+
+float AnimationClip::bake(const KeyframeCollection& keyframes, float sampleRate, float tolerance, float maxSampleRate)
+{
+	clear();
+	float begin, end;
+	if (!keyframes.getTimeRange(begin, end))
+		return 0.0f;
+
+	// The channels are quantised with a part of the tolerance, the rest is left to the resampling
+	float quantisationTolerance = 0.25f * tolerance;
+	float rate = std::max(sampleRate, 1e-3f);
+	float error = 0.0f;
+	while (true)
+	{
+		size_t count = end > begin ? size_t(std::ceil((end - begin) * rate)) + 1 : 1;
+		m_startTime = begin;
+		m_sampleInterval = count > 1 ? (end - begin) / (count - 1) : 1.0f;
+		m_sampleCount = count;
+
+		std::vector<glm::vec3> translations(count), scales(count);
+		std::vector<glm::quat> orientations(count);
+		for (size_t i = 0; i < count; ++i)
+			keyframes.interpolate(m_startTime + i * m_sampleInterval, translations[i], orientations[i], scales[i]);
+		m_translation.encode(translations, quantisationTolerance);
+		m_rotation.encode(orientations, quantisationTolerance);
+		m_scale.encode(scales, quantisationTolerance);
+
+		// Error of the clip at the samples and between them
+		error = 0.0f;
+		size_t steps = count > 1 ? (count - 1) * error_subdivisions : 0;
+		for (size_t j = 0; j <= steps; ++j)
+		{
+			float time = m_startTime + j * m_sampleInterval / error_subdivisions;
+			glm::vec3 t, s, clipT, clipS;
+			glm::quat r, clipR;
+			keyframes.interpolate(time, t, r, s);
+			sample(time, clipT, clipR, clipS);
+			error = std::max(error, glm::length(t - clipT));
+			error = std::max(error, glm::length(s - clipS));
+			error = std::max(error, angle_between(glm::normalize(r), clipR));
+		}
+
+		if (error <= tolerance || rate * 2.0f > maxSampleRate)
+			break;
+		rate *= 2.0f;
+	}
+	return error;
+}
+
+void AnimationClip::sample(float time, glm::vec3& translation, glm::quat& orientation, glm::vec3& scale) const
+{
+	if (m_sampleCount == 1)
+	{
+		translation = m_translation.decode(0);
+		orientation = m_rotation.decode(0);
+		scale = m_scale.decode(0);
+		return;
+	}
+
+	float position = glm::clamp((time - m_startTime) / m_sampleInterval, 0.0f, float(m_sampleCount - 1));
+	size_t i = std::min(size_t(position), size_t(m_sampleCount - 2));
+	float factor = position - i;
+
+	translation = glm::mix(m_translation.decode(i), m_translation.decode(i + 1), factor);
+	scale = glm::mix(m_scale.decode(i), m_scale.decode(i + 1), factor);
+
+	// The samples are close: a normalized linear interpolation, along the shortest path
+	glm::quat q0 = m_rotation.decode(i);
+	glm::quat q1 = m_rotation.decode(i + 1);
+	if (glm::dot(q0, q1) < 0)
+		q1 = -q1;
+	orientation = glm::normalize(q0 * (1.0f - factor) + q1 * factor);
+}
+
+glm::mat4 AnimationClip::sample(float time) const
+{
+	if (m_sampleCount == 0)
+		return glm::mat4(1.0f);
+	glm::vec3 translation, scale;
+	glm::quat orientation;
+	sample(time, translation, orientation, scale);
+	return GeometricTransformation(translation, orientation, scale).toMatrix();
+}
+
+bool AnimationClip::empty() const
+{
+	return m_sampleCount == 0;
+}
+
+bool AnimationClip::getTimeRange(float& begin, float& end) const
+{
+	if (m_sampleCount == 0)
+		return false;
+	begin = m_startTime;
+	end = m_startTime + (m_sampleCount - 1) * m_sampleInterval;
+	return true;
+}
+
+size_t AnimationClip::getSampleCount() const
+{
+	return m_sampleCount;
+}
+
+size_t AnimationClip::getMemorySize() const
+{
+	return sizeof(AnimationClip) + (m_translation.samples.size() + m_rotation.samples.size() + m_scale.samples.size()) * sizeof(uint16_t);
+}
+
+template <typename T>
+static void write_value(std::ofstream& out, const T& value)
+{
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static void read_value(std::ifstream& in, T& value)
+{
+	in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+static void write_samples(std::ofstream& out, const std::vector<uint16_t>& samples)
+{
+	uint32_t count = samples.size();
+	write_value(out, count);
+	out.write(reinterpret_cast<const char*>(samples.data()), count * sizeof(uint16_t));
+}
+
+static bool read_samples(std::ifstream& in, std::vector<uint16_t>& samples, uint32_t sampleCount)
+{
+	uint32_t count = 0;
+	read_value(in, count);
+	// A channel is either constant or has three words per sample
+	if (!in || (count != 0 && count != 3 * sampleCount))
+		return false;
+	samples.resize(count);
+	in.read(reinterpret_cast<char*>(samples.data()), count * sizeof(uint16_t));
+	return bool(in);
+}
+
+bool AnimationClip::loadFromFile(const std::string& filename)
+{
+	clear();
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	char magic[4];
+	in.read(magic, sizeof(magic));
+	read_value(in, m_startTime);
+	read_value(in, m_sampleInterval);
+	read_value(in, m_sampleCount);
+	read_value(in, m_translation.minimum);
+	read_value(in, m_translation.extent);
+	read_value(in, m_rotation.constant);
+	read_value(in, m_scale.minimum);
+	read_value(in, m_scale.extent);
+	bool valid = in && std::memcmp(magic, clip_magic, sizeof(magic)) == 0 && m_sampleInterval > 0
+	             && read_samples(in, m_translation.samples, m_sampleCount)
+	             && read_samples(in, m_rotation.samples, m_sampleCount)
+	             && read_samples(in, m_scale.samples, m_sampleCount);
+	if (!valid)
+		clear();
+	return valid;
+}
+
+bool AnimationClip::saveToFile(const std::string& filename) const
+{
+	std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	out.write(clip_magic, sizeof(clip_magic));
+	write_value(out, m_startTime);
+	write_value(out, m_sampleInterval);
+	write_value(out, m_sampleCount);
+	write_value(out, m_translation.minimum);
+	write_value(out, m_translation.extent);
+	write_value(out, m_rotation.constant);
+	write_value(out, m_scale.minimum);
+	write_value(out, m_scale.extent);
+	write_samples(out, m_translation.samples);
+	write_samples(out, m_rotation.samples);
+	write_samples(out, m_scale.samples);
+	return bool(out);
+}
@@ -0,0 +1,196 @@
+#include "../include/AssetResidency.hpp"
+
+#include <algorithm>
+
+#include "../include/log.hpp"
+
+AssetResidency::AssetResidency() : m_prefetchTime(2.0f),
+                                   m_intervalsRevision(0),
+                                   m_residentCount(0),
+                                   m_stallCount(0),
+                                   m_reading(-1),
+                                   m_stop(false)
+{
+}
+
+AssetResidency::~AssetResidency()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_queued.notify_all();
+	if (m_worker.joinable())
+		m_worker.join();
+}
+
+void AssetResidency::add(const MeshRenderablePtr& mesh)
+{
+	if (mesh->getMeshFilename().empty())
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Asset asset;
+	asset.mesh = mesh;
+	asset.state = mesh->isResident() ? RESIDENT : RELEASED;
+	if (asset.state == RESIDENT)
+		++m_residentCount;
+	m_assets.push_back(asset);
+	m_intervalsRevision = 0;
+	if (!m_worker.joinable())
+		m_worker = std::thread(&AssetResidency::run, this);
+}
+
+void AssetResidency::clear()
+{
+	// The mesh being read is still used by the background thread
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_queue.clear();
+	m_read.wait(lock, [this] { return m_reading < 0; });
+	m_assets.clear();
+	m_residentCount = 0;
+}
+
+void AssetResidency::setPrefetchTime(float seconds)
+{
+	m_prefetchTime = seconds;
+}
+
+float AssetResidency::getPrefetchTime() const
+{
+	return m_prefetchTime;
+}
+
+size_t AssetResidency::size() const
+{
+	return m_assets.size();
+}
+
+size_t AssetResidency::getResidentCount() const
+{
+	return m_residentCount;
+}
+
+size_t AssetResidency::getStallCount() const
+{
+	return m_stallCount;
+}
+
+void AssetResidency::gather_intervals()
+{
+	// A child is only drawn while its ancestors are active
+	for (Asset& a : m_assets)
+	{
+		const HierarchicalRenderable* node = a.mesh.get();
+		while (node && node->getActiveIntervals().empty())
+			node = node->getParent().get();
+		if (node)
+			a.intervals = node->getActiveIntervals();
+		else
+			a.intervals.clear();
+	}
+	m_intervalsRevision = Renderable::getAnimationRevision();
+}
+
+void AssetResidency::update(float time)
+{
+	if (m_assets.empty())
+		return;
+	if (m_intervalsRevision != Renderable::getAnimationRevision())
+		gather_intervals();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	bool queued = false;
+	for (size_t i = 0; i < m_assets.size(); ++i)
+	{
+		Asset& a = m_assets[i];
+		bool always = a.intervals.empty();
+		bool now = always, soon = always, later = always;
+		for (const std::pair<float, float>& interval : a.intervals)
+		{
+			now = now || (interval.first <= time && time < interval.second);
+			soon = soon || (interval.first < time + m_prefetchTime && time < interval.second);
+			later = later || time < interval.second;
+		}
+
+		if (now && a.state != RESIDENT)
+		{
+			// Needed before it is read: read it here rather than after the other queued
+			// meshes, or wait for the background thread if it is reading it
+			bool stalled = a.state != PREFETCHED && !always;
+			if (a.state == QUEUED)
+			{
+				std::deque<size_t>::iterator q = std::find(m_queue.begin(), m_queue.end(), i);
+				if (q != m_queue.end())
+					m_queue.erase(q);
+				else
+					m_read.wait(lock, [this, i] { return m_reading != int(i); });
+			}
+			if (stalled)
+			{
+				++m_stallCount;
+				LOG(warning, "[AssetResidency] " << a.mesh->getMeshFilename() << " is needed at " << time << " before it is prefetched");
+			}
+			a.mesh->load();
+			a.state = RESIDENT;
+			++m_residentCount;
+		}
+		else if (a.state == PREFETCHED)
+		{
+			// Sent to the GPU as soon as it is read, unless the time has moved away
+			if (soon)
+			{
+				a.mesh->load();
+				a.state = RESIDENT;
+				++m_residentCount;
+			}
+			else
+			{
+				a.mesh->release();
+				a.state = RELEASED;
+			}
+		}
+		else if (a.state == RELEASED && soon)
+		{
+			a.state = QUEUED;
+			m_queue.push_back(i);
+			queued = true;
+		}
+		else if (a.state == RESIDENT && !later)
+		{
+			// Past its last appearance
+			a.mesh->release();
+			a.state = RELEASED;
+			--m_residentCount;
+		}
+	}
+	lock.unlock();
+	if (queued)
+		m_queued.notify_one();
+}
+
+void AssetResidency::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_queued.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+		if (m_stop)
+			return;
+
+		size_t i = m_queue.front();
+		m_queue.pop_front();
+		MeshRenderablePtr mesh = m_assets[i].mesh;
+		m_reading = i;
+
+		// Only the files are read here, the main thread does not touch a queued mesh
+		lock.unlock();
+		mesh->prefetch();
+		lock.lock();
+
+		m_reading = -1;
+		if (i < m_assets.size() && m_assets[i].mesh == mesh && m_assets[i].state == QUEUED)
+			m_assets[i].state = PREFETCHED;
+		m_read.notify_all();
+	}
+}
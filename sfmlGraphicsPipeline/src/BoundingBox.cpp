@@ -0,0 +1,128 @@
+#include "../include/BoundingBox.hpp"
+
+#include <algorithm>
+#include <limits>
+
+BoundingBox::BoundingBox()
+    : m_min(std::numeric_limits<float>::max()), m_max(-std::numeric_limits<float>::max())
+{
+}
+
+BoundingBox::BoundingBox(const glm::vec3& min, const glm::vec3& max) : m_min(min), m_max(max)
+{
+}
+
+BoundingBox::BoundingBox(const std::vector<glm::vec3>& points) : BoundingBox()
+{
+	for (const glm::vec3& p : points)
+		extend(p);
+}
+
+bool BoundingBox::isValid() const
+{
+	return m_min.x <= m_max.x && m_min.y <= m_max.y && m_min.z <= m_max.z;
+}
+
+void BoundingBox::extend(const glm::vec3& point)
+{
+	m_min = glm::min(m_min, point);
+	m_max = glm::max(m_max, point);
+}
+
+void BoundingBox::extend(const BoundingBox& box)
+{
+	if (!box.isValid())
+		return;
+	m_min = glm::min(m_min, box.m_min);
+	m_max = glm::max(m_max, box.m_max);
+}
+
+BoundingBox BoundingBox::transformed(const glm::mat4& transform) const
+{
+	if (!isValid())
+		return BoundingBox();
+
+	// Arvo's method: each axis of the transform moves the corners independently
+	glm::vec3 min(transform[3]);
+	glm::vec3 max(transform[3]);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		glm::vec3 a = glm::vec3(transform[axis]) * m_min[axis];
+		glm::vec3 b = glm::vec3(transform[axis]) * m_max[axis];
+		min += glm::min(a, b);
+		max += glm::max(a, b);
+	}
+	return BoundingBox(min, max);
+}
+
+const glm::vec3& BoundingBox::min() const
+{
+	return m_min;
+}
+
+const glm::vec3& BoundingBox::max() const
+{
+	return m_max;
+}
+
+glm::vec3 BoundingBox::center() const
+{
+	return 0.5f * (m_min + m_max);
+}
+
+float BoundingBox::radius() const
+{
+	return 0.5f * glm::length(m_max - m_min);
+}
+
+float BoundingBox::surfaceArea() const
+{
+	if (!isValid())
+		return 0;
+	glm::vec3 d = m_max - m_min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool BoundingBox::contains(const BoundingBox& box) const
+{
+	return glm::all(glm::lessThanEqual(m_min, box.m_min)) && glm::all(glm::lessThanEqual(box.m_max, m_max));
+}
+
+bool BoundingBox::intersects(const glm::vec3& center, float radius) const
+{
+	if (!isValid())
+		return false;
+	glm::vec3 closest = glm::clamp(center, m_min, m_max);
+	glm::vec3 d = closest - center;
+	return glm::dot(d, d) <= radius * radius;
+}
+
+bool BoundingBox::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const
+{
+	if (!isValid())
+		return false;
+
+	// Slab method: intersect the intervals of t between the planes of each axis
+	float tmin = 0;
+	float tmax = maxDistance;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (direction[axis] == 0)
+		{
+			if (origin[axis] < m_min[axis] || origin[axis] > m_max[axis])
+				return false;
+			continue;
+		}
+		float inv = 1.0f / direction[axis];
+		float t0 = (m_min[axis] - origin[axis]) * inv;
+		float t1 = (m_max[axis] - origin[axis]) * inv;
+		if (t0 > t1)
+			std::swap(t0, t1);
+		tmin = std::max(tmin, t0);
+		tmax = std::min(tmax, t1);
+		if (tmin > tmax)
+			return false;
+	}
+	distance = tmin;
+	return true;
+}
@@ -44,6 +44,12 @@ void Camera::do_animate(float time)
 	m_view = glm::inverse(getModelMatrix());
 }
 
+bool Camera::getAnimationRange(float& begin, float& end) const
+{
+	// The view follows the parent of the camera at any time
+	return Renderable::getAnimationRange(begin, end);
+}
+
 const glm::mat4& Camera::viewMatrix() const
 {
 	return m_view;
@@ -0,0 +1,298 @@
+#include "../include/DeferredRenderer.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+#include <sstream>
+
+#include "../include/HierarchicalRenderable.hpp"
+#include "../include/gl_helper.hpp"
+#include "../include/lighting/LightedMeshRenderable.hpp"
+#include "../include/texturing/TexturedLightedMeshRenderable.hpp"
+#include "./../include/log.hpp"
+
+static const std::string shader_directory = "../../sfmlGraphicsPipeline/shaders/";
+
+// Must match MAX_NR_MATERIALS in deferredLightingFragment.glsl
+static const unsigned int max_materials = 64;
+
+static GLuint
+create_texture(GLint internal_format, GLenum format, GLenum type, unsigned int width, unsigned int height)
+{
+	GLuint texture = 0;
+	glcheck(glGenTextures(1, &texture));
+	glcheck(glBindTexture(GL_TEXTURE_2D, texture));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+	glcheck(glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, nullptr));
+	glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+	return texture;
+}
+
+DeferredRenderer::DeferredRenderer()
+    : m_width{0}, m_height{0}, m_fbo{0}, m_albedoTexture{0}, m_normalTexture{0}, m_materialTexture{0}, m_depthTexture{0}, m_triangleBuffer{0}
+{
+	// One geometry program per kind of renderable, to set their uniforms once per frame
+	for (int textured = 0; textured < 2; ++textured)
+	{
+		for (int model = 0; model < 2; ++model)
+		{
+			m_geometryPrograms[textured][model] = std::make_shared<ShaderProgram>(
+			    shader_directory + "gbufferVertex.glsl",
+			    shader_directory + "gbufferFragment.glsl");
+			m_programs.push_back(m_geometryPrograms[textured][model]);
+		}
+	}
+	m_lightingProgram = std::make_shared<ShaderProgram>(
+	    shader_directory + "deferredLightingVertex.glsl",
+	    shader_directory + "deferredLightingFragment.glsl");
+	m_programs.push_back(m_lightingProgram);
+
+	// A single triangle covering the whole screen
+	const glm::vec2 triangle[3] = {glm::vec2(-1.0, -1.0), glm::vec2(3.0, -1.0), glm::vec2(-1.0, 3.0)};
+	glcheck(glGenBuffers(1, &m_triangleBuffer));
+	glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_triangleBuffer));
+	glcheck(glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW));
+	glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+	release();
+	glcheck(glDeleteBuffers(1, &m_triangleBuffer));
+}
+
+void DeferredRenderer::addShaderProgram(const ShaderProgramPtr& forwardProgram, SHADING_MODEL model)
+{
+	m_forwardPrograms[forwardProgram] = model;
+}
+
+const std::vector<ShaderProgramPtr>& DeferredRenderer::getShaderPrograms() const
+{
+	return m_programs;
+}
+
+void DeferredRenderer::release()
+{
+	if (m_fbo)
+		glcheck(glDeleteFramebuffers(1, &m_fbo));
+	GLuint textures[4] = {m_albedoTexture, m_normalTexture, m_materialTexture, m_depthTexture};
+	glcheck(glDeleteTextures(4, textures));
+	m_fbo = m_albedoTexture = m_normalTexture = m_materialTexture = m_depthTexture = 0;
+	m_width = m_height = 0;
+}
+
+void DeferredRenderer::resize(unsigned int width, unsigned int height)
+{
+	release();
+	m_width = width;
+	m_height = height;
+
+	m_albedoTexture = create_texture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+	m_normalTexture = create_texture(GL_RGBA16F, GL_RGBA, GL_FLOAT, width, height);
+	m_materialTexture = create_texture(GL_RG16UI, GL_RG_INTEGER, GL_UNSIGNED_SHORT, width, height);
+	m_depthTexture = create_texture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+
+	GLint previous_fbo = 0;
+	glcheck(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_fbo));
+	glcheck(glGenFramebuffers(1, &m_fbo));
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+	glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoTexture, 0));
+	glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normalTexture, 0));
+	glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_materialTexture, 0));
+	glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0));
+	const GLenum draw_buffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+	glcheck(glDrawBuffers(3, draw_buffers));
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		LOG(error, "[DeferredRenderer] incomplete G-buffer (status " << status << ")");
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo));
+}
+
+bool DeferredRenderer::prepare(const RenderablePtr& renderable, ProgramSwaps& swaps)
+{
+	if (renderable->getRenderMode() != Renderable::WINDOW)
+		return false;
+
+	auto forward = m_forwardPrograms.find(renderable->getShaderProgram());
+	if (forward == m_forwardPrograms.end())
+		return false;
+
+	MaterialPtr material;
+	int textured = 0;
+	TexturedLightedMeshRenderablePtr tlm = std::dynamic_pointer_cast<TexturedLightedMeshRenderable>(renderable);
+	LightedMeshRenderablePtr lm = std::dynamic_pointer_cast<LightedMeshRenderable>(renderable);
+	if (tlm)
+	{
+		material = tlm->getMaterial();
+		textured = 1;
+	}
+	else if (lm)
+	{
+		material = lm->getMaterial();
+	}
+	// Transparent materials need to be blended with what is behind them
+	if (!material || material->alpha() < 1.0f)
+		return false;
+
+	// Add the material to the table of this frame
+	if (std::find(m_materials.begin(), m_materials.end(), material) == m_materials.end())
+	{
+		if (m_materials.size() >= max_materials)
+			return false;
+		material->setIndex(m_materials.size());
+		m_materials.push_back(material);
+	}
+	swaps.push_back(std::make_pair(renderable, m_geometryPrograms[textured][forward->second]));
+
+	// Children are drawn with their parent: they must be deferred too
+	HierarchicalRenderablePtr hierarchical = std::dynamic_pointer_cast<HierarchicalRenderable>(renderable);
+	if (hierarchical)
+	{
+		for (const HierarchicalRenderablePtr& child : hierarchical->getChildren())
+		{
+			if (!prepare(child, swaps))
+				return false;
+		}
+	}
+	return true;
+}
+
+void DeferredRenderer::draw(const std::vector<RenderablePtr>& renderables, std::vector<RenderablePtr>& forward,
+                            const glm::mat4& projection, const glm::mat4& view, unsigned int width, unsigned int height)
+{
+	forward.clear();
+	m_materials.clear();
+
+	std::vector<RenderablePtr> deferred;
+	std::vector<ProgramSwaps> swaps;
+	for (const RenderablePtr& r : renderables)
+	{
+		ProgramSwaps subtree;
+		if (width && height && prepare(r, subtree))
+		{
+			deferred.push_back(r);
+			swaps.push_back(subtree);
+		}
+		else
+		{
+			forward.push_back(r);
+		}
+	}
+	if (deferred.empty())
+		return;
+
+	if (width != m_width || height != m_height)
+		resize(width, height);
+
+	// Geometry pass
+	GLint previous_fbo = 0;
+	glcheck(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_fbo));
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+	const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	const GLuint zero_ui[4] = {0u, 0u, 0u, 0u};
+	const GLfloat far_depth = 1.0f;
+	glcheck(glClearBufferfv(GL_COLOR, 0, zero));
+	glcheck(glClearBufferfv(GL_COLOR, 1, zero));
+	glcheck(glClearBufferuiv(GL_COLOR, 2, zero_ui));
+	glcheck(glClearBufferfv(GL_DEPTH, 0, &far_depth));
+
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glcheck(glDisable(GL_BLEND));
+
+	for (int textured = 0; textured < 2; ++textured)
+	{
+		for (int model = 0; model < 2; ++model)
+		{
+			const ShaderProgramPtr& program = m_geometryPrograms[textured][model];
+			program->bind();
+			int location = program->getUniformLocation("useTexture");
+			if (location != ShaderProgram::null_location)
+				glcheck(glUniform1i(location, textured));
+			location = program->getUniformLocation("cartoon");
+			if (location != ShaderProgram::null_location)
+				glcheck(glUniform1i(location, model == CARTOON));
+		}
+	}
+
+	for (size_t i = 0; i < deferred.size(); ++i)
+	{
+		// Draw the subtree with the geometry programs, then restore the forward programs
+		for (auto& swap : swaps[i])
+		{
+			ShaderProgramPtr program = swap.first->getShaderProgram();
+			swap.first->setShaderProgram(swap.second);
+			swap.second = program;
+		}
+
+		const RenderablePtr& r = deferred[i];
+		r->bindShaderProgram();
+		int projectionLocation = r->projectionLocation();
+		if (projectionLocation != ShaderProgram::null_location)
+			glcheck(glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection)));
+		int viewLocation = r->viewLocation();
+		if (viewLocation != ShaderProgram::null_location)
+			glcheck(glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view)));
+		r->draw();
+		r->unbindShaderProgram();
+
+		for (auto& swap : swaps[i])
+			swap.first->setShaderProgram(swap.second);
+	}
+
+	// Lighting pass
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo));
+	m_lightingProgram->bind();
+
+	const char* samplers[4] = {"albedoSampler", "normalSampler", "materialSampler", "depthSampler"};
+	const GLuint textures[4] = {m_albedoTexture, m_normalTexture, m_materialTexture, m_depthTexture};
+	for (int unit = 0; unit < 4; ++unit)
+	{
+		glcheck(glActiveTexture(GL_TEXTURE0 + unit));
+		glcheck(glBindTexture(GL_TEXTURE_2D, textures[unit]));
+		int location = m_lightingProgram->getUniformLocation(samplers[unit]);
+		if (location != ShaderProgram::null_location)
+			glcheck(glUniform1i(location, unit));
+	}
+
+	int location = m_lightingProgram->getUniformLocation("invViewProj");
+	if (location != ShaderProgram::null_location)
+		glcheck(glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(glm::inverse(projection * view))));
+	location = m_lightingProgram->getUniformLocation("cameraPosition");
+	if (location != ShaderProgram::null_location)
+		glcheck(glUniform3fv(location, 1, glm::value_ptr(glm::vec3(glm::inverse(view)[3]))));
+
+	for (size_t i = 0; i < m_materials.size(); ++i)
+	{
+		std::ostringstream identifier;
+		identifier << "materials[" << i << "]";
+		Material::sendToGPU(m_lightingProgram, m_materials[i], identifier.str());
+	}
+
+	// The lighting pass writes the depth of the G-buffer
+	glcheck(glDepthFunc(GL_ALWAYS));
+	int positionLocation = m_lightingProgram->getAttributeLocation("vPosition");
+	if (positionLocation != ShaderProgram::null_location)
+	{
+		glcheck(glEnableVertexAttribArray(positionLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_triangleBuffer));
+		glcheck(glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+		glcheck(glDrawArrays(GL_TRIANGLES, 0, 3));
+		glcheck(glDisableVertexAttribArray(positionLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	}
+	glcheck(glDepthFunc(GL_LESS));
+
+	for (int unit = 3; unit >= 0; --unit)
+	{
+		glcheck(glActiveTexture(GL_TEXTURE0 + unit));
+		glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+	}
+	if (blend)
+		glcheck(glEnable(GL_BLEND));
+	ShaderProgram::unbind();
+}
@@ -0,0 +1,113 @@
+#include "../include/DepthPrepass.hpp"
+
+#include <GL/glew.h>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../include/HierarchicalRenderable.hpp"
+#include "../include/MeshRenderable.hpp"
+#include "../include/gl_helper.hpp"
+#include "../include/texturing/TexturedMeshRenderable.hpp"
+
+static const std::string shader_directory = "../../sfmlGraphicsPipeline/shaders/";
+
+DepthPrepass::DepthPrepass()
+{
+	m_depthProgram = std::make_shared<ShaderProgram>(
+	    shader_directory + "depthVertex.glsl",
+	    shader_directory + "depthFragment.glsl");
+	m_programs.push_back(m_depthProgram);
+}
+
+DepthPrepass::~DepthPrepass()
+{
+}
+
+void DepthPrepass::addShaderProgram(const ShaderProgramPtr& forwardProgram, float alphaCutoff)
+{
+	m_forwardPrograms[forwardProgram] = alphaCutoff;
+	if (alphaCutoff > 0.0f && m_alphaTestPrograms.find(alphaCutoff) == m_alphaTestPrograms.end())
+	{
+		ShaderProgramPtr program = std::make_shared<ShaderProgram>(
+		    shader_directory + "depthTextureVertex.glsl",
+		    shader_directory + "depthTextureFragment.glsl");
+		m_alphaTestPrograms[alphaCutoff] = program;
+		m_programs.push_back(program);
+	}
+}
+
+const std::vector<ShaderProgramPtr>& DepthPrepass::getShaderPrograms() const
+{
+	return m_programs;
+}
+
+bool DepthPrepass::prepare(const RenderablePtr& renderable, ProgramSwaps& swaps)
+{
+	if (renderable->getRenderMode() != Renderable::WINDOW || !std::dynamic_pointer_cast<MeshRenderable>(renderable))
+		return false;
+
+	auto forward = m_forwardPrograms.find(renderable->getShaderProgram());
+	if (forward == m_forwardPrograms.end())
+		return false;
+
+	// Textured meshes bind their texture only if the program has texture coordinates
+	if (forward->second > 0.0f && std::dynamic_pointer_cast<TexturedMeshRenderable>(renderable))
+		swaps.push_back(std::make_pair(renderable, m_alphaTestPrograms[forward->second]));
+	else
+		swaps.push_back(std::make_pair(renderable, m_depthProgram));
+
+	// Children are drawn with their parent: they must be pre-passed too
+	HierarchicalRenderablePtr hierarchical = std::dynamic_pointer_cast<HierarchicalRenderable>(renderable);
+	for (const HierarchicalRenderablePtr& child : hierarchical->getChildren())
+	{
+		if (!prepare(child, swaps))
+			return false;
+	}
+	return true;
+}
+
+void DepthPrepass::draw(const std::vector<RenderablePtr>& renderables, std::vector<RenderablePtr>& prepassed,
+                        const glm::mat4& projection, const glm::mat4& view)
+{
+	prepassed.clear();
+
+	for (const auto& alphaTest : m_alphaTestPrograms)
+	{
+		alphaTest.second->bind();
+		int location = alphaTest.second->getUniformLocation("alphaCutoff");
+		if (location != ShaderProgram::null_location)
+			glcheck(glUniform1f(location, alphaTest.first));
+	}
+
+	glcheck(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+	for (const RenderablePtr& r : renderables)
+	{
+		ProgramSwaps swaps;
+		if (!prepare(r, swaps))
+			continue;
+
+		// Draw the subtree with the depth programs, then restore the forward programs
+		for (auto& swap : swaps)
+		{
+			ShaderProgramPtr program = swap.first->getShaderProgram();
+			swap.first->setShaderProgram(swap.second);
+			swap.second = program;
+		}
+
+		r->bindShaderProgram();
+		int projectionLocation = r->projectionLocation();
+		if (projectionLocation != ShaderProgram::null_location)
+			glcheck(glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection)));
+		int viewLocation = r->viewLocation();
+		if (viewLocation != ShaderProgram::null_location)
+			glcheck(glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view)));
+		r->draw();
+		r->unbindShaderProgram();
+
+		for (auto& swap : swaps)
+			swap.first->setShaderProgram(swap.second);
+
+		prepassed.push_back(r);
+	}
+	glcheck(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+}
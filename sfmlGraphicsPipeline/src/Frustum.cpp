@@ -0,0 +1,42 @@
+#include "../include/Frustum.hpp"
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	// Gribb and Hartmann: the planes are sums and differences of the rows of the matrix
+	glm::mat4 m = glm::transpose(viewProjection);
+	m_planes[0] = m[3] + m[0]; // left
+	m_planes[1] = m[3] - m[0]; // right
+	m_planes[2] = m[3] + m[1]; // bottom
+	m_planes[3] = m[3] - m[1]; // top
+	m_planes[4] = m[3] + m[2]; // near
+	m_planes[5] = m[3] - m[2]; // far
+	for (glm::vec4& plane : m_planes)
+		plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersects(const glm::vec3& center, float radius) const
+{
+	for (const glm::vec4& plane : m_planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::intersects(const BoundingBox& box) const
+{
+	if (!box.isValid())
+		return true;
+
+	for (const glm::vec4& plane : m_planes)
+	{
+		// The corner of the box the farthest along the normal of the plane
+		glm::vec3 corner(plane.x >= 0 ? box.max().x : box.min().x,
+		                 plane.y >= 0 ? box.max().y : box.min().y,
+		                 plane.z >= 0 ? box.max().z : box.min().z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,286 @@
+#include "../include/GPUProfiler.hpp"
+
+#include <GL/glew.h>
+
+#include <fstream>
+
+#include "../include/gl_helper.hpp"
+#include "./../include/log.hpp"
+
+GPUProfiler::GPUProfiler(unsigned int latency, unsigned int historySize)
+    : m_enabled{false}, m_renderableTiming{false}, m_historySize{historySize}, m_ring(latency < 2 ? 2 : latency),
+      m_frame{0}, m_inFrame{false}, m_droppedFrames{0}, m_lastFrameTime{clock::now()}
+{
+	for (FrameQueries& slot : m_ring)
+	{
+		slot.used = 0;
+		slot.frame = 0;
+		slot.cpuDuration = 0;
+		slot.pending = false;
+	}
+}
+
+GPUProfiler::~GPUProfiler()
+{
+	release();
+}
+
+void GPUProfiler::release()
+{
+	for (FrameQueries& slot : m_ring)
+	{
+		if (!slot.queries.empty())
+		{
+			glcheck(glDeleteQueries(slot.queries.size(), slot.queries.data()));
+		}
+		slot.queries.clear();
+		slot.scopes.clear();
+		slot.used = 0;
+		slot.pending = false;
+	}
+	m_stack.clear();
+	m_inFrame = false;
+}
+
+void GPUProfiler::setEnabled(bool enabled)
+{
+	if (enabled && !GLEW_ARB_timer_query && !GLEW_VERSION_3_3)
+	{
+		LOG(warning, "[GPUProfiler] timer queries are not supported, the profiler stays disabled.");
+		return;
+	}
+	if (!enabled && m_enabled)
+		release();
+	m_enabled = enabled;
+	m_lastFrameTime = clock::now();
+}
+
+bool GPUProfiler::isEnabled() const
+{
+	return m_enabled;
+}
+
+void GPUProfiler::setRenderableTiming(bool enabled)
+{
+	m_renderableTiming = enabled;
+}
+
+bool GPUProfiler::isRenderableTimingEnabled() const
+{
+	return m_enabled && m_renderableTiming;
+}
+
+unsigned int GPUProfiler::timestamp()
+{
+	FrameQueries& slot = m_ring[m_frame % m_ring.size()];
+	if (slot.used == slot.queries.size())
+	{
+		unsigned int query;
+		glcheck(glGenQueries(1, &query));
+		slot.queries.push_back(query);
+	}
+	glcheck(glQueryCounter(slot.queries[slot.used], GL_TIMESTAMP));
+	return slot.used++;
+}
+
+void GPUProfiler::collect()
+{
+	// Read the oldest frames first, so that the history stays ordered
+	for (unsigned int i = 1; i <= m_ring.size(); ++i)
+	{
+		FrameQueries& slot = m_ring[(m_frame + i) % m_ring.size()];
+		if (!slot.pending)
+			continue;
+
+		// The queries of a frame complete in order: the last one tells for all
+		int available = GL_FALSE;
+		glcheck(glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+		if (!available)
+			continue;
+
+		std::vector<GLuint64> times(slot.used);
+		for (unsigned int q = 0; q < slot.used; ++q)
+		{
+			glcheck(glGetQueryObjectui64v(slot.queries[q], GL_QUERY_RESULT, &times[q]));
+		}
+
+		FrameResult result;
+		result.frame = slot.frame;
+		result.cpuDuration = slot.cpuDuration;
+		result.timings.reserve(slot.scopes.size());
+		for (const Scope& scope : slot.scopes)
+		{
+			Timing timing;
+			timing.name = scope.name;
+			timing.depth = scope.depth;
+			timing.start = (times[scope.beginQuery] - times[0]) * 1e-6;
+			timing.duration = (times[scope.endQuery] - times[scope.beginQuery]) * 1e-6;
+			result.timings.push_back(timing);
+		}
+		m_history.push_back(result);
+		while (m_history.size() > m_historySize)
+			m_history.pop_front();
+
+		slot.pending = false;
+	}
+}
+
+void GPUProfiler::beginFrame()
+{
+	if (!m_enabled)
+		return;
+	if (m_inFrame)
+		endFrame();
+
+	collect();
+
+	clock::time_point now = clock::now();
+	double cpuDuration = std::chrono::duration<double, std::milli>(now - m_lastFrameTime).count();
+	m_lastFrameTime = now;
+
+	++m_frame;
+	FrameQueries& slot = m_ring[m_frame % m_ring.size()];
+	if (slot.pending)
+	{
+		// Never wait for the GPU: the results of this old frame are lost
+		++m_droppedFrames;
+		slot.pending = false;
+	}
+	slot.used = 0;
+	slot.scopes.clear();
+	slot.frame = m_frame;
+	slot.cpuDuration = cpuDuration;
+
+	m_inFrame = true;
+	begin("frame");
+}
+
+void GPUProfiler::endFrame()
+{
+	if (!m_enabled || !m_inFrame)
+		return;
+	while (!m_stack.empty())
+		end();
+	m_ring[m_frame % m_ring.size()].pending = true;
+	m_inFrame = false;
+}
+
+void GPUProfiler::begin(const std::string& name)
+{
+	if (!m_enabled || !m_inFrame)
+		return;
+	FrameQueries& slot = m_ring[m_frame % m_ring.size()];
+	Scope scope;
+	scope.name = name;
+	scope.depth = m_stack.size();
+	scope.beginQuery = timestamp();
+	scope.endQuery = scope.beginQuery;
+	m_stack.push_back(slot.scopes.size());
+	slot.scopes.push_back(scope);
+}
+
+void GPUProfiler::end()
+{
+	if (!m_enabled || !m_inFrame || m_stack.empty())
+		return;
+	FrameQueries& slot = m_ring[m_frame % m_ring.size()];
+	slot.scopes[m_stack.back()].endQuery = timestamp();
+	m_stack.pop_back();
+}
+
+const GPUProfiler::FrameResult* GPUProfiler::lastFrame() const
+{
+	return m_history.empty() ? nullptr : &m_history.back();
+}
+
+const std::deque<GPUProfiler::FrameResult>& GPUProfiler::history() const
+{
+	return m_history;
+}
+
+unsigned long GPUProfiler::droppedFrames() const
+{
+	return m_droppedFrames;
+}
+
+bool GPUProfiler::dumpCSV(const std::string& filename) const
+{
+	std::ofstream file(filename.c_str());
+	if (!file.is_open())
+	{
+		LOG(error, "[GPUProfiler] cannot write " << filename);
+		return false;
+	}
+	file << "frame,name,depth,start_ms,duration_ms,cpu_frame_ms\n";
+	for (const FrameResult& frame : m_history)
+	{
+		for (const Timing& timing : frame.timings)
+		{
+			// Quote the names, they may contain commas
+			std::string name;
+			for (char c : timing.name)
+			{
+				if (c == '"')
+					name += '"';
+				name += c;
+			}
+			file << frame.frame << ",\"" << name << "\"," << timing.depth << "," << timing.start << ","
+			     << timing.duration << "," << frame.cpuDuration << "\n";
+		}
+	}
+	return true;
+}
+
+static std::string json_escape(const std::string& s)
+{
+	std::string escaped;
+	for (char c : s)
+	{
+		switch (c)
+		{
+		case '"':
+			escaped += "\\\"";
+			break;
+		case '\\':
+			escaped += "\\\\";
+			break;
+		case '\n':
+			escaped += "\\n";
+			break;
+		case '\t':
+			escaped += "\\t";
+			break;
+		default:
+			if ((unsigned char)c < 0x20)
+				escaped += ' ';
+			else
+				escaped += c;
+		}
+	}
+	return escaped;
+}
+
+bool GPUProfiler::dumpJSON(const std::string& filename) const
+{
+	std::ofstream file(filename.c_str());
+	if (!file.is_open())
+	{
+		LOG(error, "[GPUProfiler] cannot write " << filename);
+		return false;
+	}
+	file << "{\n  \"droppedFrames\": " << m_droppedFrames << ",\n  \"frames\": [";
+	for (auto frame = m_history.begin(); frame != m_history.end(); ++frame)
+	{
+		file << (frame == m_history.begin() ? "\n" : ",\n");
+		file << "    {\"frame\": " << frame->frame << ", \"cpuMs\": " << frame->cpuDuration << ", \"scopes\": [";
+		for (auto timing = frame->timings.begin(); timing != frame->timings.end(); ++timing)
+		{
+			file << (timing == frame->timings.begin() ? "" : ", ");
+			file << "{\"name\": \"" << json_escape(timing->name) << "\", \"depth\": " << timing->depth
+			     << ", \"startMs\": " << timing->start << ", \"durationMs\": " << timing->duration << "}";
+		}
+		file << "]}";
+	}
+	file << "\n  ]\n}\n";
+	return true;
+}
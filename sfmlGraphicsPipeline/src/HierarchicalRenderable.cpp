@@ -2,16 +2,25 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <fstream>
 
+#include "../include/Io.hpp"
 #include "../include/Viewer.hpp"
 #include "../include/gl_helper.hpp"
 
-HierarchicalRenderable::~HierarchicalRenderable() {}
+HierarchicalRenderable::~HierarchicalRenderable()
+{
+	if (m_transformStore)
+		m_transformStore->remove(m_transformHandle);
+}
 
-HierarchicalRenderable::HierarchicalRenderable(ShaderProgramPtr shaderProgram) : Renderable(shaderProgram), m_parent(nullptr), m_globalTransform(glm::mat4(1.0)), m_localTransform(glm::mat4(1.0))
+HierarchicalRenderable::HierarchicalRenderable(ShaderProgramPtr shaderProgram) : Renderable(shaderProgram), m_parent(nullptr), m_globalTransform(glm::mat4(1.0)), m_localTransform(glm::mat4(1.0)),
+                                                                                 m_globalVersion(1), m_localVersion(1), m_totalGlobalTransform(glm::mat4(1.0)), m_totalGlobalVersion(0),
+                                                                                 m_cachedGlobalVersion(0), m_cachedParentVersion(0), m_modelTotalGlobalVersion(0), m_modelLocalVersion(0),
+                                                                                 m_dirtyDescendants(false), m_transformHandle(TransformStore::null_handle)
 {
 }
 
@@ -23,12 +32,91 @@ const glm::mat4& HierarchicalRenderable::getGlobalTransform() const
 void HierarchicalRenderable::setGlobalTransform(const glm::mat4& globalTransform)
 {
 	//m_globalTransform = m_inverse * globalTransform;
+	// Keyframed renderables set their transform at each frame, even when they do not move
+	if (globalTransform == m_globalTransform)
+		return;
 	m_globalTransform = globalTransform;
+	++m_globalVersion;
+	markDirty();
+	if (m_transformStore)
+		m_transformStore->setGlobalTransform(m_transformHandle, m_globalTransform);
+	boundsChanged();
+}
+
+void HierarchicalRenderable::markDirty()
+{
+	// The flag of an ancestor is set if the flag of its child is set: stop at the first one
+	for (HierarchicalRenderable* ancestor = m_parent.get(); ancestor && !ancestor->m_dirtyDescendants; ancestor = ancestor->m_parent.get())
+		ancestor->m_dirtyDescendants = true;
+}
+
+bool HierarchicalRenderable::refreshTotalGlobalTransform() const
+{
+	unsigned int parentVersion = m_parent ? m_parent->m_totalGlobalVersion : 0;
+	if (m_cachedGlobalVersion == m_globalVersion && m_cachedParentVersion == parentVersion)
+		return false;
+
+	if (m_parent)
+		m_totalGlobalTransform = m_parent->m_totalGlobalTransform * m_globalTransform;
+	else
+		m_totalGlobalTransform = m_globalTransform;
+	m_cachedGlobalVersion = m_globalVersion;
+	m_cachedParentVersion = parentVersion;
+	++m_totalGlobalVersion;
+	return true;
+}
+
+void HierarchicalRenderable::updateTotalGlobalTransform() const
+{
+	if (m_parent)
+		m_parent->updateTotalGlobalTransform();
+	refreshTotalGlobalTransform();
+}
+
+void HierarchicalRenderable::refreshModelMatrix()
+{
+	if (m_modelTotalGlobalVersion == m_totalGlobalVersion && m_modelLocalVersion == m_localVersion)
+		return;
+	m_model = m_totalGlobalTransform * m_localTransform;
+	m_modelTotalGlobalVersion = m_totalGlobalVersion;
+	m_modelLocalVersion = m_localVersion;
 }
 
 void HierarchicalRenderable::updateModelMatrix()
 {
-	m_model = computeTotalGlobalTransform() * m_localTransform;
+	if (m_transformStore)
+	{
+		m_transformStore->update();
+		m_model = m_transformStore->modelMatrix(m_transformHandle);
+		return;
+	}
+	updateTotalGlobalTransform();
+	refreshModelMatrix();
+}
+
+void HierarchicalRenderable::updateHierarchy()
+{
+	// The store updates the whole hierarchy at once, the children only copy their model matrix
+	if (m_transformStore)
+	{
+		updateModelMatrix();
+		return;
+	}
+	if (m_parent)
+		m_parent->updateTotalGlobalTransform();
+	propagateTransforms(false);
+}
+
+void HierarchicalRenderable::propagateTransforms(bool parentMoved)
+{
+	bool moved = refreshTotalGlobalTransform();
+	refreshModelMatrix();
+	if (!moved && !parentMoved && !m_dirtyDescendants)
+		return;
+
+	m_dirtyDescendants = false;
+	for (size_t i = 0; i < m_children.size(); ++i)
+		m_children[i]->propagateTransforms(moved);
 }
 
 const glm::mat4& HierarchicalRenderable::getLocalTransform() const
@@ -38,28 +126,38 @@ const glm::mat4& HierarchicalRenderable::getLocalTransform() const
 
 void HierarchicalRenderable::setLocalTransform(const glm::mat4& localTransform)
 {
+	if (localTransform == m_localTransform)
+		return;
 	m_localTransform = localTransform;
+	++m_localVersion;
+	markDirty();
+	if (m_transformStore)
+		m_transformStore->setLocalTransform(m_transformHandle, m_localTransform);
+	boundsChanged();
 }
 
-glm::mat4 HierarchicalRenderable::computeTotalGlobalTransform() const
+const glm::mat4& HierarchicalRenderable::computeTotalGlobalTransform() const
 {
-	if (m_parent)
-	{
-		return m_parent->computeTotalGlobalTransform() * m_globalTransform;
-	}
-	else
+	if (m_transformStore)
 	{
-		return m_globalTransform;
+		m_transformStore->update();
+		return m_transformStore->totalGlobalTransform(m_transformHandle);
 	}
+	updateTotalGlobalTransform();
+	return m_totalGlobalTransform;
 }
 
 void HierarchicalRenderable::beforeDraw()
 {
 	// Each time m_localTransform is modified we need to update the model matrix of the instance.
 	// Each time m_globalTransform is modified we need to udpate the model matrix of the instance and its children.
-	// This could be implemented efficiently using a flag system to update the hierarchy whenever m_globalTransform is called.
-	// However this is a simple implementation and we chose to pay the price of a brutal update before each draw.
-	updateModelMatrix();
+	// The root updates the whole hierarchy before drawing it, and the versions of the transforms tell
+	// which cached matrices are out of date. The children are then already up to date, unless they are
+	// drawn on their own: they check their ancestors in this case.
+	if (m_parent || m_transformStore)
+		updateModelMatrix();
+	else
+		updateHierarchy();
 }
 
 void HierarchicalRenderable::afterDraw()
@@ -74,6 +172,9 @@ void HierarchicalRenderable::afterDraw()
 	//-Unbind their respective shaderProgram.
 	for (size_t i = 0; i < m_children.size(); ++i)
 	{
+		if (!m_children[i]->isActive())
+			continue;
+
 		// this affectation here is a little hack we use to keep the source code simple.
 		// As we go through the hierarchy for the drawing, we will need to have access to the camera, in order
 		// to get the projection and the view matrices. The non root hierarchical renderables has not been added
@@ -94,12 +195,25 @@ void HierarchicalRenderable::afterAnimate(float time)
 	// After the instance has been animated using do_animate,
 	// we loop over its children and animate them
 	for (size_t i = 0; i < m_children.size(); ++i)
-		m_children[i]->animate(time);
+	{
+		if (m_children[i]->isActive())
+			m_children[i]->animate(time);
+	}
 }
 
 void HierarchicalRenderable::addChild(HierarchicalRenderablePtr parent, HierarchicalRenderablePtr child, bool inverse)
 {
+	// A child has a single parent: it would be drawn by each of them
+	if (child->m_parent)
+	{
+		std::vector<HierarchicalRenderablePtr>& siblings = child->m_parent->m_children;
+		siblings.erase(std::remove(siblings.begin(), siblings.end(), child), siblings.end());
+		child->m_parent->boundsChanged();
+	}
 	child->m_parent = parent;
+	// The cached transforms of the child were computed with another parent
+	++child->m_globalVersion;
+	child->markDirty();
 	if (inverse)
 	{
 		child->m_inverse = glm::inverse(parent->computeTotalGlobalTransform());
@@ -110,44 +224,93 @@ void HierarchicalRenderable::addChild(HierarchicalRenderablePtr parent, Hierarch
 	}
 	child->setGlobalTransform(child->m_globalTransform);
 	parent->m_children.push_back(child);
+	animationChanged();
+	child->boundsChanged();
+
+	// The child joins the store of its new hierarchy
+	if (child->m_transformStore && child->m_transformStore == parent->m_transformStore)
+		child->m_transformStore->setParent(child->m_transformHandle, parent->m_transformHandle);
+	else
+		child->attachTransformStore(parent->m_transformStore);
 }
 
-std::vector<HierarchicalRenderablePtr>& HierarchicalRenderable::getChildren()
+void HierarchicalRenderable::setTransformStore(const TransformStorePtr& store)
 {
-	return m_children;
+	HierarchicalRenderable* root = this;
+	while (root->m_parent)
+		root = root->m_parent.get();
+	root->attachTransformStore(store);
 }
 
-void HierarchicalRenderable::applyObjTransform(const std::string &filename)
+void HierarchicalRenderable::attachTransformStore(const TransformStorePtr& store)
+{
+	if (m_transformStore != store)
+	{
+		if (m_transformStore)
+			m_transformStore->remove(m_transformHandle);
+		m_transformStore = store;
+		m_transformHandle = TransformStore::null_handle;
+		if (m_transformStore)
+		{
+			// The parent is attached first, and is in the same store
+			TransformStore::Handle parent = m_parent && m_parent->m_transformStore == store ? m_parent->m_transformHandle : TransformStore::null_handle;
+			m_transformHandle = m_transformStore->add(parent, m_globalTransform, m_localTransform);
+		}
+	}
+	for (size_t i = 0; i < m_children.size(); ++i)
+		m_children[i]->attachTransformStore(store);
+}
+
+const TransformStorePtr& HierarchicalRenderable::getTransformStore() const
+{
+	return m_transformStore;
+}
+
+const BoundingBox& HierarchicalRenderable::updateWorldBounds()
 {
-	glm::mat4 transform = glm::mat4(1.0f);
-	std::ifstream fin(filename.c_str());
-	if (fin)
+	updateModelMatrix();
+	Renderable::updateWorldBounds();
+	for (size_t i = 0; i < m_children.size() && m_worldBounds.isValid(); ++i)
+	{
+		if (!m_children[i]->isActive())
+			continue;
+		const BoundingBox& childBounds = m_children[i]->updateWorldBounds();
+		if (childBounds.isValid())
+			m_worldBounds.extend(childBounds);
+		else
+			m_worldBounds = BoundingBox();
+	}
+	return m_worldBounds;
+}
+
+bool HierarchicalRenderable::pick(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	bool hit = intersectRay(origin, direction, distance);
+	for (size_t i = 0; i < m_children.size(); ++i)
 	{
-		std::string token;
-		while (fin >> token)
+		if (!m_children[i]->isActive())
+			continue;
+		float childDistance;
+		if (m_children[i]->pick(origin, direction, childDistance) && (!hit || childDistance < distance))
 		{
-			if (token == "TRANSFORM")
-			{
-				float m[16];
-				bool ok = true;
-				for (int i = 0; i < 16; ++i)
-				{
-					if (!(fin >> m[i]))
-					{
-						ok = false;
-						break;
-					}
-				}
-				if (ok)
-				{
-					for (int r = 0; r < 4; ++r)
-						for (int c = 0; c < 4; ++c)
-							// break;
-							transform[c][r] = m[r * 4 + c]; // map row-major to GLM (column-major)
-				}
-				break;
-			}
+			distance = childDistance;
+			hit = true;
 		}
 	}
-	this->setGlobalTransform(transform);
+	return hit;
+}
+
+std::vector<HierarchicalRenderablePtr>& HierarchicalRenderable::getChildren()
+{
+	return m_children;
+}
+
+const HierarchicalRenderablePtr& HierarchicalRenderable::getParent() const
+{
+	return m_parent;
+}
+
+void HierarchicalRenderable::applyObjTransform(const std::string &filename)
+{
+	this->setGlobalTransform(read_obj_transform(filename));
 }
\ No newline at end of file
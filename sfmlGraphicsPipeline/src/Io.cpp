@@ -1,5 +1,8 @@
 #include "../include/Io.hpp"
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
 #define TINYOBJLOADER_IMPLEMENTATION  // define this in only *one* .cc
@@ -60,3 +63,126 @@ bool read_obj(const std::string& filename,
 
 	return ret;
 }
+
+static const char lod_cache_magic[4] = {'L', 'O', 'D', '2'};
+
+// FNV-1a hash of the geometry that the levels of detail are computed from
+static uint64_t mesh_hash(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+{
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(positions.data());
+	for (size_t i = 0; i < positions.size() * sizeof(glm::vec3); ++i)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	bytes = reinterpret_cast<const unsigned char*>(indices.data());
+	for (size_t i = 0; i < indices.size() * sizeof(unsigned int); ++i)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+bool read_lod_cache(const std::string& filename,
+                    const std::vector<glm::vec3>& positions,
+                    const std::vector<unsigned int>& meshIndices,
+                    std::vector<std::vector<unsigned int> >& lodIndices,
+                    std::vector<float>& lodErrors)
+{
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	if (!in)
+		return false;
+
+	size_t vertexCount = positions.size();
+	size_t indexCount = meshIndices.size();
+	char magic[4];
+	uint32_t header[3];
+	uint64_t hash = 0;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(header), sizeof(header));
+	in.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+	if (!in || std::memcmp(magic, lod_cache_magic, sizeof(magic)) != 0 || header[0] != vertexCount || header[1] != indexCount)
+		return false;
+	if (hash != mesh_hash(positions, meshIndices))
+		return false;
+
+	std::vector<std::vector<unsigned int> > indices(header[2]);
+	std::vector<float> errors(header[2]);
+	for (size_t l = 0; l < indices.size(); ++l)
+	{
+		uint32_t count = 0;
+		in.read(reinterpret_cast<char*>(&errors[l]), sizeof(float));
+		in.read(reinterpret_cast<char*>(&count), sizeof(count));
+		if (!in || count > indexCount)
+			return false;
+		indices[l].resize(count);
+		in.read(reinterpret_cast<char*>(indices[l].data()), count * sizeof(unsigned int));
+		if (!in)
+			return false;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (indices[l][i] >= vertexCount)
+				return false;
+		}
+	}
+
+	lodIndices.swap(indices);
+	lodErrors.swap(errors);
+	return true;
+}
+
+bool write_lod_cache(const std::string& filename,
+                     const std::vector<glm::vec3>& positions,
+                     const std::vector<unsigned int>& indices,
+                     const std::vector<std::vector<unsigned int> >& lodIndices,
+                     const std::vector<float>& lodErrors)
+{
+	std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	uint32_t header[3] = {uint32_t(positions.size()), uint32_t(indices.size()), uint32_t(lodIndices.size())};
+	uint64_t hash = mesh_hash(positions, indices);
+	out.write(lod_cache_magic, sizeof(lod_cache_magic));
+	out.write(reinterpret_cast<const char*>(header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+	for (size_t l = 0; l < lodIndices.size(); ++l)
+	{
+		uint32_t count = lodIndices[l].size();
+		out.write(reinterpret_cast<const char*>(&lodErrors[l]), sizeof(float));
+		out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		out.write(reinterpret_cast<const char*>(lodIndices[l].data()), count * sizeof(unsigned int));
+	}
+	return bool(out);
+}
+
+glm::mat4 read_obj_transform(const std::string& filename)
+{
+	glm::mat4 transform = glm::mat4(1.0f);
+	std::ifstream fin(filename.c_str());
+	if (fin)
+	{
+		std::string token;
+		while (fin >> token)
+		{
+			if (token == "TRANSFORM")
+			{
+				float m[16];
+				bool ok = true;
+				for (int i = 0; i < 16; ++i)
+				{
+					if (!(fin >> m[i]))
+					{
+						ok = false;
+						break;
+					}
+				}
+				if (ok)
+				{
+					for (int r = 0; r < 4; ++r)
+						for (int c = 0; c < 4; ++c)
+							// break;
+							transform[c][r] = m[r * 4 + c]; // map row-major to GLM (column-major)
+				}
+				break;
+			}
+		}
+	}
+	return transform;
+}
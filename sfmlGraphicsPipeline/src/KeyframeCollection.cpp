@@ -4,22 +4,58 @@
 #include <glm/gtx/compatibility.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <limits>
 #include <string>
 #include <algorithm>
 #include <regex>
 
+#include "../include/log.hpp"
+
+// Reduction of the files read by addFromFile(), disabled by default
+static float import_translation_tolerance = 0.0f;
+static float import_angle_tolerance = 0.0f;
+static bool import_rewrite_files = false;
+
+KeyframeCollection::KeyframeCollection() : m_cursor(0)
+{
+}
+
+void KeyframeCollection::setImportReduction(float translation_tolerance, float angle_tolerance, bool rewrite_files)
+{
+	import_translation_tolerance = translation_tolerance;
+	import_angle_tolerance = angle_tolerance;
+	import_rewrite_files = rewrite_files;
+}
+
 void KeyframeCollection::add(const GeometricTransformation &transformation, float time, KeyframeInterpolationMode interpolation)
 {
-	Keyframe k;
-	k.time = time;
-	k.transform = transformation;
-	k.interpolation = interpolation;
-	m_keyframes.insert(std::make_pair(time, k));
+	// A keyframe is not replaced by a new one at the same time
+	std::vector<float>::iterator it = std::lower_bound(m_times.begin(), m_times.end(), time);
+	if (it != m_times.end() && *it == time)
+		return;
+	size_t k = it - m_times.begin();
+	m_times.insert(it, time);
+	m_translations.insert(m_translations.begin() + k, transformation.getTranslation());
+	m_orientations.insert(m_orientations.begin() + k, transformation.getOrientation());
+	m_scales.insert(m_scales.begin() + k, transformation.getScale());
+	m_interpolations.insert(m_interpolations.begin() + k, interpolation);
+	m_segments.insert(m_segments.begin() + k, Segment());
+	m_cursor = 0;
+
+	// A cubic segment depends on the keyframe before it and the one after it
+	size_t first = k >= 2 ? k - 2 : 0;
+	size_t last = std::min(k + 2, m_times.size() - 1);
+	for (size_t s = first; s < last; ++s)
+		bakeSegment(s);
 }
 
 void KeyframeCollection::addFromFile(const std::string &animation_filename, float time_shift)
 {
+	// The keyframes of the file are reduced on their own, before they are added
+	KeyframeCollection file;
+	size_t lines = 0;
 	std::ifstream is(animation_filename);
 	std::string str;
 	while (getline(is, str))
@@ -47,143 +83,293 @@ void KeyframeCollection::addFromFile(const std::string &animation_filename, floa
 			interp = CUBIC;
 		}
 
-		this->add(GeometricTransformation(loc, glm::normalize(rot), size), std::stof(split[0]) + time_shift, interp);
+		file.add(GeometricTransformation(loc, glm::normalize(rot), size), std::stof(split[0]) + time_shift, interp);
+		++lines;
+	}
+
+	if (import_translation_tolerance > 0.0f)
+	{
+		size_t duplicates = lines - file.m_times.size();
+		size_t redundant = file.reduce(import_translation_tolerance, import_angle_tolerance);
+		LOG(info, "[KeyframeCollection] " << animation_filename << ": " << file.m_times.size() << " keyframes kept, "
+		                                  << duplicates << " duplicates and " << redundant << " redundant keyframes removed");
+		if (import_rewrite_files && duplicates + redundant > 0 && !file.saveToFile(animation_filename, time_shift))
+			LOG(error, "[KeyframeCollection] cannot write " << animation_filename);
+	}
+
+	if (m_times.empty())
+	{
+		*this = file;
+		return;
+	}
+	for (size_t k = 0; k < file.m_times.size(); ++k)
+	{
+		this->add(GeometricTransformation(file.m_translations[k], file.m_orientations[k], file.m_scales[k]),
+		          file.m_times[k], file.m_interpolations[k]);
 	}
 }
 
-// Stolen from https://graphicscompendium.com/opengl/22-interpolation
-float cubicInterpolate(
-	float x0, float x1,
-	float x2, float x3,
-	float t)
+bool KeyframeCollection::saveToFile(const std::string &animation_filename, float time_shift) const
+{
+	std::ofstream os(animation_filename);
+	if (!os)
+		return false;
+	os << std::setprecision(std::numeric_limits<float>::max_digits10);
+	for (size_t k = 0; k < m_times.size(); ++k)
+	{
+		// Back to the Z-up of the exporter, see addFromFile()
+		const glm::vec3& loc = m_translations[k];
+		const glm::quat& rot = m_orientations[k];
+		const glm::vec3& size = m_scales[k];
+		const char* interp = m_interpolations[k] == LINEAR ? "LINEAR" : m_interpolations[k] == CONSTANT ? "CONSTANT" : "BEZIER";
+		os << m_times[k] - time_shift << ',' << interp << ','
+		   << loc.x << ',' << -loc.z << ',' << loc.y << ','
+		   << rot.x << ',' << -rot.z << ',' << rot.y << ',' << rot.w << ','
+		   << size.x << ',' << size.z << ',' << size.y << '\n';
+	}
+	return bool(os);
+}
+
+void KeyframeCollection::remove(size_t k)
 {
-	float a = (3.0 * x1 - 3.0 * x2 + x3 - x0) / 2.0;
-	float b = (2.0 * x0 - 5.0 * x1 + 4.0 * x2 - x3) / 2.0;
-	float c = (x2 - x0) / 2.0;
-	float d = x1;
+	m_times.erase(m_times.begin() + k);
+	m_translations.erase(m_translations.begin() + k);
+	m_orientations.erase(m_orientations.begin() + k);
+	m_scales.erase(m_scales.begin() + k);
+	m_interpolations.erase(m_interpolations.begin() + k);
+	m_segments.erase(m_segments.begin() + k);
+	m_cursor = 0;
 
-	return a * t * t * t +
-		   b * t * t +
-		   c * t +
-		   d;
+	// The keyframes around the removed one are now neighbours
+	size_t first = k >= 2 ? k - 2 : 0;
+	size_t last = std::min(k + 1, m_times.size() - 1);
+	for (size_t s = first; s < last; ++s)
+		bakeSegment(s);
 }
 
-glm::mat4 KeyframeCollection::interpolateTransformation(float time) const
+size_t KeyframeCollection::reduce(float translation_tolerance, float angle_tolerance)
 {
-	if (!m_keyframes.empty())
+	const int subdivisions = 8;
+	const KeyframeCollection original(*this);
+	const std::vector<float>& times = original.m_times;
+	float cos_half_angle = std::cos(0.5f * angle_tolerance);
+
+	size_t removed = 0;
+	size_t k = 1;
+	while (k + 1 < m_times.size())
 	{
-		// Handle the case where the time parameter is outside the keyframes time scope.
-		std::map<float, Keyframe>::const_iterator first = m_keyframes.begin();
-		std::map<float, Keyframe>::const_iterator last = std::prev(m_keyframes.end());
-		if (time <= first->first)
+		// Removing a keyframe changes the cubic segments up to two keyframes away
+		float begin = m_times[k >= 2 ? k - 2 : 0];
+		float end = m_times[std::min(k + 2, m_times.size() - 1)];
+		GeometricTransformation keyframe(m_translations[k], m_orientations[k], m_scales[k]);
+		float time = m_times[k];
+		KeyframeInterpolationMode interpolation = m_interpolations[k];
+		remove(k);
+
+		bool within = true;
+		size_t o = std::lower_bound(times.begin(), times.end(), begin) - times.begin();
+		for (; within && o + 1 < times.size() && times[o] < end; ++o)
 		{
-			return first->second.transform.toMatrix();
+			for (int i = 0; within && i < subdivisions; ++i)
+			{
+				float t = times[o] + (times[o + 1] - times[o]) * i / subdivisions;
+				glm::vec3 t0, s0, t1, s1;
+				glm::quat q0, q1;
+				original.interpolate(t, t0, q0, s0);
+				interpolate(t, t1, q1, s1);
+				within = glm::distance(t0, t1) <= translation_tolerance && glm::distance(s0, s1) <= translation_tolerance
+				         && std::abs(glm::dot(glm::normalize(q0), glm::normalize(q1))) >= cos_half_angle;
+			}
 		}
-		else if (time >= last->first)
+
+		if (within)
+		{
+			++removed;
+		}
+		else
 		{
-			return last->second.transform.toMatrix();
+			add(keyframe, time, interpolation);
+			++k;
 		}
+	}
+	return removed;
+}
 
-		glm::mat4 iMatrix(1.0f);
+// Coefficients of the Catmull-Rom spline from x1 to x2, highest degree first
+// Stolen from https://graphicscompendium.com/opengl/22-interpolation
+static std::array<glm::vec3, 4> catmullRomCoefficients(
+	const glm::vec3& x0, const glm::vec3& x1,
+	const glm::vec3& x2, const glm::vec3& x3)
+{
+	std::array<glm::vec3, 4> c;
+	c[0] = (3.0f * x1 - 3.0f * x2 + x3 - x0) / 2.0f;
+	c[1] = (2.0f * x0 - 5.0f * x1 + 4.0f * x2 - x3) / 2.0f;
+	c[2] = (x2 - x0) / 2.0f;
+	c[3] = x1;
+	return c;
+}
 
-		std::map<float, Keyframe>::const_iterator ki2 = m_keyframes.upper_bound(time);
-		std::map<float, Keyframe>::const_iterator ki1 = std::prev(ki2);
+static glm::vec3 horner(const std::array<glm::vec3, 4>& c, float t)
+{
+	return ((c[0] * t + c[1]) * t + c[2]) * t + c[3];
+}
 
-		float factor = (time - ki1->first) / (ki2->first - ki1->first);
+// Logarithm of a unit quaternion, a pure quaternion
+static glm::quat quatLog(const glm::quat& q)
+{
+	glm::vec3 v(q.x, q.y, q.z);
+	float length = glm::length(v);
+	if (length < 1e-6f)
+		return glm::quat(0.0f, v.x, v.y, v.z);
+	v *= std::atan2(length, q.w) / length;
+	return glm::quat(0.0f, v.x, v.y, v.z);
+}
 
-		switch (ki1->second.interpolation)
-		{
-		case CUBIC:
-		{
-			std::map<float, Keyframe>::const_iterator first = m_keyframes.begin();
-			std::map<float, Keyframe>::const_iterator last = m_keyframes.end();
+// Exponential of a pure quaternion, a unit quaternion
+static glm::quat quatExp(const glm::quat& q)
+{
+	glm::vec3 v(q.x, q.y, q.z);
+	float angle = glm::length(v);
+	if (angle < 1e-6f)
+		return glm::normalize(glm::quat(1.0f, v.x, v.y, v.z));
+	v *= std::sin(angle) / angle;
+	return glm::quat(std::cos(angle), v.x, v.y, v.z);
+}
 
-			std::map<float, Keyframe>::const_iterator ki0 = std::prev(ki1);
-			if (ki1 == first || ki0->second.interpolation != CUBIC) // Only take cubic keyframes into account
-			{
-				ki0 = ki1;
-			}
-			std::map<float, Keyframe>::const_iterator ki3 = std::next(ki2);
-			if (ki3 == last || ki2->second.interpolation != CUBIC)
-			{
-				ki3 = ki2;
-			}
-			GeometricTransformation g0 = ki0->second.transform;
-			GeometricTransformation g1 = ki1->second.transform;
-			// Current instant is between these two keyframes
-			GeometricTransformation g2 = ki2->second.transform;
-			GeometricTransformation g3 = ki3->second.transform;
-			glm::vec3 t0 = g0.getTranslation();
-			glm::vec3 t1 = g1.getTranslation();
-			glm::vec3 t2 = g2.getTranslation();
-			glm::vec3 t3 = g3.getTranslation();
-			glm::vec3 s0 = g0.getScale();
-			glm::vec3 s1 = g1.getScale();
-			glm::vec3 s2 = g2.getScale();
-			glm::vec3 s3 = g3.getScale();
-			glm::quat r0 = glm::normalize(g0.getOrientation());
-			glm::quat r1 = glm::normalize(g1.getOrientation());
-			glm::quat r2 = glm::normalize(g2.getOrientation());
-			glm::quat r3 = glm::normalize(g3.getOrientation());
-			glm::vec3 interpTranslation;
-			glm::vec3 interpScale;
-			glm::quat interpOrientation;
-			for (int i = 0; i < 3; i++)
-			{
-				interpTranslation[i] = cubicInterpolate(
-					t0[i], t1[i], t2[i], t3[i],
-					factor);
-				interpScale[i] = cubicInterpolate(
-					s0[i], s1[i], s2[i], s3[i],
-					factor);
-			}
-			for (int i = 0; i < 4; i++)
-			{
-				interpOrientation[i] = cubicInterpolate(
-					r0[i], r1[i], r2[i], r3[i],
-					factor);
-			}
-			interpOrientation = glm::normalize(interpOrientation);
+// Inner control point of a squad at q1, between q0 and q2
+static glm::quat squadControlPoint(const glm::quat& q0, const glm::quat& q1, const glm::quat& q2)
+{
+	glm::quat inverse = glm::conjugate(q1);
+	glm::quat l = quatLog(inverse * q2) + quatLog(inverse * q0);
+	return glm::normalize(q1 * quatExp(l * -0.25f));
+}
 
-			iMatrix = glm::translate(iMatrix, interpTranslation);
-			iMatrix *= glm::toMat4(interpOrientation);
-			iMatrix = glm::scale(iMatrix, interpScale);
+void KeyframeCollection::bakeSegment(size_t k)
+{
+	if (m_interpolations[k] != CUBIC)
+		return;
 
-			break;
-		}
-		case LINEAR:
-		{
-			Keyframe k1 = ki1->second;
-			Keyframe k2 = ki2->second;
+	// Only take cubic keyframes into account
+	size_t k1 = k;
+	size_t k2 = k + 1;
+	size_t k0 = k1 > 0 && m_interpolations[k1 - 1] == CUBIC ? k1 - 1 : k1;
+	size_t k3 = k2 + 1 < m_times.size() && m_interpolations[k2] == CUBIC ? k2 + 1 : k2;
 
-			glm::vec3 interpTranslation = glm::lerp(k1.transform.getTranslation(), k2.transform.getTranslation(), factor);
-			glm::vec3 interpScale = glm::lerp(k1.transform.getScale(), k2.transform.getScale(), factor);
-			glm::quat interpOrientation = glm::slerp(glm::normalize(k1.transform.getOrientation()), glm::normalize(k2.transform.getOrientation()), factor);
+	Segment& segment = m_segments[k];
+	segment.translation = catmullRomCoefficients(m_translations[k0], m_translations[k1], m_translations[k2], m_translations[k3]);
+	segment.scale = catmullRomCoefficients(m_scales[k0], m_scales[k1], m_scales[k2], m_scales[k3]);
 
-			iMatrix = glm::translate(iMatrix, interpTranslation);
-			iMatrix *= glm::toMat4(interpOrientation);
-			iMatrix = glm::scale(iMatrix, interpScale);
+	// Each orientation in the hemisphere of the previous one, for the shortest rotations
+	glm::quat q1 = glm::normalize(m_orientations[k1]);
+	glm::quat q0 = glm::normalize(m_orientations[k0]);
+	glm::quat q2 = glm::normalize(m_orientations[k2]);
+	glm::quat q3 = glm::normalize(m_orientations[k3]);
+	if (glm::dot(q0, q1) < 0)
+		q0 = -q0;
+	if (glm::dot(q1, q2) < 0)
+		q2 = -q2;
+	if (glm::dot(q2, q3) < 0)
+		q3 = -q3;
+	segment.orientation[0] = q1;
+	segment.orientation[1] = q2;
+	segment.orientation[2] = squadControlPoint(q0, q1, q2);
+	segment.orientation[3] = squadControlPoint(q1, q2, q3);
+}
 
-			break;
-		}
-		case CONSTANT:
-		{
-			// Just use the previous keyframe's transform
-			iMatrix = ki1->second.transform.toMatrix();
+// Same matrix as GeometricTransformation::toMatrix()
+static glm::mat4 compose(const glm::vec3& translation, const glm::quat& orientation, const glm::vec3& scale)
+{
+	glm::mat4 rot = glm::mat4_cast(orientation);
+	glm::mat4 transformation;
+	transformation[0] = rot[0] * scale.x;
+	transformation[1] = rot[1] * scale.y;
+	transformation[2] = rot[2] * scale.z;
+	transformation[3] = glm::vec4(translation, 1.0f);
+	return transformation;
+}
 
-			break;
-		}
-		}
+size_t KeyframeCollection::findSegment(float time) const
+{
+	// Playing forward, the time is in the same segment or in the next one
+	size_t last = m_times.size() - 1;
+	if (m_cursor < last && m_times[m_cursor] <= time)
+	{
+		if (time < m_times[m_cursor + 1])
+			return m_cursor;
+		if (m_cursor + 1 < last && time < m_times[m_cursor + 2])
+			return ++m_cursor;
+	}
+	m_cursor = std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin() - 1;
+	return m_cursor;
+}
+
+glm::mat4 KeyframeCollection::interpolateTransformation(float time) const
+{
+	if (m_times.empty())
+		return glm::mat4(1.0);
 
-		return iMatrix;
+	glm::vec3 translation, scale;
+	glm::quat orientation;
+	interpolate(time, translation, orientation, scale);
+	return compose(translation, orientation, scale);
+}
+
+void KeyframeCollection::interpolate(float time, glm::vec3& translation, glm::quat& orientation, glm::vec3& scale) const
+{
+	// Handle the case where the time parameter is outside the keyframes time scope.
+	size_t last = m_times.size() - 1;
+	size_t k = time <= m_times[0] ? 0 : last;
+	if (time <= m_times[0] || time >= m_times[last])
+	{
+		translation = m_translations[k];
+		orientation = m_orientations[k];
+		scale = m_scales[k];
+		return;
 	}
-	else
+
+	// Current instant is between the keyframes k1 and k2
+	size_t k1 = findSegment(time);
+	size_t k2 = k1 + 1;
+	float factor = (time - m_times[k1]) / (m_times[k2] - m_times[k1]);
+
+	switch (m_interpolations[k1])
 	{
-		return glm::mat4(1.0);
+	case CUBIC:
+	{
+		const Segment& segment = m_segments[k1];
+		const std::array<glm::quat, 4>& q = segment.orientation;
+		translation = horner(segment.translation, factor);
+		orientation = glm::mix(glm::mix(q[0], q[1], factor), glm::mix(q[2], q[3], factor), 2.0f * factor * (1.0f - factor));
+		scale = horner(segment.scale, factor);
+		break;
+	}
+	case LINEAR:
+	{
+		translation = glm::lerp(m_translations[k1], m_translations[k2], factor);
+		orientation = glm::slerp(glm::normalize(m_orientations[k1]), glm::normalize(m_orientations[k2]), factor);
+		scale = glm::lerp(m_scales[k1], m_scales[k2], factor);
+		break;
+	}
+	case CONSTANT:
+	default:
+		// Just use the previous keyframe's transform
+		translation = m_translations[k1];
+		orientation = m_orientations[k1];
+		scale = m_scales[k1];
+		break;
 	}
 }
 
 bool KeyframeCollection::empty() const
 {
-	return m_keyframes.empty();
-}
\ No newline at end of file
+	return m_times.empty();
+}
+
+bool KeyframeCollection::getTimeRange(float& begin, float& end) const
+{
+	if (m_times.empty())
+		return false;
+	begin = m_times.front();
+	end = m_times.back();
+	return true;
+}
@@ -2,6 +2,7 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <iostream>
@@ -11,35 +12,127 @@
 #include "../include/gl_helper.hpp"
 
 KeyframedHierarchicalRenderable::KeyframedHierarchicalRenderable(ShaderProgramPtr prog)
-    : HierarchicalRenderable(prog)
+    : HierarchicalRenderable(prog), m_sampleTime(0.0f), m_sampled(false)
 {
 }
 
 void KeyframedHierarchicalRenderable::addLocalTransformKeyframe(const GeometricTransformation& transformation, float time)
 {
 	m_localKeyframes.add(transformation, time);
+	animationChanged();
 }
 
 void KeyframedHierarchicalRenderable::addGlobalTransformKeyframe(const GeometricTransformation& transformation, float time)
 {
 	m_globalKeyframes.add(transformation, time);
+	animationChanged();
 }
 
 void KeyframedHierarchicalRenderable::addKeyframesFromFile(const std::string &animation_filename, float time_shift, bool local)
 {
 	m_globalKeyframes.addFromFile(animation_filename, time_shift);
+	animationChanged();
+}
+
+void KeyframedHierarchicalRenderable::setClip(const AnimationClipPtr& clip, bool local)
+{
+	(local ? m_localClip : m_globalClip) = clip;
+	m_sampled = false;
+	animationChanged();
+}
+
+static bool get_track_range(const KeyframeCollection& keyframes, const AnimationClipPtr& clip, float& begin, float& end)
+{
+	return clip ? clip->getTimeRange(begin, end) : keyframes.getTimeRange(begin, end);
+}
+
+static bool is_track_animated(const KeyframeCollection& keyframes, const AnimationClipPtr& clip)
+{
+	return clip ? !clip->empty() : !keyframes.empty();
+}
+
+bool KeyframedHierarchicalRenderable::getAnimationRange(float& begin, float& end) const
+{
+	float localBegin, localEnd, globalBegin, globalEnd;
+	bool local = get_track_range(m_localKeyframes, m_localClip, localBegin, localEnd);
+	bool global = get_track_range(m_globalKeyframes, m_globalClip, globalBegin, globalEnd);
+	if (local && global)
+	{
+		begin = std::min(localBegin, globalBegin);
+		end = std::max(localEnd, globalEnd);
+	}
+	else if (local || global)
+	{
+		begin = local ? localBegin : globalBegin;
+		end = local ? localEnd : globalEnd;
+	}
+	else
+	{
+		begin = end = 0;
+	}
+	return begin < end;
+}
+
+void KeyframedHierarchicalRenderable::sampleKeyframes(float time)
+{
+	if (m_localClip)
+		m_sampledLocalTransform = m_localClip->sample(time);
+	else if (!m_localKeyframes.empty())
+		m_sampledLocalTransform = m_localKeyframes.interpolateTransformation(time);
+	if (m_globalClip)
+		m_sampledGlobalTransform = m_globalClip->sample(time);
+	else if (!m_globalKeyframes.empty())
+		m_sampledGlobalTransform = m_globalKeyframes.interpolateTransformation(time);
+	m_sampleTime = time;
+	m_sampled = true;
+}
+
+unsigned int KeyframedHierarchicalRenderable::getTrackCount() const
+{
+	return is_track_animated(m_localKeyframes, m_localClip) + is_track_animated(m_globalKeyframes, m_globalClip);
+}
+
+static void sample_track(const KeyframeCollection& keyframes, const AnimationClipPtr& clip, float time, AnimationBatch& batch, size_t i)
+{
+	if (clip)
+		batch.sample(i, *clip, time);
+	else
+		batch.sample(i, keyframes, time);
+}
+
+void KeyframedHierarchicalRenderable::sampleTracks(float time, AnimationBatch& batch, size_t first) const
+{
+	if (is_track_animated(m_localKeyframes, m_localClip))
+		sample_track(m_localKeyframes, m_localClip, time, batch, first++);
+	if (is_track_animated(m_globalKeyframes, m_globalClip))
+		sample_track(m_globalKeyframes, m_globalClip, time, batch, first);
+}
+
+void KeyframedHierarchicalRenderable::setSampledTracks(float time, const glm::mat4* matrices)
+{
+	if (is_track_animated(m_localKeyframes, m_localClip))
+		m_sampledLocalTransform = *matrices++;
+	if (is_track_animated(m_globalKeyframes, m_globalClip))
+		m_sampledGlobalTransform = *matrices;
+	m_sampleTime = time;
+	m_sampled = true;
 }
 
 void KeyframedHierarchicalRenderable::do_animate(float time)
 {
+	// The keyframes may already have been sampled at this time by the viewer
+	if (!m_sampled || m_sampleTime != time)
+		sampleKeyframes(time);
+	m_sampled = false;
+
 	// Assign the interpolated transformations from the keyframes to the local/global transformations.
-	if (!m_localKeyframes.empty())
+	if (is_track_animated(m_localKeyframes, m_localClip))
 	{
-		setLocalTransform(m_localKeyframes.interpolateTransformation(time));
+		setLocalTransform(m_sampledLocalTransform);
 	}
-	if (!m_globalKeyframes.empty())
+	if (is_track_animated(m_globalKeyframes, m_globalClip))
 	{
-		setGlobalTransform(m_globalKeyframes.interpolateTransformation(time));
+		setGlobalTransform(m_sampledGlobalTransform);
 	}
 }
 
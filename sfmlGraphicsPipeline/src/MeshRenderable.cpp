@@ -1,32 +1,116 @@
 #include "../include/MeshRenderable.hpp"
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <fstream>
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/euler_angles.hpp>
 
+#include "../include/MeshSimplification.hpp"
 #include "../include/Utils.hpp"
+#include "../include/Viewer.hpp"
 #include "../include/gl_helper.hpp"
 #include "./../include/Io.hpp"
 #include "./../include/log.hpp"
 
 MeshRenderable::MeshRenderable(ShaderProgramPtr program,
-                               const std::string& mesh_filename) : KeyframedHierarchicalRenderable(program),
-                                                                   m_pBuffer(0),
-                                                                   m_cBuffer(0),
-                                                                   m_nBuffer(0),
-                                                                   m_iBuffer(0),
-                                                                   m_mode(GL_TRIANGLES),
-                                                                   m_indexed(true)
+                               const std::string& mesh_filename,
+                               bool deferred) : KeyframedHierarchicalRenderable(program),
+                                                m_pBuffer(0),
+                                                m_cBuffer(0),
+                                                m_nBuffer(0),
+                                                m_iBuffer(0),
+                                                m_mode(GL_TRIANGLES),
+                                                m_indexed(true),
+                                                m_lodThreshold(1.0f),
+                                                m_currentLod(0),
+                                                m_meshFilename(mesh_filename),
+                                                m_prefetched(false),
+                                                m_resident(false)
 {
-    read_obj(mesh_filename, this->m_positions, this->m_indices, this->m_normals, this->m_tcoords);
+	// The hierarchy needs the rest transform before the geometry
+	this->applyObjTransform(mesh_filename);
 
-    this->applyObjTransform(mesh_filename);
+	gen_buffers();
+	if (!deferred)
+		load();
+}
 
-    set_random_colors();
-    gen_buffers();
+void MeshRenderable::prefetch()
+{
+	if (m_prefetched)
+		return;
+
+	read_obj(m_meshFilename, this->m_positions, this->m_indices, this->m_normals, this->m_tcoords);
+	set_random_colors();
+
+	// The levels of detail of the large meshes are cached next to the OBJ file
+	if (m_indices.size() >= 3 * 1024)
+	{
+		std::string cache_filename = m_meshFilename + ".lod";
+		if (!read_lod_cache(cache_filename, m_positions, m_indices, m_lodIndices, m_lodErrors))
+		{
+			compute_lods(3, 0.5f);
+			if (!write_lod_cache(cache_filename, m_positions, m_indices, m_lodIndices, m_lodErrors))
+			{
+				LOG(warning, "[MeshRenderable] cannot write " << cache_filename);
+			}
+		}
+	}
+	m_prefetched = true;
+}
+
+void MeshRenderable::load()
+{
+	if (m_resident)
+		return;
+	prefetch();
+
+	// Sending the indices drops the levels of detail, which were read with them
+	std::vector<std::vector<unsigned int> > lodIndices;
+	std::vector<float> lodErrors;
+	lodIndices.swap(m_lodIndices);
+	lodErrors.swap(m_lodErrors);
 	update_buffers();
+	m_lodIndices.swap(lodIndices);
+	m_lodErrors.swap(lodErrors);
+	update_lod_buffers();
+	m_currentLod = 0;
+	m_resident = true;
+}
+
+void MeshRenderable::release()
+{
+	if (m_meshFilename.empty() || !m_prefetched)
+		return;
+
+	std::vector<glm::vec3>().swap(m_positions);
+	std::vector<glm::vec3>().swap(m_normals);
+	std::vector<glm::vec4>().swap(m_colors);
+	std::vector<unsigned int>().swap(m_indices);
+	std::vector<glm::vec2>().swap(m_tcoords);
+	std::vector<std::vector<unsigned int> >().swap(m_lodIndices);
+	std::vector<float>().swap(m_lodErrors);
+	if (m_resident)
+	{
+		// Empty buffers free the memory of the GPU, the bounds are kept for the culling
+		BoundingBox bounds = m_localBounds;
+		update_buffers();
+		m_localBounds = bounds;
+	}
+	m_prefetched = false;
+	m_resident = false;
+}
+
+const std::string& MeshRenderable::getMeshFilename() const
+{
+	return m_meshFilename;
+}
+
+bool MeshRenderable::isResident() const
+{
+	return m_resident;
 }
 
 MeshRenderable::MeshRenderable(ShaderProgramPtr program,
@@ -43,7 +127,11 @@ MeshRenderable::MeshRenderable(ShaderProgramPtr program,
                                                                        m_nBuffer(0),
                                                                        m_iBuffer(0),
                                                                        m_mode(GL_TRIANGLES),
-                                                                       m_indexed(true)
+                                                                       m_indexed(true),
+                                                                       m_lodThreshold(1.0f),
+                                                                       m_currentLod(0),
+                                                                       m_prefetched(true),
+                                                                       m_resident(true)
 {
 	set_random_colors();
 	gen_buffers();
@@ -62,14 +150,18 @@ MeshRenderable::MeshRenderable(ShaderProgramPtr program,
                                                                        m_nBuffer(0),
                                                                        m_iBuffer(0),
                                                                        m_mode(GL_TRIANGLES),
-                                                                       m_indexed(false)
+                                                                       m_indexed(false),
+                                                                       m_lodThreshold(1.0f),
+                                                                       m_currentLod(0),
+                                                                       m_prefetched(true),
+                                                                       m_resident(true)
 {
 	set_random_colors();
 	gen_buffers();
 	update_buffers();
 }
 
-MeshRenderable::MeshRenderable(ShaderProgramPtr program, bool indexed) : KeyframedHierarchicalRenderable(program), m_indexed(indexed), m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_mode(GL_TRIANGLES)
+MeshRenderable::MeshRenderable(ShaderProgramPtr program, bool indexed) : KeyframedHierarchicalRenderable(program), m_indexed(indexed), m_pBuffer(0), m_cBuffer(0), m_nBuffer(0), m_iBuffer(0), m_mode(GL_TRIANGLES), m_lodThreshold(1.0f), m_currentLod(0), m_prefetched(true), m_resident(true)
 {
 	gen_buffers();
 }
@@ -101,6 +193,8 @@ void MeshRenderable::update_all_buffers()
 
 void MeshRenderable::update_positions_buffer()
 {
+	m_localBounds = BoundingBox(m_positions);
+	boundsChanged();
 	glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_pBuffer));
 	glcheck(glBufferData(GL_ARRAY_BUFFER, m_positions.size() * sizeof(glm::vec3), m_positions.data(), GL_STATIC_DRAW));
 }
@@ -116,12 +210,123 @@ void MeshRenderable::update_normals_buffer()
 }
 void MeshRenderable::update_indices_buffer()
 {
+	clearLods();
 	glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iBuffer));
 	glcheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), m_indices.data(), GL_STATIC_DRAW));
 }
 
+void MeshRenderable::update_lod_buffers()
+{
+	if (!m_lodBuffers.empty())
+	{
+		glcheck(glDeleteBuffers(m_lodBuffers.size(), m_lodBuffers.data()));
+	}
+	m_lodBuffers.assign(m_lodIndices.size(), 0);
+	if (m_lodBuffers.empty())
+		return;
+	glcheck(glGenBuffers(m_lodBuffers.size(), m_lodBuffers.data()));
+	for (size_t l = 0; l < m_lodBuffers.size(); ++l)
+	{
+		glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_lodBuffers[l]));
+		glcheck(glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_lodIndices[l].size() * sizeof(unsigned int), m_lodIndices[l].data(), GL_STATIC_DRAW));
+	}
+}
+
+void MeshRenderable::generateLods(int levels, float ratio)
+{
+	compute_lods(levels, ratio);
+	update_lod_buffers();
+	m_currentLod = 0;
+}
+
+void MeshRenderable::compute_lods(int levels, float ratio)
+{
+	m_lodIndices.clear();
+	m_lodErrors.clear();
+	if (m_indexed && m_mode == GL_TRIANGLES)
+	{
+		const std::vector<unsigned int>* previous = &m_indices;
+		for (int l = 0; l < levels; ++l)
+		{
+			size_t target = size_t(previous->size() / 3 * ratio) * 3;
+			float error = 0;
+			std::vector<unsigned int> indices = simplify_mesh(m_positions, m_normals, *previous, target, error);
+			// Stop when the mesh cannot be simplified anymore
+			if (indices.size() >= previous->size())
+				break;
+			m_lodIndices.push_back(indices);
+			m_lodErrors.push_back(std::max(error, m_lodErrors.empty() ? 0.0f : m_lodErrors.back()));
+			previous = &m_lodIndices.back();
+		}
+	}
+}
+
+void MeshRenderable::clearLods()
+{
+	m_lodIndices.clear();
+	m_lodErrors.clear();
+	update_lod_buffers();
+	m_currentLod = 0;
+}
+
+int MeshRenderable::getLodCount() const
+{
+	return m_lodIndices.size() + 1;
+}
+
+int MeshRenderable::getCurrentLod() const
+{
+	return m_currentLod;
+}
+
+void MeshRenderable::setLodThreshold(float pixels)
+{
+	m_lodThreshold = pixels;
+}
+
+float MeshRenderable::getLodThreshold() const
+{
+	return m_lodThreshold;
+}
+
+int MeshRenderable::select_lod()
+{
+	if (m_lodIndices.empty() || !m_viewer)
+		return 0;
+
+	// Size on the screen of a unit at the distance of the mesh, in pixels
+	const Camera& camera = m_viewer->getCamera();
+	const BoundingBox& bounds = getWorldBounds();
+	glm::vec3 center = bounds.isValid() ? bounds.center() : glm::vec3(getModelMatrix()[3]);
+	float radius = bounds.isValid() ? bounds.radius() : 0.0f;
+	float distance = std::max(glm::length(center - camera.getPosition()) - radius, 1e-3f);
+	const glm::mat4& model = getModelMatrix();
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float pixelsPerUnit = scale / distance * camera.projectionMatrix()[1][1] * 0.5f * m_viewer->getWindowSize().y;
+
+	// Coarsest levels whose projected error is below the threshold, and below the hysteresis threshold
+	int finer = 0, coarser = 0;
+	for (size_t l = 0; l < m_lodErrors.size(); ++l)
+	{
+		float pixels = m_lodErrors[l] * pixelsPerUnit;
+		if (pixels <= m_lodThreshold)
+			finer = l + 1;
+		if (pixels <= 0.75f * m_lodThreshold)
+			coarser = l + 1;
+	}
+
+	// Go finer as soon as the current level is too coarse, coarser only with a margin
+	if (finer < m_currentLod)
+		return finer;
+	return std::max(coarser, m_currentLod);
+}
+
 void MeshRenderable::do_draw()
 {
+	// A deferred or released mesh is loaded when it is drawn
+	if (!m_resident)
+		load();
+
 	int positionLocation = m_shaderProgram->getAttributeLocation("vPosition");
 	int colorLocation = m_shaderProgram->getAttributeLocation("vColor");
 	int normalLocation = m_shaderProgram->getAttributeLocation("vNormal");
@@ -161,8 +366,17 @@ void MeshRenderable::do_draw()
 	// Draw triangles elements
 	if (m_indexed)
 	{
-		glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iBuffer));
-		glcheck(glDrawElements(m_mode, m_indices.size(), GL_UNSIGNED_INT, (void*)0));
+		m_currentLod = select_lod();
+		if (m_currentLod > 0)
+		{
+			glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_lodBuffers[m_currentLod - 1]));
+			glcheck(glDrawElements(m_mode, m_lodIndices[m_currentLod - 1].size(), GL_UNSIGNED_INT, (void*)0));
+		}
+		else
+		{
+			glcheck(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_iBuffer));
+			glcheck(glDrawElements(m_mode, m_indices.size(), GL_UNSIGNED_INT, (void*)0));
+		}
 	}
 	else
 	{
@@ -185,6 +399,57 @@ void MeshRenderable::do_draw()
 	}
 }
 
+/* Moller-Trumbore ray-triangle intersection, both faces of the triangle are hit. */
+static bool intersect_triangle(const glm::vec3& origin, const glm::vec3& direction,
+                               const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& distance)
+{
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 p = glm::cross(direction, ac);
+	float det = glm::dot(ab, p);
+	if (std::abs(det) < 1e-12f)
+		return false;
+	float invDet = 1.0f / det;
+	glm::vec3 s = origin - a;
+	float u = glm::dot(s, p) * invDet;
+	if (u < 0 || u > 1)
+		return false;
+	glm::vec3 q = glm::cross(s, ab);
+	float v = glm::dot(direction, q) * invDet;
+	if (v < 0 || u + v > 1)
+		return false;
+	distance = glm::dot(ac, q) * invDet;
+	return distance >= 0;
+}
+
+bool MeshRenderable::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	if (!KeyframedHierarchicalRenderable::intersectRay(origin, direction, distance))
+		return false;
+	if (m_mode != GL_TRIANGLES || !m_resident)
+		return true;
+
+	glm::mat4 inverseModel = glm::inverse(getModelMatrix());
+	glm::vec3 localOrigin = glm::vec3(inverseModel * glm::vec4(origin, 1.0f));
+	glm::vec3 localDirection = glm::vec3(inverseModel * glm::vec4(direction, 0.0f));
+
+	bool hit = false;
+	size_t count = m_indexed ? m_indices.size() : m_positions.size();
+	for (size_t i = 0; i + 2 < count; i += 3)
+	{
+		const glm::vec3& a = m_positions[m_indexed ? m_indices[i] : i];
+		const glm::vec3& b = m_positions[m_indexed ? m_indices[i + 1] : i + 1];
+		const glm::vec3& c = m_positions[m_indexed ? m_indices[i + 2] : i + 2];
+		float t;
+		if (intersect_triangle(localOrigin, localDirection, a, b, c, t) && (!hit || t < distance))
+		{
+			distance = t;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
 void MeshRenderable::set_random_colors()
 {
 	if (m_colors.empty())
@@ -201,6 +466,10 @@ MeshRenderable::~MeshRenderable()
 	glcheck(glDeleteBuffers(1, &m_cBuffer));
 	glcheck(glDeleteBuffers(1, &m_nBuffer));
 	glcheck(glDeleteBuffers(1, &m_iBuffer));
+	if (!m_lodBuffers.empty())
+	{
+		glcheck(glDeleteBuffers(m_lodBuffers.size(), m_lodBuffers.data()));
+	}
 }
 /*
 #include "./../include/MeshRenderable.hpp"
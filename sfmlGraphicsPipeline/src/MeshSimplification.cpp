@@ -0,0 +1,298 @@
+#include "../include/MeshSimplification.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+/* Symmetric 4x4 matrix of a quadric error, with the total area of its planes. */
+struct Quadric
+{
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	double weight;
+
+	Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0), weight(0)
+	{
+	}
+
+	Quadric(const glm::dvec3& n, double d, double w)
+	    : a2(w * n.x * n.x), ab(w * n.x * n.y), ac(w * n.x * n.z), ad(w * n.x * d),
+	      b2(w * n.y * n.y), bc(w * n.y * n.z), bd(w * n.y * d),
+	      c2(w * n.z * n.z), cd(w * n.z * d), d2(w * d * d), weight(w)
+	{
+	}
+
+	Quadric& operator+=(const Quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd; d2 += q.d2;
+		weight += q.weight;
+		return *this;
+	}
+
+	/* Weighted sum of the squared distances of p to the planes. */
+	double evaluate(const glm::vec3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+		       + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+		       + c2 * z * z + 2 * cd * z + d2;
+	}
+};
+
+struct Collapse
+{
+	unsigned int from;
+	unsigned int to;
+	double cost;
+
+	bool operator<(const Collapse& c) const
+	{
+		return cost < c.cost;
+	}
+};
+
+struct PositionHash
+{
+	size_t operator()(const glm::vec3& p) const
+	{
+		uint32_t bits[3];
+		std::memcpy(bits, &p[0], sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+uint64_t edge_key(unsigned int a, unsigned int b)
+{
+	return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+glm::vec3 triangle_normal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	return glm::cross(b - a, c - a);
+}
+}
+
+std::vector<unsigned int> simplify_mesh(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<glm::vec3>& normals,
+    const std::vector<unsigned int>& indices,
+    size_t targetIndexCount,
+    float& error)
+{
+	error = 0;
+	size_t vertexCount = positions.size();
+
+	// Weld the vertices by position: the collapses are done on the welded mesh
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> firstVertex;
+	std::vector<unsigned int> canonical(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		canonical[v] = firstVertex.insert(std::make_pair(positions[v], v)).first->second;
+
+	std::vector<unsigned int> result(indices.size() - indices.size() % 3);
+	std::vector<unsigned int> origins(result.size() / 3); // Triangle of indices of each triangle of result
+	for (size_t i = 0; i < result.size(); ++i)
+		result[i] = canonical[indices[i]];
+	for (size_t t = 0; t < origins.size(); ++t)
+		origins[t] = t;
+
+	// Lock the vertices of the border: their edges belong to a single triangle
+	std::unordered_map<uint64_t, unsigned int> edgeTriangles;
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int e = 0; e < 3; ++e)
+			++edgeTriangles[edge_key(result[i + e], result[i + (e + 1) % 3])];
+	}
+	std::vector<unsigned char> locked(vertexCount, 0);
+	for (const auto& edge : edgeTriangles)
+	{
+		if (edge.second == 1)
+		{
+			locked[edge.first >> 32] = 1;
+			locked[edge.first & 0xFFFFFFFFu] = 1;
+		}
+	}
+
+	// Quadrics of the planes of the triangles around each vertex, weighted by their area
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i + 2 < result.size(); i += 3)
+	{
+		glm::dvec3 a(positions[result[i]]), b(positions[result[i + 1]]), c(positions[result[i + 2]]);
+		glm::dvec3 n = glm::cross(b - a, c - a);
+		double length = glm::length(n);
+		if (length <= 0)
+			continue;
+		n /= length;
+		Quadric q(n, -glm::dot(n, a), 0.5 * length);
+		for (int k = 0; k < 3; ++k)
+			quadrics[result[i + k]] += q;
+	}
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned char> touched(vertexCount);
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<Collapse> collapses;
+	double maxError = 0;
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// Triangles around each vertex
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (size_t i = 0; i < result.size(); ++i)
+			++adjacencyOffsets[result[i] + 1];
+		for (size_t v = 0; v < vertexCount; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		adjacency.resize(result.size());
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); ++i)
+			adjacency[fill[result[i]]++] = i / 3;
+
+		// Cheapest direction of each edge
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				unsigned int a = result[i + e];
+				unsigned int b = result[i + (e + 1) % 3];
+				Collapse best;
+				best.cost = -1;
+				if (!locked[a])
+				{
+					Quadric q = quadrics[a];
+					q += quadrics[b];
+					best.from = a;
+					best.to = b;
+					best.cost = std::max(0.0, q.evaluate(positions[b])) / std::max(q.weight, 1e-30);
+				}
+				if (!locked[b])
+				{
+					Quadric q = quadrics[b];
+					q += quadrics[a];
+					double cost = std::max(0.0, q.evaluate(positions[a])) / std::max(q.weight, 1e-30);
+					if (best.cost < 0 || cost < best.cost)
+					{
+						best.from = b;
+						best.to = a;
+						best.cost = cost;
+					}
+				}
+				if (best.cost >= 0)
+					collapses.push_back(best);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		// Each collapse removes about two triangles. The collapses of a pass are
+		// independent: no triangle is touched by two of them.
+		size_t budget = (result.size() - targetIndexCount) / 6 + 1;
+		size_t done = 0;
+		for (unsigned int v = 0; v < vertexCount; ++v)
+			remap[v] = v;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		for (const Collapse& c : collapses)
+		{
+			if (done >= budget)
+				break;
+			if (touched[c.from] || touched[c.to])
+				continue;
+
+			bool flips = false;
+			for (unsigned int t = adjacencyOffsets[c.from]; t < adjacencyOffsets[c.from + 1] && !flips; ++t)
+			{
+				const unsigned int* tri = &result[3 * adjacency[t]];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+					continue;
+				glm::vec3 p[3], q[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					p[k] = positions[tri[k]];
+					q[k] = tri[k] == c.from ? positions[c.to] : p[k];
+				}
+				flips = glm::dot(triangle_normal(p[0], p[1], p[2]), triangle_normal(q[0], q[1], q[2])) <= 0;
+			}
+			if (flips)
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to] += quadrics[c.from];
+			maxError = std::max(maxError, c.cost);
+			for (unsigned int t = adjacencyOffsets[c.from]; t < adjacencyOffsets[c.from + 1]; ++t)
+			{
+				const unsigned int* tri = &result[3 * adjacency[t]];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+			++done;
+		}
+		if (done == 0)
+			break;
+
+		// Rebuild the triangles, without the degenerate ones
+		size_t kept = 0;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			unsigned int a = remap[result[3 * i]];
+			unsigned int b = remap[result[3 * i + 1]];
+			unsigned int c = remap[result[3 * i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			origins[kept / 3] = origins[i];
+			result[kept++] = a;
+			result[kept++] = b;
+			result[kept++] = c;
+		}
+		result.resize(kept);
+		origins.resize(kept / 3);
+	}
+
+	// Unweld: each corner keeps its original vertex if it has not moved, or takes
+	// the vertex of its new position whose normal is the closest
+	std::vector<unsigned int> groupOffsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		++groupOffsets[canonical[v] + 1];
+	for (size_t v = 0; v < vertexCount; ++v)
+		groupOffsets[v + 1] += groupOffsets[v];
+	std::vector<unsigned int> groups(vertexCount);
+	std::vector<unsigned int> fill(groupOffsets.begin(), groupOffsets.end() - 1);
+	for (unsigned int v = 0; v < vertexCount; ++v)
+		groups[fill[canonical[v]]++] = v;
+
+	for (size_t t = 0; t < origins.size(); ++t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int original = indices[3 * origins[t] + k];
+			unsigned int& corner = result[3 * t + k];
+			if (canonical[original] == corner)
+			{
+				corner = original;
+				continue;
+			}
+			if (normals.size() != vertexCount)
+				continue;
+			unsigned int best = corner;
+			float bestDot = -2.0f;
+			for (unsigned int g = groupOffsets[corner]; g < groupOffsets[corner + 1]; ++g)
+			{
+				float d = glm::dot(normals[original], normals[groups[g]]);
+				if (d > bestDot)
+				{
+					bestDot = d;
+					best = groups[g];
+				}
+			}
+			corner = best;
+		}
+	}
+
+	error = std::sqrt(maxError);
+	return result;
+}
@@ -0,0 +1,419 @@
+#include "../include/OcclusionCuller.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+#include <limits>
+
+#include "../include/gl_helper.hpp"
+#include "./../include/log.hpp"
+
+static const std::string shader_directory = "../../sfmlGraphicsPipeline/shaders/";
+
+// The level read back is the first one not wider than this
+static const int max_readback_width = 256;
+
+// Number of captures in flight
+static const size_t readback_count = 3;
+
+OcclusionCuller::OcclusionCuller()
+    : m_width{0}, m_height{0}, m_depthFbo{0}, m_depthTexture{0}, m_pyramidFbo{0}, m_pyramidTexture{0}, m_levelCount{0}, m_readLevel{0},
+      m_triangleBuffer{0}, m_lineBuffer{0}, m_nextReadback{0}, m_texelSize{1.0f}, m_screenSize{0.0f}, m_viewProjection{1.0f}
+{
+	m_reductionProgram = std::make_shared<ShaderProgram>(
+	    shader_directory + "hizVertex.glsl",
+	    shader_directory + "hizFragment.glsl");
+	m_debugProgram = std::make_shared<ShaderProgram>(
+	    shader_directory + "occlusionDebugVertex.glsl",
+	    shader_directory + "occlusionDebugFragment.glsl");
+	m_programs.push_back(m_reductionProgram);
+	m_programs.push_back(m_debugProgram);
+
+	// A single triangle covering the whole screen
+	const glm::vec2 triangle[3] = {glm::vec2(-1.0, -1.0), glm::vec2(3.0, -1.0), glm::vec2(-1.0, 3.0)};
+	glcheck(glGenBuffers(1, &m_triangleBuffer));
+	glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_triangleBuffer));
+	glcheck(glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW));
+	glcheck(glGenBuffers(1, &m_lineBuffer));
+	glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+	m_readbacks.resize(readback_count);
+	for (Readback& readback : m_readbacks)
+	{
+		glcheck(glGenBuffers(1, &readback.buffer));
+		readback.fence = nullptr;
+	}
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	release();
+	for (Readback& readback : m_readbacks)
+	{
+		glcheck(glDeleteBuffers(1, &readback.buffer));
+	}
+	glcheck(glDeleteBuffers(1, &m_triangleBuffer));
+	glcheck(glDeleteBuffers(1, &m_lineBuffer));
+}
+
+const std::vector<ShaderProgramPtr>& OcclusionCuller::getShaderPrograms() const
+{
+	return m_programs;
+}
+
+void OcclusionCuller::release()
+{
+	for (Readback& readback : m_readbacks)
+	{
+		if (readback.fence)
+		{
+			glcheck(glDeleteSync(static_cast<GLsync>(readback.fence)));
+		}
+		readback.fence = nullptr;
+	}
+	if (m_depthFbo)
+	{
+		glcheck(glDeleteFramebuffers(1, &m_depthFbo));
+	}
+	if (m_pyramidFbo)
+	{
+		glcheck(glDeleteFramebuffers(1, &m_pyramidFbo));
+	}
+	GLuint textures[2] = {m_depthTexture, m_pyramidTexture};
+	glcheck(glDeleteTextures(2, textures));
+	m_depthFbo = m_pyramidFbo = m_depthTexture = m_pyramidTexture = 0;
+	m_width = m_height = 0;
+	m_levelCount = m_readLevel = 0;
+}
+
+void OcclusionCuller::resize(unsigned int width, unsigned int height)
+{
+	release();
+	m_width = width;
+	m_height = height;
+
+	// The depth is copied with a blit, which needs the format of the window: 24 bits depth, 8 bits stencil
+	glcheck(glGenTextures(1, &m_depthTexture));
+	glcheck(glBindTexture(GL_TEXTURE_2D, m_depthTexture));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE));
+	glcheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr));
+
+	// Levels of the pyramid, each half the size of the previous one rounded up
+	glcheck(glGenTextures(1, &m_pyramidTexture));
+	glcheck(glBindTexture(GL_TEXTURE_2D, m_pyramidTexture));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST));
+	m_readLevel = -1;
+	unsigned int w = (width + 1) / 2, h = (height + 1) / 2;
+	for (m_levelCount = 0;; ++m_levelCount)
+	{
+		glcheck(glTexImage2D(GL_TEXTURE_2D, m_levelCount, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr));
+		if (m_readLevel < 0 && w <= (unsigned int)max_readback_width)
+			m_readLevel = m_levelCount;
+		if (w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+	++m_levelCount;
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1));
+	glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+
+	GLint previous_fbo = 0;
+	glcheck(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_fbo));
+	glcheck(glGenFramebuffers(1, &m_depthFbo));
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, m_depthFbo));
+	glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0));
+	glcheck(glDrawBuffer(GL_NONE));
+	glcheck(glReadBuffer(GL_NONE));
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		LOG(error, "[OcclusionCuller] incomplete depth framebuffer (status " << status << ")");
+	}
+	glcheck(glGenFramebuffers(1, &m_pyramidFbo));
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo));
+}
+
+void OcclusionCuller::capture(unsigned int width, unsigned int height, const glm::mat4& viewProjection)
+{
+	if (!width || !height)
+		return;
+	if (width != m_width || height != m_height)
+		resize(width, height);
+
+	// A slot still in flight is dropped rather than waited for
+	Readback& readback = m_readbacks[m_nextReadback];
+	m_nextReadback = (m_nextReadback + 1) % m_readbacks.size();
+	if (readback.fence)
+	{
+		glcheck(glDeleteSync(static_cast<GLsync>(readback.fence)));
+		readback.fence = nullptr;
+	}
+
+	GLint previous_fbo = 0, viewport[4];
+	glcheck(glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_fbo));
+	glcheck(glGetIntegerv(GL_VIEWPORT, viewport));
+	GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+
+	// Copy the depth buffer, resolving it if it is multisampled
+	glcheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_fbo));
+	glcheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFbo));
+	glcheck(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST));
+
+	// Reduce each level from the previous one, the first one from the depth
+	glcheck(glDisable(GL_DEPTH_TEST));
+	glcheck(glDisable(GL_BLEND));
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, m_pyramidFbo));
+	m_reductionProgram->bind();
+	int location = m_reductionProgram->getUniformLocation("sourceSampler");
+	if (location != ShaderProgram::null_location)
+	{
+		glcheck(glUniform1i(location, 0));
+	}
+	glcheck(glActiveTexture(GL_TEXTURE0));
+	int positionLocation = m_reductionProgram->getAttributeLocation("vPosition");
+	if (positionLocation != ShaderProgram::null_location)
+	{
+		glcheck(glEnableVertexAttribArray(positionLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_triangleBuffer));
+		glcheck(glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+	}
+
+	unsigned int w = (width + 1) / 2, h = (height + 1) / 2;
+	for (int level = 0; level < m_levelCount; ++level)
+	{
+		if (level == 0)
+		{
+			glcheck(glBindTexture(GL_TEXTURE_2D, m_depthTexture));
+		}
+		else
+		{
+			// Only the source level can be sampled, as the target level is written
+			glcheck(glBindTexture(GL_TEXTURE_2D, m_pyramidTexture));
+			glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1));
+			glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1));
+		}
+		glcheck(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pyramidTexture, level));
+		glcheck(glViewport(0, 0, w, h));
+		glcheck(glDrawArrays(GL_TRIANGLES, 0, 3));
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	if (positionLocation != ShaderProgram::null_location)
+	{
+		glcheck(glDisableVertexAttribArray(positionLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	}
+	glcheck(glBindTexture(GL_TEXTURE_2D, m_pyramidTexture));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1));
+
+	// Start the read back of a small level, it is mapped by update() once written
+	GLint levelWidth = 0, levelHeight = 0;
+	glcheck(glGetTexLevelParameteriv(GL_TEXTURE_2D, m_readLevel, GL_TEXTURE_WIDTH, &levelWidth));
+	glcheck(glGetTexLevelParameteriv(GL_TEXTURE_2D, m_readLevel, GL_TEXTURE_HEIGHT, &levelHeight));
+	glcheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer));
+	glcheck(glBufferData(GL_PIXEL_PACK_BUFFER, levelWidth * levelHeight * sizeof(float), nullptr, GL_STREAM_READ));
+	glcheck(glGetTexImage(GL_TEXTURE_2D, m_readLevel, GL_RED, GL_FLOAT, (void*)0));
+	glcheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+	glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.size = glm::ivec2(levelWidth, levelHeight);
+	readback.texelSize = float(2 << m_readLevel);
+	readback.screenSize = glm::vec2(width, height);
+	readback.viewProjection = viewProjection;
+
+	ShaderProgram::unbind();
+	glcheck(glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo));
+	glcheck(glViewport(viewport[0], viewport[1], viewport[2], viewport[3]));
+	if (depth_test)
+	{
+		glcheck(glEnable(GL_DEPTH_TEST));
+	}
+	if (blend)
+	{
+		glcheck(glEnable(GL_BLEND));
+	}
+}
+
+void OcclusionCuller::update()
+{
+	// Newest capture already written by the GPU, the older ones are useless
+	Readback* ready = nullptr;
+	for (size_t i = 1; i <= m_readbacks.size(); ++i)
+	{
+		Readback& readback = m_readbacks[(m_nextReadback + m_readbacks.size() - i) % m_readbacks.size()];
+		if (!readback.fence)
+			continue;
+		if (ready)
+		{
+			glcheck(glDeleteSync(static_cast<GLsync>(readback.fence)));
+			readback.fence = nullptr;
+			continue;
+		}
+		GLenum status = glClientWaitSync(static_cast<GLsync>(readback.fence), 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			ready = &readback;
+	}
+	if (!ready)
+		return;
+
+	m_levels.resize(1);
+	m_levelSizes.assign(1, ready->size);
+	m_levels[0].resize(ready->size.x * ready->size.y);
+	glcheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, ready->buffer));
+	const float* data = static_cast<const float*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+	if (data)
+	{
+		std::copy(data, data + m_levels[0].size(), m_levels[0].begin());
+		glcheck(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+	}
+	glcheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+	glcheck(glDeleteSync(static_cast<GLsync>(ready->fence)));
+	ready->fence = nullptr;
+	if (!data)
+	{
+		reset();
+		return;
+	}
+
+	// Coarser levels, built like on the GPU
+	while (m_levelSizes.back().x > 1 || m_levelSizes.back().y > 1)
+	{
+		glm::ivec2 source = m_levelSizes.back();
+		glm::ivec2 size = (source + 1) / 2;
+		std::vector<float> level(size.x * size.y);
+		const std::vector<float>& previous = m_levels.back();
+		for (int y = 0; y < size.y; ++y)
+		{
+			int y0 = 2 * y, y1 = std::min(2 * y + 1, source.y - 1);
+			for (int x = 0; x < size.x; ++x)
+			{
+				int x0 = 2 * x, x1 = std::min(2 * x + 1, source.x - 1);
+				level[y * size.x + x] = std::max(std::max(previous[y0 * source.x + x0], previous[y0 * source.x + x1]),
+				                                 std::max(previous[y1 * source.x + x0], previous[y1 * source.x + x1]));
+			}
+		}
+		m_levels.push_back(level);
+		m_levelSizes.push_back(size);
+	}
+	m_texelSize = ready->texelSize;
+	m_screenSize = ready->screenSize;
+	m_viewProjection = ready->viewProjection;
+}
+
+void OcclusionCuller::reset()
+{
+	m_levels.clear();
+	m_levelSizes.clear();
+}
+
+bool OcclusionCuller::isOccluded(const BoundingBox& box) const
+{
+	if (m_levels.empty() || !box.isValid())
+		return false;
+
+	// Screen rectangle and nearest depth of the box in the captured frame
+	glm::vec3 ndcMin(std::numeric_limits<float>::max()), ndcMax(-std::numeric_limits<float>::max());
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		glm::vec4 p(corner & 1 ? box.max().x : box.min().x,
+		            corner & 2 ? box.max().y : box.min().y,
+		            corner & 4 ? box.max().z : box.min().z, 1.0f);
+		p = m_viewProjection * p;
+		// A box crossing the near plane is in front of everything
+		if (p.w <= 1e-5f)
+			return false;
+		glm::vec3 ndc = glm::vec3(p) / p.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+	if (ndcMin.z < -1.0f || ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f)
+		return false;
+	float depth = 0.5f * ndcMin.z + 0.5f;
+
+	// Rectangle in texels of the first level
+	glm::vec2 scale = 0.5f * m_screenSize / m_texelSize;
+	glm::vec2 low = glm::clamp((glm::vec2(ndcMin) + 1.0f) * scale, glm::vec2(0.0f), glm::vec2(m_levelSizes[0] - 1));
+	glm::vec2 high = glm::clamp((glm::vec2(ndcMax) + 1.0f) * scale, glm::vec2(0.0f), glm::vec2(m_levelSizes[0] - 1));
+
+	// Level where the rectangle covers at most 2x2 texels, or 3x3 when it is not aligned
+	float extent = std::max(high.x - low.x, high.y - low.y);
+	int level = std::min(int(m_levels.size()) - 1, std::max(0, int(std::ceil(std::log2(std::max(extent, 1.0f))))));
+	glm::ivec2 first = glm::ivec2(low) >> level;
+	glm::ivec2 last = glm::ivec2(high) >> level;
+	const std::vector<float>& texels = m_levels[level];
+	int width = m_levelSizes[level].x;
+	for (int y = first.y; y <= last.y; ++y)
+	{
+		for (int x = first.x; x <= last.x; ++x)
+		{
+			if (depth <= texels[y * width + x])
+				return false;
+		}
+	}
+	return true;
+}
+
+void OcclusionCuller::drawBoxes(const std::vector<BoundingBox>& boxes, const glm::mat4& viewProjection)
+{
+	if (boxes.empty())
+		return;
+
+	// Twelve edges per box
+	static const int edges[12][2] = {{0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3},
+	                                 {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+	std::vector<glm::vec3> lines;
+	lines.reserve(24 * boxes.size());
+	for (const BoundingBox& box : boxes)
+	{
+		glm::vec3 corners[8];
+		for (int corner = 0; corner < 8; ++corner)
+			corners[corner] = glm::vec3(corner & 1 ? box.max().x : box.min().x,
+			                            corner & 2 ? box.max().y : box.min().y,
+			                            corner & 4 ? box.max().z : box.min().z);
+		for (int e = 0; e < 12; ++e)
+		{
+			lines.push_back(corners[edges[e][0]]);
+			lines.push_back(corners[edges[e][1]]);
+		}
+	}
+
+	// The edges are drawn over everything, to show the culled renderables behind their occluders
+	GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+	glcheck(glDisable(GL_DEPTH_TEST));
+	m_debugProgram->bind();
+	int location = m_debugProgram->getUniformLocation("viewProjection");
+	if (location != ShaderProgram::null_location)
+	{
+		glcheck(glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(viewProjection)));
+	}
+	location = m_debugProgram->getUniformLocation("color");
+	if (location != ShaderProgram::null_location)
+	{
+		glcheck(glUniform4f(location, 1.0f, 0.0f, 0.0f, 1.0f));
+	}
+	int positionLocation = m_debugProgram->getAttributeLocation("vPosition");
+	if (positionLocation != ShaderProgram::null_location)
+	{
+		glcheck(glEnableVertexAttribArray(positionLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_lineBuffer));
+		glcheck(glBufferData(GL_ARRAY_BUFFER, lines.size() * sizeof(glm::vec3), lines.data(), GL_STREAM_DRAW));
+		glcheck(glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+		glcheck(glDrawArrays(GL_LINES, 0, lines.size()));
+		glcheck(glDisableVertexAttribArray(positionLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	}
+	ShaderProgram::unbind();
+	if (depth_test)
+	{
+		glcheck(glEnable(GL_DEPTH_TEST));
+	}
+}
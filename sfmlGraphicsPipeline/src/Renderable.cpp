@@ -1,12 +1,18 @@
 #include "../include/Renderable.hpp"
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <iostream>
+#include <limits>
 
+#include "../include/HierarchicalRenderable.hpp"
 #include "../include/Viewer.hpp"
 #include "../include/gl_helper.hpp"
 
+// Incremented when the animation range of a renderable changes
+static unsigned int animation_revision = 1;
+
 Renderable::~Renderable() {}
 
 Renderable::Renderable(ShaderProgramPtr program)
@@ -14,7 +20,8 @@ Renderable::Renderable(ShaderProgramPtr program)
       m_model(glm::mat4(1.0)),  // default: loads the identity
       m_viewer(nullptr),
       m_priority(0),
-      m_render_mode(RENDER_MODE::WINDOW)
+      m_render_mode(RENDER_MODE::WINDOW),
+      m_active(true)
 {
 }
 
@@ -52,10 +59,85 @@ void Renderable::animate(float time)
 	afterAnimate(time);
 }
 
+void Renderable::animateNode(float time)
+{
+	beforeAnimate(time);
+	do_animate(time);
+}
+
 void Renderable::do_animate(float time)
 {
 }
 
+bool Renderable::getAnimationRange(float& begin, float& end) const
+{
+	begin = -std::numeric_limits<float>::infinity();
+	end = std::numeric_limits<float>::infinity();
+	return true;
+}
+
+unsigned int Renderable::getAnimationRevision()
+{
+	return animation_revision;
+}
+
+void Renderable::animationChanged()
+{
+	++animation_revision;
+}
+
+void Renderable::addActiveInterval(float start, float end)
+{
+	if (!(start < end))
+		return;
+
+	// Merge the intervals overlapping or touching the new one
+	std::vector<std::pair<float, float> >::iterator first = m_activeIntervals.begin();
+	while (first != m_activeIntervals.end() && first->second < start)
+		++first;
+	std::vector<std::pair<float, float> >::iterator last = first;
+	while (last != m_activeIntervals.end() && last->first <= end)
+	{
+		start = std::min(start, last->first);
+		end = std::max(end, last->second);
+		++last;
+	}
+	first = m_activeIntervals.erase(first, last);
+	m_activeIntervals.insert(first, std::make_pair(start, end));
+	animationChanged();
+}
+
+void Renderable::clearActiveIntervals()
+{
+	m_activeIntervals.clear();
+	m_active = true;
+	animationChanged();
+}
+
+const std::vector<std::pair<float, float> >& Renderable::getActiveIntervals() const
+{
+	return m_activeIntervals;
+}
+
+bool Renderable::isActiveAt(float time) const
+{
+	if (m_activeIntervals.empty())
+		return true;
+	for (const std::pair<float, float>& interval : m_activeIntervals)
+	{
+		if (time < interval.first)
+			return false;
+		if (time < interval.second)
+			return true;
+	}
+	return false;
+}
+
+bool Renderable::isActive() const
+{
+	return m_active;
+}
+
 void Renderable::keyPressedEvent(sf::Event& e)
 {
 	do_keyPressedEvent(e);
@@ -113,6 +195,7 @@ void Renderable::do_mouseMoveEvent(sf::Event& e)
 void Renderable::setModelMatrix(const glm::mat4& model)
 {
 	m_model = model;
+	boundsChanged();
 }
 
 const glm::mat4& Renderable::getModelMatrix() const
@@ -168,6 +251,64 @@ Renderable::RENDER_MODE Renderable::getRenderMode() const
 void Renderable::setRenderMode(Renderable::RENDER_MODE mode)
 {
 	m_render_mode = mode;
+	// Only the renderables drawn in the window are culled
+	boundsChanged();
+}
+
+const std::string& Renderable::getName() const
+{
+	return m_name;
+}
+
+void Renderable::setName(const std::string& name)
+{
+	m_name = name;
+}
+
+const BoundingBox& Renderable::getLocalBounds() const
+{
+	return m_localBounds;
+}
+
+void Renderable::setLocalBounds(const BoundingBox& bounds)
+{
+	m_localBounds = bounds;
+	boundsChanged();
+}
+
+void Renderable::boundsChanged()
+{
+	// The viewer only knows the roots of the hierarchies
+	Renderable* root = this;
+	for (HierarchicalRenderable* node = dynamic_cast<HierarchicalRenderable*>(this); node && node->getParent(); node = node->getParent().get())
+		root = node->getParent().get();
+	if (root->m_viewer)
+		root->m_viewer->invalidateBounds(root);
+}
+
+const BoundingBox& Renderable::updateWorldBounds()
+{
+	m_worldBounds = m_localBounds.transformed(m_model);
+	return m_worldBounds;
+}
+
+const BoundingBox& Renderable::getWorldBounds() const
+{
+	return m_worldBounds;
+}
+
+bool Renderable::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	// The object space ray has the same parameter t as the world space ray
+	glm::mat4 inverseModel = glm::inverse(m_model);
+	glm::vec3 localOrigin = glm::vec3(inverseModel * glm::vec4(origin, 1.0f));
+	glm::vec3 localDirection = glm::vec3(inverseModel * glm::vec4(direction, 0.0f));
+	return m_localBounds.intersectRay(localOrigin, localDirection, std::numeric_limits<float>::max(), distance);
+}
+
+bool Renderable::pick(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	return intersectRay(origin, direction, distance);
 }
 
 // void Renderable::displayTextInViewer(std::string text) const
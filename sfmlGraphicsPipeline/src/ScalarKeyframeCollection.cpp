@@ -0,0 +1,56 @@
+#include "../include/ScalarKeyframeCollection.hpp"
+
+#include <algorithm>
+
+ScalarKeyframeCollection::ScalarKeyframeCollection() : m_cursor(0)
+{
+}
+
+void ScalarKeyframeCollection::add(float value, float time)
+{
+	size_t k = std::lower_bound(m_times.begin(), m_times.end(), time) - m_times.begin();
+	if (k < m_times.size() && m_times[k] == time)
+	{
+		m_values[k] = value;
+		return;
+	}
+	m_times.insert(m_times.begin() + k, time);
+	m_values.insert(m_values.begin() + k, value);
+	m_cursor = 0;
+}
+
+float ScalarKeyframeCollection::interpolate(float time) const
+{
+	if (m_times.empty())
+		return 0.0f;
+	size_t last = m_times.size() - 1;
+	if (time <= m_times[0])
+		return m_values[0];
+	if (time >= m_times[last])
+		return m_values[last];
+
+	// Playing forward, the time is in the same segment or in the next one
+	if (!(m_cursor < last && m_times[m_cursor] <= time && time < m_times[m_cursor + 1]))
+	{
+		if (m_cursor + 1 < last && m_times[m_cursor + 1] <= time && time < m_times[m_cursor + 2])
+			++m_cursor;
+		else
+			m_cursor = std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin() - 1;
+	}
+	float factor = (time - m_times[m_cursor]) / (m_times[m_cursor + 1] - m_times[m_cursor]);
+	return m_values[m_cursor] + factor * (m_values[m_cursor + 1] - m_values[m_cursor]);
+}
+
+bool ScalarKeyframeCollection::empty() const
+{
+	return m_times.empty();
+}
+
+bool ScalarKeyframeCollection::getTimeRange(float& begin, float& end) const
+{
+	if (m_times.empty())
+		return false;
+	begin = m_times.front();
+	end = m_times.back();
+	return true;
+}
@@ -0,0 +1,386 @@
+#include "../include/SceneBVH.hpp"
+
+#include <algorithm>
+#include <limits>
+
+// Relative and absolute margins of the boxes of the leaves
+static const float leaf_margin_ratio = 0.1f;
+static const float leaf_margin = 0.01f;
+
+static BoundingBox merge(const BoundingBox& a, const BoundingBox& b)
+{
+	BoundingBox box = a;
+	box.extend(b);
+	return box;
+}
+
+SceneBVH::SceneBVH() : m_root{-1}, m_freeList{-1}
+{
+}
+
+SceneBVH::~SceneBVH()
+{
+}
+
+int SceneBVH::allocateNode()
+{
+	int node;
+	if (m_freeList >= 0)
+	{
+		node = m_freeList;
+		m_freeList = m_nodes[node].parent;
+	}
+	else
+	{
+		node = m_nodes.size();
+		m_nodes.push_back(Node());
+	}
+	m_nodes[node].parent = -1;
+	m_nodes[node].children[0] = -1;
+	m_nodes[node].children[1] = -1;
+	m_nodes[node].height = 0;
+	return node;
+}
+
+void SceneBVH::freeNode(int node)
+{
+	m_nodes[node].renderable = nullptr;
+	m_nodes[node].height = -1;
+	m_nodes[node].parent = m_freeList;
+	m_freeList = node;
+}
+
+bool SceneBVH::update(const RenderablePtr& renderable, const BoundingBox& bounds)
+{
+	if (!bounds.isValid())
+	{
+		bool removed = contains(renderable);
+		remove(renderable);
+		return removed;
+	}
+
+	glm::vec3 margin = leaf_margin_ratio * (bounds.max() - bounds.min()) + glm::vec3(leaf_margin);
+	BoundingBox box(bounds.min() - margin, bounds.max() + margin);
+
+	int leaf;
+	auto it = m_leaves.find(renderable.get());
+	if (it != m_leaves.end())
+	{
+		leaf = it->second;
+		m_nodes[leaf].bounds = bounds;
+		// Small moves stay in the enlarged box, but a box far too large is shrunk
+		if (m_nodes[leaf].box.contains(bounds) && m_nodes[leaf].box.surfaceArea() <= 2.0f * box.surfaceArea())
+			return false;
+		removeLeaf(leaf);
+	}
+	else
+	{
+		leaf = allocateNode();
+		m_nodes[leaf].renderable = renderable;
+		m_nodes[leaf].bounds = bounds;
+		m_leaves[renderable.get()] = leaf;
+	}
+	m_nodes[leaf].box = box;
+	insertLeaf(leaf);
+	return true;
+}
+
+void SceneBVH::remove(const RenderablePtr& renderable)
+{
+	auto it = m_leaves.find(renderable.get());
+	if (it == m_leaves.end())
+		return;
+	removeLeaf(it->second);
+	freeNode(it->second);
+	m_leaves.erase(it);
+}
+
+void SceneBVH::clear()
+{
+	m_nodes.clear();
+	m_leaves.clear();
+	m_root = -1;
+	m_freeList = -1;
+}
+
+bool SceneBVH::contains(const RenderablePtr& renderable) const
+{
+	return m_leaves.count(renderable.get()) != 0;
+}
+
+size_t SceneBVH::size() const
+{
+	return m_leaves.size();
+}
+
+int SceneBVH::height() const
+{
+	return m_root < 0 ? 0 : m_nodes[m_root].height;
+}
+
+void SceneBVH::insertLeaf(int leaf)
+{
+	if (m_root < 0)
+	{
+		m_root = leaf;
+		m_nodes[leaf].parent = -1;
+		return;
+	}
+
+	// Find the best sibling with the surface area heuristic
+	// Copied, as allocating the new parent below may move the nodes
+	BoundingBox box = m_nodes[leaf].box;
+	int index = m_root;
+	while (!m_nodes[index].isLeaf())
+	{
+		float area = m_nodes[index].box.surfaceArea();
+		float combinedArea = merge(m_nodes[index].box, box).surfaceArea();
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			const Node& child = m_nodes[m_nodes[index].children[i]];
+			childCosts[i] = merge(child.box, box).surfaceArea() + inheritanceCost;
+			if (!child.isLeaf())
+				childCosts[i] -= child.box.surfaceArea();
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+		index = m_nodes[index].children[childCosts[0] < childCosts[1] ? 0 : 1];
+	}
+
+	// Create a new parent for the sibling and the leaf
+	int sibling = index;
+	int oldParent = m_nodes[sibling].parent;
+	int newParent = allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].box = merge(box, m_nodes[sibling].box);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].children[0] = sibling;
+	m_nodes[newParent].children[1] = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent >= 0)
+	{
+		int slot = m_nodes[oldParent].children[0] == sibling ? 0 : 1;
+		m_nodes[oldParent].children[slot] = newParent;
+	}
+	else
+	{
+		m_root = newParent;
+	}
+
+	fixUpwards(m_nodes[leaf].parent);
+}
+
+void SceneBVH::removeLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	int parent = m_nodes[leaf].parent;
+	int grandParent = m_nodes[parent].parent;
+	int sibling = m_nodes[parent].children[0] == leaf ? m_nodes[parent].children[1] : m_nodes[parent].children[0];
+
+	if (grandParent >= 0)
+	{
+		int slot = m_nodes[grandParent].children[0] == parent ? 0 : 1;
+		m_nodes[grandParent].children[slot] = sibling;
+		m_nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		fixUpwards(grandParent);
+	}
+	else
+	{
+		m_root = sibling;
+		m_nodes[sibling].parent = -1;
+		freeNode(parent);
+	}
+}
+
+void SceneBVH::fixUpwards(int node)
+{
+	while (node >= 0)
+	{
+		node = balance(node);
+		Node& n = m_nodes[node];
+		const Node& a = m_nodes[n.children[0]];
+		const Node& b = m_nodes[n.children[1]];
+		n.height = 1 + std::max(a.height, b.height);
+		n.box = merge(a.box, b.box);
+		node = n.parent;
+	}
+}
+
+int SceneBVH::balance(int iA)
+{
+	Node& A = m_nodes[iA];
+	if (A.isLeaf() || A.height < 2)
+		return iA;
+
+	int iB = A.children[0];
+	int iC = A.children[1];
+	Node& B = m_nodes[iB];
+	Node& C = m_nodes[iC];
+	int difference = C.height - B.height;
+
+	// Rotate C up
+	if (difference > 1)
+	{
+		int iF = C.children[0];
+		int iG = C.children[1];
+		Node& F = m_nodes[iF];
+		Node& G = m_nodes[iG];
+
+		C.children[0] = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+		if (C.parent >= 0)
+		{
+			int slot = m_nodes[C.parent].children[0] == iA ? 0 : 1;
+			m_nodes[C.parent].children[slot] = iC;
+		}
+		else
+		{
+			m_root = iC;
+		}
+
+		// The highest child of C stays with C
+		int iKept = F.height > G.height ? iF : iG;
+		int iMoved = F.height > G.height ? iG : iF;
+		C.children[1] = iKept;
+		A.children[1] = iMoved;
+		m_nodes[iMoved].parent = iA;
+		A.box = merge(B.box, m_nodes[iMoved].box);
+		C.box = merge(A.box, m_nodes[iKept].box);
+		A.height = 1 + std::max(B.height, m_nodes[iMoved].height);
+		C.height = 1 + std::max(A.height, m_nodes[iKept].height);
+		return iC;
+	}
+
+	// Rotate B up
+	if (difference < -1)
+	{
+		int iD = B.children[0];
+		int iE = B.children[1];
+		Node& D = m_nodes[iD];
+		Node& E = m_nodes[iE];
+
+		B.children[0] = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+		if (B.parent >= 0)
+		{
+			int slot = m_nodes[B.parent].children[0] == iA ? 0 : 1;
+			m_nodes[B.parent].children[slot] = iB;
+		}
+		else
+		{
+			m_root = iB;
+		}
+
+		int iKept = D.height > E.height ? iD : iE;
+		int iMoved = D.height > E.height ? iE : iD;
+		B.children[1] = iKept;
+		A.children[0] = iMoved;
+		m_nodes[iMoved].parent = iA;
+		A.box = merge(C.box, m_nodes[iMoved].box);
+		B.box = merge(A.box, m_nodes[iKept].box);
+		A.height = 1 + std::max(C.height, m_nodes[iMoved].height);
+		B.height = 1 + std::max(A.height, m_nodes[iKept].height);
+		return iB;
+	}
+
+	return iA;
+}
+
+void SceneBVH::query(const Frustum& frustum, std::vector<RenderablePtr>& result) const
+{
+	if (m_root < 0)
+		return;
+	std::vector<int> stack(1, m_root);
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!frustum.intersects(node.box))
+			continue;
+		if (node.isLeaf())
+		{
+			if (frustum.intersects(node.bounds))
+				result.push_back(node.renderable);
+		}
+		else
+		{
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+}
+
+void SceneBVH::query(const glm::vec3& center, float radius, std::vector<RenderablePtr>& result) const
+{
+	if (m_root < 0)
+		return;
+	std::vector<int> stack(1, m_root);
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!node.box.intersects(center, radius))
+			continue;
+		if (node.isLeaf())
+		{
+			if (node.bounds.intersects(center, radius))
+				result.push_back(node.renderable);
+		}
+		else
+		{
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+}
+
+RenderablePtr SceneBVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance) const
+{
+	RenderablePtr hit;
+	distance = std::numeric_limits<float>::max();
+	if (m_root < 0)
+		return hit;
+
+	std::vector<int> stack(1, m_root);
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		// Skip the boxes beyond the closest hit found so far
+		float t;
+		if (!node.box.intersectRay(origin, direction, distance, t))
+			continue;
+		if (node.isLeaf())
+		{
+			if (node.bounds.intersectRay(origin, direction, distance, t) && node.renderable->pick(origin, direction, t) && t < distance)
+			{
+				distance = t;
+				hit = node.renderable;
+			}
+		}
+		else
+		{
+			stack.push_back(node.children[0]);
+			stack.push_back(node.children[1]);
+		}
+	}
+	return hit;
+}
@@ -0,0 +1,140 @@
+#include "../include/SceneRegistry.hpp"
+
+#include "../include/HierarchicalRenderable.hpp"
+#include "./../include/log.hpp"
+
+bool PriorityComparator::operator()(const RenderablePtr& a, const RenderablePtr& b) const
+{
+	return a->priority() > b->priority();
+}
+
+/* Parent of a renderable, nullptr for a root. */
+static HierarchicalRenderablePtr parent_of(const RenderablePtr& renderable)
+{
+	HierarchicalRenderablePtr hierarchical = std::dynamic_pointer_cast<HierarchicalRenderable>(renderable);
+	return hierarchical ? hierarchical->getParent() : nullptr;
+}
+
+/* Root of the hierarchy containing a renderable. */
+static RenderablePtr root_of(const RenderablePtr& renderable)
+{
+	RenderablePtr root = renderable;
+	for (HierarchicalRenderablePtr parent = parent_of(root); parent; parent = parent->getParent())
+		root = parent;
+	return root;
+}
+
+SceneRegistry::SceneRegistry()
+{
+}
+
+bool SceneRegistry::addRoot(const RenderablePtr& renderable)
+{
+	if (m_ids.count(renderable.get()))
+	{
+		LOG(warning, "[SceneRegistry] " << describe(renderable) << " is already in the scene, it is not added again.")
+		return false;
+	}
+	HierarchicalRenderablePtr parent = parent_of(renderable);
+	if (parent)
+	{
+		LOG(warning, "[SceneRegistry] " << describe(renderable) << " is a child of " << describe(parent)
+		                                << ", it is drawn and animated by its parent rather than as a root.")
+		// The hierarchy is still drawn if its root was not registered
+		RenderablePtr root = root_of(renderable);
+		if (!m_ids.count(root.get()))
+		{
+			m_roots.insert(root);
+			m_ids.insert(root.get());
+		}
+		return false;
+	}
+	m_roots.insert(renderable);
+	m_ids.insert(renderable.get());
+	return true;
+}
+
+void SceneRegistry::remove(const RenderablePtr& renderable)
+{
+	if (!m_ids.erase(renderable.get()))
+		return;
+	for (RootSet::iterator it = m_roots.begin(); it != m_roots.end(); ++it)
+	{
+		if (*it == renderable)
+		{
+			m_roots.erase(it);
+			break;
+		}
+	}
+}
+
+void SceneRegistry::clear()
+{
+	m_roots.clear();
+	m_ids.clear();
+}
+
+const SceneRegistry::RootSet& SceneRegistry::getRoots() const
+{
+	return m_roots;
+}
+
+bool SceneRegistry::isRoot(const RenderablePtr& renderable) const
+{
+	return m_ids.count(renderable.get()) != 0;
+}
+
+size_t SceneRegistry::validate(std::vector<RenderablePtr>& demoted)
+{
+	size_t count = 0;
+	for (RootSet::iterator it = m_roots.begin(); it != m_roots.end();)
+	{
+		HierarchicalRenderablePtr parent = parent_of(*it);
+		if (!parent)
+		{
+			++it;
+			continue;
+		}
+		LOG(warning, "[SceneRegistry] " << describe(*it) << " has become a child of " << describe(parent)
+		                                << ", it is now drawn and animated by its parent only.")
+		demoted.push_back(*it);
+		m_ids.erase(it->get());
+		it = m_roots.erase(it);
+		++count;
+	}
+
+	// The hierarchies of the removed roots are still drawn if their root was not registered
+	for (size_t i = demoted.size() - count; i < demoted.size(); ++i)
+	{
+		RenderablePtr root = root_of(demoted[i]);
+		if (!m_ids.count(root.get()))
+		{
+			m_roots.insert(root);
+			m_ids.insert(root.get());
+		}
+	}
+	return count;
+}
+
+void SceneRegistry::forEachNode(const std::function<void(const RenderablePtr&)>& visit) const
+{
+	std::vector<RenderablePtr> stack;
+	for (const RenderablePtr& root : m_roots)
+	{
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			RenderablePtr node = stack.back();
+			stack.pop_back();
+			visit(node);
+			HierarchicalRenderablePtr hierarchical = std::dynamic_pointer_cast<HierarchicalRenderable>(node);
+			if (hierarchical)
+				stack.insert(stack.end(), hierarchical->getChildren().rbegin(), hierarchical->getChildren().rend());
+		}
+	}
+}
+
+std::string SceneRegistry::describe(const RenderablePtr& renderable)
+{
+	return renderable->getName().empty() ? "an unnamed renderable" : "\"" + renderable->getName() + "\"";
+}
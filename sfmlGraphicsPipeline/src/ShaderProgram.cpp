@@ -53,17 +53,80 @@ check_program_status(GLuint program)
 	return status;
 }
 
-static GLuint
-compile_shader(const std::string& gpu_name, GLuint type)
+static const unsigned int max_include_depth = 16;
+
+static std::string
+directory_of(const std::string& path)
 {
-	// open the shader file
+	size_t slash = path.find_last_of("/\\");
+	if (slash == std::string::npos)
+		return std::string();
+	return path.substr(0, slash + 1);
+}
+
+/* Read a shader file and splice the files it includes with #include "file".
+ * Each included file gets a source string number (its index in files) in the
+ * #line directives, so that compilation errors can be traced back to their
+ * file. The root file is the source string 0. */
+static bool
+read_shader_source(const std::string& gpu_name, std::string& source, std::vector<std::string>& files, unsigned int depth = 0)
+{
+	if (depth > max_include_depth)
+	{
+		LOG(error, "too many nested includes when reading shader file " << gpu_name << ". Is there an include cycle?");
+		return false;
+	}
+
 	std::ifstream gpu_file(gpu_name);
 	if (!gpu_file.is_open())
 	{
 		LOG(error, "cannot open shader file " << gpu_name << ". Are you in the right directory?");
-		return 0;
+		return false;
+	}
+
+	size_t file_number = std::find(files.begin(), files.end(), gpu_name) - files.begin();
+	if (file_number == files.size())
+		files.push_back(gpu_name);
+
+	std::ostringstream gpu_data;
+	std::string line;
+	unsigned int line_number = 0;
+	while (std::getline(gpu_file, line))
+	{
+		++line_number;
+		size_t first = line.find_first_not_of(" \t");
+		if (first == std::string::npos || line.compare(first, 8, "#include") != 0)
+		{
+			gpu_data << line << '\n';
+			continue;
+		}
+
+		size_t open_quote = line.find('"', first + 8);
+		size_t close_quote = open_quote == std::string::npos ? open_quote : line.find('"', open_quote + 1);
+		if (close_quote == std::string::npos)
+		{
+			LOG(error, "malformed include directive in " << gpu_name << ":" << line_number << ": " << line);
+			return false;
+		}
+
+		std::string included_source;
+		std::string included_name = directory_of(gpu_name) + line.substr(open_quote + 1, close_quote - open_quote - 1);
+		if (!read_shader_source(included_name, included_source, files, depth + 1))
+			return false;
+		size_t included_number = std::find(files.begin(), files.end(), included_name) - files.begin();
+		gpu_data << "#line 1 " << included_number << '\n'
+		         << included_source
+		         << "#line " << line_number + 1 << " " << file_number << '\n';
 	}
+	source = gpu_data.str();
+	return true;
+}
 
+/* Create a shader object and submit its compilation. The compilation status is
+ * not checked here, so that the driver can compile it in the background. */
+static GLuint
+create_shader(const std::string& gpu_string, const std::string& gpu_name, GLuint type)
+{
 	// create a new shader object
 	glcheck(GLuint shader = glCreateShader(type));
 	if (!shader)
@@ -72,12 +135,6 @@ compile_shader(const std::string& gpu_name, GLuint type)
 		return 0;
 	}
 
-	// load the shader source in one string
-	std::stringstream gpu_data;
-	gpu_data << gpu_file.rdbuf();
-	gpu_file.close();  // no more needed, so close it now
-	const std::string gpu_string = gpu_data.str();
-
 	// set the source of the shader (as one big cstring)
 	const char* strShaderVar = gpu_string.c_str();
 	GLint iShaderLen = gpu_string.size();
@@ -85,33 +142,41 @@ compile_shader(const std::string& gpu_name, GLuint type)
 
 	// compile the shader
 	glcheck(glCompileShader(shader));
+	return shader;
+}
+
+static bool
+check_shader_status(GLuint shader, const std::string& gpu_name, const std::vector<std::string>& files)
+{
 	GLint result;
 	glcheck(glGetShaderiv(shader, GL_COMPILE_STATUS, &result));
 	if (GL_FALSE == result)
 	{
 		LOG(error, "shader [" << gpu_name << "] compilation failed!");
+		for (size_t i = 0; i < files.size(); ++i)
+			LOG(error, "\tsource string " << i << ": " << files[i]);
 		dump_shader_log(shader);
-		glcheck(glDeleteShader(shader));
-		return 0;
+		return false;
 	}
-	return shader;
+	return true;
 }
 
 ShaderProgram::ShaderProgram()
-    : m_programId{0}
+    : m_programId{0}, m_pendingProgramId{0}, m_pendingVertexId{0}, m_pendingFragmentId{0}
 {
 }
 
 ShaderProgram::ShaderProgram(
     const std::string& vertex_file_path,
     const std::string& fragment_file_path)
-    : m_programId{0}
+    : m_programId{0}, m_pendingProgramId{0}, m_pendingVertexId{0}, m_pendingFragmentId{0}
 {
 	load(vertex_file_path, fragment_file_path);
 }
 
 ShaderProgram::~ShaderProgram()
 {
+	discard_pending();
 	if (glIsProgram(m_programId))
 		glcheck(glDeleteProgram(m_programId));
 }
@@ -120,55 +185,99 @@ void ShaderProgram::load(
     const std::string& vertex_file_path,
     const std::string& fragment_file_path)
 {
+	if (begin_link(vertex_file_path, fragment_file_path))
+		end_link();
+}
+
+bool ShaderProgram::begin_link(
+    const std::string& vertex_file_path,
+    const std::string& fragment_file_path)
+{
+	discard_pending();
+
+	// read the sources first: nothing is sent to the GPU if a file is missing
+	std::vector<std::string> vertex_files, fragment_files;
+	std::string vertex_source, fragment_source;
+	if (!read_shader_source(vertex_file_path, vertex_source, vertex_files)
+	    || !read_shader_source(fragment_file_path, fragment_source, fragment_files))
+	{
+		LOG(error, "cannot load shader program. Program unchanged...");
+		return false;
+	}
+
 	// ids of the shaders that we will link together to form a program
-	GLuint vertex_shader_id = compile_shader(vertex_file_path, GL_VERTEX_SHADER);
-	GLuint fragment_shader_id = compile_shader(fragment_file_path, GL_FRAGMENT_SHADER);
-	if (!vertex_shader_id || !fragment_shader_id)
+	m_pendingVertexId = create_shader(vertex_source, vertex_file_path, GL_VERTEX_SHADER);
+	m_pendingFragmentId = create_shader(fragment_source, fragment_file_path, GL_FRAGMENT_SHADER);
+	if (!m_pendingVertexId || !m_pendingFragmentId)
 	{
 		LOG(error, "cannot load shader program. Program unchanged...");
-		if (glIsShader(vertex_shader_id))
-			glcheck(glDeleteShader(vertex_shader_id));
-		if (glIsShader(fragment_shader_id))
-			glcheck(glDeleteShader(fragment_shader_id));
-		return;
+		discard_pending();
+		return false;
 	}
 
-	// previous program id, to restore in case of failure
-	unsigned int previous_id = m_programId;
+	// Create, attach, Link the program. The current program remains in use until end_link().
+	glcheck(m_pendingProgramId = glCreateProgram());
+	glcheck(glAttachShader(m_pendingProgramId, m_pendingVertexId));
+	glcheck(glAttachShader(m_pendingProgramId, m_pendingFragmentId));
+	glcheck(glLinkProgram(m_pendingProgramId));
+
+	m_pendingVertexFilename = vertex_file_path;
+	m_pendingFragmentFilename = fragment_file_path;
+	m_pendingVertexFiles.swap(vertex_files);
+	m_pendingFragmentFiles.swap(fragment_files);
+	return true;
+}
 
-	// Create, attach, Link the program
-	glcheck(m_programId = glCreateProgram());
-	glcheck(glAttachShader(m_programId, vertex_shader_id));
-	glcheck(glAttachShader(m_programId, fragment_shader_id));
-	glcheck(glLinkProgram(m_programId));
+void ShaderProgram::end_link()
+{
+	bool compiled = check_shader_status(m_pendingVertexId, m_pendingVertexFilename, m_pendingVertexFiles);
+	compiled = check_shader_status(m_pendingFragmentId, m_pendingFragmentFilename, m_pendingFragmentFiles) && compiled;
 
 	// everything is ok: use this new program
-	if (check_program_status(m_programId))
+	if (compiled && check_program_status(m_pendingProgramId))
 	{
 		// if this is already a program, delete all data
-		if (glIsProgram(previous_id))
-			glcheck(glDeleteProgram(previous_id));
-		m_vertexFilename = vertex_file_path;
-		m_fragmentFilename = fragment_file_path;
+		if (glIsProgram(m_programId))
+			glcheck(glDeleteProgram(m_programId));
+		m_programId = m_pendingProgramId;
+		m_pendingProgramId = 0;
+		m_vertexFilename = m_pendingVertexFilename;
+		m_fragmentFilename = m_pendingFragmentFilename;
+		m_sourceFiles = m_pendingVertexFiles;
+		for (const std::string& file : m_pendingFragmentFiles)
+			if (std::find(m_sourceFiles.begin(), m_sourceFiles.end(), file) == m_sourceFiles.end())
+				m_sourceFiles.push_back(file);
 
 		// load attributes and uniforms
-		LOG(info, "resources info for ShaderProgram " << this << " (" << vertex_file_path << ", " << fragment_file_path << ")");
+		LOG(info, "resources info for ShaderProgram " << this << " (" << m_vertexFilename << ", " << m_fragmentFilename << ")");
 		resources_introspection();
 	}
-	// it failed: delete new program and restore to previous state
+	// it failed: the previous program is kept
 	else
 	{
-		LOG(warning, "shader program described by (" << vertex_file_path << ", " << fragment_file_path
+		LOG(warning, "shader program described by (" << m_pendingVertexFilename << ", " << m_pendingFragmentFilename
 		                                             << ") is invalid. ShaderProgram " << this << " remains unchanged...");
-		glcheck(glDeleteProgram(m_programId));
-		m_programId = previous_id;
 	}
 
 	// Delete vertex & fragment id. We do not need them anymore as they are already
 	//"in" this program. The only reason to keep those shaders somewhere would be
 	// to reused them in order to build another shader program.
-	glDeleteShader(vertex_shader_id);
-	glDeleteShader(fragment_shader_id);
+	discard_pending();
+}
+
+void ShaderProgram::discard_pending()
+{
+	if (m_pendingProgramId)
+		glcheck(glDeleteProgram(m_pendingProgramId));
+	if (m_pendingVertexId)
+		glcheck(glDeleteShader(m_pendingVertexId));
+	if (m_pendingFragmentId)
+		glcheck(glDeleteShader(m_pendingFragmentId));
+	m_pendingProgramId = 0;
+	m_pendingVertexId = 0;
+	m_pendingFragmentId = 0;
+	m_pendingVertexFiles.clear();
+	m_pendingFragmentFiles.clear();
 }
 
 void ShaderProgram::reload()
@@ -177,6 +286,40 @@ void ShaderProgram::reload()
 		load(m_vertexFilename, m_fragmentFilename);
 }
 
+void ShaderProgram::reloadAsync()
+{
+	if (!m_vertexFilename.empty() && !m_fragmentFilename.empty())
+		begin_link(m_vertexFilename, m_fragmentFilename);
+}
+
+bool ShaderProgram::pollReload()
+{
+	if (!m_pendingProgramId)
+		return false;
+
+	// Without the extension, querying the link status would block until the
+	// driver is done: finish the reload right away.
+	if (GLEW_ARB_parallel_shader_compile)
+	{
+		GLint completed = GL_FALSE;
+		glcheck(glGetProgramiv(m_pendingProgramId, GL_COMPLETION_STATUS_ARB, &completed));
+		if (completed == GL_FALSE)
+			return false;
+	}
+	end_link();
+	return true;
+}
+
+bool ShaderProgram::isReloading() const
+{
+	return m_pendingProgramId != 0;
+}
+
+const std::vector<std::string>& ShaderProgram::getSourceFiles() const
+{
+	return m_sourceFiles;
+}
+
 void ShaderProgram::bind()
 {
 	glcheck(glUseProgram(m_programId));
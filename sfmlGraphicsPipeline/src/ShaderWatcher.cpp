@@ -0,0 +1,144 @@
+#include "../include/ShaderWatcher.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "./../include/log.hpp"
+
+static std::string
+canonical_name(const std::string& filename)
+{
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, filename.c_str(), _MAX_PATH))
+		return buffer;
+#else
+	char buffer[PATH_MAX];
+	if (realpath(filename.c_str(), buffer))
+		return buffer;
+#endif
+	return filename;
+}
+
+static long long
+modification_date(const std::string& filename)
+{
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0)
+		return -1;
+	return (long long)info.st_mtime;
+}
+
+ShaderWatcher::ShaderWatcher()
+    : m_inotifyFd{-1}
+{
+#ifdef __linux__
+	m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotifyFd < 0)
+		LOG(warning, "cannot use inotify to watch shader files, falling back to polling");
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+	if (m_inotifyFd >= 0)
+		close(m_inotifyFd);
+#endif
+}
+
+void ShaderWatcher::watch(const ShaderProgramPtr& program)
+{
+	// forget the previous files of this program
+	for (auto& dependents : m_dependents)
+		dependents.second.erase(std::remove(dependents.second.begin(), dependents.second.end(), program), dependents.second.end());
+
+	for (const std::string& filename : program->getSourceFiles())
+		watchFile(canonical_name(filename), program);
+}
+
+void ShaderWatcher::watchFile(const std::string& filename, const ShaderProgramPtr& program)
+{
+	std::vector<ShaderProgramPtr>& dependents = m_dependents[filename];
+	if (std::find(dependents.begin(), dependents.end(), program) == dependents.end())
+		dependents.push_back(program);
+
+	if (m_modificationDates.find(filename) == m_modificationDates.end())
+		m_modificationDates[filename] = modification_date(filename);
+
+#ifdef __linux__
+	if (m_inotifyFd >= 0)
+	{
+		std::string directory = filename.substr(0, filename.find_last_of('/'));
+		// adding a watch twice on the same directory returns the same descriptor
+		int wd = inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd < 0)
+		{
+			LOG(warning, "cannot watch shader directory " << directory);
+		}
+		else
+		{
+			m_directories[wd] = directory;
+		}
+	}
+#endif
+}
+
+void ShaderWatcher::notify(const std::string& filename, std::vector<ShaderProgramPtr>& programs)
+{
+	auto search = m_dependents.find(filename);
+	if (search == m_dependents.end())
+		return;
+	for (const ShaderProgramPtr& program : search->second)
+		if (std::find(programs.begin(), programs.end(), program) == programs.end())
+			programs.push_back(program);
+}
+
+void ShaderWatcher::poll(std::vector<ShaderProgramPtr>& programs)
+{
+	programs.clear();
+
+#ifdef __linux__
+	if (m_inotifyFd >= 0)
+	{
+		char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+		ssize_t length;
+		while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len)
+			{
+				const struct inotify_event* event = (const struct inotify_event*)ptr;
+				// some events were lost: reload everything to be safe
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					for (auto& dependents : m_dependents)
+						notify(dependents.first, programs);
+					continue;
+				}
+				auto directory = m_directories.find(event->wd);
+				if (event->len && directory != m_directories.end())
+					notify(directory->second + "/" + event->name, programs);
+			}
+		}
+		return;
+	}
+#endif
+
+	for (auto& date : m_modificationDates)
+	{
+		long long current = modification_date(date.first);
+		if (current != date.second)
+		{
+			date.second = current;
+			notify(date.first, programs);
+		}
+	}
+}
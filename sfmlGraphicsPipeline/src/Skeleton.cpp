@@ -0,0 +1,88 @@
+#include "../include/Skeleton.hpp"
+
+#include <algorithm>
+
+const unsigned int Skeleton::max_joints = 64;
+
+Skeleton::Skeleton()
+{
+}
+
+int Skeleton::addJoint(const std::string& name, int parent, const glm::mat4& restTransform, const glm::mat4& inverseBindMatrix)
+{
+	if (m_joints.size() >= max_joints || parent >= int(m_joints.size()))
+		return -1;
+	Joint joint;
+	joint.name = name;
+	joint.parent = parent;
+	joint.restTransform = restTransform;
+	joint.inverseBindMatrix = inverseBindMatrix;
+	m_joints.push_back(joint);
+	return m_joints.size() - 1;
+}
+
+size_t Skeleton::getJointCount() const
+{
+	return m_joints.size();
+}
+
+int Skeleton::findJoint(const std::string& name) const
+{
+	for (size_t j = 0; j < m_joints.size(); ++j)
+	{
+		if (m_joints[j].name == name)
+			return j;
+	}
+	return -1;
+}
+
+void Skeleton::addKeyframe(int joint, const GeometricTransformation& transformation, float time)
+{
+	m_joints[joint].keyframes.add(transformation, time);
+}
+
+void Skeleton::addKeyframesFromFile(int joint, const std::string& animation_filename, float time_shift)
+{
+	m_joints[joint].keyframes.addFromFile(animation_filename, time_shift);
+}
+
+void Skeleton::setClip(int joint, const AnimationClipPtr& clip)
+{
+	m_joints[joint].clip = clip;
+}
+
+bool Skeleton::getAnimationRange(float& begin, float& end) const
+{
+	bool animated = false;
+	for (const Joint& joint : m_joints)
+	{
+		float b, e;
+		bool valid = joint.clip ? joint.clip->getTimeRange(b, e) : joint.keyframes.getTimeRange(b, e);
+		if (!valid)
+			continue;
+		begin = animated ? std::min(begin, b) : b;
+		end = animated ? std::max(end, e) : e;
+		animated = true;
+	}
+	return animated;
+}
+
+void Skeleton::computePalette(float time, std::vector<glm::mat4>& palette) const
+{
+	palette.resize(m_joints.size());
+	for (size_t j = 0; j < m_joints.size(); ++j)
+	{
+		const Joint& joint = m_joints[j];
+		glm::mat4 local = joint.restTransform;
+		if (joint.clip && !joint.clip->empty())
+			local = joint.clip->sample(time);
+		else if (!joint.clip && !joint.keyframes.empty())
+			local = joint.keyframes.interpolateTransformation(time);
+
+		// The parent comes first: its pose is already computed
+		palette[j] = joint.parent < 0 ? local : palette[joint.parent] * local;
+	}
+	// Once all the poses are known, the bind pose is removed
+	for (size_t j = 0; j < m_joints.size(); ++j)
+		palette[j] = palette[j] * m_joints[j].inverseBindMatrix;
+}
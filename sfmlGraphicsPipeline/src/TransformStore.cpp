@@ -0,0 +1,216 @@
+#include "../include/TransformStore.hpp"
+
+#include <limits>
+
+const TransformStore::Handle TransformStore::null_handle = std::numeric_limits<TransformStore::Handle>::max();
+
+// Flags of TransformStore::m_dirty
+static const unsigned char dirty_global = 1;
+static const unsigned char dirty_local = 2;
+
+// Under this number of nodes, a depth level is not worth splitting across threads
+static const long parallel_level_size = 1024;
+
+TransformStore::TransformStore() : m_sorted{true}, m_dirtyNodes{false}
+{
+	m_levels.push_back(0);
+}
+
+TransformStore::~TransformStore()
+{
+}
+
+TransformStore::Handle TransformStore::add(Handle parent, const glm::mat4& globalTransform, const glm::mat4& localTransform)
+{
+	Handle handle;
+	if (m_freeHandles.empty())
+	{
+		handle = m_indices.size();
+		m_indices.push_back(-1);
+	}
+	else
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+
+	// Appending keeps the parents before their children, but the depth levels must be rebuilt
+	m_indices[handle] = m_handles.size();
+	m_parents.push_back(parent == null_handle ? -1 : m_indices[parent]);
+	m_globals.push_back(globalTransform);
+	m_locals.push_back(localTransform);
+	m_totals.push_back(glm::mat4(1.0));
+	m_models.push_back(glm::mat4(1.0));
+	m_dirty.push_back(dirty_global | dirty_local);
+	m_moved.push_back(0);
+	m_handles.push_back(handle);
+
+	m_sorted = false;
+	m_dirtyNodes = true;
+	return handle;
+}
+
+void TransformStore::remove(Handle handle)
+{
+	int index = m_indices[handle];
+	for (size_t i = 0; i < m_parents.size(); ++i)
+	{
+		if (m_parents[i] == index)
+		{
+			m_parents[i] = -1;
+			m_dirty[i] |= dirty_global;
+		}
+	}
+	// The node is dropped by the next sort
+	m_handles[index] = null_handle;
+	m_indices[handle] = -1;
+	m_freeHandles.push_back(handle);
+	m_sorted = false;
+	m_dirtyNodes = true;
+}
+
+void TransformStore::setParent(Handle handle, Handle parent)
+{
+	int index = m_indices[handle];
+	m_parents[index] = parent == null_handle ? -1 : m_indices[parent];
+	m_dirty[index] |= dirty_global;
+	m_sorted = false;
+	m_dirtyNodes = true;
+}
+
+void TransformStore::setGlobalTransform(Handle handle, const glm::mat4& globalTransform)
+{
+	int index = m_indices[handle];
+	m_globals[index] = globalTransform;
+	m_dirty[index] |= dirty_global;
+	m_dirtyNodes = true;
+}
+
+void TransformStore::setLocalTransform(Handle handle, const glm::mat4& localTransform)
+{
+	int index = m_indices[handle];
+	m_locals[index] = localTransform;
+	m_dirty[index] |= dirty_local;
+	m_dirtyNodes = true;
+}
+
+const glm::mat4& TransformStore::totalGlobalTransform(Handle handle) const
+{
+	return m_totals[m_indices[handle]];
+}
+
+const glm::mat4& TransformStore::modelMatrix(Handle handle) const
+{
+	return m_models[m_indices[handle]];
+}
+
+bool TransformStore::isDirty() const
+{
+	return m_dirtyNodes;
+}
+
+size_t TransformStore::size() const
+{
+	return m_handles.size();
+}
+
+void TransformStore::sort()
+{
+	// setParent() may have put a child before its parent: walk up to the nodes of known depth
+	size_t count = m_handles.size();
+	std::vector<int> depths(count, -1);
+	std::vector<int> path;
+	size_t maxDepth = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		int node = i;
+		while (node >= 0 && depths[node] < 0)
+		{
+			path.push_back(node);
+			node = m_parents[node];
+		}
+		int depth = node < 0 ? -1 : depths[node];
+		while (!path.empty())
+		{
+			depths[path.back()] = ++depth;
+			path.pop_back();
+		}
+		if (m_handles[i] != null_handle && (size_t)depths[i] > maxDepth)
+			maxDepth = depths[i];
+	}
+
+	// Counting sort of the remaining nodes by depth
+	m_levels.assign(maxDepth + 2, 0);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (m_handles[i] != null_handle)
+			++m_levels[depths[i] + 1];
+	}
+	for (size_t d = 1; d < m_levels.size(); ++d)
+		m_levels[d] += m_levels[d - 1];
+
+	std::vector<size_t> next(m_levels.begin(), m_levels.end() - 1);
+	std::vector<int> newIndices(count, -1);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (m_handles[i] != null_handle)
+			newIndices[i] = next[depths[i]]++;
+	}
+
+	size_t size = m_levels.back();
+	std::vector<int> parents(size);
+	std::vector<glm::mat4> globals(size), locals(size), totals(size), models(size);
+	std::vector<unsigned char> dirty(size);
+	std::vector<Handle> handles(size);
+	for (size_t i = 0; i < count; ++i)
+	{
+		int j = newIndices[i];
+		if (j < 0)
+			continue;
+		parents[j] = m_parents[i] < 0 ? -1 : newIndices[m_parents[i]];
+		globals[j] = m_globals[i];
+		locals[j] = m_locals[i];
+		totals[j] = m_totals[i];
+		models[j] = m_models[i];
+		dirty[j] = m_dirty[i];
+		handles[j] = m_handles[i];
+		m_indices[m_handles[i]] = j;
+	}
+	m_parents.swap(parents);
+	m_globals.swap(globals);
+	m_locals.swap(locals);
+	m_totals.swap(totals);
+	m_models.swap(models);
+	m_dirty.swap(dirty);
+	m_handles.swap(handles);
+	m_moved.assign(size, 0);
+	m_sorted = true;
+}
+
+void TransformStore::update()
+{
+	if (!m_dirtyNodes)
+		return;
+	if (!m_sorted)
+		sort();
+
+	// All the parents of a level are in the previous levels
+	for (size_t d = 0; d + 1 < m_levels.size(); ++d)
+	{
+		long begin = m_levels[d];
+		long end = m_levels[d + 1];
+#pragma omp parallel for if (end - begin > parallel_level_size)
+		for (long i = begin; i < end; ++i)
+		{
+			int parent = m_parents[i];
+			bool moved = (m_dirty[i] & dirty_global) || (parent >= 0 && m_moved[parent]);
+			if (moved)
+				m_totals[i] = parent >= 0 ? m_totals[parent] * m_globals[i] : m_globals[i];
+			if (moved || (m_dirty[i] & dirty_local))
+				m_models[i] = m_totals[i] * m_locals[i];
+			m_moved[i] = moved;
+			m_dirty[i] = 0;
+		}
+	}
+	m_dirtyNodes = false;
+}
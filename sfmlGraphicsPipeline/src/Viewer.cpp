@@ -2,6 +2,7 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/string_cast.hpp>
@@ -9,18 +10,19 @@
 #include <iostream>
 #include <sstream>
 
+#include "../include/Frustum.hpp"
 #include "../include/gl_helper.hpp"
 #include "./../include/log.hpp"
 
-bool PriorityComparator::operator()(const RenderablePtr& a, const RenderablePtr& b) const
-{
-	return a->priority() > b->priority();
-}
-
 static const Viewer::Duration g_modeInformationTextTimeout = std::chrono::seconds(3);
 
 static const std::string screenshot_basename = "screenshot";
 
+static const std::string profile_basename = "gpu_profile";
+
+// Below this number of keyframed nodes, the keyframes are sampled by a single thread
+static const long parallel_animation_size = 64;
+
 static void initializeGL()
 {
 	// Initialize GLEW
@@ -29,6 +31,10 @@ static void initializeGL()
 	if (GLEW_OK != err)
 		LOG(error, "[GLEW] " << glewGetErrorString(err));
 	LOG(info, "[GLEW] using version " << glewGetString(GLEW_VERSION));
+
+	// Let the driver compile shaders with as many threads as it wants
+	if (GLEW_ARB_parallel_shader_compile)
+		glcheck(glMaxShaderCompilerThreadsARB(0xFFFFFFFF));
 }
 
 Viewer::KeyboardState::KeyboardState()
@@ -54,17 +60,31 @@ Viewer::Viewer(float width, float height, const glm::vec4& background_color) : m
                                                                                    sf::ContextSettings{24 /* depth*/, 8 /*stencil*/, 4 /*anti aliasing level*/, 4 /*GL major version*/, 0 /*GL minor version*/}},
                                                                                // m_modeInformationTextDisappearanceTime{ clock::now() + g_modeInformationTextTimeout },
                                                                                // m_modeInformationText{ "Arcball Camera Activated" },
+                                                                               m_transformStore{std::make_shared<TransformStore>()},
+                                                                               m_deferredShading{false},
+                                                                               m_depthPrepassEnabled{false},
+                                                                               m_depthPrepassEqual{false},
+                                                                               m_occlusionCulling{false},
+                                                                               m_occlusionDebug{false},
                                                                                m_applicationRunning{true},
                                                                                m_animationLoop{false},
                                                                                m_animationIsStarted{false},
                                                                                m_loopDuration{120},
                                                                                m_simulationTime{0},
                                                                                m_timeFactor{1.0f},
+                                                                               m_reverse{false},
+                                                                               m_seekPending{false},
+                                                                               m_frameDuration{1.0f / 30.0f},
                                                                                m_screenshotCounter{0},
                                                                                m_helpDisplayed{false},
                                                                                m_helpDisplayRequest{false},
                                                                                m_lastEventHandleTime{clock::now()},
-                                                                               m_background_color{background_color}
+                                                                               m_background_color{background_color},
+                                                                               m_frustumCulling{true},
+                                                                               m_cullingStats{0, 0, 0},
+                                                                               m_animationRevision{0},
+                                                                               m_cullableCount{0},
+                                                                               m_timelineRevision{0}
 {
 	sf::ContextSettings settings = m_window.getSettings();
 	LOG(info, "Settings of OPENGL Context created by SFML");
@@ -96,7 +116,7 @@ Viewer::Viewer(float width, float height, const glm::vec4& background_color) : m
 }
 
 Viewer::Viewer(const glm::vec4 &background_color) :
-	m_applicationRunning{true}, m_animationLoop{false}, m_animationIsStarted{false}, m_loopDuration{120}, m_simulationTime{0}, m_timeFactor{1.0f}, m_screenshotCounter{0}, m_helpDisplayed{false}, m_helpDisplayRequest{false}, m_lastEventHandleTime{clock::now()}, m_background_color{background_color}
+	m_transformStore{std::make_shared<TransformStore>()}, m_deferredShading{false}, m_depthPrepassEnabled{false}, m_depthPrepassEqual{false}, m_occlusionCulling{false}, m_occlusionDebug{false}, m_applicationRunning{true}, m_animationLoop{false}, m_animationIsStarted{false}, m_loopDuration{120}, m_simulationTime{0}, m_timeFactor{1.0f}, m_reverse{false}, m_seekPending{false}, m_frameDuration{1.0f / 30.0f}, m_screenshotCounter{0}, m_helpDisplayed{false}, m_helpDisplayRequest{false}, m_lastEventHandleTime{clock::now()}, m_background_color{background_color}, m_frustumCulling{true}, m_cullingStats{0, 0, 0}, m_animationRevision{0}, m_cullableCount{0}, m_timelineRevision{0}
 {
 	sf::Vector2u windowSize;
 	sf::Uint32 style;
@@ -140,9 +160,20 @@ constexpr const char* g_help_message =
     "VIEWER SHORTCUTS:\n"
     "      [F1]  Display/Hide this help message\n"
     "      [F2]  Take a screen shot of the frame currently in the frame buffer\n"
-    "      [F3]  Reload all managed shader program from their sources\n"
+    "      [F3]  Reload all managed shader program from their sources (modified sources are reloaded automatically)\n"
     "      [F4]  Pause/Stop the animation\n"
     "      [F5]  Reset the animation\n"
+    "  [pageup]  Move the animation 5 seconds forward\n"
+    "[pagedown]  Move the animation 5 seconds backward\n"
+    "    [.][,]  Stop the animation and move it one frame forward / backward\n"
+    "[backspace]  Play the animation backward / forward\n"
+    "      [F6]  Enable/Disable the occlusion culling\n"
+    "      [F7]  Show/Hide the bounds of the renderables rejected by the occlusion culling\n"
+    "      [F9]  Enable/Disable the deferred shading\n"
+    "     [F10]  Enable/Disable the depth pre-pass\n"
+    "     [F11]  Cycle the GPU profiler: disabled / passes / passes and renderables\n"
+    "     [F12]  Print the last GPU profile and save the history in gpu_profile.csv and gpu_profile.json\n"
+    "  [lclick]  Print the name of the renderable under the mouse cursor\n"
     "       [c]  Switch the camera mode between First Person / Arcball / Trackball / Space ship\n"
     "[ctrl]+[w]  Quit the application\n"
     "\n"
@@ -169,7 +200,16 @@ constexpr const char* g_help_message =
 
 void Viewer::draw()
 {
+	updateShaderPrograms();
+
+	m_fpsCounter.getFPS();
+	m_profiler.beginFrame();
+
 	glcheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+	// Update the transforms of all the hierarchies in one pass
+	m_transformStore->update();
+
 	float time = getTime();
 	for (const ShaderProgramPtr& prog : m_programs)
 	{
@@ -188,8 +228,49 @@ void Viewer::draw()
 	std::vector<RenderablePtr> opaque_renderables;
 	std::vector<RenderablePtr> transparent_renderables;
 
-	for (const RenderablePtr &r : m_renderables)
+	// Refit the hierarchy of bounds with the moved objects, the inactive ones left it when they stopped
+	validateScene();
+	updateTimeline(time);
+	refitBounds();
+	m_cullingStats.tested = m_frustumCulling || m_occlusionCulling ? m_cullableCount : 0;
+	m_cullingStats.culled = 0;
+	m_cullingStats.occluded = 0;
+
+	// Skip the objects outside the view of the camera, before sending anything for them:
+	// the query gives the visible cullable roots, the others are always drawn
+	std::vector<RootState*> visible_roots;
+	if (m_frustumCulling)
+	{
+		std::vector<RenderablePtr> visible;
+		m_bvh.query(Frustum(m_camera.projectionMatrix() * m_camera.viewMatrix()), visible);
+		for (const RenderablePtr& r : visible)
+		{
+			std::unordered_map<Renderable*, RootState>::iterator root = m_roots.find(r.get());
+			if (root != m_roots.end() && root->second.cullable)
+				visible_roots.push_back(&root->second);
+		}
+		m_cullingStats.culled = m_cullableCount - visible_roots.size();
+		visible_roots.insert(visible_roots.end(), m_uncullableRoots.begin(), m_uncullableRoots.end());
+		std::sort(visible_roots.begin(), visible_roots.end(), [](const RootState* a, const RootState* b) { return a->order < b->order; });
+	}
+	const std::vector<RootState*>& drawn_roots = m_frustumCulling ? visible_roots : m_activeRoots;
+
+	// Skip the objects hidden by the opaque objects of the previous frames
+	std::vector<BoundingBox> occluded_bounds;
+	if (m_occlusionCulling && m_occlusionCuller)
+		m_occlusionCuller->update();
+
+	for (const RootState* root : drawn_roots)
 	{
+		const RenderablePtr& r = root->renderable;
+		if (m_occlusionCulling && m_occlusionCuller && root->cullable && m_occlusionCuller->isOccluded(r->getWorldBounds()))
+		{
+			++m_cullingStats.occluded;
+			if (m_occlusionDebug)
+				occluded_bounds.push_back(r->getWorldBounds());
+			continue;
+		}
+
 		LightedMeshRenderablePtr lm = std::dynamic_pointer_cast<LightedMeshRenderable>(r);
 		if (lm != nullptr && lm->getMaterial()->alpha() < 1.0f)
 		{
@@ -201,13 +282,42 @@ void Viewer::draw()
 		}
 	}
 	
+	// The deferred renderer draws the opaque objects it can, and gives back the others
+	if (m_deferredShading && m_deferredRenderer)
+	{
+		std::vector<RenderablePtr> forward_renderables;
+		sf::Vector2u size = m_window.getSize();
+		m_profiler.begin("deferred shading");
+		m_deferredRenderer->draw(opaque_renderables, forward_renderables, m_camera.projectionMatrix(), m_camera.viewMatrix(), size.x, size.y);
+		m_profiler.end();
+		opaque_renderables.swap(forward_renderables);
+	}
+
+	// The depth pre-pass fills the depth buffer with the opaque objects it can
+	std::unordered_set<RenderablePtr> prepassed_renderables;
+	if (m_depthPrepassEnabled && m_depthPrepass)
+	{
+		std::vector<RenderablePtr> prepassed;
+		m_profiler.begin("depth pre-pass");
+		m_depthPrepass->draw(opaque_renderables, prepassed, m_camera.projectionMatrix(), m_camera.viewMatrix());
+		m_profiler.end();
+		prepassed_renderables.insert(prepassed.begin(), prepassed.end());
+	}
+
 	// We draw the opaque objects first so that they can always appear behind the transparent ones
 	std::vector<RenderablePtr> sorted_renderables;
 	sorted_renderables.insert(sorted_renderables.end(), opaque_renderables.begin(), opaque_renderables.end());
 	sorted_renderables.insert(sorted_renderables.end(), transparent_renderables.begin(), transparent_renderables.end());
 
-	for (const RenderablePtr& r : sorted_renderables)
+	m_profiler.begin("forward");
+	bool time_renderables = m_profiler.isRenderableTimingEnabled();
+	for (size_t i = 0; i < sorted_renderables.size(); ++i)
 	{
+		// The transparent objects do not hide what is behind them
+		if (i == opaque_renderables.size())
+			captureOccluders();
+
+		const RenderablePtr& r = sorted_renderables[i];
 		if (r->getShaderProgram())
 		{
 			r->bindShaderProgram();
@@ -229,9 +339,26 @@ void Viewer::draw()
 				glUniform1i(texsamplerLocation, 0);
 			}
 		}
+		// Pre-passed objects only shade the fragments that passed the pre-pass
+		bool prepassed = prepassed_renderables.count(r) != 0;
+		if (prepassed)
+		{
+			glcheck(glDepthFunc(m_depthPrepassEqual ? GL_EQUAL : GL_LEQUAL));
+			glcheck(glDepthMask(GL_FALSE));
+		}
 		if (r->getRenderMode() <= Renderable::RENDER_MODE::WINDOW_TEXTURE)
 		{
+			// Only the window draws are timed, the render texture has its own context
+			if (time_renderables)
+				m_profiler.begin(r->getName().empty() ? "unnamed" : r->getName());
 			r->draw();
+			if (time_renderables)
+				m_profiler.end();
+		}
+		if (prepassed)
+		{
+			glcheck(glDepthFunc(GL_LESS));
+			glcheck(glDepthMask(GL_TRUE));
 		}
 		if (r->getRenderMode() >= Renderable::RENDER_MODE::WINDOW_TEXTURE)
 		{
@@ -247,6 +374,13 @@ void Viewer::draw()
 		}
 		r->unbindShaderProgram();
 	}
+	if (transparent_renderables.empty())
+		captureOccluders();
+	m_profiler.end();
+
+	if (m_occlusionDebug && m_occlusionCuller)
+		m_occlusionCuller->drawBoxes(occluded_bounds, m_camera.projectionMatrix() * m_camera.viewMatrix());
+	m_profiler.endFrame();
 
 	if (m_helpDisplayRequest && !m_helpDisplayed)
 	{
@@ -273,28 +407,94 @@ float Viewer::getTime()
 {
 	if (m_animationIsStarted)
 	{
-		m_simulationTime += Duration(clock::now() - m_lastSimulationTimePoint).count();
+		float elapsed = Duration(clock::now() - m_lastSimulationTimePoint).count();
+		m_simulationTime += m_reverse ? -elapsed : elapsed;
 		m_lastSimulationTimePoint = clock::now();
 	}
 	if (m_animationLoop && m_simulationTime >= m_loopDuration)
 		m_simulationTime = std::fmod(m_simulationTime, m_loopDuration);
+	// Backward, the animation wraps to the end of the loop or stops at the beginning
+	if (m_simulationTime < 0)
+		m_simulationTime = m_animationLoop && m_loopDuration > 0 ? m_loopDuration + std::fmod(m_simulationTime, m_loopDuration) : 0;
 	return m_simulationTime * m_timeFactor;
 }
 
 void Viewer::animate()
 {
-	if (m_animationIsStarted)
+	if (m_animationIsStarted || m_seekPending)
 	{
-		for (const RenderablePtr& r : m_renderables)
-			r->animate(getTime());
+		// The same time for everything animated in this frame
+		float time = getTime();
+		m_seekPending = false;
+		validateScene();
+		updateTimeline(time);
+
+		// Select the renderables which may have changed since the last frame: the time
+		// elapsed since then overlaps their animation range. The static renderables
+		// leave the list after their first placement.
+		m_animatedNodes.clear();
+		m_keyframedNodes.clear();
+		size_t kept = 0;
+		for (size_t i = 0; i < m_activeAnimations.size(); ++i)
+		{
+			AnimatedRenderable& a = m_animations[m_activeAnimations[i]];
+			bool before = a.lastTime <= a.begin && time <= a.begin;
+			bool after = a.lastTime >= a.end && time >= a.end;
+			if (!a.placed || !(before || after))
+			{
+				m_animatedNodes.push_back(a.renderable.get());
+				if (a.keyframed)
+					m_keyframedNodes.push_back(a.keyframed);
+			}
+			a.placed = true;
+			a.lastTime = time;
+			if (a.animated)
+				m_activeAnimations[kept++] = m_activeAnimations[i];
+		}
+		m_activeAnimations.resize(kept);
+
+		// Evaluate: sample the keyframes of the animated nodes in parallel, this only writes to each node and its slots
+		for (const DirectionalLightPtr& dl : m_directionalLights)
+			m_keyframedNodes.push_back(dl.get());
+		for (const PointLightPtr& pl : m_pointLights)
+			m_keyframedNodes.push_back(pl.get());
+		for (const SpotLightPtr& sl : m_spotLights)
+			m_keyframedNodes.push_back(sl.get());
+		m_keyframedNodes.push_back(&m_camera);
+
+		// Each node has a slot per animated transformation in the batch, which
+		// composes all the matrices at once with SIMD kernels
+		long count = m_keyframedNodes.size();
+		m_trackOffsets.resize(count);
+		size_t tracks = 0;
+		for (long i = 0; i < count; ++i)
+		{
+			m_trackOffsets[i] = tracks;
+			tracks += m_keyframedNodes[i]->getTrackCount();
+		}
+		m_animationBatch.resize(tracks);
+#pragma omp parallel for if (count > parallel_animation_size)
+		for (long i = 0; i < count; ++i)
+			m_keyframedNodes[i]->sampleTracks(time, m_animationBatch, m_trackOffsets[i]);
+		m_animationBatch.compose(m_trackMatrices);
+#pragma omp parallel for if (count > parallel_animation_size)
+		for (long i = 0; i < count; ++i)
+			m_keyframedNodes[i]->setSampledTracks(time, m_trackMatrices.data() + m_trackOffsets[i]);
+
+		// Animate in order, parents first: apply the samples and run the other animations, which may touch OpenGL
+		for (Renderable* r : m_animatedNodes)
+			r->animateNode(time);
 		for (const DirectionalLightPtr& dl : m_directionalLights)
-			dl->animate(getTime());
+			dl->animate(time);
 		for (const PointLightPtr& pl : m_pointLights)
-			pl->animate(getTime());
+			pl->animate(time);
 		for (const SpotLightPtr& sl : m_spotLights)
-			sl->animate(getTime());
+			sl->animate(time);
 
-		m_camera.animate(getTime());
+		m_camera.animate(time);
+
+		// Propagate: update the transforms of the hierarchies in one pass
+		m_transformStore->update();
 	}
 }
 
@@ -304,6 +504,47 @@ void Viewer::setAnimationLoop(bool animationLoop, float loopDuration)
 	m_loopDuration = loopDuration;
 }
 
+void Viewer::seek(float time)
+{
+	m_simulationTime = std::max(0.0f, time / m_timeFactor);
+	if (m_animationLoop && m_loopDuration > 0 && m_simulationTime >= m_loopDuration)
+		m_simulationTime = std::fmod(m_simulationTime, m_loopDuration);
+	m_lastSimulationTimePoint = clock::now();
+	m_seekPending = true;
+	if (!soundtrack_path.empty())
+	{
+		std::system("pkill -f 'aplay'");
+	}
+}
+
+void Viewer::stepFrames(int frames)
+{
+	if (m_animationIsStarted)
+		stopAnimation();
+	seek(getTime() + frames * m_frameDuration);
+}
+
+void Viewer::setFrameDuration(float seconds)
+{
+	m_frameDuration = seconds;
+}
+
+void Viewer::setReverse(bool reverse)
+{
+	// The time played so far is counted in the previous direction
+	getTime();
+	m_reverse = reverse;
+	if (reverse && !soundtrack_path.empty())
+	{
+		std::system("pkill -f 'aplay'");
+	}
+}
+
+bool Viewer::isReversed() const
+{
+	return m_reverse;
+}
+
 void Viewer::setSoundtrack(const std::string& path)
 {
 	soundtrack_path = path;
@@ -328,7 +569,8 @@ void Viewer::startAnimation()
 {
 	m_lastSimulationTimePoint = clock::now();
 	m_animationIsStarted = true;
-	if (!soundtrack_path.empty()) {
+	// The soundtrack can only be played from the beginning
+	if (!soundtrack_path.empty() && m_simulationTime == 0 && !m_reverse) {
 		std::string cmd = "aplay \"" + soundtrack_path + "\" &";
 		std::system(cmd.c_str());
 	}
@@ -347,7 +589,8 @@ void Viewer::resetAnimation()
 {
 	m_lastSimulationTimePoint = clock::now();
 	m_simulationTime = 0;
-	if (!soundtrack_path.empty())
+	m_seekPending = true;
+	if (!soundtrack_path.empty() && m_animationIsStarted && !m_reverse)
 	{
 		std::system("pkill -f 'aplay'");
 		std::string cmd = "aplay \"" + soundtrack_path + "\" &";
@@ -358,7 +601,13 @@ void Viewer::resetAnimation()
 void Viewer::addRenderable(const RenderablePtr& r)
 {
 	r->m_viewer = this;
-	m_renderables.insert(r);
+	m_scene.addRoot(r);
+	m_animationRevision = 0;
+	m_timelineRevision = 0;
+
+	HierarchicalRenderablePtr hierarchical = std::dynamic_pointer_cast<HierarchicalRenderable>(r);
+	if (hierarchical)
+		hierarchical->setTransformStore(m_transformStore);
 }
 
 void Viewer::keyPressedEvent(sf::Event& e)
@@ -369,7 +618,25 @@ void Viewer::keyPressedEvent(sf::Event& e)
 		changeCameraMode();
 		break;
 	case sf::Keyboard::R:
-		m_renderables.clear();
+		for (const RenderablePtr& r : m_scene.getRoots())
+		{
+			HierarchicalRenderablePtr hierarchical = std::dynamic_pointer_cast<HierarchicalRenderable>(r);
+			if (hierarchical)
+				hierarchical->setTransformStore(nullptr);
+		}
+		m_scene.clear();
+		m_bvh.clear();
+		m_animations.clear();
+		m_activeAnimations.clear();
+		m_animationIndices.clear();
+		m_roots.clear();
+		m_activeRoots.clear();
+		m_dirtyRoots.clear();
+		m_uncullableRoots.clear();
+		m_cullableCount = 0;
+		m_animationRevision = 0;
+		m_timeline.clear();
+		m_timelineRevision = 0;
 		LOG(info, "Renderables cleared.")
 		break;
 	case sf::Keyboard::F1:
@@ -380,7 +647,7 @@ void Viewer::keyPressedEvent(sf::Event& e)
 		break;
 	case sf::Keyboard::F3:
 		reloadShaderPrograms();
-		LOG(info, "Shaders reloaded.")
+		LOG(info, "Reloading shaders...")
 		break;
 	case sf::Keyboard::F4:
 		if (m_animationIsStarted)
@@ -396,10 +663,65 @@ void Viewer::keyPressedEvent(sf::Event& e)
 		break;
 	case sf::Keyboard::F5:
 		resetAnimation();
-		for (const RenderablePtr& r : m_renderables)
-			r->keyPressedEvent(e);
+		m_scene.forEachNode([&e](const RenderablePtr& r) { r->keyPressedEvent(e); });
 		LOG(info, "Animation reset.")
 		break;
+	case sf::Keyboard::PageUp:
+		seek(getTime() + 5.0f);
+		LOG(info, "Animation time = " << getTime());
+		break;
+	case sf::Keyboard::PageDown:
+		seek(getTime() - 5.0f);
+		LOG(info, "Animation time = " << getTime());
+		break;
+	case sf::Keyboard::Period:
+		stepFrames(1);
+		LOG(info, "Animation time = " << getTime());
+		break;
+	case sf::Keyboard::Comma:
+		stepFrames(-1);
+		LOG(info, "Animation time = " << getTime());
+		break;
+	case sf::Keyboard::Backspace:
+		setReverse(!m_reverse);
+		LOG(info, "Animation played " << (m_reverse ? "backward." : "forward."))
+		break;
+	case sf::Keyboard::F9:
+		setDeferredShading(!m_deferredShading);
+		LOG(info, "Deferred shading " << (m_deferredShading ? "enabled." : "disabled."))
+		break;
+	case sf::Keyboard::F6:
+		setOcclusionCulling(!m_occlusionCulling);
+		LOG(info, "Occlusion culling " << (m_occlusionCulling ? "enabled." : "disabled."))
+		break;
+	case sf::Keyboard::F7:
+		setOcclusionDebug(!m_occlusionDebug);
+		LOG(info, "Occluded bounds " << (m_occlusionDebug ? "shown." : "hidden."))
+		break;
+	case sf::Keyboard::F10:
+		setDepthPrepass(!m_depthPrepassEnabled, m_depthPrepassEqual);
+		LOG(info, "Depth pre-pass " << (m_depthPrepassEnabled ? "enabled." : "disabled."))
+		break;
+	case sf::Keyboard::F11:
+		// Cycle between disabled, passes only, and passes with renderables
+		if (!m_profiler.isEnabled())
+		{
+			m_profiler.setEnabled(true);
+			m_profiler.setRenderableTiming(false);
+		}
+		else if (!m_profiler.isRenderableTimingEnabled())
+		{
+			m_profiler.setRenderableTiming(true);
+		}
+		else
+		{
+			m_profiler.setEnabled(false);
+		}
+		LOG(info, "GPU profiler " << (!m_profiler.isEnabled() ? "disabled." : (m_profiler.isRenderableTimingEnabled() ? "timing passes and renderables." : "timing passes.")))
+		break;
+	case sf::Keyboard::F12:
+		dumpProfile();
+		break;
 	case sf::Keyboard::W:
 		if (e.key.control)
 			m_applicationRunning = false;
@@ -458,8 +780,7 @@ void Viewer::keyPressedEvent(sf::Event& e)
 	default:
 		break;
 	}
-	for (const RenderablePtr& r : m_renderables)
-		r->keyPressedEvent(e);
+	m_scene.forEachNode([&e](const RenderablePtr& r) { r->keyPressedEvent(e); });
 }
 
 void Viewer::keyReleasedEvent(sf::Event& e)
@@ -512,8 +833,7 @@ void Viewer::keyReleasedEvent(sf::Event& e)
 	default:
 		break;
 	}
-	for (const RenderablePtr& r : m_renderables)
-		r->keyReleasedEvent(e);
+	m_scene.forEachNode([&e](const RenderablePtr& r) { r->keyReleasedEvent(e); });
 }
 
 void Viewer::mousePressEvent(sf::Event& e)
@@ -523,15 +843,21 @@ void Viewer::mousePressEvent(sf::Event& e)
 	pos.x = 2.0f * pos_pix.x / (float)m_window.getSize().x - 1.0f;
 	pos.y = 2.0f * pos_pix.y / (float)m_window.getSize().y - 1.0f;
 	m_camera.mousePress(pos);
-	for (const RenderablePtr& r : m_renderables)
-		r->mousePressEvent(e);
+	if (e.mouseButton.button == sf::Mouse::Left)
+	{
+		RenderablePtr picked = pick(pos_pix.x, pos_pix.y);
+		if (picked)
+		{
+			LOG(info, "Picked " << (picked->getName().empty() ? "an unnamed renderable" : picked->getName()) << ".")
+		}
+	}
+	m_scene.forEachNode([&e](const RenderablePtr& r) { r->mousePressEvent(e); });
 }
 
 void Viewer::mouseReleaseEvent(sf::Event& e)
 {
 	m_camera.mouseRelease();
-	for (const RenderablePtr& r : m_renderables)
-		r->mouseReleaseEvent(e);
+	m_scene.forEachNode([&e](const RenderablePtr& r) { r->mouseReleaseEvent(e); });
 }
 
 void Viewer::mouseWheelEvent(sf::Event& e)
@@ -547,8 +873,7 @@ void Viewer::mouseWheelEvent(sf::Event& e)
 		m_camera.updateModelMatrix();
 	}
 	// Solve mouse wheel event for the renderables of the viewer
-	for (const RenderablePtr& r : m_renderables)
-		r->mouseWheelEvent(e);
+	m_scene.forEachNode([&e](const RenderablePtr& r) { r->mouseWheelEvent(e); });
 }
 
 void Viewer::mouseMoveEvent(sf::Event& e)
@@ -571,8 +896,7 @@ void Viewer::mouseMoveEvent(sf::Event& e)
 	// Set last mouse position.
 	m_lastMousePosition = m_currentMousePosition;
 
-	for (const RenderablePtr& r : m_renderables)
-		r->mouseMoveEvent(e);
+	m_scene.forEachNode([&e](const RenderablePtr& r) { r->mouseMoveEvent(e); });
 }
 
 void Viewer::handleEvent()
@@ -699,13 +1023,32 @@ void Viewer::display()
 
 void Viewer::addShaderProgram(const ShaderProgramPtr& program)
 {
-	m_programs.insert(program);
+	if (m_programs.insert(program).second)
+		m_shaderWatcher.watch(program);
 }
 
 void Viewer::reloadShaderPrograms()
 {
 	for (const ShaderProgramPtr& program : m_programs)
-		program->reload();
+		program->reloadAsync();
+}
+
+void Viewer::updateShaderPrograms()
+{
+	std::vector<ShaderProgramPtr> modified;
+	m_shaderWatcher.poll(modified);
+	for (const ShaderProgramPtr& program : modified)
+	{
+		LOG(info, "Sources of ShaderProgram " << program.get() << " changed, reloading it...");
+		program->reloadAsync();
+	}
+
+	for (const ShaderProgramPtr& program : m_programs)
+	{
+		// a reload may change the included files
+		if (program->pollReload())
+			m_shaderWatcher.watch(program);
+	}
 }
 
 Camera& Viewer::getCamera()
@@ -725,6 +1068,22 @@ glm::vec3 Viewer::worldToWindow(const glm::vec3& worldCoordinate)
 	return glm::project(worldCoordinate, m_camera.viewMatrix(), m_camera.projectionMatrix(), glm::vec4(0, 0, size.x, size.y));
 }
 
+RenderablePtr Viewer::pick(int x, int y)
+{
+	// The window coordinates of OpenGL start from the bottom
+	sf::Vector2u size = m_window.getSize();
+	glm::vec3 nearPoint = windowToWorld(glm::vec3(x, size.y - y, 0.0f));
+	glm::vec3 farPoint = windowToWorld(glm::vec3(x, size.y - y, 1.0f));
+	float distance;
+	return m_bvh.raycast(nearPoint, farPoint - nearPoint, distance);
+}
+
+void Viewer::queryRadius(const glm::vec3& center, float radius, std::vector<RenderablePtr>& result)
+{
+	result.clear();
+	m_bvh.query(center, radius, result);
+}
+
 void Viewer::setBackgroundColor(const glm::vec4& color)
 {
 	m_background_color = color;
@@ -744,8 +1103,390 @@ const glm::vec4& Viewer::getBackgroundColor() const
 	return m_background_color;
 }
 
+const DeferredRendererPtr& Viewer::deferredRenderer()
+{
+	if (!m_deferredRenderer)
+	{
+		m_deferredRenderer = std::make_shared<DeferredRenderer>();
+		for (const ShaderProgramPtr& program : m_deferredRenderer->getShaderPrograms())
+			addShaderProgram(program);
+	}
+	return m_deferredRenderer;
+}
+
+void Viewer::setDeferredShading(bool enabled)
+{
+	if (enabled)
+		deferredRenderer();
+	m_deferredShading = enabled;
+}
+
+bool Viewer::isDeferredShadingEnabled() const
+{
+	return m_deferredShading;
+}
+
+void Viewer::addDeferredShaderProgram(const ShaderProgramPtr& forwardProgram, DeferredRenderer::SHADING_MODEL model)
+{
+	deferredRenderer()->addShaderProgram(forwardProgram, model);
+}
+
+const DepthPrepassPtr& Viewer::depthPrepass()
+{
+	if (!m_depthPrepass)
+		m_depthPrepass = std::make_shared<DepthPrepass>();
+	return m_depthPrepass;
+}
+
+void Viewer::setDepthPrepass(bool enabled, bool equalDepthTest)
+{
+	if (enabled)
+		depthPrepass();
+	m_depthPrepassEnabled = enabled;
+	m_depthPrepassEqual = equalDepthTest;
+}
+
+bool Viewer::isDepthPrepassEnabled() const
+{
+	return m_depthPrepassEnabled;
+}
+
+void Viewer::addDepthPrepassShaderProgram(const ShaderProgramPtr& forwardProgram, float alphaCutoff)
+{
+	depthPrepass()->addShaderProgram(forwardProgram, alphaCutoff);
+	// an alpha cutoff may need a new program
+	for (const ShaderProgramPtr& program : m_depthPrepass->getShaderPrograms())
+		addShaderProgram(program);
+}
+
 // void Viewer::displayText(std::string text, Viewer::Duration duration)
 //{
 // m_modeInformationText = text;
 // m_modeInformationTextDisappearanceTime = clock::now() + duration;
 //}
+
+GPUProfiler& Viewer::getProfiler()
+{
+	return m_profiler;
+}
+
+AssetResidency& Viewer::getAssetResidency()
+{
+	return m_residency;
+}
+
+sf::Vector2u Viewer::getWindowSize() const
+{
+	return m_window.getSize();
+}
+
+void Viewer::dumpProfile()
+{
+	const GPUProfiler::FrameResult* frame = m_profiler.lastFrame();
+	if (!frame)
+	{
+		LOG(info, "No GPU profile available, enable the profiler with [F11].")
+		return;
+	}
+
+	std::ostringstream ss;
+	ss << "GPU profile of frame " << frame->frame << " (" << std::setprecision(2) << std::fixed << m_fpsCounter.getFPS()
+	   << " FPS, " << frame->cpuDuration << " ms on CPU, " << m_profiler.droppedFrames() << " dropped frames):\n";
+	ss << "  " << m_cullingStats.culled << " of " << m_cullingStats.tested << " renderables culled, "
+	   << m_cullingStats.occluded << " occluded\n";
+	ss << std::setprecision(3);
+	for (const GPUProfiler::Timing& timing : frame->timings)
+		ss << std::string(2 * (timing.depth + 1), ' ') << timing.name << ": " << timing.duration << " ms\n";
+	LOG(info, ss.str())
+
+	if (m_profiler.dumpCSV(profile_basename + ".csv") && m_profiler.dumpJSON(profile_basename + ".json"))
+	{
+		LOG(info, "GPU profile history saved in " << profile_basename << ".csv and " << profile_basename << ".json")
+	}
+}
+
+void Viewer::setFrustumCulling(bool enabled)
+{
+	m_frustumCulling = enabled;
+}
+
+bool Viewer::isFrustumCullingEnabled() const
+{
+	return m_frustumCulling;
+}
+
+const Viewer::CullingStats& Viewer::getCullingStats() const
+{
+	return m_cullingStats;
+}
+
+const OcclusionCullerPtr& Viewer::occlusionCuller()
+{
+	if (!m_occlusionCuller)
+	{
+		m_occlusionCuller = std::make_shared<OcclusionCuller>();
+		for (const ShaderProgramPtr& program : m_occlusionCuller->getShaderPrograms())
+			addShaderProgram(program);
+	}
+	return m_occlusionCuller;
+}
+
+void Viewer::captureOccluders()
+{
+	if (!m_occlusionCulling || !m_occlusionCuller)
+		return;
+	sf::Vector2u size = m_window.getSize();
+	m_profiler.begin("hi-z");
+	m_occlusionCuller->capture(size.x, size.y, m_camera.projectionMatrix() * m_camera.viewMatrix());
+	m_profiler.end();
+}
+
+void Viewer::setOcclusionCulling(bool enabled)
+{
+	// The depth captured before the culling was disabled may be outdated
+	if (enabled && !m_occlusionCulling)
+		occlusionCuller()->reset();
+	m_occlusionCulling = enabled;
+}
+
+bool Viewer::isOcclusionCullingEnabled() const
+{
+	return m_occlusionCulling;
+}
+
+void Viewer::setOcclusionDebug(bool enabled)
+{
+	if (enabled)
+		occlusionCuller();
+	m_occlusionDebug = enabled;
+}
+
+bool Viewer::isOcclusionDebugEnabled() const
+{
+	return m_occlusionDebug;
+}
+
+void Viewer::validateScene()
+{
+	std::vector<RenderablePtr> demoted;
+	if (m_scene.validate(demoted))
+	{
+		for (const RenderablePtr& r : demoted)
+			m_bvh.remove(r);
+		m_animationRevision = 0;
+		m_timelineRevision = 0;
+	}
+}
+
+void Viewer::updateAnimations()
+{
+	m_animations.clear();
+	m_animationIndices.clear();
+	m_activeAnimations.clear();
+
+	// The nodes are visited in depth first order: the open nodes are the ancestors of the next one
+	std::vector<size_t> open;
+	m_scene.forEachNode([this, &open](const RenderablePtr& r) {
+		HierarchicalRenderable* hierarchical = dynamic_cast<HierarchicalRenderable*>(r.get());
+		Renderable* parent = hierarchical && hierarchical->getParent() ? hierarchical->getParent().get() : nullptr;
+		while (!open.empty() && m_animations[open.back()].renderable.get() != parent)
+		{
+			m_animations[open.back()].subtreeEnd = m_animations.size();
+			open.pop_back();
+		}
+
+		AnimatedRenderable a;
+		a.renderable = r;
+		a.keyframed = dynamic_cast<KeyframedHierarchicalRenderable*>(r.get());
+		a.parent = open.empty() ? m_animations.size() : open.back();
+		a.root = open.empty() ? r.get() : m_animations[open.front()].renderable.get();
+		a.subtreeEnd = m_animations.size() + 1;
+		a.animated = r->getAnimationRange(a.begin, a.end);
+		a.placed = false;
+		a.lastTime = 0;
+
+		// Active in its hierarchy if it and its parent are
+		if (r->isActive() && (open.empty() || std::binary_search(m_activeAnimations.begin(), m_activeAnimations.end(), open.back())))
+			m_activeAnimations.push_back(m_animations.size());
+		m_animationIndices[r.get()] = m_animations.size();
+		open.push_back(m_animations.size());
+		m_animations.push_back(a);
+	});
+	for (size_t node : open)
+		m_animations[node].subtreeEnd = m_animations.size();
+	m_animationRevision = Renderable::getAnimationRevision();
+}
+
+void Viewer::updateRoots()
+{
+	m_roots.clear();
+	m_activeRoots.clear();
+	m_dirtyRoots.clear();
+	m_uncullableRoots.clear();
+	m_cullableCount = 0;
+	m_bvh.clear();
+	size_t order = 0;
+	for (const RenderablePtr& r : m_scene.getRoots())
+	{
+		RootState& root = m_roots[r.get()];
+		root.renderable = r;
+		root.order = order++;
+		root.active = false;
+		root.dirty = false;
+		root.cullable = false;
+		setRootActive(root, r->isActive());
+	}
+}
+
+void Viewer::updateActiveAnimations(size_t node)
+{
+	// The subtree is a range of the nodes in depth first order, and of the sorted active list
+	size_t end = m_animations[node].subtreeEnd;
+	std::vector<size_t>::iterator first = std::lower_bound(m_activeAnimations.begin(), m_activeAnimations.end(), node);
+	std::vector<size_t>::iterator last = std::lower_bound(first, m_activeAnimations.end(), end);
+	first = m_activeAnimations.erase(first, last);
+
+	for (size_t n = node; ; n = m_animations[n].parent)
+	{
+		if (!m_animations[n].renderable->isActive())
+			return;
+		if (m_animations[n].parent == n)
+			break;
+	}
+
+	// The inactive descendants are skipped with their subtree, the static ones once placed
+	std::vector<size_t> active;
+	for (size_t n = node; n < end;)
+	{
+		const AnimatedRenderable& a = m_animations[n];
+		if (!a.renderable->isActive())
+		{
+			n = a.subtreeEnd;
+			continue;
+		}
+		if (a.animated || !a.placed)
+			active.push_back(n);
+		++n;
+	}
+	m_activeAnimations.insert(first, active.begin(), active.end());
+}
+
+void Viewer::setRootActive(RootState& root, bool active)
+{
+	if (root.active == active)
+		return;
+	root.active = active;
+	std::vector<RootState*>::iterator position = std::lower_bound(m_activeRoots.begin(), m_activeRoots.end(), &root,
+	                                                              [](const RootState* a, const RootState* b) { return a->order < b->order; });
+	std::vector<RootState*>::iterator uncullable = std::lower_bound(m_uncullableRoots.begin(), m_uncullableRoots.end(), &root,
+	                                                                [](const RootState* a, const RootState* b) { return a->order < b->order; });
+	if (active)
+	{
+		// Drawn without culling until its bounds are refitted
+		m_activeRoots.insert(position, &root);
+		m_uncullableRoots.insert(uncullable, &root);
+		root.cullable = false;
+		if (!root.dirty)
+		{
+			root.dirty = true;
+			m_dirtyRoots.push_back(&root);
+		}
+	}
+	else
+	{
+		m_activeRoots.erase(position);
+		if (root.cullable)
+			--m_cullableCount;
+		else
+			m_uncullableRoots.erase(uncullable);
+		root.cullable = false;
+		m_bvh.remove(root.renderable);
+	}
+}
+
+void Viewer::invalidateBounds(Renderable* root)
+{
+	std::unordered_map<Renderable*, RootState>::iterator state = m_roots.find(root);
+	if (state == m_roots.end() || !state->second.active || state->second.dirty)
+		return;
+	state->second.dirty = true;
+	m_dirtyRoots.push_back(&state->second);
+}
+
+void Viewer::refitBounds()
+{
+	for (RootState* root : m_dirtyRoots)
+	{
+		// The roots which stopped since they moved left the hierarchy
+		root->dirty = false;
+		if (!root->active)
+			continue;
+		const BoundingBox& bounds = root->renderable->updateWorldBounds();
+		m_bvh.update(root->renderable, bounds);
+
+		// Only the renderables drawn in the window with known bounds are culled
+		bool cullable = root->renderable->getRenderMode() == Renderable::WINDOW && bounds.isValid();
+		if (cullable == root->cullable)
+			continue;
+		root->cullable = cullable;
+		std::vector<RootState*>::iterator position = std::lower_bound(m_uncullableRoots.begin(), m_uncullableRoots.end(), root,
+		                                                              [](const RootState* a, const RootState* b) { return a->order < b->order; });
+		if (cullable)
+		{
+			m_uncullableRoots.erase(position);
+			++m_cullableCount;
+		}
+		else
+		{
+			m_uncullableRoots.insert(position, root);
+			--m_cullableCount;
+		}
+	}
+	m_dirtyRoots.clear();
+}
+
+void Viewer::updateTimeline(float time)
+{
+	if (m_timelineRevision != Renderable::getAnimationRevision())
+	{
+		// The renderables with intervals are inactive until the index reaches them
+		std::vector<RenderablePtr> timed;
+		m_scene.forEachNode([&timed](const RenderablePtr& r) {
+			r->m_active = r->getActiveIntervals().empty();
+			if (!r->m_active)
+				timed.push_back(r);
+		});
+		m_timeline.build(timed);
+		m_timelineRevision = Renderable::getAnimationRevision();
+	}
+
+	m_activityChanges.clear();
+	m_timeline.update(time, m_activityChanges);
+	for (const std::pair<Renderable*, bool>& change : m_activityChanges)
+		change.first->m_active = change.second;
+
+	if (m_animationRevision != Renderable::getAnimationRevision())
+	{
+		updateAnimations();
+		updateRoots();
+	}
+	else
+	{
+		// A renderable may change several times after a seek: its final activity is used each time
+		for (const std::pair<Renderable*, bool>& change : m_activityChanges)
+		{
+			std::unordered_map<Renderable*, size_t>::iterator node = m_animationIndices.find(change.first);
+			if (node == m_animationIndices.end())
+				continue;
+			updateActiveAnimations(node->second);
+			std::unordered_map<Renderable*, RootState>::iterator root = m_roots.find(change.first);
+			if (root != m_roots.end())
+				setRootActive(root->second, change.first->isActive());
+			else
+				invalidateBounds(m_animations[node->second].root);
+		}
+	}
+
+	// The meshes which become active are loaded before they are animated or drawn
+	m_residency.update(time);
+}
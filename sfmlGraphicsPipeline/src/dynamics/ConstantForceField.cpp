@@ -6,12 +6,12 @@ ConstantForceField::ConstantForceField(const std::vector<ParticlePtr>& particles
 	m_force = force;
 }
 
-void ConstantForceField::do_addForce()
+void ConstantForceField::do_addForce(ParticleStore& particles)
 {
-	for (ParticlePtr p : m_particles)
-	{
-		p->incrForce(m_force * p->getMass());
-	}
+	glm::vec3* forces = particles.forces();
+	const float* inverseMasses = particles.inverseMasses();
+	for (size_t i : indicesIn(particles, m_particles))
+		forces[i] += m_force / inverseMasses[i];
 }
 
 const std::vector<ParticlePtr> ConstantForceField::getParticles()
@@ -22,6 +22,7 @@ const std::vector<ParticlePtr> ConstantForceField::getParticles()
 void ConstantForceField::setParticles(const std::vector<ParticlePtr>& particles)
 {
 	m_particles = particles;
+	invalidateIndices();
 }
 
 const glm::vec3& ConstantForceField::getForce()
@@ -132,3 +132,9 @@ void ControlledForceFieldRenderable::do_animate(float time)
 	}
 	m_status.last_time = time;
 }
+
+bool ControlledForceFieldRenderable::getAnimationRange(float& begin, float& end) const
+{
+	// The force follows the user inputs at any time
+	return Renderable::getAnimationRange(begin, end);
+}
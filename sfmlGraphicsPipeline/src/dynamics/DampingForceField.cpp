@@ -6,12 +6,12 @@ DampingForceField::DampingForceField(const std::vector<ParticlePtr> particles, c
 	m_damping = damping;
 }
 
-void DampingForceField::do_addForce()
+void DampingForceField::do_addForce(ParticleStore& particles)
 {
-	for (ParticlePtr p : m_particles)
-	{
-		p->incrForce(-m_damping * p->getVelocity());
-	}
+	glm::vec3* forces = particles.forces();
+	const glm::vec3* velocities = particles.velocities();
+	for (size_t i : indicesIn(particles, m_particles))
+		forces[i] -= m_damping * velocities[i];
 }
 
 const std::vector<ParticlePtr> DampingForceField::getParticles()
@@ -22,6 +22,7 @@ const std::vector<ParticlePtr> DampingForceField::getParticles()
 void DampingForceField::setParticles(const std::vector<ParticlePtr>& particles)
 {
 	m_particles = particles;
+	invalidateIndices();
 }
 
 const float& DampingForceField::getDamping()
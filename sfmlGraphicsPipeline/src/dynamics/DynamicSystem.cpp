@@ -2,6 +2,7 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <cmath>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/norm.hpp>
@@ -11,9 +12,11 @@
 #include "../../include/gl_helper.hpp"
 #include "./../../include/dynamics/ParticleParticleCollision.hpp"
 
-DynamicSystem::DynamicSystem() : m_dt(0.1),
+DynamicSystem::DynamicSystem() : m_store(std::make_shared<ParticleStore>()),
+                                 m_dt(0.1),
                                  m_restitution(1.0),
-                                 m_handleCollisions(true)
+                                 m_handleCollisions(true),
+                                 m_broadphase(true)
 {
 }
 
@@ -26,7 +29,15 @@ const std::vector<ParticlePtr>& DynamicSystem::getParticles() const
 
 void DynamicSystem::setParticles(const std::vector<ParticlePtr>& particles)
 {
-	m_particles = particles;
+	m_store = std::make_shared<ParticleStore>();
+	m_particles.clear();
+	for (const ParticlePtr& p : particles)
+		addParticle(p);
+}
+
+const ParticleStorePtr& DynamicSystem::getParticleStore() const
+{
+	return m_store;
 }
 
 const std::vector<ForceFieldPtr>& DynamicSystem::getForceFields() const
@@ -54,6 +65,7 @@ DynamicSystem::~DynamicSystem() {}
 void DynamicSystem::clear()
 {
 	m_particles.clear();
+	m_store = std::make_shared<ParticleStore>();
 	m_forceFields.clear();
 	m_planeObstacles.clear();
 }
@@ -68,8 +80,21 @@ void DynamicSystem::setCollisionsDetection(bool onOff)
 	m_handleCollisions = onOff;
 }
 
+bool DynamicSystem::getBroadphase() const
+{
+	return m_broadphase;
+}
+
+void DynamicSystem::setBroadphase(bool onOff)
+{
+	m_broadphase = onOff;
+}
+
 void DynamicSystem::addParticle(ParticlePtr p)
 {
+	if (p->getStore() == m_store)
+		return;
+	p->moveTo(m_store);
 	m_particles.push_back(p);
 }
 
@@ -95,30 +120,37 @@ void DynamicSystem::setSolver(SolverPtr solver)
 
 void DynamicSystem::detectCollisions()
 {
+	size_t count = m_store->size();
+
 	// Detect particle plane collisions
-	for (ParticlePtr p : m_particles)
+	for (size_t i = 0; i < count; ++i)
 	{
-		for (PlanePtr o : m_planeObstacles)
+		for (size_t o = 0; o < m_planeObstacles.size(); ++o)
 		{
-			if (testParticlePlane(p, o))
-			{
-				ParticlePlaneCollisionPtr c = std::make_shared<ParticlePlaneCollision>(p, o, m_restitution);
-				m_collisions.push_back(c);
-			}
+			if (testParticlePlane(*m_store, i, *m_planeObstacles[o]))
+				m_planeCollisions.push_back(std::make_pair(i, o));
 		}
 	}
 
 	// Detect particle particle collisions
-	for (size_t i = 0; i < m_particles.size(); ++i)
+	if (m_broadphase)
 	{
-		for (size_t j = i; j < m_particles.size(); ++j)
+		m_grid.build(*m_store);
+		m_grid.findPairs(m_candidatePairs);
+		for (const std::pair<size_t, size_t>& pair : m_candidatePairs)
 		{
-			ParticlePtr p1 = m_particles[i];
-			ParticlePtr p2 = m_particles[j];
-			if (testParticleParticle(p1, p2))
+			if (testParticleParticle(*m_store, pair.first, pair.second))
+				m_particleCollisions.push_back(pair);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			for (size_t j = i + 1; j < count; ++j)
 			{
-				ParticleParticleCollisionPtr c = std::make_shared<ParticleParticleCollision>(p1, p2, m_restitution);
-				m_collisions.push_back(c);
+				if (testParticleParticle(*m_store, i, j))
+					m_particleCollisions.push_back(std::make_pair(i, j));
 			}
 		}
 	}
@@ -126,28 +158,30 @@ void DynamicSystem::detectCollisions()
 
 void DynamicSystem::solveCollisions()
 {
-	while (!m_collisions.empty())
+	// The last detected collisions are solved first
+	while (!m_particleCollisions.empty())
 	{
-		CollisionPtr collision = m_collisions.back();
-		collision->solveCollision();
-		m_collisions.pop_back();
+		solveParticleParticle(*m_store, m_particleCollisions.back().first, m_particleCollisions.back().second, m_restitution);
+		m_particleCollisions.pop_back();
+	}
+	while (!m_planeCollisions.empty())
+	{
+		solveParticlePlane(*m_store, m_planeCollisions.back().first, *m_planeObstacles[m_planeCollisions.back().second], m_restitution);
+		m_planeCollisions.pop_back();
 	}
 }
 
 void DynamicSystem::computeSimulationStep()
 {
 	// Compute particle's force
-	for (ParticlePtr p : m_particles)
-	{
-		p->setForce(glm::vec3(0.0, 0.0, 0.0));
-	}
+	m_store->clearForces();
 	for (ForceFieldPtr f : m_forceFields)
 	{
-		f->addForce();
+		f->addForce(*m_store);
 	}
 
 	// Integrate position and velocity of particles
-	m_solver->solve(m_dt, m_particles);
+	m_solver->solve(m_dt, *m_store);
 
 	// Detect and resolve collisions
 	if (m_handleCollisions)
@@ -157,6 +191,28 @@ void DynamicSystem::computeSimulationStep()
 	}
 }
 
+void DynamicSystem::saveState(State& state) const
+{
+	size_t count = m_store->size();
+	state.positions.assign(m_store->positions(), m_store->positions() + count);
+	state.velocities.assign(m_store->velocities(), m_store->velocities() + count);
+	state.forceFields.clear();
+	for (const ForceFieldPtr& f : m_forceFields)
+		f->saveState(state.forceFields);
+}
+
+bool DynamicSystem::restoreState(const State& state)
+{
+	if (state.positions.size() != m_store->size())
+		return false;
+	std::copy(state.positions.begin(), state.positions.end(), m_store->positions());
+	std::copy(state.velocities.begin(), state.velocities.end(), m_store->velocities());
+	size_t offset = 0;
+	for (const ForceFieldPtr& f : m_forceFields)
+		f->restoreState(state.forceFields, offset);
+	return true;
+}
+
 const float DynamicSystem::getRestitution()
 {
 	return m_restitution;
@@ -2,6 +2,7 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <cmath>
 #include <glm/gtc/random.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -10,12 +11,13 @@
 
 #include "../../include/Viewer.hpp"
 #include "../../include/gl_helper.hpp"
+#include "../../include/log.hpp"
 
 DynamicSystemRenderable::~DynamicSystemRenderable()
 {
 }
 
-DynamicSystemRenderable::DynamicSystemRenderable(DynamicSystemPtr system) : HierarchicalRenderable(nullptr), m_lastUpdateTime(0), m_startTime(0.0f)
+DynamicSystemRenderable::DynamicSystemRenderable(DynamicSystemPtr system) : HierarchicalRenderable(nullptr), m_step(0), m_startTime(0.0f), m_checkpointInterval(1.0f)
 {
 	m_system = system;
 }
@@ -24,28 +26,127 @@ void DynamicSystemRenderable::do_draw()
 {
 }
 
-void DynamicSystemRenderable::do_animate(float time)
+unsigned long DynamicSystemRenderable::step_count(float time) const
 {
+	// The first step is computed at the start time
 	if (time < m_startTime)
+		return 0;
+	return (unsigned long)(std::floor(double(time - m_startTime) / m_system->getDt())) + 1;
+}
+
+void DynamicSystemRenderable::compute_step()
+{
+	// The events since the previous step happen before this one
+	double dt = m_system->getDt();
+	double stepTime = m_startTime + m_step * dt;
+	for (const Event& e : m_events)
 	{
+		if (e.time > stepTime)
+			break;
+		if (m_step == 0 || e.time > stepTime - dt)
+			e.action();
+	}
+	m_system->computeSimulationStep();
+	++m_step;
+}
+
+void DynamicSystemRenderable::do_animate(float time)
+{
+	unsigned long target = step_count(time);
+	if (target == m_step)
 		return;
+	if (m_checkpoints.empty() && m_step == 0)
+	{
+		m_checkpoints.push_back(Checkpoint());
+		m_checkpoints.back().step = 0;
+		m_system->saveState(m_checkpoints.back().state);
 	}
-	if (time - m_lastUpdateTime >= m_system->getDt())
+
+	// Start from the last checkpoint before the time if the time went back,
+	// or if this checkpoint is ahead of the current step
+	for (size_t c = m_checkpoints.size(); c-- > 0;)
 	{
-		// Dynamic system step
-		m_system->computeSimulationStep();
-		m_lastUpdateTime = time;
+		const Checkpoint& checkpoint = m_checkpoints[c];
+		if (checkpoint.step > target)
+			continue;
+		if (checkpoint.step > m_step || target < m_step)
+		{
+			if (m_system->restoreState(checkpoint.state))
+			{
+				m_step = checkpoint.step;
+			}
+			else
+			{
+				LOG(warning, "[DynamicSystemRenderable] the particles changed since the checkpoints, the simulation cannot go back");
+				m_checkpoints.clear();
+			}
+		}
+		break;
+	}
+
+	unsigned long interval = std::max(1UL, (unsigned long)(std::round(m_checkpointInterval / m_system->getDt())));
+	while (m_step < target)
+	{
+		compute_step();
+		if (m_step % interval == 0 && (m_checkpoints.empty() || m_checkpoints.back().step < m_step))
+		{
+			m_checkpoints.push_back(Checkpoint());
+			m_checkpoints.back().step = m_step;
+			m_system->saveState(m_checkpoints.back().state);
+		}
 	}
 }
 
 void DynamicSystemRenderable::setDynamicSystem(const DynamicSystemPtr& system)
 {
 	m_system = system;
+	m_checkpoints.clear();
+	m_step = 0;
 }
 
 void DynamicSystemRenderable::setStartTime(float startTime)
 {
 	m_startTime = startTime;
+	// The steps are now at other times: only the initial state is kept
+	if (m_checkpoints.size() > 1)
+		m_checkpoints.resize(1);
+	if (!m_checkpoints.empty() && m_system->restoreState(m_checkpoints.front().state))
+		m_step = 0;
+}
+
+void DynamicSystemRenderable::addEvent(float time, const std::function<void()>& action)
+{
+	Event e;
+	e.time = time;
+	e.action = action;
+	m_events.insert(std::upper_bound(m_events.begin(), m_events.end(), e, [](const Event& a, const Event& b) { return a.time < b.time; }), e);
+
+	// The states after the event was due are computed again with it
+	double steps = std::ceil(double(time - m_startTime) / m_system->getDt());
+	unsigned long due = steps > 0 ? (unsigned long)(steps) : 0;
+	if (m_step > due)
+	{
+		while (m_checkpoints.size() > 1 && m_checkpoints.back().step > due)
+			m_checkpoints.pop_back();
+		if (!m_checkpoints.empty() && m_system->restoreState(m_checkpoints.back().state))
+			m_step = m_checkpoints.back().step;
+	}
+}
+
+void DynamicSystemRenderable::setCheckpointInterval(float seconds)
+{
+	m_checkpointInterval = seconds;
+}
+
+size_t DynamicSystemRenderable::getCheckpointCount() const
+{
+	return m_checkpoints.size();
+}
+
+void DynamicSystemRenderable::invalidateCheckpoints()
+{
+	while (!m_checkpoints.empty() && m_checkpoints.back().step > m_step)
+		m_checkpoints.pop_back();
 }
 
 void DynamicSystemRenderable::do_keyPressedEvent(sf::Event& e)
@@ -53,6 +154,7 @@ void DynamicSystemRenderable::do_keyPressedEvent(sf::Event& e)
 	if (e.key.code == sf::Keyboard::A)  // Toggle collision detection
 	{
 		m_system->setCollisionsDetection(!m_system->getCollisionDetection());
+		invalidateCheckpoints();
 	}
 	else if (e.key.code == sf::Keyboard::T)  // Tilt particles
 	{
@@ -65,14 +167,23 @@ void DynamicSystemRenderable::do_keyPressedEvent(sf::Event& e)
 			pos += glm::ballRand(1.0f);
 			p->setPosition(pos);
 		}
+		invalidateCheckpoints();
 	}
 	else if (e.key.code == sf::Keyboard::F5)  // Reset the simulation
 	{
-		for (const ParticlePtr& p : m_system->getParticles())
+		if (!m_checkpoints.empty() && m_system->restoreState(m_checkpoints.front().state))
+		{
+			m_step = 0;
+		}
+		else
 		{
-			p->restart();
+			for (const ParticlePtr& p : m_system->getParticles())
+			{
+				p->restart();
+			}
+			m_checkpoints.clear();
+			m_step = 0;
 		}
-		m_lastUpdateTime = 0;
 	}
 	else  // Propagate events to the children
 	{
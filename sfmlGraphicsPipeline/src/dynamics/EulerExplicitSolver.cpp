@@ -8,16 +8,22 @@ EulerExplicitSolver::~EulerExplicitSolver()
 {
 }
 
-void EulerExplicitSolver::do_solve(const float& dt, std::vector<ParticlePtr>& particles)
+void EulerExplicitSolver::do_solve(const float& dt, ParticleStore& particles)
 {
-	for (ParticlePtr p : particles)
+	glm::vec3* positions = particles.positions();
+	glm::vec3* velocities = particles.velocities();
+	const glm::vec3* forces = particles.forces();
+	const float* inverseMasses = particles.inverseMasses();
+	const unsigned char* flags = particles.flags();
+	size_t count = particles.size();
+	for (size_t i = 0; i < count; ++i)
 	{
-		if (!p->isFixed())
+		if (!(flags[i] & ParticleStore::FIXED))
 		{
 			// Update particle velocity
-			p->setVelocity(p->getVelocity() + (1 / p->getMass()) * dt * p->getForce());
+			velocities[i] += inverseMasses[i] * dt * forces[i];
 			// Update particle position
-			p->setPosition(p->getPosition() + dt * p->getVelocity());
+			positions[i] += dt * velocities[i];
 		}
 	}
 }
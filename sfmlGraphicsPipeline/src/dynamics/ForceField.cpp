@@ -1,10 +1,49 @@
 #include "../../include/dynamics/ForceField.hpp"
 
-ForceField::ForceField() {}
+ForceField::ForceField() : m_indexedStore(nullptr), m_indexedRevision(0) {}
 
 ForceField::~ForceField() {}
 
-void ForceField::addForce()
+void ForceField::addForce(ParticleStore& particles)
 {
-	do_addForce();
+	do_addForce(particles);
+}
+
+void ForceField::saveState(std::vector<float>& state) const
+{
+	do_saveState(state);
+}
+
+void ForceField::restoreState(const std::vector<float>& state, size_t& offset)
+{
+	do_restoreState(state, offset);
+}
+
+void ForceField::do_saveState(std::vector<float>& state) const
+{
+}
+
+void ForceField::do_restoreState(const std::vector<float>& state, size_t& offset)
+{
+}
+
+const std::vector<size_t>& ForceField::indicesIn(const ParticleStore& store, const std::vector<ParticlePtr>& particles)
+{
+	if (m_indexedStore != &store || m_indexedRevision != store.getRevision())
+	{
+		m_indices.clear();
+		for (const ParticlePtr& p : particles)
+		{
+			if (p->getStore().get() == &store)
+				m_indices.push_back(p->getIndex());
+		}
+		m_indexedStore = &store;
+		m_indexedRevision = store.getRevision();
+	}
+	return m_indices;
+}
+
+void ForceField::invalidateIndices()
+{
+	m_indexedStore = nullptr;
 }
@@ -53,7 +53,7 @@ void MushroomForceField::setStrength(float s)
 	m_strength = s;
 }
 
-void MushroomForceField::do_addForce()
+void MushroomForceField::do_addForce(ParticleStore& particles)
 {
 	if (!m_active)
 		return;
@@ -67,9 +67,11 @@ void MushroomForceField::do_addForce()
 	float sigma = m_ringRadius * 0.5f;
 	float sigmaSq = sigma * sigma;
 
-	for (auto& p : m_particles)
+	const glm::vec3* positions = particles.positions();
+	glm::vec3* forces = particles.forces();
+	for (size_t i : indicesIn(particles, m_particles))
 	{
-		glm::vec3 pos = p->getPosition();
+		const glm::vec3& pos = positions[i];
 		glm::vec3 local = pos - m_center;
 
 		// Cylindrical coordinates relative to axis
@@ -115,6 +117,16 @@ void MushroomForceField::do_addForce()
 		}
 		force.y = fVertical;
 
-		p->incrForce(force);
+		forces[i] += force;
 	}
 }
+
+void MushroomForceField::do_saveState(std::vector<float>& state) const
+{
+	state.push_back(m_active ? 1.0f : 0.0f);
+}
+
+void MushroomForceField::do_restoreState(const std::vector<float>& state, size_t& offset)
+{
+	m_active = state[offset++] != 0.0f;
+}
@@ -0,0 +1,115 @@
+#include "../../include/dynamics/ParticleGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// The cells far from the origin, and the cells of invalid positions, are
+// gathered in the outer cells so that the cell coordinates fit in an int
+static int cell_coordinate(float position, float cellSize)
+{
+	float c = std::floor(position / cellSize);
+	if (!(c > -1e9f))
+		return -1000000000;
+	if (c > 1e9f)
+		return 1000000000;
+	return static_cast<int>(c);
+}
+
+ParticleGrid::ParticleGrid() : m_cellSize(1.0f), m_bucketMask(0)
+{
+}
+
+ParticleGrid::~ParticleGrid()
+{
+}
+
+size_t ParticleGrid::bucket(const glm::ivec3& cell) const
+{
+	size_t h = (static_cast<size_t>(static_cast<unsigned int>(cell.x)) * 73856093u)
+	           ^ (static_cast<size_t>(static_cast<unsigned int>(cell.y)) * 19349663u)
+	           ^ (static_cast<size_t>(static_cast<unsigned int>(cell.z)) * 83492791u);
+	return h & m_bucketMask;
+}
+
+void ParticleGrid::build(const ParticleStore& particles)
+{
+	size_t count = particles.size();
+	const glm::vec3* positions = particles.positions();
+	const float* radii = particles.radii();
+
+	// Two particles in contact are closer than the largest diameter
+	float maxRadius = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+		maxRadius = std::max(maxRadius, radii[i]);
+	m_cellSize = maxRadius > 0.0f ? 2.0f * maxRadius : 1.0f;
+
+	size_t bucketCount = 1;
+	while (bucketCount < 2 * count)
+		bucketCount *= 2;
+	m_bucketMask = bucketCount - 1;
+
+	m_cells.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		m_cells[i] = glm::ivec3(cell_coordinate(positions[i].x, m_cellSize),
+		                        cell_coordinate(positions[i].y, m_cellSize),
+		                        cell_coordinate(positions[i].z, m_cellSize));
+	}
+
+	// Counting sort of the particles by bucket: the particles of a bucket
+	// are in increasing order
+	m_starts.assign(bucketCount + 1, 0);
+	for (size_t i = 0; i < count; ++i)
+		++m_starts[bucket(m_cells[i])];
+	for (size_t b = 1; b <= bucketCount; ++b)
+		m_starts[b] += m_starts[b - 1];
+	m_sorted.resize(count);
+	for (size_t i = count; i-- > 0;)
+		m_sorted[--m_starts[bucket(m_cells[i])]] = i;
+}
+
+void ParticleGrid::findPairs(std::vector<std::pair<size_t, size_t> >& pairs)
+{
+	pairs.clear();
+	size_t count = m_cells.size();
+	size_t buckets[27];
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const glm::ivec3& cell = m_cells[i];
+
+		// Buckets of the neighbouring cells, each one visited once when
+		// several cells share a bucket
+		size_t bucketCount = 0;
+		for (int dx = -1; dx <= 1; ++dx)
+			for (int dy = -1; dy <= 1; ++dy)
+				for (int dz = -1; dz <= 1; ++dz)
+					buckets[bucketCount++] = bucket(cell + glm::ivec3(dx, dy, dz));
+		std::sort(buckets, buckets + bucketCount);
+		bucketCount = std::unique(buckets, buckets + bucketCount) - buckets;
+
+		// The particles of other cells in the same bucket are skipped
+		m_candidates.clear();
+		for (size_t b = 0; b < bucketCount; ++b)
+		{
+			for (size_t k = m_starts[buckets[b]]; k < m_starts[buckets[b] + 1]; ++k)
+			{
+				size_t j = m_sorted[k];
+				if (j <= i)
+					continue;
+				const glm::ivec3& other = m_cells[j];
+				if (std::abs(other.x - cell.x) <= 1 && std::abs(other.y - cell.y) <= 1 && std::abs(other.z - cell.z) <= 1)
+					m_candidates.push_back(j);
+			}
+		}
+
+		std::sort(m_candidates.begin(), m_candidates.end());
+		for (size_t j : m_candidates)
+			pairs.push_back(std::make_pair(i, j));
+	}
+}
+
+float ParticleGrid::getCellSize() const
+{
+	return m_cellSize;
+}
@@ -14,45 +14,55 @@ ParticleParticleCollision::ParticleParticleCollision(ParticlePtr particle1, Part
 
 void ParticleParticleCollision::do_solveCollision()
 {
+	if (m_p1->getStore() == m_p2->getStore())
+		solveParticleParticle(*m_p1->getStore(), m_p1->getIndex(), m_p2->getIndex(), m_restitution);
+}
+
+void solveParticleParticle(ParticleStore& particles, size_t i, size_t j, float restitution)
+{
+	const unsigned char* flags = particles.flags();
+	bool fixed1 = (flags[i] & ParticleStore::FIXED) != 0;
+	bool fixed2 = (flags[j] & ParticleStore::FIXED) != 0;
 	// Don't process fixed particles (Let's assume that the ground plane is fixed)
-	if (m_p1->isFixed() && m_p2->isFixed())
+	if (fixed1 && fixed2)
 		return;
+	glm::vec3& x1 = particles.positions()[i];
+	glm::vec3& x2 = particles.positions()[j];
+	glm::vec3& v1 = particles.velocities()[i];
+	glm::vec3& v2 = particles.velocities()[j];
+	float w1 = particles.inverseMasses()[i];
+	float w2 = particles.inverseMasses()[j];
 
 	// Compute interpenetration distance
-	float particleParticleDist = glm::distance(m_p1->getPosition(), m_p2->getPosition());
-	float interpenetrationDist = m_p1->getRadius() + m_p2->getRadius() - particleParticleDist;
+	float particleParticleDist = glm::distance(x1, x2);
+	float interpenetrationDist = particles.radii()[i] + particles.radii()[j] - particleParticleDist;
 
 	// Compute particle-particle vector
-	glm::vec3 k = glm::normalize(m_p1->getPosition() - m_p2->getPosition());
+	glm::vec3 k = glm::normalize(x1 - x2);
 
 	// Project each particle along the particle-particle vector with half of the interpenetration distance
 	// To be more precise, we ponderate the distance with the mass of the particle
-	glm::vec3 prev_x1 = m_p1->getPosition();
-	glm::vec3 prev_x2 = m_p2->getPosition();
-	if (m_p1->isFixed())
+	if (fixed1)
 	{
-		m_p2->setPosition(prev_x2 - interpenetrationDist * k);
+		x2 -= interpenetrationDist * k;
 	}
-	else if (m_p2->isFixed())
+	else if (fixed2)
 	{
-		m_p1->setPosition(prev_x1 + interpenetrationDist * k);
+		x1 += interpenetrationDist * k;
 	}
 	else
 	{
-		float c1 = m_p1->getMass() / (m_p1->getMass() + m_p2->getMass());
-		float c2 = m_p2->getMass() / (m_p1->getMass() + m_p2->getMass());
-		m_p1->setPosition(prev_x1 + c2 * interpenetrationDist * k);
-		m_p2->setPosition(prev_x2 - c1 * interpenetrationDist * k);
+		// m1 / (m1 + m2) = w2 / (w1 + w2), with the inverse masses
+		float c1 = w2 / (w1 + w2);
+		float c2 = w1 / (w1 + w2);
+		x1 += c2 * interpenetrationDist * k;
+		x2 -= c1 * interpenetrationDist * k;
 	}
 
 	// Compute post-collision velocity
-	glm::vec3 prev_v1 = m_p1->getVelocity();
-	glm::vec3 prev_v2 = m_p2->getVelocity();
-	float proj_v = (1.0f + m_restitution) * glm::dot(k, prev_v1 - prev_v2) / (1.0 / m_p1->getMass() + 1.0 / m_p2->getMass());
-	glm::vec3 new_v1 = prev_v1 - proj_v / m_p1->getMass() * k;
-	glm::vec3 new_v2 = prev_v2 + proj_v / m_p2->getMass() * k;
-	m_p1->setVelocity(new_v1);
-	m_p2->setVelocity(new_v2);
+	float proj_v = (1.0f + restitution) * glm::dot(k, v1 - v2) / (w1 + w2);
+	v1 -= proj_v * w1 * k;
+	v2 += proj_v * w2 * k;
 }
 
 bool testParticleParticle(const ParticlePtr& p1, const ParticlePtr& p2)
@@ -71,3 +81,11 @@ bool testParticleParticle(const ParticlePtr& p1, const ParticlePtr& p2)
 	float c = glm::distance2(p1->getPosition(), p2->getPosition()) - r * r;
 	return (c < 0.0f) ? true : false;
 }
+
+bool testParticleParticle(const ParticleStore& particles, size_t i, size_t j)
+{
+	if (i == j)
+		return false;
+	float r = particles.radii()[i] + particles.radii()[j];
+	return glm::distance2(particles.positions()[i], particles.positions()[j]) < r * r;
+}
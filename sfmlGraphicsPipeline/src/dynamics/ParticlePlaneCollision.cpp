@@ -11,9 +11,14 @@ ParticlePlaneCollision::ParticlePlaneCollision(ParticlePtr particle, PlanePtr pl
 }
 
 void ParticlePlaneCollision::do_solveCollision()
+{
+	solveParticlePlane(*m_particle->getStore(), m_particle->getIndex(), *m_plane, m_restitution);
+}
+
+void solveParticlePlane(ParticleStore& particles, size_t i, Plane& plane, float restitution)
 {
 	// Don't process fixed particles (Let's assume that the ground plane is fixed)
-	if (m_particle->isFixed())
+	if (particles.flags()[i] & ParticleStore::FIXED)
 		return;
 
 	// TODO: Solve ParticlePlane collisions, update particle position and velocity after collision
@@ -21,23 +26,31 @@ void ParticlePlaneCollision::do_solveCollision()
 	// glm::dot(v1, v2): Return the dot product of two vector.
 	// Plane::distanceToOrigin(): Return the distance to origin from the plane
 	// Plane::normal(): Return the normal of the plane
-	// Particle::getRadius(), Particle::getPosition(), Particle::getVelocity(), Particle::setPosition(), Particle::setVelocity()
+	// ParticleStore::radii(), ParticleStore::positions(), ParticleStore::velocities()
+	glm::vec3& position = particles.positions()[i];
+	glm::vec3& velocity = particles.velocities()[i];
+	float radius = particles.radii()[i];
 
 	// Compute interpenetration distance
-	float planeParticleDist = glm::dot(m_particle->getPosition(), m_plane->normal()) - m_plane->distanceToOrigin();
-	float interpenetrationDist = m_particle->getRadius() - planeParticleDist;
+	float planeParticleDist = glm::dot(position, plane.normal()) - plane.distanceToOrigin();
+	float interpenetrationDist = radius - planeParticleDist;
 	if (interpenetrationDist <= 0)
 		return;
-	
+
 	// Project the particle on the plane
-	glm::vec3 proj = m_plane->projectOnPlane(m_particle->getPosition());
-	m_particle->setPosition(proj + m_particle->getRadius() * m_plane->normal());
+	glm::vec3 proj = plane.projectOnPlane(position);
+	position = proj + radius * plane.normal();
 
 	// Compute post-collision velocity
-	m_particle->setVelocity(m_particle->getVelocity() - (1.0f + m_restitution) * glm::dot(m_particle->getVelocity(), m_plane->normal()) * (m_plane->normal()));
+	velocity = velocity - (1.0f + restitution) * glm::dot(velocity, plane.normal()) * plane.normal();
 }
 
 bool testParticlePlane(const ParticlePtr& particle, const PlanePtr& plane)
+{
+	return testParticlePlane(*particle->getStore(), particle->getIndex(), *plane);
+}
+
+bool testParticlePlane(const ParticleStore& particles, size_t i, const Plane& plane)
 {
 	/* Equation of a plane passing through A and normal to n:
 	 * dot( p - A, n ) = dot( p, n ) - dot( A, n ) = 0
@@ -61,7 +74,7 @@ bool testParticlePlane(const ParticlePtr& particle, const PlanePtr& plane)
 	// glm::dot(v1, v2): Return the dot product of two vector.
 	// Plane::distanceToOrigin(): Return the distance to origin from the plane
 	// Plane::normal(): Return the normal of the plane
-	// Particle::getRadius(), Particle::getPosition()
-	float dist = glm::dot(particle->getPosition(), plane->normal()) - plane->distanceToOrigin();
-	return dist <= particle->getRadius();
+	// ParticleStore::radii(), ParticleStore::positions()
+	float dist = glm::dot(particles.positions()[i], plane.normal()) - plane.distanceToOrigin();
+	return dist <= particles.radii()[i];
 }
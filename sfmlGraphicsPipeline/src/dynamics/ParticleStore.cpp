@@ -0,0 +1,141 @@
+#include "../../include/dynamics/ParticleStore.hpp"
+
+#include <algorithm>
+
+// The revisions are unique among all the stores, so that a store allocated where
+// another one was freed does not have its revisions
+static unsigned int store_revision = 0;
+
+ParticleStore::ParticleStore() : m_revision(++store_revision)
+{
+}
+
+ParticleStore::~ParticleStore()
+{
+}
+
+size_t ParticleStore::add(const glm::vec3& position, const glm::vec3& velocity, float mass, float radius)
+{
+	m_positions.push_back(position);
+	m_velocities.push_back(velocity);
+	m_forces.push_back(glm::vec3(0.0f));
+	m_inverseMasses.push_back(1.0f / mass);
+	m_radii.push_back(radius);
+	m_flags.push_back(0);
+	m_initialPositions.push_back(position);
+	m_initialVelocities.push_back(velocity);
+	m_revision = ++store_revision;
+	return m_positions.size() - 1;
+}
+
+size_t ParticleStore::add(const ParticleStore& other, size_t index)
+{
+	m_positions.push_back(other.m_positions[index]);
+	m_velocities.push_back(other.m_velocities[index]);
+	m_forces.push_back(other.m_forces[index]);
+	m_inverseMasses.push_back(other.m_inverseMasses[index]);
+	m_radii.push_back(other.m_radii[index]);
+	m_flags.push_back(other.m_flags[index]);
+	m_initialPositions.push_back(other.m_initialPositions[index]);
+	m_initialVelocities.push_back(other.m_initialVelocities[index]);
+	m_revision = ++store_revision;
+	return m_positions.size() - 1;
+}
+
+void ParticleStore::clear()
+{
+	m_positions.clear();
+	m_velocities.clear();
+	m_forces.clear();
+	m_inverseMasses.clear();
+	m_radii.clear();
+	m_flags.clear();
+	m_initialPositions.clear();
+	m_initialVelocities.clear();
+	m_revision = ++store_revision;
+}
+
+size_t ParticleStore::size() const
+{
+	return m_positions.size();
+}
+
+unsigned int ParticleStore::getRevision() const
+{
+	return m_revision;
+}
+
+void ParticleStore::clearForces()
+{
+	std::fill(m_forces.begin(), m_forces.end(), glm::vec3(0.0f));
+}
+
+glm::vec3* ParticleStore::positions()
+{
+	return m_positions.data();
+}
+
+const glm::vec3* ParticleStore::positions() const
+{
+	return m_positions.data();
+}
+
+glm::vec3* ParticleStore::velocities()
+{
+	return m_velocities.data();
+}
+
+const glm::vec3* ParticleStore::velocities() const
+{
+	return m_velocities.data();
+}
+
+glm::vec3* ParticleStore::forces()
+{
+	return m_forces.data();
+}
+
+const glm::vec3* ParticleStore::forces() const
+{
+	return m_forces.data();
+}
+
+float* ParticleStore::inverseMasses()
+{
+	return m_inverseMasses.data();
+}
+
+const float* ParticleStore::inverseMasses() const
+{
+	return m_inverseMasses.data();
+}
+
+float* ParticleStore::radii()
+{
+	return m_radii.data();
+}
+
+const float* ParticleStore::radii() const
+{
+	return m_radii.data();
+}
+
+unsigned char* ParticleStore::flags()
+{
+	return m_flags.data();
+}
+
+const unsigned char* ParticleStore::flags() const
+{
+	return m_flags.data();
+}
+
+const glm::vec3* ParticleStore::initialPositions() const
+{
+	return m_initialPositions.data();
+}
+
+const glm::vec3* ParticleStore::initialVelocities() const
+{
+	return m_initialVelocities.data();
+}
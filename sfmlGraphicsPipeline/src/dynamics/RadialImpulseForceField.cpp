@@ -68,7 +68,7 @@ bool RadialImpulseForceField::isActive() const
 	return m_active;
 }
 
-void RadialImpulseForceField::do_addForce()
+void RadialImpulseForceField::do_addForce(ParticleStore& particles)
 {
 	if (!m_active || m_remainingTime <= 0.0f)
 	{
@@ -79,9 +79,11 @@ void RadialImpulseForceField::do_addForce()
 	// Linear temporal falloff
 	float timeFactor = (m_duration > 0.0f) ? (m_remainingTime / m_duration) : 1.0f;
 
-	for (auto& p : m_particles)
+	const glm::vec3* positions = particles.positions();
+	glm::vec3* forces = particles.forces();
+	for (size_t i : indicesIn(particles, m_particles))
 	{
-		glm::vec3 dir = p->getPosition() - m_center;
+		glm::vec3 dir = positions[i] - m_center;
 		float dist = glm::length(dir);
 		if (dist < 1e-5f)
 		{
@@ -92,7 +94,7 @@ void RadialImpulseForceField::do_addForce()
 		// Gaussian falloff: smooth decay without hard threshold
 		float spatialFactor = std::exp(-(dist * dist) / (m_radius * m_radius));
 		glm::vec3 force = dir * (m_strength * spatialFactor * timeFactor);
-		p->incrForce(force);
+		forces[i] += force;
 	}
 
 	m_remainingTime -= m_dt;
@@ -101,3 +103,15 @@ void RadialImpulseForceField::do_addForce()
 		stop();
 	}
 }
+
+void RadialImpulseForceField::do_saveState(std::vector<float>& state) const
+{
+	state.push_back(m_remainingTime);
+	state.push_back(m_active ? 1.0f : 0.0f);
+}
+
+void RadialImpulseForceField::do_restoreState(const std::vector<float>& state, size_t& offset)
+{
+	m_remainingTime = state[offset++];
+	m_active = state[offset++] != 0.0f;
+}
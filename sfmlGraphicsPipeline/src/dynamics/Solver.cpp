@@ -1,6 +1,6 @@
 #include "../../include/dynamics/Solver.hpp"
 
-void Solver::solve(const float& dt, std::vector<ParticlePtr>& particles)
+void Solver::solve(const float& dt, ParticleStore& particles)
 {
 	do_solve(dt, particles);
 }
@@ -8,18 +8,27 @@ SpringForceField::SpringForceField(const ParticlePtr p1, const ParticlePtr p2, f
 {
 }
 
-void SpringForceField::do_addForce()
+void SpringForceField::do_addForce(ParticleStore& particles)
 {
 	// TODO: Implement a damped spring
 	// Functions to use:
 	// glm::length( vec3 ): Return the length of a vector
 	// glm::normalize( vec3 ): Return the normalization of a vector
-	// Particle::getVelocity(), Particle::getForce(), Particle::setForce()
+	// ParticleStore::positions(), ParticleStore::velocities(), ParticleStore::forces()
 	// Nb:   Compute force ONLY IF the displacement length is above std::numeric_limits<float>::epsilon()
 	//       Otherwise the computation is useless
 
+	// The two particles must be in the store of the system
+	if (m_p1->getStore().get() != &particles || m_p2->getStore().get() != &particles)
+		return;
+	size_t i1 = m_p1->getIndex();
+	size_t i2 = m_p2->getIndex();
+	const glm::vec3* positions = particles.positions();
+	const glm::vec3* velocities = particles.velocities();
+	glm::vec3* forces = particles.forces();
+
 	// Compute displacement vector
-	glm::vec3 displacement = m_p1->getPosition() - m_p2->getPosition();
+	glm::vec3 displacement = positions[i1] - positions[i2];
 
 	// Compute displacement length
 	float displacementLength = glm::length(displacement);
@@ -30,13 +39,13 @@ void SpringForceField::do_addForce()
 	{
 		glm::vec3 normalizedDisplacement = glm::normalize(displacement);
 		glm::vec3 idealForce = -m_stiffness * (displacementLength - m_equilibriumLength) * normalizedDisplacement;
-		glm::vec3 relativeVelocity = m_p1->getVelocity() - m_p2->getVelocity();
+		glm::vec3 relativeVelocity = velocities[i1] - velocities[i2];
 		float dampingFactor = glm::dot(relativeVelocity, normalizedDisplacement);
 		glm::vec3 dampedForce = -m_damping * dampingFactor * normalizedDisplacement;
 		glm::vec3 totalForce = idealForce + dampedForce;
 
-		m_p1->setForce(m_p1->getForce() + totalForce);
-		m_p2->setForce(m_p2->getForce() - totalForce);
+		forces[i1] += totalForce;
+		forces[i2] -= totalForce;
 	}
 }
 
@@ -49,4 +49,10 @@ void DirectionalLightRenderable::do_animate(float time)
 
 DirectionalLightRenderable::~DirectionalLightRenderable()
 {
-}
\ No newline at end of file
+}
+
+bool DirectionalLightRenderable::getAnimationRange(float& begin, float& end) const
+{
+	// The renderable follows its light at any time
+	return Renderable::getAnimationRange(begin, end);
+}
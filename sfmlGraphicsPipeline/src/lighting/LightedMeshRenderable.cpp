@@ -34,7 +34,8 @@ LightedMeshRenderable::LightedMeshRenderable(ShaderProgramPtr shaderProgram,
 
 LightedMeshRenderable::LightedMeshRenderable(ShaderProgramPtr shaderProgram,
                                              const std::string& mesh_filename,
-                                             const MaterialPtr& material) : MeshRenderable(shaderProgram, mesh_filename),
+                                             const MaterialPtr& material,
+                                             bool deferred) : MeshRenderable(shaderProgram, mesh_filename, deferred),
                                                                             m_material(material)
 {
 }
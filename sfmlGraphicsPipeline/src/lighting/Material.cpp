@@ -13,6 +13,7 @@ Material::Material()
 	m_specular = glm::vec3(0.0, 0.0, 0.0);
 	m_shininess = 0.0;
 	m_alpha = 1.0;
+	m_index = 0;
 }
 
 Material::Material(const glm::vec3 &ambient, const glm::vec3 &diffuse, const glm::vec3 &specular, const float &shininess, const float &alpha)
@@ -22,6 +23,7 @@ Material::Material(const glm::vec3 &ambient, const glm::vec3 &diffuse, const glm
 	m_specular = specular;
 	m_shininess = shininess;
 	m_alpha = alpha;
+	m_index = 0;
 }
 
 Material::Material(const Material& material)
@@ -31,6 +33,7 @@ Material::Material(const Material& material)
 	m_specular = material.m_specular;
 	m_shininess = material.m_shininess;
 	m_alpha = material.m_alpha;
+	m_index = material.m_index;
 }
 
 const glm::vec3& Material::ambient() const
@@ -78,12 +81,39 @@ void Material::setAlpha(float alpha)
 	m_alpha = alpha;
 }
 
+unsigned int Material::index() const
+{
+	return m_index;
+}
+
+void Material::setIndex(unsigned int index)
+{
+	m_index = index;
+}
+
 const float &Material::alpha() const
 {
 	return m_alpha;
 }
 
 bool Material::sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& material)
+{
+	if (program == nullptr || material == nullptr)
+	{
+		return false;
+	}
+
+	// Optional: only the G-buffer programs need it
+	int location = program->getUniformLocation("materialId");
+	if (location != ShaderProgram::null_location)
+	{
+		glcheck(glUniform1i(location, (int)material->index()));
+	}
+
+	return sendToGPU(program, material, "material");
+}
+
+bool Material::sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& material, const std::string& identifier)
 {
 	bool success = true;
 	int location = -1;
@@ -93,7 +123,7 @@ bool Material::sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& mat
 		return false;
 	}
 
-	location = program->getUniformLocation("material.ambient");
+	location = program->getUniformLocation(identifier + ".ambient");
 	if (location != ShaderProgram::null_location)
 	{
 		glcheck(glUniform3fv(location, 1, glm::value_ptr(material->ambient())));
@@ -103,7 +133,7 @@ bool Material::sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& mat
 		success = false;
 	}
 
-	location = program->getUniformLocation("material.diffuse");
+	location = program->getUniformLocation(identifier + ".diffuse");
 	if (location != ShaderProgram::null_location)
 	{
 		glcheck(glUniform3fv(location, 1, glm::value_ptr(material->diffuse())));
@@ -113,7 +143,7 @@ bool Material::sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& mat
 		success = false;
 	}
 
-	location = program->getUniformLocation("material.specular");
+	location = program->getUniformLocation(identifier + ".specular");
 	if (location != ShaderProgram::null_location)
 	{
 		glcheck(glUniform3fv(location, 1, glm::value_ptr(material->specular())));
@@ -123,7 +153,7 @@ bool Material::sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& mat
 		success = false;
 	}
 
-	location = program->getUniformLocation("material.shininess");
+	location = program->getUniformLocation(identifier + ".shininess");
 	if (location != ShaderProgram::null_location)
 	{
 		// Just a small hack for pow(0,0) = NaN on NVidia hardware
@@ -135,7 +165,7 @@ bool Material::sendToGPU(const ShaderProgramPtr& program, const MaterialPtr& mat
 		success = false;
 	}
 
-	location = program->getUniformLocation("material.alpha");
+	location = program->getUniformLocation(identifier + ".alpha");
 	if (location != ShaderProgram::null_location)
 	{
 		// Just a small hack for pow(0,0) = NaN on NVidia hardware
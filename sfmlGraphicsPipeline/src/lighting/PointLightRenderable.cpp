@@ -31,3 +31,9 @@ void PointLightRenderable::do_animate(float time)
 PointLightRenderable::~PointLightRenderable()
 {
 }
+
+bool PointLightRenderable::getAnimationRange(float& begin, float& end) const
+{
+	// The renderable follows its light at any time
+	return Renderable::getAnimationRange(begin, end);
+}
@@ -35,3 +35,9 @@ void SpotLightRenderable::do_animate(float time)
 SpotLightRenderable::~SpotLightRenderable()
 {
 }
+
+bool SpotLightRenderable::getAnimationRange(float& begin, float& end) const
+{
+	// The renderable follows its light at any time
+	return Renderable::getAnimationRange(begin, end);
+}
@@ -135,6 +135,12 @@ void BillBoardPlaneRenderable::do_animate(float time)
 {
 }
 
+bool BillBoardPlaneRenderable::getAnimationRange(float& begin, float& end) const
+{
+	begin = end = 0;
+	return false;
+}
+
 void BillBoardPlaneRenderable::do_keyPressedEvent(sf::Event& e)
 {
 }
@@ -41,6 +41,8 @@ void CubeMapRenderable::update_all_buffers()
 {
 	MeshRenderable::update_all_buffers();
 	update_textures_buffer();
+	// The cube map is drawn around the camera, wherever the cube is
+	m_localBounds = BoundingBox();
 }
 
 void CubeMapRenderable::update_textures_buffer()
@@ -0,0 +1,236 @@
+#include "../../include/texturing/MorphMeshRenderable.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../../include/gl_helper.hpp"
+#include "./../../include/Io.hpp"
+#include "./../../include/log.hpp"
+
+const unsigned int MorphMeshRenderable::max_targets = 32;
+
+MorphMeshRenderable::~MorphMeshRenderable()
+{
+	glcheck(glDeleteBuffers(1, &m_rangeBuffer));
+	glcheck(glDeleteBuffers(1, &m_deltaBuffer));
+	glcheck(glDeleteTextures(1, &m_deltaTexture));
+}
+
+MorphMeshRenderable::MorphMeshRenderable(ShaderProgramPtr program,
+                                         const std::string& mesh_filename,
+                                         const std::string& texture_filename) : TexturedMeshRenderable(program, mesh_filename, texture_filename),
+                                                                                m_deltaCount(0),
+                                                                                m_rangeBuffer(0),
+                                                                                m_deltaBuffer(0),
+                                                                                m_deltaTexture(0)
+{
+	glcheck(glGenBuffers(1, &m_rangeBuffer));
+	glcheck(glGenBuffers(1, &m_deltaBuffer));
+	glcheck(glGenTextures(1, &m_deltaTexture));
+	update_morph_buffers();
+}
+
+int MorphMeshRenderable::addMorphTarget(const std::string& name,
+                                        const std::vector<glm::vec3>& positions,
+                                        const std::vector<glm::vec3>& normals,
+                                        float threshold)
+{
+	if (m_targets.size() >= max_targets || positions.size() != m_positions.size())
+	{
+		LOG(error, "[MorphMeshRenderable] cannot add the morph target " << name);
+		return -1;
+	}
+	bool hasNormals = normals.size() == m_positions.size() && m_normals.size() == m_positions.size();
+
+	MorphTarget target;
+	target.name = name;
+	for (size_t v = 0; v < positions.size(); ++v)
+	{
+		glm::vec3 positionDelta = positions[v] - m_positions[v];
+		glm::vec3 normalDelta = hasNormals ? normals[v] - m_normals[v] : glm::vec3(0);
+		if (glm::length(positionDelta) < threshold && glm::length(normalDelta) < threshold)
+			continue;
+		target.vertices.push_back(v);
+		target.positionDeltas.push_back(positionDelta);
+		target.normalDeltas.push_back(normalDelta);
+	}
+	m_targets.push_back(target);
+	m_weights.push_back(0.0f);
+	update_morph_buffers();
+	animationChanged();
+	return m_targets.size() - 1;
+}
+
+int MorphMeshRenderable::addMorphTargetFromFile(const std::string& name, const std::string& mesh_filename, float threshold)
+{
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> tcoords;
+	std::vector<unsigned int> indices;
+	if (!read_obj(mesh_filename, positions, indices, normals, tcoords))
+	{
+		LOG(error, "[MorphMeshRenderable] cannot read " << mesh_filename);
+		return -1;
+	}
+	return addMorphTarget(name, positions, normals, threshold);
+}
+
+int MorphMeshRenderable::findMorphTarget(const std::string& name) const
+{
+	for (size_t t = 0; t < m_targets.size(); ++t)
+	{
+		if (m_targets[t].name == name)
+			return t;
+	}
+	return -1;
+}
+
+size_t MorphMeshRenderable::getMorphTargetCount() const
+{
+	return m_targets.size();
+}
+
+size_t MorphMeshRenderable::getDeltaCount() const
+{
+	return m_deltaCount;
+}
+
+void MorphMeshRenderable::setWeight(int target, float weight)
+{
+	m_weights[target] = weight;
+}
+
+float MorphMeshRenderable::getWeight(int target) const
+{
+	return m_weights[target];
+}
+
+void MorphMeshRenderable::addWeightKeyframe(int target, float weight, float time)
+{
+	m_targets[target].weights.add(weight, time);
+	animationChanged();
+}
+
+void MorphMeshRenderable::update_morph_buffers()
+{
+	// Sort the deltas by vertex: each vertex reads a contiguous range
+	std::vector<unsigned int> counts(m_positions.size(), 0);
+	for (const MorphTarget& target : m_targets)
+	{
+		for (unsigned int v : target.vertices)
+			++counts[v];
+	}
+	m_morphRanges.resize(m_positions.size());
+	unsigned int first = 0;
+	for (size_t v = 0; v < m_positions.size(); ++v)
+	{
+		m_morphRanges[v] = glm::uvec2(first, 0);
+		first += counts[v];
+	}
+	m_deltaCount = first;
+
+	// Two texels per delta: the position delta and the target, then the normal delta
+	std::vector<glm::vec4> texels(2 * std::max<size_t>(m_deltaCount, 1), glm::vec4(0));
+	std::vector<glm::vec3> extents(m_positions.size(), glm::vec3(0));
+	for (size_t t = 0; t < m_targets.size(); ++t)
+	{
+		const MorphTarget& target = m_targets[t];
+		for (size_t i = 0; i < target.vertices.size(); ++i)
+		{
+			unsigned int v = target.vertices[i];
+			unsigned int d = m_morphRanges[v].x + m_morphRanges[v].y++;
+			texels[2 * d] = glm::vec4(target.positionDeltas[i], float(t));
+			texels[2 * d + 1] = glm::vec4(target.normalDeltas[i], 0.0f);
+			extents[v] += glm::abs(target.positionDeltas[i]);
+		}
+	}
+
+	// Bounds of all the shapes with weights between -1 and 1
+	BoundingBox bounds;
+	for (size_t v = 0; v < m_positions.size(); ++v)
+	{
+		BoundingBox vertexBounds(m_positions[v] - extents[v], m_positions[v] + extents[v]);
+		if (bounds.isValid())
+			bounds.extend(vertexBounds);
+		else
+			bounds = vertexBounds;
+	}
+	setLocalBounds(bounds);
+
+	glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_rangeBuffer));
+	glcheck(glBufferData(GL_ARRAY_BUFFER, m_morphRanges.size() * sizeof(glm::uvec2), m_morphRanges.data(), GL_STATIC_DRAW));
+	glcheck(glBindBuffer(GL_TEXTURE_BUFFER, m_deltaBuffer));
+	glcheck(glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW));
+	glcheck(glBindTexture(GL_TEXTURE_BUFFER, m_deltaTexture));
+	glcheck(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_deltaBuffer));
+	glcheck(glBindTexture(GL_TEXTURE_BUFFER, 0));
+	glcheck(glBindBuffer(GL_TEXTURE_BUFFER, 0));
+}
+
+bool MorphMeshRenderable::getAnimationRange(float& begin, float& end) const
+{
+	bool animated = KeyframedHierarchicalRenderable::getAnimationRange(begin, end);
+	for (const MorphTarget& target : m_targets)
+	{
+		float b, e;
+		if (!target.weights.getTimeRange(b, e) || !(b < e))
+			continue;
+		begin = animated ? std::min(begin, b) : b;
+		end = animated ? std::max(end, e) : e;
+		animated = true;
+	}
+	return animated;
+}
+
+bool MorphMeshRenderable::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	return KeyframedHierarchicalRenderable::intersectRay(origin, direction, distance);
+}
+
+void MorphMeshRenderable::do_animate(float time)
+{
+	KeyframedHierarchicalRenderable::do_animate(time);
+	for (size_t t = 0; t < m_targets.size(); ++t)
+	{
+		if (!m_targets[t].weights.empty())
+			m_weights[t] = m_targets[t].weights.interpolate(time);
+	}
+}
+
+void MorphMeshRenderable::do_draw()
+{
+	int rangeLocation = m_shaderProgram->getAttributeLocation("vMorphRange");
+	int deltasLocation = m_shaderProgram->getUniformLocation("morphDeltas");
+	int weightsLocation = m_shaderProgram->getUniformLocation("morphWeights");
+
+	if (weightsLocation != ShaderProgram::null_location && !m_weights.empty())
+		glcheck(glUniform1fv(weightsLocation, m_weights.size(), m_weights.data()));
+
+	// The deltas are in the texture unit 1, the texture of the mesh in the unit 0
+	if (deltasLocation != ShaderProgram::null_location)
+	{
+		glcheck(glActiveTexture(GL_TEXTURE1));
+		glcheck(glBindTexture(GL_TEXTURE_BUFFER, m_deltaTexture));
+		glcheck(glUniform1i(deltasLocation, 1));
+		glcheck(glActiveTexture(GL_TEXTURE0));
+	}
+
+	if (rangeLocation != ShaderProgram::null_location)
+	{
+		glcheck(glEnableVertexAttribArray(rangeLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_rangeBuffer));
+		glcheck(glVertexAttribIPointer(rangeLocation, 2, GL_UNSIGNED_INT, 0, (void*)0));
+	}
+
+	TexturedMeshRenderable::do_draw();
+
+	if (rangeLocation != ShaderProgram::null_location)
+		glcheck(glDisableVertexAttribArray(rangeLocation));
+	if (deltasLocation != ShaderProgram::null_location)
+	{
+		glcheck(glActiveTexture(GL_TEXTURE1));
+		glcheck(glBindTexture(GL_TEXTURE_BUFFER, 0));
+		glcheck(glActiveTexture(GL_TEXTURE0));
+	}
+}
@@ -0,0 +1,231 @@
+#include "../../include/texturing/SkinnedMeshRenderable.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../../include/gl_helper.hpp"
+#include "./../../include/Io.hpp"
+#include "./../../include/log.hpp"
+
+// Binding point of the palette uniform buffer
+static const unsigned int joint_palette_binding = 0;
+
+SkinnedMeshRenderable::~SkinnedMeshRenderable()
+{
+	glcheck(glDeleteBuffers(1, &m_jBuffer));
+	glcheck(glDeleteBuffers(1, &m_wBuffer));
+	glcheck(glDeleteBuffers(1, &m_paletteBuffer));
+}
+
+SkinnedMeshRenderable::SkinnedMeshRenderable(ShaderProgramPtr program,
+                                             const SkeletonPtr& skeleton,
+                                             const MaterialPtr& material,
+                                             const std::string& texture_filename) : TexturedMeshRenderable(program, true),
+                                                                                    m_skeleton(skeleton),
+                                                                                    m_material(material),
+                                                                                    m_jBuffer(0),
+                                                                                    m_wBuffer(0),
+                                                                                    m_paletteBuffer(0)
+{
+	m_image.loadFromFile(texture_filename);
+	m_image.flipVertically();
+	update_texture_buffer();
+
+	glcheck(glGenBuffers(1, &m_jBuffer));
+	glcheck(glGenBuffers(1, &m_wBuffer));
+	glcheck(glGenBuffers(1, &m_paletteBuffer));
+	glcheck(glBindBuffer(GL_UNIFORM_BUFFER, m_paletteBuffer));
+	glcheck(glBufferData(GL_UNIFORM_BUFFER, Skeleton::max_joints * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW));
+	glcheck(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+bool SkinnedMeshRenderable::addRigidPart(const std::string& mesh_filename, int joint)
+{
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> tcoords;
+	std::vector<unsigned int> indices;
+	if (!read_obj(mesh_filename, positions, indices, normals, tcoords))
+	{
+		LOG(error, "[SkinnedMeshRenderable] cannot read " << mesh_filename);
+		return false;
+	}
+	std::vector<glm::uvec4> joints(positions.size(), glm::uvec4(joint, 0, 0, 0));
+	std::vector<glm::vec4> weights(positions.size(), glm::vec4(1, 0, 0, 0));
+	addVertices(positions, normals, tcoords, indices, joints, weights);
+	return true;
+}
+
+void SkinnedMeshRenderable::addVertices(const std::vector<glm::vec3>& positions,
+                                        const std::vector<glm::vec3>& normals,
+                                        const std::vector<glm::vec2>& tcoords,
+                                        const std::vector<unsigned int>& indices,
+                                        const std::vector<glm::uvec4>& joints,
+                                        const std::vector<glm::vec4>& weights)
+{
+	unsigned int first = m_positions.size();
+	m_jointBounds.resize(m_skeleton->getJointCount());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		m_positions.push_back(positions[i]);
+		m_normals.push_back(i < normals.size() ? normals[i] : glm::vec3(0, 0, 1));
+		m_tcoords.push_back(i < tcoords.size() ? tcoords[i] : glm::vec2(0));
+		m_colors.push_back(glm::vec4(1));
+
+		// The weights are stored on a byte each: round them, and give the
+		// rounding error to the largest one so that they still sum to one
+		glm::vec4 w = weights[i] / std::max(weights[i].x + weights[i].y + weights[i].z + weights[i].w, 1e-6f);
+		glm::u8vec4 quantized;
+		int sum = 0, largest = 0;
+		for (int k = 0; k < 4; ++k)
+		{
+			quantized[k] = glm::u8(w[k] * 255.0f + 0.5f);
+			sum += quantized[k];
+			if (w[k] > w[largest])
+				largest = k;
+		}
+		quantized[largest] += 255 - sum;
+		m_weights.push_back(quantized);
+		m_joints.push_back(glm::u8vec4(joints[i]));
+
+		// A vertex moves with each joint it is bound to
+		for (int k = 0; k < 4; ++k)
+		{
+			if (quantized[k] == 0 || joints[i][k] >= m_jointBounds.size())
+				continue;
+			BoundingBox& bounds = m_jointBounds[joints[i][k]];
+			if (bounds.isValid())
+				bounds.extend(positions[i]);
+			else
+				bounds = BoundingBox(positions[i], positions[i]);
+		}
+	}
+	for (unsigned int index : indices)
+		m_indices.push_back(first + index);
+	m_original_tcoords = m_tcoords;
+
+	update_positions_buffer();
+	update_colors_buffer();
+	update_normals_buffer();
+	update_indices_buffer();
+	update_tcoords_buffer();
+	update_skin_buffers();
+	update_pose_bounds();
+}
+
+void SkinnedMeshRenderable::update_skin_buffers()
+{
+	glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_jBuffer));
+	glcheck(glBufferData(GL_ARRAY_BUFFER, m_joints.size() * sizeof(glm::u8vec4), m_joints.data(), GL_STATIC_DRAW));
+	glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_wBuffer));
+	glcheck(glBufferData(GL_ARRAY_BUFFER, m_weights.size() * sizeof(glm::u8vec4), m_weights.data(), GL_STATIC_DRAW));
+}
+
+void SkinnedMeshRenderable::update_pose_bounds()
+{
+	// Until the first animation step, the mesh is in the rest pose of the skeleton
+	if (m_palette.size() != m_skeleton->getJointCount())
+		m_skeleton->computePalette(0.0f, m_palette);
+
+	BoundingBox bounds;
+	for (size_t j = 0; j < m_jointBounds.size() && j < m_palette.size(); ++j)
+	{
+		if (!m_jointBounds[j].isValid())
+			continue;
+		BoundingBox jointBounds = m_jointBounds[j].transformed(m_palette[j]);
+		if (bounds.isValid())
+			bounds.extend(jointBounds);
+		else
+			bounds = jointBounds;
+	}
+	setLocalBounds(bounds);
+}
+
+const SkeletonPtr& SkinnedMeshRenderable::getSkeleton() const
+{
+	return m_skeleton;
+}
+
+const MaterialPtr& SkinnedMeshRenderable::getMaterial() const
+{
+	return m_material;
+}
+
+void SkinnedMeshRenderable::setMaterial(const MaterialPtr& material)
+{
+	m_material = material;
+}
+
+bool SkinnedMeshRenderable::getAnimationRange(float& begin, float& end) const
+{
+	float meshBegin, meshEnd, skeletonBegin, skeletonEnd;
+	bool mesh = KeyframedHierarchicalRenderable::getAnimationRange(meshBegin, meshEnd);
+	bool skeleton = m_skeleton->getAnimationRange(skeletonBegin, skeletonEnd) && skeletonBegin < skeletonEnd;
+	if (mesh && skeleton)
+	{
+		begin = std::min(meshBegin, skeletonBegin);
+		end = std::max(meshEnd, skeletonEnd);
+	}
+	else if (mesh || skeleton)
+	{
+		begin = mesh ? meshBegin : skeletonBegin;
+		end = mesh ? meshEnd : skeletonEnd;
+	}
+	else
+	{
+		begin = end = 0;
+	}
+	return mesh || skeleton;
+}
+
+bool SkinnedMeshRenderable::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	return KeyframedHierarchicalRenderable::intersectRay(origin, direction, distance);
+}
+
+void SkinnedMeshRenderable::do_animate(float time)
+{
+	KeyframedHierarchicalRenderable::do_animate(time);
+	m_skeleton->computePalette(time, m_palette);
+	update_pose_bounds();
+}
+
+void SkinnedMeshRenderable::do_draw()
+{
+	// Send the palette to its uniform block
+	unsigned int program = m_shaderProgram->programId();
+	GLuint block = glGetUniformBlockIndex(program, "JointPalette");
+	if (block != GL_INVALID_INDEX)
+	{
+		size_t count = std::min<size_t>(m_palette.size(), Skeleton::max_joints);
+		glcheck(glBindBuffer(GL_UNIFORM_BUFFER, m_paletteBuffer));
+		glcheck(glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(glm::mat4), m_palette.data()));
+		glcheck(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+		glcheck(glUniformBlockBinding(program, block, joint_palette_binding));
+		glcheck(glBindBufferBase(GL_UNIFORM_BUFFER, joint_palette_binding, m_paletteBuffer));
+	}
+
+	int jointLocation = m_shaderProgram->getAttributeLocation("vJoints");
+	int weightLocation = m_shaderProgram->getAttributeLocation("vWeights");
+	if (jointLocation != ShaderProgram::null_location)
+	{
+		glcheck(glEnableVertexAttribArray(jointLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_jBuffer));
+		glcheck(glVertexAttribIPointer(jointLocation, 4, GL_UNSIGNED_BYTE, 0, (void*)0));
+	}
+	if (weightLocation != ShaderProgram::null_location)
+	{
+		glcheck(glEnableVertexAttribArray(weightLocation));
+		glcheck(glBindBuffer(GL_ARRAY_BUFFER, m_wBuffer));
+		glcheck(glVertexAttribPointer(weightLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (void*)0));
+	}
+
+	Material::sendToGPU(m_shaderProgram, m_material);
+	TexturedMeshRenderable::do_draw();
+
+	if (jointLocation != ShaderProgram::null_location)
+		glcheck(glDisableVertexAttribArray(jointLocation));
+	if (weightLocation != ShaderProgram::null_location)
+		glcheck(glDisableVertexAttribArray(weightLocation));
+}
@@ -17,8 +17,9 @@ TexturedLightedMeshRenderable::TexturedLightedMeshRenderable(
     ShaderProgramPtr program,
     const std::string& mesh_filename,
     const MaterialPtr& material,
-    const std::string& texture_filename) : TexturedMeshRenderable(program, mesh_filename, texture_filename),
-                                           m_material(material)
+    const std::string& texture_filename,
+    bool deferred) : TexturedMeshRenderable(program, mesh_filename, texture_filename, deferred),
+                     m_material(material)
 {
 }
 
@@ -30,23 +30,61 @@ TexturedMeshRenderable::~TexturedMeshRenderable()
 TexturedMeshRenderable::TexturedMeshRenderable(
     ShaderProgramPtr program,
     const std::string& mesh_filename,
-    const std::string& texture_filename) : MeshRenderable(program, mesh_filename),  // Should initialize m_tcoords trought read_obj...
-                                           m_tBuffer(0),
-                                           m_texId(0),
-                                           m_wrap_option(0),
-                                           m_filter_option(0)
+    const std::string& texture_filename,
+    bool deferred) : MeshRenderable(program, mesh_filename, true),  // The textured mesh loads itself, with its image
+                     m_tBuffer(0),
+                     m_texId(0),
+                     m_textureFilename(texture_filename),
+                     m_wrap_option(0),
+                     m_filter_option(0)
 {
-	m_image.loadFromFile(texture_filename);
+	gen_buffers();
+	if (!deferred)
+		load();
+}
+
+void TexturedMeshRenderable::prefetch()
+{
+	if (m_prefetched)
+		return;
+	MeshRenderable::prefetch();
+
+	m_image.loadFromFile(m_textureFilename);
 	if (m_tcoords.size() != m_positions.size())
 	{
 		m_tcoords.resize(m_positions.size(), glm::vec2(0.0));
 	}
-	m_original_tcoords = m_tcoords;  // m_tcoords is already loaded from MeshRenderable ctor
+	m_original_tcoords = m_tcoords;  // m_tcoords is already loaded by MeshRenderable::prefetch()
 	m_image.flipVertically();
-	gen_buffers();
+}
+
+void TexturedMeshRenderable::load()
+{
+	if (m_resident)
+		return;
+	MeshRenderable::load();
 	update_buffers();
 }
 
+void TexturedMeshRenderable::release()
+{
+	if (m_textureFilename.empty() || !m_prefetched)
+		return;
+	bool resident = m_resident;
+	MeshRenderable::release();
+
+	m_image = sf::Image();
+	std::vector<glm::vec2>().swap(m_original_tcoords);
+	if (resident)
+	{
+		// An empty texture frees the memory of the GPU, without reading the released image
+		update_tcoords_buffer();
+		glcheck(glBindTexture(GL_TEXTURE_2D, m_texId));
+		glcheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+		glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+	}
+}
+
 TexturedMeshRenderable::TexturedMeshRenderable(
     ShaderProgramPtr program,
     const std::vector<glm::vec3>& positions,
@@ -135,6 +173,10 @@ void TexturedMeshRenderable::update_tcoords_buffer()
 
 void TexturedMeshRenderable::do_draw()
 {
+	// Loaded before its texture is bound, see MeshRenderable::do_draw()
+	if (!m_resident)
+		load();
+
 	// Location
 	int texcoordLocation = m_shaderProgram->getAttributeLocation("vTexCoord");
 	int texsamplerLocation = m_shaderProgram->getUniformLocation("texSampler");
@@ -0,0 +1,174 @@
+#include "../../include/texturing/VertexAnimatedMeshRenderable.hpp"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../../include/gl_helper.hpp"
+#include "./../../include/Io.hpp"
+#include "./../../include/log.hpp"
+
+const unsigned int VertexAnimatedMeshRenderable::texture_width = 4096;
+
+VertexAnimatedMeshRenderable::~VertexAnimatedMeshRenderable()
+{
+	glcheck(glDeleteTextures(1, &m_frameTexture));
+}
+
+VertexAnimatedMeshRenderable::VertexAnimatedMeshRenderable(ShaderProgramPtr program,
+                                                           const std::string& mesh_filename,
+                                                           const std::string& texture_filename) : TexturedMeshRenderable(program, mesh_filename, texture_filename),
+                                                                                                  m_frameCount(0),
+                                                                                                  m_framesChanged(false),
+                                                                                                  m_frameRate(30.0f),
+                                                                                                  m_startTime(0.0f),
+                                                                                                  m_loop(true),
+                                                                                                  m_currentFrames(0, 0),
+                                                                                                  m_blend(0.0f),
+                                                                                                  m_frameTexture(0)
+{
+	glcheck(glGenTextures(1, &m_frameTexture));
+}
+
+bool VertexAnimatedMeshRenderable::addFrame(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals)
+{
+	if (positions.size() != m_positions.size())
+	{
+		LOG(error, "[VertexAnimatedMeshRenderable] the frame " << m_frameCount << " does not have the vertices of the mesh");
+		return false;
+	}
+	const std::vector<glm::vec3>& frameNormals = normals.size() == positions.size() ? normals : m_normals;
+	for (const glm::vec3& p : positions)
+		m_frames.push_back(glm::vec4(p, 1.0f));
+	for (size_t v = 0; v < positions.size(); ++v)
+		m_frames.push_back(glm::vec4(v < frameNormals.size() ? frameNormals[v] : glm::vec3(0, 0, 1), 0.0f));
+	++m_frameCount;
+	m_framesChanged = true;
+
+	// The bounds contain the mesh and all the frames
+	BoundingBox bounds(positions);
+	if (m_localBounds.isValid())
+		bounds.extend(m_localBounds);
+	setLocalBounds(bounds);
+	animationChanged();
+	return true;
+}
+
+bool VertexAnimatedMeshRenderable::addFrameFromFile(const std::string& mesh_filename)
+{
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> tcoords;
+	std::vector<unsigned int> indices;
+	if (!read_obj(mesh_filename, positions, indices, normals, tcoords))
+	{
+		LOG(error, "[VertexAnimatedMeshRenderable] cannot read " << mesh_filename);
+		return false;
+	}
+	return addFrame(positions, normals);
+}
+
+size_t VertexAnimatedMeshRenderable::getFrameCount() const
+{
+	return m_frameCount;
+}
+
+void VertexAnimatedMeshRenderable::setPlayback(float frameRate, float startTime, bool loop)
+{
+	m_frameRate = frameRate;
+	m_startTime = startTime;
+	m_loop = loop;
+	animationChanged();
+}
+
+void VertexAnimatedMeshRenderable::update_frame_texture()
+{
+	// The texels are wrapped in rows of texture_width
+	size_t texels = m_frames.size();
+	size_t height = (texels + texture_width - 1) / texture_width;
+	std::vector<glm::vec4> data(height * texture_width, glm::vec4(0));
+	std::copy(m_frames.begin(), m_frames.end(), data.begin());
+
+	glcheck(glBindTexture(GL_TEXTURE_2D, m_frameTexture));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	glcheck(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	glcheck(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, texture_width, height, 0, GL_RGBA, GL_FLOAT, data.data()));
+	glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+	m_framesChanged = false;
+}
+
+bool VertexAnimatedMeshRenderable::getAnimationRange(float& begin, float& end) const
+{
+	float meshBegin, meshEnd;
+	bool mesh = KeyframedHierarchicalRenderable::getAnimationRange(meshBegin, meshEnd);
+	if (m_frameCount < 2)
+	{
+		begin = meshBegin;
+		end = meshEnd;
+		return mesh;
+	}
+	float framesEnd = m_loop ? std::numeric_limits<float>::infinity() : m_startTime + (m_frameCount - 1) / m_frameRate;
+	begin = mesh ? std::min(meshBegin, m_startTime) : m_startTime;
+	end = mesh ? std::max(meshEnd, framesEnd) : framesEnd;
+	return true;
+}
+
+bool VertexAnimatedMeshRenderable::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& distance)
+{
+	return KeyframedHierarchicalRenderable::intersectRay(origin, direction, distance);
+}
+
+void VertexAnimatedMeshRenderable::do_animate(float time)
+{
+	KeyframedHierarchicalRenderable::do_animate(time);
+	if (m_frameCount == 0)
+		return;
+
+	float frame = std::max(0.0f, (time - m_startTime) * m_frameRate);
+	if (m_loop)
+		frame = std::fmod(frame, float(m_frameCount));
+	else
+		frame = std::min(frame, float(m_frameCount - 1));
+	int first = std::min(int(frame), int(m_frameCount) - 1);
+	// A loop goes from the last frame back to the first one
+	int second = first + 1 < int(m_frameCount) ? first + 1 : (m_loop ? 0 : first);
+	m_currentFrames = glm::ivec2(first, second);
+	m_blend = frame - first;
+}
+
+void VertexAnimatedMeshRenderable::do_draw()
+{
+	if (m_framesChanged)
+		update_frame_texture();
+
+	int textureLocation = m_shaderProgram->getUniformLocation("vatTexture");
+	int vertexCountLocation = m_shaderProgram->getUniformLocation("vatVertexCount");
+	int framesLocation = m_shaderProgram->getUniformLocation("vatFrames");
+	int blendLocation = m_shaderProgram->getUniformLocation("vatBlend");
+
+	if (vertexCountLocation != ShaderProgram::null_location)
+		glcheck(glUniform1i(vertexCountLocation, m_frameCount > 0 ? int(m_positions.size()) : 0));
+	if (framesLocation != ShaderProgram::null_location)
+		glcheck(glUniform2i(framesLocation, m_currentFrames.x, m_currentFrames.y));
+	if (blendLocation != ShaderProgram::null_location)
+		glcheck(glUniform1f(blendLocation, m_blend));
+
+	// The frames are in the texture unit 1, the texture of the mesh in the unit 0
+	if (textureLocation != ShaderProgram::null_location)
+	{
+		glcheck(glActiveTexture(GL_TEXTURE1));
+		glcheck(glBindTexture(GL_TEXTURE_2D, m_frameTexture));
+		glcheck(glUniform1i(textureLocation, 1));
+		glcheck(glActiveTexture(GL_TEXTURE0));
+	}
+
+	TexturedMeshRenderable::do_draw();
+
+	if (textureLocation != ShaderProgram::null_location)
+	{
+		glcheck(glActiveTexture(GL_TEXTURE1));
+		glcheck(glBindTexture(GL_TEXTURE_2D, 0));
+		glcheck(glActiveTexture(GL_TEXTURE0));
+	}
+}